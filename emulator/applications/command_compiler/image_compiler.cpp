@@ -0,0 +1,184 @@
+#include "image_compiler.h"
+
+#include "printer_file_manager.h"
+#include "printer_memory_manager.h"
+#include "sdcard_mock.h"
+#include "ff.h"
+
+#include <algorithm>
+
+// size of the source volume for small files, enough for FAT file system structures
+static const size_t s_min_sectors = 4096;
+
+ImageCompiler::ImageCompiler(const GCodeAxisConfig& axis_config, uint16_t max_fetch_speed)
+    : m_axis_config(axis_config)
+    , m_max_fetch_speed(max_fetch_speed)
+    , m_control_block{ 0 }
+{
+}
+
+PRINTER_STATUS ImageCompiler::Compile(const std::string& file_name, const std::vector<char>& content, GCODE_STORAGE_FORMAT format)
+{
+    m_image.clear();
+    m_error.clear();
+    m_control_block = { 0 };
+    m_max_deviation = 0;
+
+    if (file_name.empty() || file_name.size() >= FILE_NAME_LEN)
+    {
+        m_error = "File name should contain 1 to " + std::to_string(FILE_NAME_LEN - 1) + " symbols";
+        return PRINTER_FILE_NOT_FOUND;
+    }
+
+    // every line produces no more than one command
+    size_t lines = std::count(content.begin(), content.end(), '\n') + 1;
+    size_t command_sectors = lines * std::max<size_t>(GCODE_CHUNK_SIZE, GCODE_COMPACT_MAX_SIZE) / SDcardMock::s_sector_size + 2;
+    SDcardMock sdcard(s_min_sectors + 2 * content.size() / SDcardMock::s_sector_size);
+    SDcardMock ram(CONTROL_BLOCK_POSITION + 1 + command_sectors);
+
+    // file manager reads the file through the file system, the same way as the printer does
+    FATFS fatfs;
+    FIL file;
+    MKFS_PARM fs_params = { FM_ANY, 1, 0, 0, SDcardMock::s_sector_size };
+    std::vector<uint8_t> working_buffer(SDcardMock::s_sector_size);
+    SDCARD_FAT_Register(&sdcard, 0);
+
+    // control block stores fixed size name
+    char name[FILE_NAME_LEN] = { 0 };
+    std::copy(file_name.begin(), file_name.end(), name);
+
+    uint32_t bytes_written = 0;
+    bool file_created = FR_OK == f_mkfs("0", &fs_params, working_buffer.data(), (UINT)working_buffer.size()) &&
+                        FR_OK == f_mount(&fatfs, "", 0) &&
+                        FR_OK == f_open(&file, name, FA_CREATE_NEW | FA_WRITE) &&
+                        FR_OK == f_write(&file, content.data(), (UINT)content.size(), &bytes_written) &&
+                        FR_OK == f_close(&file) &&
+                        bytes_written == content.size();
+
+    PRINTER_STATUS status = PRINTER_OK;
+    if (!file_created)
+    {
+        m_error = "Source file system cannot be created";
+        status = PRINTER_SDCARD_FAILURE;
+    }
+
+    MemoryManager memory = { 0 };
+    HGCODE gcode = nullptr;
+    HFILEMANAGER file_manager = nullptr;
+    if (PRINTER_OK == status)
+    {
+        MemoryManagerConfigure(&memory);
+        gcode = GC_Configure(&m_axis_config, m_max_fetch_speed);
+        file_manager = memory.memory_pool && gcode ? FileManagerConfigure(&sdcard, &ram, &memory, gcode, nullptr, &file, nullptr) : nullptr;
+        if (!file_manager)
+        {
+            m_error = "Not enough device memory";
+            status = PRINTER_RAM_FAILURE;
+        }
+    }
+
+    if (PRINTER_OK == status)
+    {
+        FileManagerSetStorageFormat(file_manager, format);
+        FileManagerSetCoalescing(file_manager, m_coalescing_tolerance);
+        FileManagerSetSimplification(file_manager, m_simplification_tolerance);
+        FileManagerSetHeatingOverlap(file_manager, m_overlap_heating);
+        FileManagerSetAccelerationProfile(file_manager, m_acceleration_profile);
+        size_t blocks = FileManagerOpenGCode(file_manager, name);
+        if (!blocks)
+        {
+            m_error = "File is empty";
+            status = PRINTER_FILE_NOT_GCODE;
+        }
+
+        for (size_t i = 0; i < blocks && PRINTER_OK == status; ++i)
+        {
+            status = FileManagerReadGCodeBlock(file_manager);
+        }
+
+        if (PRINTER_OK == status)
+        {
+            status = FileManagerCloseGCode(file_manager);
+            m_max_deviation = FileManagerGetMaxDeviation(file_manager);
+        }
+        else if (PRINTER_FILE_NOT_GCODE == status && FileManagerGetError(file_manager))
+        {
+            m_error = std::string("Invalid command: ") + FileManagerGetError(file_manager);
+        }
+    }
+
+    f_mount(0, "", 0);
+    SDcardMock::ResetFS();
+
+    if (PRINTER_OK != status)
+    {
+        return status;
+    }
+
+    const uint8_t* data = (const uint8_t*)ram.GetMemoryPtr();
+    m_control_block = *(const PrinterControlBlock*)(data + CONTROL_BLOCK_POSITION * SDcardMock::s_sector_size);
+
+    uint32_t sectors = m_control_block.file_sector - CONTROL_BLOCK_POSITION +
+        getCommandSectors(data + m_control_block.file_sector * SDcardMock::s_sector_size,
+                          (uint32_t)ram.GetBlocksNumber() - m_control_block.file_sector);
+
+    const uint8_t* image = data + CONTROL_BLOCK_POSITION * SDcardMock::s_sector_size;
+    m_image.assign(image, image + sectors * SDcardMock::s_sector_size);
+    return PRINTER_OK;
+}
+
+uint32_t ImageCompiler::getCommandSectors(const uint8_t* first_sector, uint32_t max_sectors) const
+{
+    if (GCODE_FORMAT_COMPACT != m_control_block.storage_format)
+    {
+        return (m_control_block.commands_count * GCODE_CHUNK_SIZE + SDcardMock::s_sector_size - 1) / SDcardMock::s_sector_size;
+    }
+
+    // compact sectors contain variable number of commands, stored in the sector header
+    uint32_t sectors = 0;
+    for (uint32_t commands = 0; commands < m_control_block.commands_count && sectors < max_sectors; ++sectors)
+    {
+        commands += first_sector[sectors * SDcardMock::s_sector_size];
+    }
+    return sectors;
+}
+
+void ImageCompiler::SetCoalescing(float tolerance)
+{
+    m_coalescing_tolerance = tolerance;
+}
+
+void ImageCompiler::SetSimplification(float tolerance)
+{
+    m_simplification_tolerance = tolerance;
+}
+
+void ImageCompiler::SetHeatingOverlap(bool enable)
+{
+    m_overlap_heating = enable;
+}
+
+void ImageCompiler::SetAccelerationProfile(ACCELERATION_PROFILE profile)
+{
+    m_acceleration_profile = profile;
+}
+
+float ImageCompiler::GetMaxDeviation() const
+{
+    return m_max_deviation;
+}
+
+const std::vector<uint8_t>& ImageCompiler::GetImage() const
+{
+    return m_image;
+}
+
+const PrinterControlBlock& ImageCompiler::GetControlBlock() const
+{
+    return m_control_block;
+}
+
+const std::string& ImageCompiler::GetError() const
+{
+    return m_error;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "include/gcode.h"
+#include "printer_entities.h"
+
+#include <string>
+#include <vector>
+
+// Host side translation of the gcode file to the image of the printer internal storage.
+// The file is translated by the same file manager that printer uses on FILE_TRANSFERING stage,
+// so the image is identical to the data printer creates by itself and can be flashed in one go.
+class ImageCompiler
+{
+public:
+    ImageCompiler(const GCodeAxisConfig& axis_config, uint16_t max_fetch_speed);
+
+    // requires attached device, all internal objects are allocated from the device heap
+    PRINTER_STATUS Compile(const std::string& file_name, const std::vector<char>& content, GCODE_STORAGE_FORMAT format);
+
+    // collinear moves are merged with the tolerance in mm, 0 disables merging
+    void SetCoalescing(float tolerance);
+
+    // points of dense paths are dropped with the tolerance in XYZ steps, 0 disables simplification
+    void SetSimplification(float tolerance);
+
+    // waits for the heaters before the first extruding move are deferred to overlap heating with the preamble
+    void SetHeatingOverlap(bool enable);
+
+    // print time is estimated by the velocity profile executed by the driver
+    void SetAccelerationProfile(ACCELERATION_PROFILE profile);
+
+    // the largest deviation of the dropped points from the simplified path in XYZ steps
+    float GetMaxDeviation() const;
+
+    // image starts with the control block and has to be written from the CONTROL_BLOCK_POSITION sector
+    const std::vector<uint8_t>& GetImage() const;
+    const PrinterControlBlock& GetControlBlock() const;
+    const std::string& GetError() const;
+
+private:
+    uint32_t getCommandSectors(const uint8_t* first_sector, uint32_t max_sectors) const;
+
+    GCodeAxisConfig         m_axis_config;
+    uint16_t                m_max_fetch_speed;
+    float                   m_coalescing_tolerance = 0;
+    float                   m_simplification_tolerance = 0;
+    bool                    m_overlap_heating = false;
+    ACCELERATION_PROFILE    m_acceleration_profile = ACCELERATION_PROFILE_TRAPEZOID;
+    float                   m_max_deviation = 0;
+    PrinterControlBlock     m_control_block;
+    std::vector<uint8_t>    m_image;
+    std::string             m_error;
+};
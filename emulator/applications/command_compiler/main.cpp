@@ -1,13 +1,21 @@
-// material editor and compiler. creates mtl file that can be used to add custom settings for printer
+// commands compiler. interactive mode prints compiled commands as C array,
+// batch mode translates gcode file to the image of the printer internal storage
 #include "device_mock.h"
-#include "include\gcode.h"
+#include "include/gcode.h"
 #include "printer_constants.h"
+#include "sdcard.h"
+#include "image_compiler.h"
+#include "parallel_compiler.h"
 
 #include <iostream>
 #include <iomanip>
+#include <fstream>
+#include <iterator>
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <chrono>
+#include <thread>
 
 std::string GetError(GCODE_ERROR error)
 {
@@ -20,9 +28,134 @@ std::string GetError(GCODE_ERROR error)
     return "Unknown";
 }
 
+template <class Compiler>
+int CompileImage(Compiler& compiler, const std::string& source, const std::string& target, GCODE_STORAGE_FORMAT format, float tolerance, float simplification, bool overlap_heating,
+    ACCELERATION_PROFILE profile)
+{
+    std::ifstream input(source, std::ios::binary);
+    if (!input)
+    {
+        std::cout << "File " << source << " cannot be opened\n";
+        return 1;
+    }
+    std::vector<char> content((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+    // file manager, parser and memory pages are allocated from the device heap
+    DeviceSettings ds;
+    Device device(ds);
+    AttachDevice(device);
+
+    // control block keeps file name without path
+    std::string file_name = source.substr(source.find_last_of("/\\") + 1);
+
+    compiler.SetCoalescing(tolerance);
+    compiler.SetSimplification(simplification);
+    compiler.SetHeatingOverlap(overlap_heating);
+    compiler.SetAccelerationProfile(profile);
+    auto start = std::chrono::steady_clock::now();
+    PRINTER_STATUS status = compiler.Compile(file_name, content, format);
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    DetachDevice();
+    if (PRINTER_OK != status)
+    {
+        std::cout << "Compilation failed with status " << status << ": " << compiler.GetError() << "\n";
+        return 1;
+    }
+
+    std::ofstream output(target, std::ios::binary);
+    const std::vector<uint8_t>& image = compiler.GetImage();
+    if (!output.write((const char*)image.data(), image.size()))
+    {
+        std::cout << "File " << target << " cannot be written, check permissions of the target directory.\n";
+        return 1;
+    }
+
+    const PrinterControlBlock& control_block = compiler.GetControlBlock();
+    std::cout << "Commands: " << control_block.commands_count << " of " << control_block.source_commands_count
+              << " source commands, compiled in " << elapsed << " ms\n";
+    if (simplification > 0)
+    {
+        std::cout << "Max deviation of simplified paths: " << compiler.GetMaxDeviation() << " steps\n";
+    }
+    uint32_t seconds = control_block.print_time / MAIN_TIMER_FREQUENCY;
+    std::cout << "Estimated print time: " << seconds / 3600 << ":" << std::setfill('0') << std::setw(2) << seconds / 60 % 60
+              << ":" << std::setw(2) << seconds % 60 << std::setfill(' ') << "\n";
+    std::cout << "Image: " << image.size() / SDCARD_BLOCK_SIZE << " sectors, to be written from sector " << CONTROL_BLOCK_POSITION << "\n";
+    return 0;
+}
+
+// usage: CommandCompiler <file.gcode> <image.bin> [--compact] [--coalesce MM] [--simplify STEPS] [--overlap-heating] [--scurve] [--threads N] [--sequential]
+//  --compact         store commands in GCODE_FORMAT_COMPACT
+//  --coalesce MM     merge collinear moves deviating from the line by no more than MM millimeters
+//  --simplify STEPS  drop points of dense paths deviating from the simplified path by no more than STEPS
+//  --overlap-heating defer waits for the heaters to the first extruding move, so homing overlaps heating
+//  --scurve          estimate the print time for the printer configured with ACCELERATION_PROFILE_SCURVE
+//  --threads N       amount of compilation threads, all cores are used by default
+//  --sequential      compile by the printer file manager in a single thread
+int BatchMode(int argc, char** argv)
+{
+    GCODE_STORAGE_FORMAT format = GCODE_FORMAT_CHUNKS;
+    size_t threads = std::thread::hardware_concurrency();
+    bool sequential = false;
+    float tolerance = 0;
+    float simplification = 0;
+    bool overlap_heating = false;
+    ACCELERATION_PROFILE profile = ACCELERATION_PROFILE_TRAPEZOID;
+    for (int i = 3; i < argc; ++i)
+    {
+        std::string option = argv[i];
+        if (option == "--compact")
+        {
+            format = GCODE_FORMAT_COMPACT;
+        }
+        else if (option == "--coalesce" && i + 1 < argc)
+        {
+            tolerance = std::stof(argv[++i]);
+        }
+        else if (option == "--simplify" && i + 1 < argc)
+        {
+            simplification = std::stof(argv[++i]);
+        }
+        else if (option == "--overlap-heating")
+        {
+            overlap_heating = true;
+        }
+        else if (option == "--scurve")
+        {
+            profile = ACCELERATION_PROFILE_SCURVE;
+        }
+        else if (option == "--threads" && i + 1 < argc)
+        {
+            threads = std::stoul(argv[++i]);
+        }
+        else if (option == "--sequential")
+        {
+            sequential = true;
+        }
+        else
+        {
+            std::cout << "Unknown option " << option << "\n";
+            return 1;
+        }
+    }
+
+    if (sequential)
+    {
+        ImageCompiler compiler(axis_configuration, MAX_FETCH_SPEED);
+        return CompileImage(compiler, argv[1], argv[2], format, tolerance, simplification, overlap_heating, profile);
+    }
+    ParallelCompiler compiler(axis_configuration, MAX_FETCH_SPEED, threads);
+    return CompileImage(compiler, argv[1], argv[2], format, tolerance, simplification, overlap_heating, profile);
+}
+
 int main(int argc, char** argv)
 {
     std::cout << "Commands Compiler v0.0.0\n";
+    if (argc >= 3)
+    {
+        return BatchMode(argc, argv);
+    }
+
     std::string command;
     std::vector<std::string> commands;
 
@@ -0,0 +1,420 @@
+#include "parallel_compiler.h"
+
+#include "printer_math.h"
+#include "printer_planner.h"
+#include "printer_pipeline.h"
+#include "printer_estimator.h"
+#include "sdcard.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+namespace
+{
+    // default amount of chunks per thread, more chunks balance threads better
+    const size_t s_chunks_per_thread = 4;
+
+    // The same planning as the file manager does: moves are added to the plan, other commands stop the head
+    void planCommand(MotionPlanner& planner, GCodeCommandParams& previous_point, uint8_t* command)
+    {
+        if (!(*(uint32_t*)command & GCODE_COMMAND))
+        {
+            PlannerStop(&planner);
+            return;
+        }
+
+        ExtendedGCodeCommandParams* point = (ExtendedGCodeCommandParams*)(command + sizeof(parameterType));
+        switch (command[0])
+        {
+        case GCODE_MOVE:
+        case GCODE_HOME:
+            if (point->segment_time)
+            {
+                GCodeCommandParams segment = {
+                    point->g.x - previous_point.x,
+                    point->g.y - previous_point.y,
+                    point->g.z - previous_point.z,
+                    point->g.e - previous_point.e,
+                    point->g.fetch_speed
+                };
+                PlannerAddSegment(&planner, &segment, point->segment_time, (uint8_t*)&point->entry_speed);
+            }
+            previous_point = point->g;
+            break;
+        case GCODE_SET:
+            previous_point = point->g;
+            // fall through
+        default:
+            PlannerStop(&planner);
+            break;
+        }
+    }
+}
+
+ParallelCompiler::ParallelCompiler(const GCodeAxisConfig& axis_config, uint16_t max_fetch_speed, size_t threads, size_t chunk_size)
+    : m_axis_config(axis_config)
+    , m_max_fetch_speed(max_fetch_speed)
+    , m_threads(std::max<size_t>(threads, 1))
+    , m_chunk_size(chunk_size)
+    , m_control_block{ 0 }
+{
+}
+
+PRINTER_STATUS ParallelCompiler::Compile(const std::string& file_name, const std::vector<char>& content, GCODE_STORAGE_FORMAT format)
+{
+    m_image.clear();
+    m_error.clear();
+    m_control_block = { 0 };
+    m_max_deviation = 0;
+
+    if (file_name.empty() || file_name.size() >= FILE_NAME_LEN)
+    {
+        m_error = "File name should contain 1 to " + std::to_string(FILE_NAME_LEN - 1) + " symbols";
+        return PRINTER_FILE_NOT_FOUND;
+    }
+
+    if (content.empty())
+    {
+        m_error = "File is empty";
+        return PRINTER_FILE_NOT_GCODE;
+    }
+
+    if (!m_parser)
+    {
+        m_parser = GC_Configure(&m_axis_config, m_max_fetch_speed);
+        if (!m_parser)
+        {
+            m_error = "Not enough device memory";
+            return PRINTER_RAM_FAILURE;
+        }
+    }
+
+    // every line changes the modal state of the parser, so the chunks are parsed in the order of the file
+    // by the same parser as the file manager uses
+    splitChunks(content);
+    GC_Reset(m_parser, 0);
+    for (Chunk& chunk : m_chunks)
+    {
+        parseChunk(chunk, content);
+        if (GCODE_OK_NO_COMMAND != chunk.error)
+        {
+            m_error = "Invalid command: " + chunk.error_line;
+            return PRINTER_FILE_NOT_GCODE;
+        }
+    }
+
+    // previous points are taken from the commands of the previous chunks, they should be found before the processing
+    runParallel(m_chunks.size(), [&](size_t index, size_t) { findPreviousPoint(index); });
+    runParallel(m_chunks.size(), [&](size_t index, size_t) { processChunk(m_chunks[index]); });
+    return writeImage(file_name, format);
+}
+
+void ParallelCompiler::splitChunks(const std::vector<char>& content)
+{
+    size_t chunk_size = m_chunk_size ? m_chunk_size : content.size() / (m_threads * s_chunks_per_thread) + 1;
+
+    m_chunks.clear();
+    for (size_t begin = 0; begin < content.size();)
+    {
+        size_t end = std::min(begin + chunk_size, content.size());
+        const char* line_end = (const char*)memchr(content.data() + end - 1, '\n', content.size() - end + 1);
+        end = line_end ? line_end - content.data() + 1 : content.size();
+
+        Chunk chunk;
+        chunk.begin = begin;
+        chunk.end = end;
+        m_chunks.push_back(std::move(chunk));
+        begin = end;
+    }
+}
+
+// parser continues from the state of the previous chunk
+void ParallelCompiler::parseChunk(Chunk& chunk, const std::vector<char>& content)
+{
+    // parser modifies the text
+    std::vector<char> text(content.begin() + chunk.begin, content.begin() + chunk.end);
+    GCodeBuffer input = { text.data(), (uint32_t)text.size(), 0, true, nullptr };
+
+    size_t size = 0;
+    chunk.commands.resize((text.size() / 16 + 1) * GCODE_CHUNK_SIZE);
+    do
+    {
+        if (chunk.commands.size() - size < GCODE_CHUNK_SIZE)
+        {
+            chunk.commands.resize(chunk.commands.size() * 2);
+        }
+        uint32_t bytes_written = 0;
+        chunk.error = GC_ParseBuffer(m_parser, &input, chunk.commands.data() + size, (uint32_t)(chunk.commands.size() - size), &bytes_written);
+        size += bytes_written;
+    }
+    while (GCODE_OK_COMMAND_CREATED == chunk.error);
+
+    chunk.commands.resize(size);
+    if (GCODE_OK_NO_COMMAND != chunk.error)
+    {
+        chunk.error_line = input.line ? input.line : "";
+    }
+}
+
+// Finds the last point before the chunk, move, home and set commands are points
+void ParallelCompiler::findPreviousPoint(size_t index)
+{
+    Chunk& chunk = m_chunks[index];
+    chunk.previous_point = { 0 };
+
+    for (size_t c = index; c-- > 0;)
+    {
+        const std::vector<uint8_t>& commands = m_chunks[c].commands;
+        for (size_t offset = commands.size(); offset > 0;)
+        {
+            offset -= GCODE_CHUNK_SIZE;
+            const uint8_t* command = commands.data() + offset;
+            uint8_t command_index = command[0];
+            if (!(*(const uint32_t*)command & GCODE_COMMAND) || GCODE_SAVE_POSITION == command_index || GCODE_SAVE_STATE == command_index)
+            {
+                continue;
+            }
+
+            chunk.previous_point = *(const GCodeCommandParams*)(command + sizeof(parameterType));
+            if (GCODE_HOME == command_index)
+            {
+                chunk.previous_point.fetch_speed = 1800;
+            }
+            return;
+        }
+    }
+}
+
+// The same calculation of the segment times as the file manager does, speeds are planned by writeImage
+void ParallelCompiler::processChunk(Chunk& chunk)
+{
+    GCodeCommandParams previous_point = chunk.previous_point;
+
+    for (size_t offset = 0; offset < chunk.commands.size(); offset += GCODE_CHUNK_SIZE)
+    {
+        uint8_t* command = chunk.commands.data() + offset;
+        if (!(*(uint32_t*)command & GCODE_COMMAND))
+        {
+            continue;
+        }
+
+        ExtendedGCodeCommandParams* point = (ExtendedGCodeCommandParams*)(command + sizeof(parameterType));
+        switch (command[0])
+        {
+        case GCODE_HOME:
+            point->g.fetch_speed = 1800;
+            // fall through
+        case GCODE_MOVE:
+            point->entry_speed = 0;
+            point->exit_speed = 0;
+            point->segment_time = CalculateSegmentTime(&m_axis_config, &point->g, &previous_point);
+            previous_point = point->g;
+            break;
+        case GCODE_SET:
+            previous_point = point->g;
+            break;
+        }
+    }
+}
+
+PRINTER_STATUS ParallelCompiler::writeImage(const std::string& file_name, GCODE_STORAGE_FORMAT format)
+{
+    m_control_block.secure_id = CONTROL_BLOCK_SEC_CODE;
+    m_control_block.file_sector = CONTROL_BLOCK_POSITION + 1;
+    m_control_block.storage_format = format;
+    std::copy(file_name.begin(), file_name.end(), m_control_block.file_name);
+    for (const Chunk& chunk : m_chunks)
+    {
+        m_control_block.source_commands_count += (uint32_t)(chunk.commands.size() / GCODE_CHUNK_SIZE);
+    }
+
+    // speeds are planned in the same order and with the same window as the file manager does: the window
+    // keeps segments of the current and the previous sectors only. The planner keeps pointers to the image,
+    // so the image is allocated once and the commands which don't fit it fail the compilation. Compact sector
+    // is closed when the largest command doesn't fit, so it keeps at least 14 commands. The heating scheduler
+    // adds up to one wait per heater
+    const size_t commands_per_sector = (GCODE_FORMAT_COMPACT == format) ?
+        (SDCARD_BLOCK_SIZE - GCODE_COMPACT_SECTOR_HEADER - GCODE_COMPACT_MAX_SIZE) / GCODE_COMPACT_MAX_SIZE + 1 :
+        SDCARD_BLOCK_SIZE / GCODE_CHUNK_SIZE;
+    const size_t max_commands = m_control_block.source_commands_count + TERMO_REGULATOR_COUNT;
+    m_image.assign(SDCARD_BLOCK_SIZE * ((max_commands + commands_per_sector - 1) / commands_per_sector + 1), 0);
+    size_t image_size = SDCARD_BLOCK_SIZE;
+    bool overflow = false;
+
+    MotionPlanner planner;
+    PlannerReset(&planner, &m_axis_config);
+    GCodeCommandParams previous_point = { 0 };
+
+    // compact sectors are filled in the same way as the file manager fills them
+    GCodeCompactState compact;
+    size_t sector = 0;
+    size_t size = SDCARD_BLOCK_SIZE;
+    auto storeCommand = [&](uint8_t* command)
+    {
+        ++m_control_block.commands_count;
+        if (overflow)
+        {
+            return;
+        }
+        if (GCODE_FORMAT_COMPACT != format)
+        {
+            size_t offset = image_size;
+            if (offset + GCODE_CHUNK_SIZE > m_image.size())
+            {
+                overflow = true;
+                return;
+            }
+            if (offset > SDCARD_BLOCK_SIZE && 0 == offset % SDCARD_BLOCK_SIZE)
+            {
+                PlannerRelease(&planner, m_image.data() + offset - SDCARD_BLOCK_SIZE, m_image.data() + offset);
+            }
+            memcpy(m_image.data() + offset, command, GCODE_CHUNK_SIZE);
+            image_size += GCODE_CHUNK_SIZE;
+            planCommand(planner, previous_point, m_image.data() + offset);
+            return;
+        }
+
+        if (SDCARD_BLOCK_SIZE - size < GCODE_COMPACT_MAX_SIZE)
+        {
+            if (image_size + SDCARD_BLOCK_SIZE > m_image.size())
+            {
+                overflow = true;
+                return;
+            }
+            PlannerRelease(&planner, m_image.data() + sector, m_image.data() + sector + SDCARD_BLOCK_SIZE);
+            sector = image_size;
+            image_size += SDCARD_BLOCK_SIZE;
+            size = GCODE_COMPACT_SECTOR_HEADER;
+            GC_ResetCompact(&compact);
+        }
+        planCommand(planner, previous_point, command);
+
+        uint8_t* speeds = nullptr;
+        size += GC_EncodeCompact(&compact, command, m_image.data() + sector + size, &speeds);
+        if (speeds)
+        {
+            PlannerSetLocation(&planner, speeds);
+        }
+        ++m_image[sector];
+    };
+
+    // paths are simplified and collinear moves are merged in the same way as the file manager does,
+    // time of the stored move is calculated from the end of the previous stored move
+    const bool rebuild_times = m_coalescing_tolerance > 0 || m_simplification_tolerance > 0;
+    std::function<void(uint8_t*)> storeMove = [&](uint8_t* command)
+    {
+        ExtendedGCodeCommandParams* point = (ExtendedGCodeCommandParams*)(command + sizeof(parameterType));
+        if (rebuild_times && (*(uint32_t*)command & GCODE_COMMAND) && GCODE_MOVE == command[0])
+        {
+            point->segment_time = CalculateSegmentTime(&m_axis_config, &point->g, &previous_point);
+        }
+        storeCommand(command);
+    };
+
+    // commands pass the same pipeline as in the file manager
+    std::vector<uint8_t> window(SIMPLIFIER_WINDOW * GCODE_CHUNK_SIZE);
+    CommandPipeline pipeline;
+    CommandPipelineConfig pipeline_cfg = {
+        &m_axis_config, window.data(), m_simplification_tolerance, m_coalescing_tolerance, m_overlap_heating, &previous_point,
+        [](uint8_t* command, void* store) { (*(std::function<void(uint8_t*)>*)store)(command); }, &storeMove
+    };
+    PipelineReset(&pipeline, &pipeline_cfg);
+
+    for (Chunk& chunk : m_chunks)
+    {
+        for (size_t offset = 0; offset < chunk.commands.size(); offset += GCODE_CHUNK_SIZE)
+        {
+            PipelineAppend(&pipeline, chunk.commands.data() + offset);
+        }
+    }
+    PipelineFlush(&pipeline);
+    if (overflow)
+    {
+        m_image.clear();
+        m_error = "Commands exceed the size of the image";
+        return PRINTER_RAM_FAILURE;
+    }
+    m_max_deviation = pipeline.simplifier.max_deviation;
+
+    m_image.resize((image_size + SDCARD_BLOCK_SIZE - 1) / SDCARD_BLOCK_SIZE * SDCARD_BLOCK_SIZE);
+    estimatePrintTime();
+    memcpy(m_image.data(), &m_control_block, sizeof(m_control_block));
+    return PRINTER_OK;
+}
+
+// The same estimation as the file manager does by the written pages
+void ParallelCompiler::estimatePrintTime()
+{
+    PrintTimeEstimator estimator;
+    EstimatorReset(&estimator, &m_axis_config, m_acceleration_profile, &m_control_block);
+
+    for (size_t sector = SDCARD_BLOCK_SIZE; sector < m_image.size(); sector += SDCARD_BLOCK_SIZE)
+    {
+        EstimatorAddPage(&estimator, &m_control_block, m_image.data() + sector);
+    }
+}
+
+void ParallelCompiler::SetCoalescing(float tolerance)
+{
+    m_coalescing_tolerance = tolerance;
+}
+
+void ParallelCompiler::SetSimplification(float tolerance)
+{
+    m_simplification_tolerance = tolerance;
+}
+
+void ParallelCompiler::SetHeatingOverlap(bool enable)
+{
+    m_overlap_heating = enable;
+}
+
+void ParallelCompiler::SetAccelerationProfile(ACCELERATION_PROFILE profile)
+{
+    m_acceleration_profile = profile;
+}
+
+float ParallelCompiler::GetMaxDeviation() const
+{
+    return m_max_deviation;
+}
+
+void ParallelCompiler::runParallel(size_t count, const std::function<void(size_t index, size_t worker)>& task)
+{
+    std::atomic<size_t> next(0);
+    auto worker = [&](size_t id)
+    {
+        for (size_t index = next++; index < count; index = next++)
+        {
+            task(index, id);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t id = 1; id < std::min(m_threads, count); ++id)
+    {
+        threads.emplace_back(worker, id);
+    }
+    worker(0);
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+const std::vector<uint8_t>& ParallelCompiler::GetImage() const
+{
+    return m_image;
+}
+
+const PrinterControlBlock& ParallelCompiler::GetControlBlock() const
+{
+    return m_control_block;
+}
+
+const std::string& ParallelCompiler::GetError() const
+{
+    return m_error;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "include/gcode.h"
+#include "printer_entities.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Multithreaded host side translation of the gcode file to the image of the printer internal storage.
+// Produces the same image as ImageCompiler:
+//  1. the text is split to chunks on the line boundaries;
+//  2. chunks are parsed and compressed in the order of the file by one parser, which keeps the modal state;
+//  3. segment times are calculated in parallel, the final sequential pass runs the commands through the same CommandPipeline
+//     as the file manager and plans speeds of the segments with the same planner and the same page boundaries.
+class ParallelCompiler
+{
+public:
+    // chunk_size 0 selects the chunk size by the amount of threads
+    ParallelCompiler(const GCodeAxisConfig& axis_config, uint16_t max_fetch_speed, size_t threads, size_t chunk_size = 0);
+
+    // requires attached device, parsers are allocated from the device heap
+    PRINTER_STATUS Compile(const std::string& file_name, const std::vector<char>& content, GCODE_STORAGE_FORMAT format);
+
+    // collinear moves are merged with the tolerance in mm, 0 disables merging
+    void SetCoalescing(float tolerance);
+
+    // points of dense paths are dropped with the tolerance in XYZ steps, 0 disables simplification
+    void SetSimplification(float tolerance);
+
+    // waits for the heaters before the first extruding move are deferred to overlap heating with the preamble
+    void SetHeatingOverlap(bool enable);
+
+    // print time is estimated by the velocity profile executed by the driver
+    void SetAccelerationProfile(ACCELERATION_PROFILE profile);
+
+    // the largest deviation of the dropped points from the simplified path in XYZ steps
+    float GetMaxDeviation() const;
+
+    // image starts with the control block and has to be written from the CONTROL_BLOCK_POSITION sector
+    const std::vector<uint8_t>& GetImage() const;
+    const PrinterControlBlock& GetControlBlock() const;
+    const std::string& GetError() const;
+
+private:
+    struct Chunk
+    {
+        size_t                  begin;
+        size_t                  end;
+        std::vector<uint8_t>    commands;       // compressed commands, GCODE_CHUNK_SIZE each
+        GCODE_ERROR             error;
+        std::string             error_line;
+        GCodeCommandParams      previous_point; // last point before the chunk
+    };
+
+    void splitChunks(const std::vector<char>& content);
+    void parseChunk(Chunk& chunk, const std::vector<char>& content);
+    void findPreviousPoint(size_t index);
+    void processChunk(Chunk& chunk);
+    PRINTER_STATUS writeImage(const std::string& file_name, GCODE_STORAGE_FORMAT format);
+    void estimatePrintTime();
+    void runParallel(size_t count, const std::function<void(size_t index, size_t worker)>& task);
+
+    GCodeAxisConfig         m_axis_config;
+    uint16_t                m_max_fetch_speed;
+    size_t                  m_threads;
+    size_t                  m_chunk_size;
+    float                   m_coalescing_tolerance = 0;
+    float                   m_simplification_tolerance = 0;
+    bool                    m_overlap_heating = false;
+    ACCELERATION_PROFILE    m_acceleration_profile = ACCELERATION_PROFILE_TRAPEZOID;
+    float                   m_max_deviation = 0;
+    HGCODE                  m_parser = nullptr;
+    std::vector<Chunk>      m_chunks;
+    PrinterControlBlock     m_control_block;
+    std::vector<uint8_t>    m_image;
+    std::string             m_error;
+};
@@ -2,11 +2,13 @@
 #include "printer.h"
 #include "printer_memory_manager.h"
 #include "printer_entities.h"
+#include "printer_constants.h"
 #include "include/touch.h"
 #include "include/termal_regulator.h"
 
 #include "printer_interface.h"
 #include "plot_area.h"
+#include "velocity_plot.h"
 
 // device mock
 #include "device_mock.h"
@@ -43,7 +45,7 @@ uint16_t HandleNozzleEnvironmentTick(Device& device, GPIO_TypeDef port, uint16_t
 }
 uint16_t HandleTableEnvironmentTick(Device& device, GPIO_TypeDef port, uint16_t table_value, const uint16_t atm_value)
 {
-    //rever5ced pin state for heat and cool
+    // the code of the table sensor decreases while it is heated
     GPIO_PinState state = device.GetPinState(port, 0).state;
     int16_t multiplier = (GPIO_PIN_SET == state) ? -1 : 1;
     int16_t limit_multiplier = (atm_value < table_value && multiplier < 0) ? 0 : 1;
@@ -88,6 +90,30 @@ int main(int argc, char** argv)
     app.config.hdisplay = &app.display;
 
     MemoryManagerConfigure(&app.config.memory_manager);
+    app.config.prefetch_pages = MEMORY_PAGES_COUNT - 1;
+    app.config.motion_blocks = MOTION_BLOCKS_COUNT;
+
+    // velocity profile of the acceleration is selected by the command line: --scurve or --trapezoid (default),
+    // --overlap-heating defers waits for the heaters of the preamble to the first extruding move,
+    // --preheat heats the heaters to the temperatures of the file while it is transferred
+    app.config.acceleration_profile = ACCELERATION_PROFILE_TRAPEZOID;
+    app.config.overlap_heating = false;
+    app.config.preheat_on_transfer = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::string("--scurve") == argv[i])
+        {
+            app.config.acceleration_profile = ACCELERATION_PROFILE_SCURVE;
+        }
+        else if (std::string("--overlap-heating") == argv[i])
+        {
+            app.config.overlap_heating = true;
+        }
+        else if (std::string("--preheat") == argv[i])
+        {
+            app.config.preheat_on_transfer = true;
+        }
+    }
 
     MKFS_PARM fs_params =
     {
@@ -175,7 +201,7 @@ int main(int argc, char** argv)
             &EXTRUDER_HEATER_CONTROL_GPIO_Port, EXTRUDER_HEATER_CONTROL_Pin, GPIO_PIN_SET, GPIO_PIN_RESET, 0.467f, -1065.f
         },
         {
-            &TABLE_HEATER_CONTROL_GPIO_Port, TABLE_HEATER_CONTROL_Pin, GPIO_PIN_RESET, GPIO_PIN_SET, -0.033f, 141.f
+            &TABLE_HEATER_CONTROL_GPIO_Port, TABLE_HEATER_CONTROL_Pin, GPIO_PIN_SET, GPIO_PIN_RESET, -0.033f, 141.f
         }
     };
     for (int i = 0; i < TERMO_REGULATOR_COUNT; ++i)
@@ -191,10 +217,7 @@ int main(int argc, char** argv)
         {PULSE_LOWER,  &Z_ENG_STEP_GPIO_Port, Z_ENG_STEP_Pin, &Z_ENG_DIR_GPIO_Port, Z_ENG_DIR_Pin },
         {PULSE_LOWER,  &E_ENG_STEP_GPIO_Port, E_ENG_STEP_Pin, &E_ENG_DIR_GPIO_Port, E_ENG_DIR_Pin },
     };
-    for (int i = 0; i < MOTOR_COUNT; ++i)
-    {
-        app.config.motors[i] = MOTOR_Configure(&motor_config[i]);
-    }
+    app.config.steppers = STEPPERGROUP_Configure(motor_config, MOTOR_COUNT);
 
     // configuring nozzle cooler
     app.config.cooler_port = &EXTRUDER_COOLER_CONTROL_GPIO_Port;
@@ -215,8 +238,13 @@ int main(int argc, char** argv)
     RECT plot = { 0, 0, 800, 800 };
     PlotArea plot_area(plot, "Plot area", "PLOT");
 
+    RECT velocity = { 0, 0, 800, 200 };
+    const char* velocity_title = (ACCELERATION_PROFILE_SCURVE == app.config.acceleration_profile) ? "Velocity: S-curve" : "Velocity: trapezoid";
+    VelocityPlot velocity_plot(velocity, velocity_title, "VELOCITY", MAX_FETCH_SPEED);
+
     printer_ui.Show();
     plot_area.Show();
+    velocity_plot.Show();
 
     std::thread thread([&]()
         {
@@ -244,6 +272,12 @@ int main(int argc, char** argv)
                 }
 
                 OnTimer(app.printer);
+
+                // velocity is changed once per acceleration segment
+                if (0 == step % STANDARD_ACCELERATION_SEGMENT)
+                {
+                    velocity_plot.AddSample(GetVelocity(app.printer));
+                }
                 
                 //calculate step using pin state of engine steppers.
                 auto x_state = device.GetPinState(X_ENG_STEP_GPIO_Port, 0);
@@ -278,6 +312,7 @@ int main(int argc, char** argv)
     {
         printer_ui.ProcessMessage();
         plot_area.ProcessMessage();
+        velocity_plot.ProcessMessage();
     }
 
     thread.join();
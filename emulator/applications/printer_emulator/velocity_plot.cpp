@@ -0,0 +1,55 @@
+#include "velocity_plot.h"
+
+VelocityPlot::VelocityPlot(const RECT& wnd_position, const std::string& title, const std::string& name, uint16_t max_velocity)
+    : Window(wnd_position, title, name)
+    , m_max_velocity(max_velocity)
+{
+
+};
+
+void VelocityPlot::onIdle()
+{
+}
+
+LRESULT CALLBACK VelocityPlot::WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
+{
+    switch (message)
+    {
+    case WM_PAINT:
+    {
+        std::lock_guard<std::mutex> guard(m_guard);
+        m_position = 0;
+        return DefWindowProc(hWnd, message, wParam, lParam);
+    }
+    case WM_DESTROY:
+        PostQuitMessage(0);
+        StopMainLoop();
+        break;
+    default:
+        return DefWindowProc(hWnd, message, wParam, lParam);
+    }
+
+    return 0;
+}
+
+void VelocityPlot::AddSample(uint16_t velocity)
+{
+    std::lock_guard<std::mutex> guard(m_guard);
+
+    RECT area;
+    GetClientRect(GetWindowHandle(), &area);
+    if (m_position >= area.right)
+    {
+        // start the next pass over the cleared area
+        m_position = 0;
+        InvalidateRect(GetWindowHandle(), nullptr, TRUE);
+    }
+
+    const int32_t height = area.bottom - 1;
+    const int32_t y = height - height * (velocity < m_max_velocity ? velocity : m_max_velocity) / m_max_velocity;
+
+    HDC hdc = GetDC(GetWindowHandle());
+    SetPixel(hdc, m_position, y, 0x50000000);
+    ReleaseDC(GetWindowHandle(), hdc);
+    ++m_position;
+}
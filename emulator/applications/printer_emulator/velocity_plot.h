@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Window.h"
+#include <mutex>
+
+class VelocityPlot : public Window
+{
+public:
+    VelocityPlot(const RECT& wnd_position, const std::string& title, const std::string& name, uint16_t max_velocity);
+    virtual ~VelocityPlot() {};
+
+    LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam) override;
+    void onIdle() override;
+
+    // adds velocity of the head in mm/min, samples are drawn from left to right and wrap around the window
+    void AddSample(uint16_t velocity);
+
+private:
+    std::mutex m_guard;
+    const uint16_t m_max_velocity;
+    int32_t m_position = 0;
+};
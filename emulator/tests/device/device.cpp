@@ -201,3 +201,33 @@ TEST_F(DeviceSignalsTest, signals_log_reset)
 }
 
 
+
+TEST_F(DeviceSignalsTest, write_port)
+{
+    device->WritePort(0, 0x0005, 0x0002);
+    ASSERT_EQ(device->GetPinState(0, 0).state, GPIO_PIN_SET);
+    ASSERT_EQ(device->GetPinState(0, 1).state, GPIO_PIN_RESET);
+    ASSERT_EQ(device->GetPinState(0, 2).state, GPIO_PIN_SET);
+    ASSERT_EQ(device->GetPinState(0, 1).signals_log.size(), 1);
+    // pins out of masks are not changed
+    ASSERT_EQ(device->GetPinState(0, 3).signals_log.size(), 0);
+}
+
+TEST_F(DeviceSignalsTest, write_port_set_has_priority)
+{
+    device->WritePort(0, 0x0002, 0x0002);
+    ASSERT_EQ(device->GetPinState(0, 1).state, GPIO_PIN_SET);
+}
+
+TEST_F(DeviceSignalsTest, port_writes_count)
+{
+    device->WritePort(1, 0x00F0, 0x000F);
+    ASSERT_EQ(1, device->GetPortWritesCount(1));
+    device->WritePin(1, 1, GPIO_PIN_SET);
+    device->TogglePin(1, 1);
+    ASSERT_EQ(3, device->GetPortWritesCount(1));
+    ASSERT_EQ(0, device->GetPortWritesCount(0));
+
+    device->ResetPortWritesCount(1);
+    ASSERT_EQ(0, device->GetPortWritesCount(1));
+}
@@ -92,8 +92,14 @@ TEST_F(SDcardMockTest, sdcard_cannot_read_0_sectors)
 
 TEST_F(SDcardMockTest, sdcard_cannot_read_outside_sectors)
 {
-    std::vector<uint8_t> read_data(1024);
-    ASSERT_EQ(SDCARD_CARD_FAILURE, SDCARD_Read(sdcard.get(), read_data.data(), 1000, 24));
+    std::vector<uint8_t> read_data(24 * SDcardMock::s_sector_size);
+    ASSERT_EQ(SDCARD_CARD_FAILURE, SDCARD_Read(sdcard.get(), read_data.data(), 1001, 24));
+}
+
+TEST_F(SDcardMockTest, sdcard_can_read_last_sectors)
+{
+    std::vector<uint8_t> read_data(24 * SDcardMock::s_sector_size);
+    ASSERT_EQ(SDCARD_OK, SDCARD_Read(sdcard.get(), read_data.data(), 1000, 24));
 }
 
 TEST_F(SDcardMockTest, sdcard_can_read_multiple_data)
@@ -151,8 +157,18 @@ TEST_F(SDcardMockTest, sdcard_cannot_write_to_null_multiple)
 
 TEST_F(SDcardMockTest, sdcard_cannot_write_outside_multiple)
 {
-    std::vector<uint8_t> write_data(SDcardMock::s_sector_size);
-    ASSERT_EQ(SDCARD_CARD_FAILURE, SDCARD_Write(sdcard.get(), write_data.data(), 1000, 24));
+    std::vector<uint8_t> write_data(24 * SDcardMock::s_sector_size);
+    ASSERT_EQ(SDCARD_CARD_FAILURE, SDCARD_Write(sdcard.get(), write_data.data(), 1001, 24));
+}
+
+TEST_F(SDcardMockTest, sdcard_can_write_last_sectors)
+{
+    std::vector<uint8_t> write_data(24 * SDcardMock::s_sector_size, 'N');
+    ASSERT_EQ(24 * SDcardMock::s_sector_size, SDCARD_Write(sdcard.get(), write_data.data(), 1000, 24));
+
+    std::vector<uint8_t> read_data(SDcardMock::s_sector_size);
+    ASSERT_EQ(SDCARD_OK, SDCARD_ReadSingleBlock(sdcard.get(), read_data.data(), 1023));
+    ASSERT_EQ('N', read_data.back());
 }
 
 TEST_F(SDcardMockTest, sdcard_can_write_multiple_data)
@@ -302,4 +318,101 @@ TEST(SDCardFileSystemTest, reset_file_system)
     SDcardMock::ResetFS();
     ASSERT_THROW(SDcardMock::GetCard(0), std::exception);
     ASSERT_THROW(SDcardMock::GetCard(1), std::exception);
-}
\ No newline at end of file
+}
+class SDcardMockAsyncTest : public SDcardMockTest
+{
+protected:
+    size_t callbacks_count = 0;
+    SDCARD_Status callback_status = SDCARD_NOT_READY;
+
+    static void onComplete(HSDCARD, SDCARD_Status status, void* context)
+    {
+        SDcardMockAsyncTest* test = (SDcardMockAsyncTest*)context;
+        ++test->callbacks_count;
+        test->callback_status = status;
+    }
+};
+
+TEST_F(SDcardMockAsyncTest, sdcard_async_read_completed_by_poll)
+{
+    std::vector<uint8_t> read_data(SDcardMock::s_sector_size, 0);
+    ASSERT_EQ(SDCARD_OK, SDCARD_ReadAsync(sdcard.get(), read_data.data(), 0, 1, onComplete, this));
+    ASSERT_EQ(0, callbacks_count);
+    ASSERT_EQ(0, read_data[0]);
+
+    ASSERT_EQ(SDCARD_OK, SDCARD_Poll(sdcard.get()));
+    ASSERT_EQ(1, callbacks_count);
+    ASSERT_EQ(SDCARD_OK, callback_status);
+    ASSERT_EQ(SDcardMock::s_initial_symbol, read_data[0]);
+}
+
+TEST_F(SDcardMockAsyncTest, sdcard_async_latency)
+{
+    const size_t latency = 3;
+    const uint32_t sectors = 2;
+    sdcard->SetLatency(latency);
+    std::vector<uint8_t> read_data(SDcardMock::s_sector_size * sectors, 0);
+    ASSERT_EQ(SDCARD_OK, SDCARD_ReadAsync(sdcard.get(), read_data.data(), 10, sectors, onComplete, this));
+    for (size_t i = 0; i < latency * sectors; ++i)
+    {
+        ASSERT_EQ(SDCARD_BUSY, SDCARD_Poll(sdcard.get())) << "on poll: " << i;
+    }
+    ASSERT_EQ(0, callbacks_count);
+    ASSERT_EQ(0, sdcard->GetReadSectorsCount());
+
+    ASSERT_EQ(SDCARD_OK, SDCARD_Poll(sdcard.get()));
+    ASSERT_EQ(1, callbacks_count);
+    ASSERT_EQ(sectors, sdcard->GetReadSectorsCount());
+    ASSERT_EQ(SDcardMock::s_initial_symbol, read_data.back());
+}
+
+TEST_F(SDcardMockAsyncTest, sdcard_async_transfer_keeps_card_busy)
+{
+    sdcard->SetLatency(1);
+    std::vector<uint8_t> data(SDcardMock::s_sector_size);
+    ASSERT_EQ(SDCARD_OK, SDCARD_ReadAsync(sdcard.get(), data.data(), 0, 1, onComplete, this));
+    ASSERT_EQ(SDCARD_BUSY, SDCARD_GetStatus(sdcard.get()));
+    ASSERT_EQ(SDCARD_BUSY, SDCARD_ReadSingleBlock(sdcard.get(), data.data(), 1));
+    ASSERT_EQ(SDCARD_BUSY, SDCARD_WriteSingleBlock(sdcard.get(), data.data(), 1));
+    ASSERT_EQ(SDCARD_BUSY, SDCARD_WriteAsync(sdcard.get(), data.data(), 1, 1, onComplete, this));
+
+    while (SDCARD_BUSY == SDCARD_Poll(sdcard.get()));
+    ASSERT_EQ(SDCARD_OK, SDCARD_GetStatus(sdcard.get()));
+    ASSERT_EQ(SDCARD_OK, SDCARD_ReadSingleBlock(sdcard.get(), data.data(), 1));
+}
+
+TEST_F(SDcardMockAsyncTest, sdcard_async_write)
+{
+    const uint32_t sectors = 3;
+    sdcard->SetLatency(2);
+    std::vector<uint8_t> write_data(SDcardMock::s_sector_size * sectors, 'N');
+    ASSERT_EQ(SDCARD_OK, SDCARD_WriteAsync(sdcard.get(), write_data.data(), 100, sectors, onComplete, this));
+    while (SDCARD_BUSY == SDCARD_Poll(sdcard.get()));
+    ASSERT_EQ(1, callbacks_count);
+    ASSERT_EQ(SDCARD_OK, callback_status);
+
+    std::vector<uint8_t> read_data(SDcardMock::s_sector_size * sectors);
+    SDCARD_Read(sdcard.get(), read_data.data(), 100, sectors);
+    ASSERT_TRUE(read_data == write_data);
+}
+
+TEST_F(SDcardMockAsyncTest, sdcard_async_cannot_transfer_outside)
+{
+    std::vector<uint8_t> data(SDcardMock::s_sector_size * 2);
+    ASSERT_EQ(SDCARD_INVALID_ARGUMENT, SDCARD_ReadAsync(sdcard.get(), data.data(), (uint32_t)blocks_count - 1, 2, onComplete, this));
+    ASSERT_EQ(SDCARD_INVALID_ARGUMENT, SDCARD_WriteAsync(sdcard.get(), nullptr, 0, 1, onComplete, this));
+    ASSERT_EQ(SDCARD_INVALID_ARGUMENT, SDCARD_ReadAsync(sdcard.get(), data.data(), 0, 0, onComplete, this));
+    ASSERT_EQ(SDCARD_OK, SDCARD_GetStatus(sdcard.get()));
+}
+
+TEST_F(SDcardMockAsyncTest, sdcard_async_reports_failure)
+{
+    std::vector<uint8_t> data(SDcardMock::s_sector_size);
+    ASSERT_EQ(SDCARD_OK, SDCARD_ReadAsync(sdcard.get(), data.data(), 0, 1, onComplete, this));
+    sdcard->SetCardStatus(SDCARD_CARD_FAILURE);
+    ASSERT_EQ(SDCARD_CARD_FAILURE, SDCARD_Poll(sdcard.get()));
+    ASSERT_EQ(SDCARD_CARD_FAILURE, callback_status);
+    // the status of the last transfer is kept
+    ASSERT_EQ(SDCARD_CARD_FAILURE, SDCARD_Poll(sdcard.get()));
+    ASSERT_EQ(1, callbacks_count);
+}
@@ -0,0 +1,385 @@
+#include "include/sdcard.h"
+#include "include/spibus.h"
+#include "device_mock.h"
+#include "stm32f7xx_hal_spi.h"
+
+#include <gtest/gtest.h>
+#include <deque>
+#include <memory>
+#include <vector>
+
+// SD card in SPI mode connected to the SPI HAL mock, the card answers only while its chip select is low
+class SDCardEmulator
+{
+public:
+    static const size_t s_blocks_count = 2048;
+    // bytes of the card respond while it prepares the data or programs the block
+    static const size_t s_latency = 20;
+
+    SDCardEmulator(Device& device, GPIO_TypeDef port, uint16_t pin)
+        : m_device(device)
+        , m_port(port)
+        , m_pin(pin)
+    {
+        m_data.resize(s_blocks_count * SDCARD_BLOCK_SIZE, 0);
+    }
+
+    std::vector<uint8_t>& GetData()
+    {
+        return m_data;
+    }
+
+    uint8_t Exchange(uint8_t byte)
+    {
+        if (GPIO_PIN_SET == m_device.GetPinState(m_port, m_pin).state)
+        {
+            return 0xFF;
+        }
+
+        uint8_t respond = 0xFF;
+        if (!m_respond.empty())
+        {
+            respond = m_respond.front();
+            m_respond.pop_front();
+        }
+
+        if (WRITE == m_mode)
+        {
+            receiveData(byte);
+        }
+        else if (!m_command.empty() || 0x40 == (byte & 0xC0))
+        {
+            receiveCommand(byte);
+        }
+        else if (READ_MULTIPLE == m_mode && m_respond.empty())
+        {
+            sendBlock();
+        }
+        return respond;
+    }
+
+private:
+    enum Mode
+    {
+        COMMAND,
+        READ_MULTIPLE,
+        WRITE,
+    };
+
+    void respond(uint8_t r1, std::vector<uint8_t> data = {})
+    {
+        m_respond.push_back(0xFF);
+        m_respond.push_back(r1);
+        m_respond.insert(m_respond.end(), data.begin(), data.end());
+    }
+
+    void busy()
+    {
+        m_respond.insert(m_respond.end(), s_latency, 0x00);
+    }
+
+    void sendBlock()
+    {
+        m_respond.insert(m_respond.end(), s_latency, 0xFF);
+        m_respond.push_back(0xFE);
+        auto block = m_data.begin() + m_sector++ * SDCARD_BLOCK_SIZE;
+        m_respond.insert(m_respond.end(), block, block + SDCARD_BLOCK_SIZE);
+        m_respond.insert(m_respond.end(), 2, 0xFF);
+    }
+
+    void receiveCommand(uint8_t byte)
+    {
+        m_command.push_back(byte);
+        if (m_command.size() < 6)
+        {
+            return;
+        }
+        uint8_t command = m_command[0] & 0x3F;
+        uint32_t argument = (m_command[1] << 24) | (m_command[2] << 16) | (m_command[3] << 8) | m_command[4];
+        m_command.clear();
+
+        bool application = m_application;
+        m_application = false;
+        uint8_t r1 = m_idle ? 0x01 : 0x00;
+        switch (command)
+        {
+        case 0:
+            m_idle = true;
+            respond(0x01);
+            break;
+        case 8:
+            respond(r1, { 0x00, 0x00, 0x01, 0xAA });
+            break;
+        case 55:
+            m_application = true;
+            respond(r1);
+            break;
+        case 41:
+            m_idle = !application;
+            respond(m_idle ? 0x01 : 0x00);
+            break;
+        case 58:
+            respond(r1, { 0xC0, 0x00, 0x00, 0x00 });
+            break;
+        case 9:
+        {
+            // CSD v2, block length 512, C_SIZE is the number of 512K units minus one
+            uint32_t c_size = s_blocks_count / 1024 - 1;
+            respond(r1, { 0xFE, 0x40, 0x0E, 0x00, 0x32, 0x5B, 0x59, 0x00, (uint8_t)(c_size >> 16), (uint8_t)(c_size >> 8), (uint8_t)c_size, 0x7F, 0x80, 0x0A, 0x40, 0x00, 0x01, 0xFF, 0xFF });
+            break;
+        }
+        case 17:
+            m_sector = argument;
+            respond(r1);
+            sendBlock();
+            break;
+        case 18:
+            m_sector = argument;
+            m_mode = READ_MULTIPLE;
+            respond(r1);
+            sendBlock();
+            break;
+        case 12:
+            // the stuff byte follows the command, the card is busy after the respond
+            m_respond.clear();
+            m_mode = COMMAND;
+            respond(0x00);
+            busy();
+            break;
+        case 24:
+        case 25:
+            m_sector = argument;
+            m_mode = WRITE;
+            m_multiple = (25 == command);
+            respond(r1);
+            break;
+        default:
+            respond(0x04);
+        }
+    }
+
+    void receiveData(uint8_t byte)
+    {
+        if (!m_receiving)
+        {
+            if ((m_multiple ? 0xFC : 0xFE) == byte)
+            {
+                m_receiving = true;
+                m_block.clear();
+            }
+            else if (m_multiple && 0xFD == byte)
+            {
+                m_respond.push_back(0xFF);
+                busy();
+                m_mode = COMMAND;
+            }
+            return;
+        }
+
+        // data of the block and 2 bytes of CRC
+        m_block.push_back(byte);
+        if (m_block.size() < SDCARD_BLOCK_SIZE + 2)
+        {
+            return;
+        }
+        std::copy(m_block.begin(), m_block.begin() + SDCARD_BLOCK_SIZE, m_data.begin() + m_sector++ * SDCARD_BLOCK_SIZE);
+        m_receiving = false;
+        m_respond.push_back(0x05);
+        busy();
+        if (!m_multiple)
+        {
+            m_mode = COMMAND;
+        }
+    }
+
+    Device& m_device;
+    GPIO_TypeDef m_port;
+    uint16_t m_pin;
+    std::vector<uint8_t> m_data;
+
+    Mode m_mode = COMMAND;
+    std::deque<uint8_t> m_respond;
+    std::vector<uint8_t> m_command;
+    bool m_idle = false;
+    bool m_application = false;
+    uint32_t m_sector = 0;
+    bool m_multiple = false;
+    bool m_receiving = false;
+    std::vector<uint8_t> m_block;
+};
+
+class SDCardProtocolTest : public ::testing::Test
+{
+protected:
+    static const uint16_t s_card_pin = 3;
+    static const uint16_t s_display_pin = 4;
+
+    virtual void SetUp()
+    {
+        DeviceSettings ds;
+        device = std::make_unique<Device>(ds);
+        AttachDevice(*device);
+
+        card = std::make_unique<SDCardEmulator>(*device, port, s_card_pin);
+        ConnectSPIPeripheral([this](uint8_t byte) { return card->Exchange(byte); });
+
+        hspibus = SPIBUS_Configure(&hspi, 0);
+        sdcard = SDCARD_Configure(hspibus, &port, s_card_pin);
+        display = SPIBUS_AddPeripherialDevice(hspibus, &port, s_display_pin);
+        ASSERT_EQ(SDCARD_OK, SDCARD_Init(sdcard));
+        ASSERT_EQ(SDCARD_OK, SDCARD_ReadBlocksNumber(sdcard));
+    }
+
+    virtual void TearDown()
+    {
+        ConnectSPIPeripheral(nullptr);
+        SPIBUS_Release(hspibus);
+        DetachDevice();
+        card = nullptr;
+        device = nullptr;
+    }
+
+    static void onComplete(HSDCARD, SDCARD_Status status, void* context)
+    {
+        SDCardProtocolTest* test = static_cast<SDCardProtocolTest*>(context);
+        test->completed = true;
+        test->status = status;
+    }
+
+    // polls the card until the transfer is completed, returns the number of polls
+    size_t pollTransfer()
+    {
+        size_t polls = 1;
+        for (; SDCARD_BUSY == SDCARD_Poll(sdcard); ++polls);
+        return polls;
+    }
+
+    const std::vector<GPIO_PinState>& cardSelectLog()
+    {
+        return device->GetPinState(port, s_card_pin).signals_log;
+    }
+
+    std::unique_ptr<Device> device;
+    std::unique_ptr<SDCardEmulator> card;
+    GPIO_TypeDef port = 0;
+    SPI_HandleTypeDef hspi = 0;
+    HSPIBUS hspibus = nullptr;
+    HSDCARD sdcard = nullptr;
+    uint32_t display = 0;
+    bool completed = false;
+    SDCARD_Status status = SDCARD_BUSY;
+};
+
+TEST_F(SDCardProtocolTest, card_is_initialized)
+{
+    ASSERT_EQ(SDCARD_OK, SDCARD_GetStatus(sdcard));
+    ASSERT_EQ(SDCardEmulator::s_blocks_count, SDCARD_GetBlocksNumber(sdcard));
+}
+
+TEST_F(SDCardProtocolTest, card_is_selected_from_command_to_last_block_of_read)
+{
+    const uint32_t sectors = 4;
+    std::vector<uint8_t>& data = card->GetData();
+    for (size_t i = 0; i < sectors * SDCARD_BLOCK_SIZE; ++i)
+    {
+        data[10 * SDCARD_BLOCK_SIZE + i] = (uint8_t)(i * 7 + 1);
+    }
+
+    std::vector<uint8_t> read_data(sectors * SDCARD_BLOCK_SIZE);
+    device->ResetPinGPIOCounters(port, s_card_pin);
+    ResetSPIStatistics();
+    ASSERT_EQ(SDCARD_OK, SDCARD_ReadAsync(sdcard, read_data.data(), 10, sectors, onComplete, this));
+    ASSERT_EQ(std::vector<GPIO_PinState>{ GPIO_PIN_RESET }, cardSelectLog());
+
+    // the card prepares every block longer than a single poll
+    ASSERT_LT(sectors, pollTransfer());
+    ASSERT_TRUE(completed);
+    ASSERT_EQ(SDCARD_OK, status);
+    ASSERT_TRUE(std::equal(read_data.begin(), read_data.end(), data.begin() + 10 * SDCARD_BLOCK_SIZE));
+
+    // the chip select is released only after the stop of the transmission
+    std::vector<GPIO_PinState> expected = { GPIO_PIN_RESET, GPIO_PIN_SET };
+    ASSERT_EQ(expected, cardSelectLog());
+    ASSERT_LE(sectors * SDCARD_BLOCK_SIZE, GetSPIStatistics().transmit_receive_bytes);
+}
+
+TEST_F(SDCardProtocolTest, card_is_selected_from_command_to_last_block_of_write)
+{
+    const uint32_t sectors = 3;
+    std::vector<uint8_t> write_data(sectors * SDCARD_BLOCK_SIZE);
+    for (size_t i = 0; i < write_data.size(); ++i)
+    {
+        write_data[i] = (uint8_t)(i * 3 + 5);
+    }
+
+    device->ResetPinGPIOCounters(port, s_card_pin);
+    ResetSPIStatistics();
+    ASSERT_EQ(SDCARD_OK, SDCARD_WriteAsync(sdcard, write_data.data(), 100, sectors, onComplete, this));
+    ASSERT_LT(sectors, pollTransfer());
+    ASSERT_TRUE(completed);
+    ASSERT_EQ(SDCARD_OK, status);
+
+    std::vector<uint8_t>& data = card->GetData();
+    ASSERT_TRUE(std::equal(write_data.begin(), write_data.end(), data.begin() + 100 * SDCARD_BLOCK_SIZE));
+
+    std::vector<GPIO_PinState> expected = { GPIO_PIN_RESET, GPIO_PIN_SET };
+    ASSERT_EQ(expected, cardSelectLog());
+    ASSERT_LE(sectors * SDCARD_BLOCK_SIZE, GetSPIStatistics().transmit_bytes);
+}
+
+TEST_F(SDCardProtocolTest, single_block_keeps_card_selected)
+{
+    std::vector<uint8_t> read_data(SDCARD_BLOCK_SIZE);
+    device->ResetPinGPIOCounters(port, s_card_pin);
+    ASSERT_EQ(SDCARD_OK, SDCARD_ReadAsync(sdcard, read_data.data(), 0, 1, onComplete, this));
+    ASSERT_LT(1u, pollTransfer());
+    ASSERT_EQ(SDCARD_OK, status);
+
+    std::vector<GPIO_PinState> expected = { GPIO_PIN_RESET, GPIO_PIN_SET };
+    ASSERT_EQ(expected, cardSelectLog());
+}
+
+TEST_F(SDCardProtocolTest, other_device_cannot_take_bus_during_transfer)
+{
+    std::vector<uint8_t> read_data(2 * SDCARD_BLOCK_SIZE);
+    ASSERT_EQ(SDCARD_OK, SDCARD_ReadAsync(sdcard, read_data.data(), 0, 2, onComplete, this));
+    ASSERT_EQ(SDCARD_BUSY, SDCARD_Poll(sdcard));
+
+    ASSERT_EQ(SPIBUS_FAIL, SPIBUS_BeginTransaction(hspibus, display));
+    ASSERT_EQ(GPIO_PIN_SET, device->GetPinState(port, s_display_pin).state);
+    ASSERT_EQ(GPIO_PIN_RESET, device->GetPinState(port, s_card_pin).state);
+
+    pollTransfer();
+    ASSERT_EQ(SDCARD_OK, status);
+    ASSERT_EQ(display, SPIBUS_BeginTransaction(hspibus, display));
+    ASSERT_EQ(display, SPIBUS_EndTransaction(hspibus, display));
+}
+
+TEST_F(SDCardProtocolTest, transfer_is_completed_by_dispatch_of_bus)
+{
+    std::vector<uint8_t> read_data(2 * SDCARD_BLOCK_SIZE);
+    ASSERT_EQ(SDCARD_OK, SDCARD_ReadAsync(sdcard, read_data.data(), 0, 2, onComplete, this));
+
+    // the device waiting for the bus runs the queued steps of the transfer
+    while (SPIBUS_FAIL == SPIBUS_BeginTransaction(hspibus, display))
+    {
+        ASSERT_NE(0u, SPIBUS_Dispatch(hspibus, 1));
+    }
+    ASSERT_TRUE(completed);
+    ASSERT_EQ(SDCARD_OK, status);
+    ASSERT_EQ(GPIO_PIN_SET, device->GetPinState(port, s_card_pin).state);
+    SPIBUS_EndTransaction(hspibus, display);
+}
+
+TEST_F(SDCardProtocolTest, bus_is_released_by_failed_transfer)
+{
+    std::vector<uint8_t> read_data(SDCARD_BLOCK_SIZE);
+    ASSERT_EQ(SDCARD_OK, SDCARD_ReadAsync(sdcard, read_data.data(), 0, 1, onComplete, this));
+    // the card answers by the error token instead of the data
+    ConnectSPIPeripheral([](uint8_t) { return 0x00; });
+    ASSERT_EQ(SDCARD_CARD_FAILURE, SDCARD_Poll(sdcard));
+    ASSERT_TRUE(completed);
+    ASSERT_EQ(GPIO_PIN_SET, device->GetPinState(port, s_card_pin).state);
+    ASSERT_EQ(display, SPIBUS_BeginTransaction(hspibus, display));
+    SPIBUS_EndTransaction(hspibus, display);
+}
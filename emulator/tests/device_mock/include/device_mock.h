@@ -52,13 +52,35 @@ public:
     // single pin emulation
     void WritePin(GPIO_TypeDef port, uint16_t pin, GPIO_PinState state);
     GPIO_PinState TogglePin(GPIO_TypeDef port, uint16_t pin);
+    // all pins of the port by one write of set/reset masks
+    void WritePort(GPIO_TypeDef port, uint16_t set_mask, uint16_t reset_mask);
 
     // adc emulation
     int ADC_GetValue(ADC_HandleTypeDef* adc);
 
+    // circular DMA of the ADC emulation
+    enum DMAEvent
+    {
+        DMA_NONE,
+        DMA_HALF_TRANSFER,  // the first half of the buffer is filled
+        DMA_TRANSFER,       // the second half of the buffer is filled, the next conversion goes to the start
+    };
+    bool ADC_StartDMA(ADC_HandleTypeDef* adc, uint16_t* buffer, size_t length);
+    void ADC_StopDMA(ADC_HandleTypeDef* adc);
+    // writes the next conversion of the started DMA, test has to call the interrupt handler on the event
+    DMAEvent ADC_Convert(uint16_t value);
+    bool IsADCDMAStarted() const;
+
+    // system tick emulation, milliseconds
+    uint32_t GetTick() const;
+    void AdvanceTick(uint32_t milliseconds);
+
     // Diagnostics funtions. 
     void ResetPinGPIOCounters(GPIO_TypeDef port, uint16_t pin);
     const PinState& GetPinState(GPIO_TypeDef port, uint16_t pin) const;
+    // number of GPIO write operations on the port, every pin or port write is a single operation
+    size_t GetPortWritesCount(GPIO_TypeDef port) const;
+    void ResetPortWritesCount(GPIO_TypeDef port);
 
 private:
     void ValidatePortAndPin(size_t port, uint16_t pin) const;
@@ -71,10 +93,15 @@ private:
     struct Port
     {
         uint16_t port_type = 0;
+        size_t writes = 0;
         std::array<PinState, 16> pins;
     };
     std::vector<Port> m_ports;
     std::array<int, 3> m_adc; // values on ADCs
+    uint16_t* m_adc_dma_buffer = nullptr;
+    size_t m_adc_dma_length = 0;
+    size_t m_adc_dma_position = 0;
+    uint32_t m_tick = 0;
 
 // no defaults, no copy
     Device() = delete;
@@ -33,11 +33,21 @@ typedef size_t ADC_HandleTypeDef;
 #define GPIO_PIN_RESET 1
 #define GPIO_PIN_SET 0
 
+// emulated pins are identified by their index, port writes use bit masks of pins
+#define GPIO_PIN_MASK(pin) ((uint16_t)(1U << (pin)))
+
 void HAL_GPIO_WritePin(GPIO_TypeDef* port, uint16_t pin, GPIO_PinState value);
+// sets and resets pins of the port by a single write, the same way as BSRR register does. Set has priority
+void HAL_GPIO_WritePort(GPIO_TypeDef* port, uint16_t set_mask, uint16_t reset_mask);
 GPIO_PinState HAL_GPIO_TogglePin(GPIO_TypeDef* port, uint16_t pin);
 void HAL_Delay(int timeout);
+// milliseconds since the device start, the time is advanced by the test
+uint32_t HAL_GetTick(void);
 
 int HAL_ADC_GetValue(ADC_HandleTypeDef* adc);
+// circular DMA of the regular sequence, conversions are written to the buffer by Device::ADC_Convert
+int HAL_ADC_Start_DMA(ADC_HandleTypeDef* adc, uint32_t* buffer, uint32_t length);
+int HAL_ADC_Stop_DMA(ADC_HandleTypeDef* adc);
 
 #ifdef __cplusplus
 }
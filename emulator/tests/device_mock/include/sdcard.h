@@ -47,6 +47,12 @@ SDCARD_Status SDCARD_Read(HSDCARD hsdcard, uint8_t* buffer, uint32_t sector, uin
 SDCARD_Status SDCARD_WriteSingleBlock(HSDCARD hsdcard, const uint8_t* data, uint32_t sector);
 size_t SDCARD_Write(HSDCARD hsdcard, const uint8_t* buffer, uint32_t sector, uint32_t count);
 
+// Asynchronous commands
+typedef void (*SDCARD_Callback)(HSDCARD hsdcard, SDCARD_Status status, void* context);
+SDCARD_Status SDCARD_ReadAsync(HSDCARD hsdcard, uint8_t* buffer, uint32_t sector, uint32_t count, SDCARD_Callback callback, void* context);
+SDCARD_Status SDCARD_WriteAsync(HSDCARD hsdcard, const uint8_t* buffer, uint32_t sector, uint32_t count, SDCARD_Callback callback, void* context);
+SDCARD_Status SDCARD_Poll(HSDCARD hsdcard);
+
 SDCARD_Status SDCARD_FAT_Register(HSDCARD hsdcard, uint8_t drive_index);
 SDCARD_Status SDCARD_FAT_IsInitialized(uint8_t drive_index);
 SDCARD_Status SDCARD_FAT_Read(uint8_t drive_index, uint8_t* buffer, uint32_t sector, uint32_t count);
@@ -3,6 +3,7 @@
 //SDCARD MOC FILE
 #include <main.h>
 #include <sdcard.h>
+#include <functional>
 #include <vector>
 #include <map>
 
@@ -29,10 +30,24 @@ public:
 	// Write commands
 	SDCARD_Status WriteSingleBlock(const uint8_t* data, uint32_t sector);
 	size_t Write(const uint8_t* buffer, uint32_t sector, uint32_t count);
+	// Asynchronous commands, transfer is completed by the Poll call
+	SDCARD_Status ReadAsync(uint8_t* buffer, uint32_t sector, uint32_t count, SDCARD_Callback callback, void* context);
+	SDCARD_Status WriteAsync(const uint8_t* buffer, uint32_t sector, uint32_t count, SDCARD_Callback callback, void* context);
+	SDCARD_Status Poll();
 
 	//State control functions;
 	void SetCardStatus(SDCARD_Status new_status);
 
+	// Slow card emulation: the callback is called by every read command before the data is returned,
+	// so the device can do its work while the card transfers the data
+	void SetReadCallback(std::function<void(uint32_t sector, uint32_t count)> callback);
+	size_t GetReadsCount() const;
+	size_t GetReadSectorsCount() const;
+	// Latency mode: asynchronous transfer is in progress for the given amount of Poll calls per sector,
+	// the data is transferred when the transfer is completed
+	void SetLatency(size_t polls_per_sector);
+	size_t GetPollsCount() const;
+
 	void* GetMemoryPtr();
 	size_t GetMemorySize();
 	size_t GetSectorsCount();
@@ -41,8 +56,30 @@ public:
 	static HSDCARD GetCard(uint8_t drive);
 	static void ResetFS();
 private:
+	SDCARD_Status readSectors(uint8_t* buffer, uint32_t sector, uint32_t count);
+	SDCARD_Status startTransfer(bool write, uint8_t* buffer, uint32_t sector, uint32_t count, SDCARD_Callback callback, void* context);
+
+	struct AsyncTransfer
+	{
+		bool active;
+		bool write;
+		uint8_t* buffer;
+		uint32_t sector;
+		uint32_t count;
+		size_t polls_left;
+		SDCARD_Callback callback;
+		void* context;
+	};
+
 	SDCARD_Status m_status;
 	std::vector<uint8_t> m_data;
+	std::function<void(uint32_t sector, uint32_t count)> m_read_callback;
+	size_t m_reads_count;
+	size_t m_read_sectors_count;
+	AsyncTransfer m_transfer;
+	SDCARD_Status m_async_status;
+	size_t m_latency;
+	size_t m_polls_count;
 
 	static std::map<uint8_t, HSDCARD> s_file_systems;
 };
\ No newline at end of file
@@ -14,4 +14,22 @@ HAL_StatusTypeDef HAL_SPI_TransmitReceive(SPI_HandleTypeDef* hspi, uint8_t* tran
 
 #ifdef __cplusplus
 }
+
+// usage statistics of the SPI HAL, transmitted data is looped back to the receive buffer
+struct SPIStatistics
+{
+    size_t transmit_calls;
+    size_t transmit_bytes;
+    size_t transmit_receive_calls;
+    size_t transmit_receive_bytes;
+};
+
+SPIStatistics& GetSPIStatistics();
+void ResetSPIStatistics();
+
+#include <functional>
+// peripheral connected to the bus, it gets every transmitted byte and returns the received one.
+// transmitted data is looped back if no peripheral is connected
+typedef std::function<uint8_t(uint8_t)> SPIPeripheral;
+void ConnectSPIPeripheral(SPIPeripheral peripheral);
 #endif
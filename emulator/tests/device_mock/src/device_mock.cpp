@@ -58,6 +58,24 @@ void Device::WritePin(size_t port, uint16_t pin, GPIO_PinState state)
     ++pin_state.gpio_signals;
     pin_state.state = state;
     pin_state.signals_log.push_back(pin_state.state);
+    ++m_ports[port].writes;
+}
+
+void Device::WritePort(GPIO_TypeDef port, uint16_t set_mask, uint16_t reset_mask)
+{
+    ValidatePortAndPin(port, 0);
+    for (uint16_t pin = 0; pin < m_ports[port].pins.size(); ++pin)
+    {
+        uint16_t mask = 1 << pin;
+        if ((set_mask | reset_mask) & mask)
+        {
+            auto& pin_state = m_ports[port].pins[pin];
+            ++pin_state.gpio_signals;
+            pin_state.state = (set_mask & mask) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+            pin_state.signals_log.push_back(pin_state.state);
+        }
+    }
+    ++m_ports[port].writes;
 }
 
 GPIO_PinState Device::TogglePin(size_t port, uint16_t pin)
@@ -74,6 +92,7 @@ GPIO_PinState Device::TogglePin(size_t port, uint16_t pin)
     }
     pin_state.signals_log.push_back(pin_state.state);
     ++pin_state.gpio_signals;
+    ++m_ports[port].writes;
     return m_ports[port].pins[pin].state;
 }
 
@@ -82,6 +101,56 @@ int Device::ADC_GetValue(ADC_HandleTypeDef* adc)
     return m_adc[*adc];
 }
 
+bool Device::ADC_StartDMA(ADC_HandleTypeDef* /*adc*/, uint16_t* buffer, size_t length)
+{
+    // DMA is started once, both halves have the same size
+    if (m_adc_dma_buffer || !buffer || !length || (length & 1))
+    {
+        return false;
+    }
+    m_adc_dma_buffer = buffer;
+    m_adc_dma_length = length;
+    m_adc_dma_position = 0;
+    return true;
+}
+
+void Device::ADC_StopDMA(ADC_HandleTypeDef* /*adc*/)
+{
+    m_adc_dma_buffer = nullptr;
+    m_adc_dma_length = 0;
+    m_adc_dma_position = 0;
+}
+
+Device::DMAEvent Device::ADC_Convert(uint16_t value)
+{
+    if (!m_adc_dma_buffer)
+    {
+        return DMA_NONE;
+    }
+    m_adc_dma_buffer[m_adc_dma_position++] = value;
+    if (m_adc_dma_length == m_adc_dma_position)
+    {
+        m_adc_dma_position = 0;
+        return DMA_TRANSFER;
+    }
+    return (m_adc_dma_length / 2 == m_adc_dma_position) ? DMA_HALF_TRANSFER : DMA_NONE;
+}
+
+bool Device::IsADCDMAStarted() const
+{
+    return nullptr != m_adc_dma_buffer;
+}
+
+uint32_t Device::GetTick() const
+{
+    return m_tick;
+}
+
+void Device::AdvanceTick(uint32_t milliseconds)
+{
+    m_tick += milliseconds;
+}
+
 void Device::ResetPinGPIOCounters(GPIO_TypeDef port, uint16_t pin)
 {
     ValidatePortAndPin(port, pin);
@@ -95,3 +164,15 @@ const Device::PinState& Device::GetPinState(GPIO_TypeDef port, uint16_t pin) con
     ValidatePortAndPin(port, pin);
     return m_ports[port].pins[pin];
 }
+
+size_t Device::GetPortWritesCount(GPIO_TypeDef port) const
+{
+    ValidatePortAndPin(port, 0);
+    return m_ports[port].writes;
+}
+
+void Device::ResetPortWritesCount(GPIO_TypeDef port)
+{
+    ValidatePortAndPin(port, 0);
+    m_ports[port].writes = 0;
+}
@@ -28,6 +28,14 @@ void HAL_GPIO_WritePin(GPIO_TypeDef* port, uint16_t pin, GPIO_PinState value)
     }
 }
 
+void HAL_GPIO_WritePort(GPIO_TypeDef* port, uint16_t set_mask, uint16_t reset_mask)
+{
+    if (g_device)
+    {
+        g_device->WritePort(*port, set_mask, reset_mask);
+    }
+}
+
 GPIO_PinState HAL_GPIO_TogglePin(GPIO_TypeDef* port, uint16_t pin)
 {
     if (g_device)
@@ -46,11 +54,38 @@ int HAL_ADC_GetValue(ADC_HandleTypeDef* adc)
     return 0;
 }
 
+int HAL_ADC_Start_DMA(ADC_HandleTypeDef* adc, uint32_t* buffer, uint32_t length)
+{
+    if (g_device && g_device->ADC_StartDMA(adc, (uint16_t*)buffer, length))
+    {
+        return HAL_OK;
+    }
+    return HAL_ERROR;
+}
+
+int HAL_ADC_Stop_DMA(ADC_HandleTypeDef* adc)
+{
+    if (g_device)
+    {
+        g_device->ADC_StopDMA(adc);
+    }
+    return HAL_OK;
+}
+
 void HAL_Delay(int)
 {
 
 }
 
+uint32_t HAL_GetTick(void)
+{
+    if (g_device)
+    {
+        return g_device->GetTick();
+    }
+    return 0;
+}
+
 void* DeviceAlloc(size_t object_size)
 {
     if (g_device)
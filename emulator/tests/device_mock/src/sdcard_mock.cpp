@@ -1,11 +1,18 @@
 #include "sdcard.h"
 #include "sdcard_mock.h"
+#include <algorithm>
 #include <vector>
 
 std::map<uint8_t, HSDCARD> SDcardMock::s_file_systems;
 
 SDcardMock::SDcardMock(size_t sectors_count)
     : m_status(SDCARD_OK)
+    , m_reads_count(0)
+    , m_read_sectors_count(0)
+    , m_transfer{ false }
+    , m_async_status(SDCARD_OK)
+    , m_latency(0)
+    , m_polls_count(0)
 {
     if (!sectors_count)
     {
@@ -21,6 +28,10 @@ SDCARD_Status SDcardMock::IsInitialized() const
 
 SDCARD_Status SDcardMock::GetStatus() const
 {
+    if (m_transfer.active)
+    {
+        return SDCARD_BUSY;
+    }
     return m_status;
 }
 
@@ -48,9 +59,9 @@ size_t SDcardMock::GetBlocksNumber() const
 // Read commands
 SDCARD_Status SDcardMock::ReadSingleBlock(uint8_t* buffer, uint32_t sector)
 {
-    if (m_status == SDCARD_BUSY)
+    if (m_status == SDCARD_BUSY || m_transfer.active)
     {
-        return m_status;
+        return SDCARD_BUSY;
     }
 
     if (sector >= m_data.size() / s_sector_size || !buffer)
@@ -58,45 +69,47 @@ SDCARD_Status SDcardMock::ReadSingleBlock(uint8_t* buffer, uint32_t sector)
         m_status = SDCARD_CARD_FAILURE;
         return m_status;
     }
-    size_t carret_possition = (size_t)sector * s_sector_size;
-    for (size_t i = carret_possition; i < carret_possition + s_sector_size; ++i)
-    {
-        *buffer = m_data[i];
-        ++buffer;
-    }
-    
-    return m_status;
+
+    return readSectors(buffer, sector, 1);
 }
 
 SDCARD_Status SDcardMock::Read(uint8_t* buffer, uint32_t sector, uint32_t count)
 {
-    if (m_status == SDCARD_BUSY)
+    if (m_status == SDCARD_BUSY || m_transfer.active)
     {
-        return m_status;
+        return SDCARD_BUSY;
     }
 
     if (!count 
-        || (sector + count) >= (m_data.size() / s_sector_size) 
+        || (size_t)sector + count > m_data.size() / s_sector_size 
         || !buffer)
     {
         return SDCARD_CARD_FAILURE;
     }
 
-    for (uint32_t i = 0; i < count; ++i)
+    return readSectors(buffer, sector, count);
+}
+
+SDCARD_Status SDcardMock::readSectors(uint8_t* buffer, uint32_t sector, uint32_t count)
+{
+    ++m_reads_count;
+    m_read_sectors_count += count;
+    if (m_read_callback)
     {
-        ReadSingleBlock(buffer, sector + i);
-        buffer += s_sector_size;
+        m_read_callback(sector, count);
     }
 
+    size_t carret_possition = (size_t)sector * s_sector_size;
+    std::copy(m_data.begin() + carret_possition, m_data.begin() + carret_possition + count * s_sector_size, buffer);
     return m_status;
 }
 
 // Write commands
 SDCARD_Status SDcardMock::WriteSingleBlock(const uint8_t* data, uint32_t sector)
 {
-    if (m_status == SDCARD_BUSY)
+    if (m_status == SDCARD_BUSY || m_transfer.active)
     {
-        return m_status;
+        return SDCARD_BUSY;
     }
 
     if (sector >= m_data.size() / s_sector_size || !data)
@@ -115,8 +128,13 @@ SDCARD_Status SDcardMock::WriteSingleBlock(const uint8_t* data, uint32_t sector)
 
 size_t SDcardMock::Write(const uint8_t* buffer, uint32_t sector, uint32_t count)
 {
+    if (m_transfer.active)
+    {
+        return 0;
+    }
+
     if (!count
-        || (sector + count) >= (m_data.size() / s_sector_size)
+        || (size_t)sector + count > m_data.size() / s_sector_size
         || !buffer)
     {
         return SDCARD_CARD_FAILURE;
@@ -131,6 +149,70 @@ size_t SDcardMock::Write(const uint8_t* buffer, uint32_t sector, uint32_t count)
     return count * s_sector_size;
 }
 
+SDCARD_Status SDcardMock::ReadAsync(uint8_t* buffer, uint32_t sector, uint32_t count, SDCARD_Callback callback, void* context)
+{
+    return startTransfer(false, buffer, sector, count, callback, context);
+}
+
+SDCARD_Status SDcardMock::WriteAsync(const uint8_t* buffer, uint32_t sector, uint32_t count, SDCARD_Callback callback, void* context)
+{
+    return startTransfer(true, const_cast<uint8_t*>(buffer), sector, count, callback, context);
+}
+
+SDCARD_Status SDcardMock::startTransfer(bool write, uint8_t* buffer, uint32_t sector, uint32_t count, SDCARD_Callback callback, void* context)
+{
+    if (m_transfer.active)
+    {
+        return SDCARD_BUSY;
+    }
+
+    if (m_status != SDCARD_OK)
+    {
+        return m_status;
+    }
+
+    if (!count || !buffer || (size_t)sector + count > m_data.size() / s_sector_size)
+    {
+        return SDCARD_INVALID_ARGUMENT;
+    }
+
+    m_transfer = { true, write, buffer, sector, count, m_latency * count, callback, context };
+    return SDCARD_OK;
+}
+
+SDCARD_Status SDcardMock::Poll()
+{
+    ++m_polls_count;
+    if (!m_transfer.active)
+    {
+        return m_async_status;
+    }
+
+    if (m_transfer.polls_left)
+    {
+        --m_transfer.polls_left;
+        return SDCARD_BUSY;
+    }
+
+    m_transfer.active = false;
+    size_t carret_possition = (size_t)m_transfer.sector * s_sector_size;
+    if (m_transfer.write)
+    {
+        std::copy(m_transfer.buffer, m_transfer.buffer + m_transfer.count * s_sector_size, m_data.begin() + carret_possition);
+        m_async_status = m_status;
+    }
+    else
+    {
+        m_async_status = readSectors(m_transfer.buffer, m_transfer.sector, m_transfer.count);
+    }
+
+    if (m_transfer.callback)
+    {
+        m_transfer.callback((HSDCARD)this, m_async_status, m_transfer.context);
+    }
+    return m_async_status;
+}
+
 void SDcardMock::Mount(uint8_t drive, HSDCARD hcard)
 {
     if (nullptr == hcard)
@@ -159,6 +241,31 @@ void SDcardMock::SetCardStatus(SDCARD_Status new_status)
     m_status = new_status;
 }
 
+void SDcardMock::SetReadCallback(std::function<void(uint32_t sector, uint32_t count)> callback)
+{
+    m_read_callback = callback;
+}
+
+size_t SDcardMock::GetReadsCount() const
+{
+    return m_reads_count;
+}
+
+size_t SDcardMock::GetReadSectorsCount() const
+{
+    return m_read_sectors_count;
+}
+
+void SDcardMock::SetLatency(size_t polls_per_sector)
+{
+    m_latency = polls_per_sector;
+}
+
+size_t SDcardMock::GetPollsCount() const
+{
+    return m_polls_count;
+}
+
 SDCARD_Status SDCARD_Init(HSDCARD)
 {
     return SDCARD_OK;
@@ -211,6 +318,24 @@ size_t SDCARD_Write(HSDCARD hsdcard, const uint8_t* buffer, uint32_t sector, uin
     return sdcard->Write(buffer, sector, count);
 }
 
+SDCARD_Status SDCARD_ReadAsync(HSDCARD hsdcard, uint8_t* buffer, uint32_t sector, uint32_t count, SDCARD_Callback callback, void* context)
+{
+    SDcardMock* sdcard = (SDcardMock*)(hsdcard);
+    return sdcard->ReadAsync(buffer, sector, count, callback, context);
+}
+
+SDCARD_Status SDCARD_WriteAsync(HSDCARD hsdcard, const uint8_t* buffer, uint32_t sector, uint32_t count, SDCARD_Callback callback, void* context)
+{
+    SDcardMock* sdcard = (SDcardMock*)(hsdcard);
+    return sdcard->WriteAsync(buffer, sector, count, callback, context);
+}
+
+SDCARD_Status SDCARD_Poll(HSDCARD hsdcard)
+{
+    SDcardMock* sdcard = (SDcardMock*)(hsdcard);
+    return sdcard->Poll();
+}
+
 // FAT SYSTEM
 SDCARD_Status SDCARD_FAT_Register(HSDCARD hsdcard, uint8_t drive_index)
 {
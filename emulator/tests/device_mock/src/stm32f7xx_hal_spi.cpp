@@ -1,12 +1,52 @@
 #include "stm32f7xx_hal_spi.h"
+#include <algorithm>
 
-HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef* /*hspi*/, uint8_t* /*transmit_data*/, size_t /*size*/, uint32_t /*timeout*/)
+static SPIStatistics s_statistics = { 0 };
+static SPIPeripheral s_peripheral;
+
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef* /*hspi*/, uint8_t* transmit_data, size_t size, uint32_t /*timeout*/)
 {
+    ++s_statistics.transmit_calls;
+    s_statistics.transmit_bytes += size;
+    if (s_peripheral)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            s_peripheral(transmit_data[i]);
+        }
+    }
     return HAL_OK;
 }
 
-HAL_StatusTypeDef HAL_SPI_TransmitReceive(SPI_HandleTypeDef* /*hspi*/, uint8_t* /*transmit_data*/, uint8_t* /*receive_data*/, size_t /*size*/, uint32_t /*timeout*/)
+HAL_StatusTypeDef HAL_SPI_TransmitReceive(SPI_HandleTypeDef* /*hspi*/, uint8_t* transmit_data, uint8_t* receive_data, size_t size, uint32_t /*timeout*/)
 {
+    ++s_statistics.transmit_receive_calls;
+    s_statistics.transmit_receive_bytes += size;
+    if (s_peripheral)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            receive_data[i] = s_peripheral(transmit_data[i]);
+        }
+    }
+    else if (transmit_data && receive_data)
+    {
+        std::copy(transmit_data, transmit_data + size, receive_data);
+    }
     return HAL_OK;
 }
 
+SPIStatistics& GetSPIStatistics()
+{
+    return s_statistics;
+}
+
+void ResetSPIStatistics()
+{
+    s_statistics = { 0 };
+}
+
+void ConnectSPIPeripheral(SPIPeripheral peripheral)
+{
+    s_peripheral = peripheral;
+}
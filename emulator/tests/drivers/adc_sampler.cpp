@@ -0,0 +1,222 @@
+#include "include/adc_sampler.h"
+#include "device_mock.h"
+#include <gtest/gtest.h>
+#include <memory>
+#include <random>
+#include <vector>
+
+TEST(ADCSampler_BasicTest, cannot_create_with_invalid_config)
+{
+    DeviceSettings ds;
+    Device device(ds);
+    AttachDevice(device);
+
+    ADC_HandleTypeDef adc = 0;
+    uint16_t buffer[64];
+    ASSERT_TRUE(nullptr == SAMPLER_Configure(0));
+
+    AdcSamplerConfig cfg = { &adc, buffer, 16, 2, 16, 0, nullptr, nullptr };
+    ASSERT_TRUE(nullptr != SAMPLER_Configure(&cfg));
+
+    AdcSamplerConfig no_buffer = cfg;
+    no_buffer.buffer = nullptr;
+    ASSERT_TRUE(nullptr == SAMPLER_Configure(&no_buffer));
+
+    AdcSamplerConfig too_many_channels = cfg;
+    too_many_channels.channels = ADC_SAMPLER_MAX_CHANNELS + 1;
+    ASSERT_TRUE(nullptr == SAMPLER_Configure(&too_many_channels));
+
+    AdcSamplerConfig not_power_of_two = cfg;
+    not_power_of_two.decimation = 12;
+    ASSERT_TRUE(nullptr == SAMPLER_Configure(&not_power_of_two));
+
+    // 16 samples add 2 bits at most
+    AdcSamplerConfig too_many_bits = cfg;
+    too_many_bits.extra_bits = 3;
+    ASSERT_TRUE(nullptr == SAMPLER_Configure(&too_many_bits));
+
+    // 1024 samples add 5 bits, but 17 bit values don't fit
+    AdcSamplerConfig too_wide_value = cfg;
+    too_wide_value.decimation = 1024;
+    too_wide_value.extra_bits = 5;
+    ASSERT_TRUE(nullptr == SAMPLER_Configure(&too_wide_value));
+
+    AdcSamplerConfig widest_value = cfg;
+    widest_value.decimation = 1024;
+    widest_value.extra_bits = 4;
+    ASSERT_TRUE(nullptr != SAMPLER_Configure(&widest_value));
+
+    DetachDevice();
+}
+
+class ADCSampler_Test : public ::testing::Test
+{
+protected:
+    static const uint16_t SEQUENCES = 12;
+    static const uint8_t CHANNELS = 2;
+
+    std::unique_ptr<Device> device;
+    ADC_HandleTypeDef adc = 0;
+    uint16_t buffer[2 * SEQUENCES * CHANNELS];
+    std::vector<std::vector<uint16_t>> samples;
+
+    virtual void SetUp()
+    {
+        DeviceSettings ds;
+        device = std::make_unique<Device>(ds);
+        AttachDevice(*device);
+        samples.resize(CHANNELS);
+    }
+
+    virtual void TearDown()
+    {
+        DetachDevice();
+    }
+
+    static void OnSample(uint8_t channel, uint16_t value, void* parameter)
+    {
+        ((ADCSampler_Test*)parameter)->samples[channel].push_back(value);
+    }
+
+    HADCSAMPLER Configure(uint16_t decimation, uint8_t extra_bits)
+    {
+        AdcSamplerConfig cfg = { &adc, buffer, SEQUENCES, CHANNELS, decimation, extra_bits, OnSample, this };
+        HADCSAMPLER sampler = SAMPLER_Configure(&cfg);
+        EXPECT_TRUE(SAMPLER_Start(sampler));
+        return sampler;
+    }
+
+    // emulates DMA interrupts for the conversions of the regular sequence
+    void Convert(HADCSAMPLER sampler, uint16_t nozzle, uint16_t table)
+    {
+        for (uint16_t value : { nozzle, table })
+        {
+            switch (device->ADC_Convert(value))
+            {
+            case Device::DMA_HALF_TRANSFER:
+                SAMPLER_HandleHalfTransfer(sampler);
+                break;
+            case Device::DMA_TRANSFER:
+                SAMPLER_HandleTransfer(sampler);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+};
+
+TEST_F(ADCSampler_Test, start_fills_buffer_circularly)
+{
+    HADCSAMPLER sampler = Configure(8, 0);
+    ASSERT_TRUE(device->IsADCDMAStarted());
+    // DMA is already running
+    ASSERT_FALSE(SAMPLER_Start(sampler));
+
+    for (uint16_t i = 1; i < SEQUENCES * CHANNELS; ++i)
+    {
+        ASSERT_EQ(Device::DMA_NONE, device->ADC_Convert(i));
+    }
+    ASSERT_EQ(Device::DMA_HALF_TRANSFER, device->ADC_Convert(0));
+    for (uint16_t i = 1; i < SEQUENCES * CHANNELS; ++i)
+    {
+        ASSERT_EQ(Device::DMA_NONE, device->ADC_Convert(i));
+    }
+    ASSERT_EQ(Device::DMA_TRANSFER, device->ADC_Convert(7));
+    ASSERT_EQ(7, buffer[2 * SEQUENCES * CHANNELS - 1]);
+
+    ASSERT_EQ(Device::DMA_NONE, device->ADC_Convert(9));
+    ASSERT_EQ(9, buffer[0]);
+
+    SAMPLER_Stop(sampler);
+    ASSERT_FALSE(device->IsADCDMAStarted());
+}
+
+TEST_F(ADCSampler_Test, values_are_produced_at_decimated_rate)
+{
+    HADCSAMPLER sampler = Configure(8, 0);
+    ASSERT_EQ(0, SAMPLER_GetValue(sampler, 0));
+
+    // the values are ready when the half of the buffer is processed
+    for (uint32_t i = 0; i < 8 * SEQUENCES; ++i)
+    {
+        Convert(sampler, 1000, 2000);
+    }
+    ASSERT_EQ(SEQUENCES, samples[0].size());
+    ASSERT_EQ(SEQUENCES, samples[1].size());
+    for (uint32_t i = 0; i < SEQUENCES; ++i)
+    {
+        ASSERT_EQ(1000, samples[0][i]);
+        ASSERT_EQ(2000, samples[1][i]);
+    }
+    ASSERT_EQ(1000, SAMPLER_GetValue(sampler, 0));
+    ASSERT_EQ(2000, SAMPLER_GetValue(sampler, 1));
+    ASSERT_EQ(0U, SAMPLER_GetOverruns(sampler));
+}
+
+TEST_F(ADCSampler_Test, decimation_spans_buffer_halves)
+{
+    // half of the buffer keeps 12 sequences, a value is produced per 8 sequences
+    HADCSAMPLER sampler = Configure(8, 0);
+    for (uint32_t i = 0; i < SEQUENCES; ++i)
+    {
+        Convert(sampler, 100, (uint16_t)(i < 8 ? 200 : 400));
+    }
+    ASSERT_EQ(1U, samples[1].size());
+    ASSERT_EQ(200, samples[1][0]);
+
+    // the rest of the first half is summed with the second one
+    for (uint32_t i = SEQUENCES; i < 2 * SEQUENCES; ++i)
+    {
+        Convert(sampler, 100, 400);
+    }
+    ASSERT_EQ(3U, samples[1].size());
+    ASSERT_EQ(400, samples[1][1]);
+    ASSERT_EQ(400, samples[1][2]);
+    ASSERT_EQ(100, samples[0][2]);
+}
+
+TEST_F(ADCSampler_Test, noise_is_averaged)
+{
+    HADCSAMPLER sampler = Configure(64, 0);
+    std::mt19937 generator(17);
+    std::uniform_int_distribution<int> noise(-40, 40);
+    for (uint32_t i = 0; i < 64 * 3 * SEQUENCES; ++i)
+    {
+        Convert(sampler, (uint16_t)(1500 + noise(generator)), (uint16_t)(3000 + noise(generator)));
+    }
+
+    ASSERT_EQ(3U * SEQUENCES, samples[0].size());
+    for (uint32_t i = 0; i < samples[0].size(); ++i)
+    {
+        ASSERT_NEAR(1500, samples[0][i], 10);
+        ASSERT_NEAR(3000, samples[1][i], 10);
+    }
+}
+
+TEST_F(ADCSampler_Test, oversampling_adds_resolution)
+{
+    HADCSAMPLER sampler = Configure(16, 2);
+    // the signal between two codes of the ADC is dithered by the noise
+    for (uint32_t i = 0; i < 16 * 3; ++i)
+    {
+        Convert(sampler, (uint16_t)(i % 4 ? 1000 : 1001), (uint16_t)(i % 2 ? 1000 : 1001));
+    }
+    ASSERT_EQ(3U, samples[0].size());
+    for (uint32_t i = 0; i < samples[0].size(); ++i)
+    {
+        // 1000.25 and 1000.5 in the scale of the 14 bit value
+        ASSERT_EQ(4001, samples[0][i]);
+        ASSERT_EQ(4002, samples[1][i]);
+    }
+}
+
+TEST_F(ADCSampler_Test, missed_half_is_counted)
+{
+    HADCSAMPLER sampler = Configure(8, 0);
+    SAMPLER_HandleHalfTransfer(sampler);
+    SAMPLER_HandleHalfTransfer(sampler);
+    ASSERT_EQ(1U, SAMPLER_GetOverruns(sampler));
+    SAMPLER_HandleTransfer(sampler);
+    ASSERT_EQ(1U, SAMPLER_GetOverruns(sampler));
+}
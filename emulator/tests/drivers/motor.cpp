@@ -97,6 +97,13 @@ TEST_F(Motor_Test, motor_step_pin_states)
     ASSERT_EQ(GPIO_PIN_RESET, device->GetPinState(step_port, step_pin).signals_log[1]);
 }
 
+TEST_F(Motor_Test, motor_step_port_writes)
+{
+    device->ResetPortWritesCount(step_port);
+    MOTOR_Step(hmotor);
+    ASSERT_EQ(2, device->GetPortWritesCount(step_port));
+}
+
 TEST_F(Motor_Test, motor_change_direction_cw)
 {
     MOTOR_SetDirection(hmotor, MOTOR_CW);
@@ -2,7 +2,9 @@
 #include "include/pulse_engine.h"
 #include "device_mock.h"
 #include <gtest/gtest.h>
+#include <chrono>
 #include <sstream>
+#include <vector>
 
 class PULSEBasicTest : public ::testing::Test
 {
@@ -563,3 +565,154 @@ INSTANTIATE_TEST_SUITE_P(
     }
     );
 
+
+class PULSEModeTest : public ::testing::Test
+{
+protected:
+    std::unique_ptr<Device> device;
+    HPULSE engines[2] = { nullptr };
+
+    virtual void SetUp()
+    {
+        DeviceSettings ds;
+        device = std::make_unique<Device>(ds);
+        AttachDevice(*device);
+        engines[PULSE_LOWER] = PULSE_Configure(PULSE_LOWER);
+        engines[PULSE_HIGHER] = PULSE_Configure(PULSE_HIGHER);
+    }
+
+    virtual void TearDown()
+    {
+        PULSE_Release(engines[PULSE_LOWER]);
+        PULSE_Release(engines[PULSE_HIGHER]);
+        DetachDevice();
+        device = nullptr;
+    }
+
+    // returns pulses produced by the engine in the requested mode
+    std::vector<bool> pulses(PULSE_MODE mode, PULSE_SINGAL signal_type, uint32_t period, uint32_t power, size_t ticks)
+    {
+        HPULSE pulse = engines[signal_type];
+        PULSE_SetMode(pulse, mode);
+        PULSE_SetPeriod(pulse, period);
+        PULSE_SetPower(pulse, power);
+        std::vector<bool> result;
+        for (size_t i = 0; i < ticks; ++i)
+        {
+            result.push_back(PULSE_HandleTick(pulse));
+        }
+        return result;
+    }
+};
+
+TEST_F(PULSEModeTest, accumulator_is_default_mode)
+{
+    for (PULSE_SINGAL signal_type : { PULSE_LOWER, PULSE_HIGHER })
+    {
+        HPULSE pulse = PULSE_Configure(signal_type);
+        PULSE_SetPeriod(pulse, 7);
+        PULSE_SetPower(pulse, 3);
+        std::vector<bool> result;
+        for (size_t i = 0; i < 14; ++i)
+        {
+            result.push_back(PULSE_HandleTick(pulse));
+        }
+        PULSE_Release(pulse);
+        ASSERT_EQ(pulses(PULSE_ACCUMULATOR, signal_type, 7, 3, 14), result);
+    }
+}
+
+TEST_F(PULSEModeTest, accumulator_matches_division)
+{
+    for (PULSE_SINGAL signal_type : { PULSE_LOWER, PULSE_HIGHER })
+    {
+        for (uint32_t period = 0; period < 70; ++period)
+        {
+            for (uint32_t power = 0; power < period + 3; ++power)
+            {
+                size_t ticks = period * 3 + 2;
+                ASSERT_EQ(pulses(PULSE_DIVISION, signal_type, period, power, ticks), pulses(PULSE_ACCUMULATOR, signal_type, period, power, ticks))
+                    << "signal " << signal_type << " period " << period << " power " << power;
+            }
+        }
+    }
+}
+
+TEST_F(PULSEModeTest, accumulator_matches_division_on_long_periods)
+{
+    // long periods use 64 bit calculations in the division mode
+    for (PULSE_SINGAL signal_type : { PULSE_LOWER, PULSE_HIGHER })
+    {
+        for (uint32_t period : { 0xFFFEu, 0xFFFFu, 0x10001u, 1000003u })
+        {
+            for (uint32_t power : { 1u, 3u, 1000u, 0x7FFFu, period - 1, period })
+            {
+                ASSERT_EQ(pulses(PULSE_DIVISION, signal_type, period, power, period + 10), pulses(PULSE_ACCUMULATOR, signal_type, period, power, period + 10))
+                    << "signal " << signal_type << " period " << period << " power " << power;
+            }
+        }
+    }
+}
+
+TEST_F(PULSEModeTest, modes_restart_signal_on_change)
+{
+    HPULSE reference = PULSE_Configure(PULSE_HIGHER);
+    HPULSE pulse = PULSE_Configure(PULSE_HIGHER);
+    PULSE_SetMode(reference, PULSE_DIVISION);
+    for (HPULSE p : { reference, pulse })
+    {
+        PULSE_SetPeriod(p, 50);
+        PULSE_SetPower(p, 17);
+    }
+    for (size_t i = 0; i < 500; ++i)
+    {
+        // power changes in a middle of the period, like acceleration does
+        if (i % 37 == 0)
+        {
+            PULSE_SetPower(reference, (uint32_t)(i % 50));
+            PULSE_SetPower(pulse, (uint32_t)(i % 50));
+        }
+        ASSERT_EQ(PULSE_HandleTick(reference), PULSE_HandleTick(pulse)) << "on tick " << i;
+    }
+    PULSE_Release(reference);
+    PULSE_Release(pulse);
+}
+
+TEST_F(PULSEModeTest, tick_benchmark)
+{
+    // 4 motors, accelerator and cooler handled on every tick of the main timer
+    const uint32_t periods[] = { 2400, 2400, 2400, 2400, 50, 255 };
+    const uint32_t powers[] = { 1733, 518, 3, 95, 27, 128 };
+    const size_t engines = sizeof(periods) / sizeof(periods[0]);
+    const size_t ticks = 2000000;
+
+    for (PULSE_MODE mode : { PULSE_DIVISION, PULSE_ACCUMULATOR })
+    {
+        std::vector<HPULSE> pulse(engines);
+        for (size_t i = 0; i < engines; ++i)
+        {
+            pulse[i] = PULSE_Configure(PULSE_LOWER);
+            PULSE_SetMode(pulse[i], mode);
+            PULSE_SetPeriod(pulse[i], periods[i]);
+            PULSE_SetPower(pulse[i], powers[i]);
+        }
+
+        size_t signals = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t tick = 0; tick < ticks; ++tick)
+        {
+            for (size_t i = 0; i < engines; ++i)
+            {
+                signals += PULSE_HandleTick(pulse[i]) ? 1 : 0;
+            }
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+        std::cout << (PULSE_DIVISION == mode ? "Division" : "Accumulator") << " mode: "
+            << (size_t)(ticks / elapsed) << " ticks per second of " << engines << " engines, " << signals << " signals" << std::endl;
+
+        for (HPULSE p : pulse)
+        {
+            PULSE_Release(p);
+        }
+    }
+}
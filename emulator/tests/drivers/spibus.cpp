@@ -2,6 +2,7 @@
 #include "include/spibus.h"
 #include "device_mock.h"
 #include <gtest/gtest.h>
+#include <algorithm>
 
 TEST(SPIBUS_BasicTest, can_create_spibus)
 {
@@ -133,6 +134,35 @@ TEST_F(SPIBUS_Test, cannot_unselect_nothing)
     ASSERT_EQ(SPIBUS_FAIL, SPIBUS_UnselectDevice(hspibus, spi_device+1));
 }
 
+TEST_F(SPIBUS_Test, receive_sector_by_single_call)
+{
+    std::vector<uint8_t> sector(512, 0);
+    ResetSPIStatistics();
+
+    ASSERT_EQ(HAL_OK, SPIBUS_Receive(hspibus, sector.data(), sector.size()));
+    ASSERT_EQ(1, GetSPIStatistics().transmit_receive_calls);
+    ASSERT_EQ(sector.size(), GetSPIStatistics().transmit_receive_bytes);
+}
+
+TEST_F(SPIBUS_Test, receive_transmits_guard)
+{
+    // HAL mock loops transmitted data back to the receive buffer
+    std::vector<uint8_t> data(100, 0);
+    SPIBUS_Receive(hspibus, data.data(), data.size());
+    ASSERT_TRUE(std::all_of(data.begin(), data.end(), [](uint8_t value) { return 0xFF == value; }));
+}
+
+TEST_F(SPIBUS_Test, receive_splits_large_data)
+{
+    std::vector<uint8_t> data(SPIBUS_ReceiveChunk * 2 + 2, 0);
+    ResetSPIStatistics();
+
+    ASSERT_EQ(HAL_OK, SPIBUS_Receive(hspibus, data.data(), data.size()));
+    ASSERT_EQ(3, GetSPIStatistics().transmit_receive_calls);
+    ASSERT_EQ(data.size(), GetSPIStatistics().transmit_receive_bytes);
+    ASSERT_TRUE(std::all_of(data.begin(), data.end(), [](uint8_t value) { return 0xFF == value; }));
+}
+
 class SPIBUS_DevicesTest : public ::testing::Test
 {
 protected:
@@ -213,3 +243,445 @@ TEST_F(SPIBUS_DevicesTest, unselect_all)
     }
 }
 
+
+TEST_F(SPIBUS_DevicesTest, device_selection_writes_port_once)
+{
+    // chip selects of all devices are on the same port
+    device->ResetPortWritesCount(port);
+    SPIBUS_SelectDevice(hspibus, SPIBUS_DeviceLimit / 3);
+    ASSERT_EQ(1, device->GetPortWritesCount(port));
+    SPIBUS_UnselectAll(hspibus);
+    ASSERT_EQ(2, device->GetPortWritesCount(port));
+}
+
+TEST_F(SPIBUS_Test, device_selection_on_several_ports)
+{
+    GPIO_TypeDef ports[2] = { 1, 2 };
+    for (uint16_t pin = 0; pin < 4; ++pin)
+    {
+        SPIBUS_AddPeripherialDevice(hspibus, &ports[pin % 2], pin);
+    }
+    device->ResetPortWritesCount(ports[0]);
+    device->ResetPortWritesCount(ports[1]);
+
+    SPIBUS_SelectDevice(hspibus, 3);
+    ASSERT_EQ(1, device->GetPortWritesCount(ports[0]));
+    ASSERT_EQ(1, device->GetPortWritesCount(ports[1]));
+    for (uint16_t pin = 0; pin < 4; ++pin)
+    {
+        ASSERT_EQ(device->GetPinState(ports[pin % 2], pin).state, (3 == pin) ? GPIO_PIN_RESET : GPIO_PIN_SET);
+    }
+}
+
+TEST_F(SPIBUS_DevicesTest, repeated_selection_writes_nothing)
+{
+    const size_t device_index = SPIBUS_DeviceLimit / 3;
+    device->ResetPortWritesCount(port);
+    SPIBUS_SelectDevice(hspibus, device_index);
+    SPIBUS_SelectDevice(hspibus, device_index);
+    ASSERT_EQ(1, device->GetPortWritesCount(port));
+    SPIBUS_UnselectDevice(hspibus, device_index);
+    SPIBUS_UnselectDevice(hspibus, device_index);
+    SPIBUS_UnselectDevice(hspibus, device_index + 1);
+    ASSERT_EQ(2, device->GetPortWritesCount(port));
+    ASSERT_EQ(device->GetPinState(port, device_index).state, GPIO_PIN_SET);
+}
+
+TEST_F(SPIBUS_DevicesTest, switching_devices_writes_port_once)
+{
+    const size_t device_index = SPIBUS_DeviceLimit / 3;
+    SPIBUS_SelectDevice(hspibus, device_index);
+    device->ResetPortWritesCount(port);
+    SPIBUS_SelectDevice(hspibus, device_index + 1);
+    ASSERT_EQ(1, device->GetPortWritesCount(port));
+    for (uint16_t pin = 0; pin < SPIBUS_DeviceLimit; ++pin)
+    {
+        ASSERT_EQ(device->GetPinState(port, pin).state, (device_index + 1 == pin) ? GPIO_PIN_RESET : GPIO_PIN_SET);
+    }
+}
+
+TEST_F(SPIBUS_DevicesTest, nested_transactions)
+{
+    const size_t device_index = SPIBUS_DeviceLimit / 3;
+    ASSERT_EQ(device_index, SPIBUS_BeginTransaction(hspibus, device_index));
+    ASSERT_EQ(device_index, SPIBUS_BeginTransaction(hspibus, device_index));
+
+    // inner selection of the same device doesn't release the bus
+    ASSERT_EQ(device_index, SPIBUS_SelectDevice(hspibus, device_index));
+    ASSERT_EQ(device_index, SPIBUS_UnselectDevice(hspibus, device_index));
+    ASSERT_EQ(device->GetPinState(port, device_index).state, GPIO_PIN_RESET);
+
+    // another device cannot take the bus
+    ASSERT_EQ(SPIBUS_FAIL, SPIBUS_SelectDevice(hspibus, device_index + 1));
+    ASSERT_EQ(SPIBUS_FAIL, SPIBUS_BeginTransaction(hspibus, device_index + 1));
+    ASSERT_EQ(SPIBUS_FAIL, SPIBUS_EndTransaction(hspibus, device_index + 1));
+
+    ASSERT_EQ(device_index, SPIBUS_EndTransaction(hspibus, device_index));
+    ASSERT_EQ(device->GetPinState(port, device_index).state, GPIO_PIN_RESET);
+    ASSERT_EQ(device_index, SPIBUS_EndTransaction(hspibus, device_index));
+    ASSERT_EQ(device->GetPinState(port, device_index).state, GPIO_PIN_SET);
+    ASSERT_EQ(SPIBUS_FAIL, SPIBUS_EndTransaction(hspibus, device_index));
+
+    ASSERT_EQ(device_index + 1, SPIBUS_SelectDevice(hspibus, device_index + 1));
+}
+
+TEST_F(SPIBUS_Test, unselect_all_drops_transaction)
+{
+    GPIO_TypeDef port = 0;
+    uint8_t first = (uint8_t)SPIBUS_AddPeripherialDevice(hspibus, &port, 0);
+    uint8_t second = (uint8_t)SPIBUS_AddPeripherialDevice(hspibus, &port, 1);
+    SPIBUS_BeginTransaction(hspibus, first);
+    SPIBUS_UnselectAll(hspibus);
+    ASSERT_EQ(device->GetPinState(port, 0).state, GPIO_PIN_SET);
+    ASSERT_EQ(second, SPIBUS_SelectDevice(hspibus, second));
+}
+
+TEST_F(SPIBUS_Test, ui_refresh_writes)
+{
+    // display and sd card share the port, touch is on another one
+    GPIO_TypeDef ports[2] = { 1, 2 };
+    uint8_t display = (uint8_t)SPIBUS_AddPeripherialDevice(hspibus, &ports[0], 0);
+    uint8_t touch   = (uint8_t)SPIBUS_AddPeripherialDevice(hspibus, &ports[1], 1);
+    uint8_t sdcard  = (uint8_t)SPIBUS_AddPeripherialDevice(hspibus, &ports[0], 2);
+    SPIBUS_UnselectAll(hspibus);
+
+    // a refresh reads the touch, draws a string and reads a few sectors
+    const size_t characters = 32;
+    const size_t sectors = 4;
+    uint8_t symbol[128] = {0};
+    uint8_t sector[512] = {0};
+    auto refresh = [&](bool transactions)
+    {
+        SPIBUS_SelectDevice(hspibus, touch);
+        SPIBUS_Transmit(hspibus, symbol, 3);
+        SPIBUS_UnselectDevice(hspibus, touch);
+
+        if (transactions)
+        {
+            SPIBUS_BeginTransaction(hspibus, display);
+        }
+        for (size_t c = 0; c < characters; ++c)
+        {
+            SPIBUS_SelectDevice(hspibus, display);
+            SPIBUS_Transmit(hspibus, symbol, sizeof(symbol));
+            SPIBUS_UnselectDevice(hspibus, display);
+        }
+        if (transactions)
+        {
+            SPIBUS_EndTransaction(hspibus, display);
+            SPIBUS_BeginTransaction(hspibus, sdcard);
+        }
+        for (size_t s = 0; s < sectors; ++s)
+        {
+            SPIBUS_SelectDevice(hspibus, sdcard);
+            SPIBUS_Receive(hspibus, sector, sizeof(sector));
+            SPIBUS_UnselectDevice(hspibus, sdcard);
+        }
+        if (transactions)
+        {
+            SPIBUS_EndTransaction(hspibus, sdcard);
+        }
+    };
+
+    auto writes = [&]()
+    {
+        return device->GetPortWritesCount(ports[0]) + device->GetPortWritesCount(ports[1]);
+    };
+
+    device->ResetPortWritesCount(ports[0]);
+    device->ResetPortWritesCount(ports[1]);
+    refresh(false);
+    size_t tracked = writes();
+
+    device->ResetPortWritesCount(ports[0]);
+    device->ResetPortWritesCount(ports[1]);
+    refresh(true);
+    size_t transaction = writes();
+
+    // every selection used to write all chip select ports and every unselection wrote the device pin
+    size_t selections = 1 + characters + sectors;
+    size_t untracked = selections * (2 + 1);
+    std::cout << "GPIO writes per UI refresh: untracked " << untracked << ", tracked " << tracked << ", transactions " << transaction << std::endl;
+
+    ASSERT_EQ(2 * selections, tracked);
+    ASSERT_EQ(2 * 3, transaction);
+    for (uint16_t pin = 0; pin < 3; ++pin)
+    {
+        ASSERT_EQ(device->GetPinState(ports[pin % 2], pin).state, GPIO_PIN_SET);
+    }
+}
+
+class SPIBUS_SchedulerTest : public ::testing::Test
+{
+protected:
+    HSPIBUS hspibus = nullptr;
+    std::unique_ptr<Device> device;
+    SPI_HandleTypeDef hspi = 0;
+    GPIO_TypeDef port = 0;
+    uint32_t storage = 0;
+    uint32_t display = 0;
+    uint32_t touch = 0;
+
+    // transaction of the test, records the execution order and emulates the transaction duration
+    struct Job
+    {
+        SPIBUS_SchedulerTest* test;
+        uint32_t device;
+        size_t   bytes;
+        uint32_t duration;
+        std::vector<uint32_t>* log;
+        uint32_t id;
+        bool     selected;
+    };
+
+    static HAL_StatusTypeDef runJob(HSPIBUS hspi, void* context)
+    {
+        Job* job = static_cast<Job*>(context);
+        job->selected = (GPIO_PIN_RESET == job->test->device->GetPinState(job->test->port, static_cast<uint16_t>(job->device)).state);
+        std::vector<uint8_t> data(job->bytes, 0);
+        HAL_StatusTypeDef status = SPIBUS_Transmit(hspi, data.data(), data.size());
+        job->test->device->AdvanceTick(job->duration);
+        job->log->push_back(job->id);
+        return status;
+    }
+
+    SPIBUS_Transaction makeTransaction(Job& job, SPIBUS_Priority priority)
+    {
+        SPIBUS_Transaction transaction = { job.device, priority, runJob, &job };
+        return transaction;
+    }
+
+    SPIBUS_Transaction makeTransaction(Job& job, SPIBUS_Priority priority, uint32_t deadline)
+    {
+        SPIBUS_Transaction transaction = { job.device, priority, runJob, &job, true, deadline };
+        return transaction;
+    }
+
+    virtual void SetUp()
+    {
+        DeviceSettings ds;
+        device = std::make_unique<Device>(ds);
+        AttachDevice(*device);
+
+        hspibus = SPIBUS_Configure(&hspi, 0);
+        // device ids match their chip select pins
+        storage = SPIBUS_AddPeripherialDevice(hspibus, &port, 0);
+        display = SPIBUS_AddPeripherialDevice(hspibus, &port, 1);
+        touch   = SPIBUS_AddPeripherialDevice(hspibus, &port, 2);
+        SPIBUS_UnselectAll(hspibus);
+    }
+
+    virtual void TearDown()
+    {
+        SPIBUS_Release(hspibus);
+        DetachDevice();
+        device = nullptr;
+    }
+};
+
+TEST_F(SPIBUS_SchedulerTest, runs_by_priority)
+{
+    std::vector<uint32_t> log;
+    Job jobs[] = {
+        { this, touch,   4,   0, &log, 0, false },
+        { this, display, 128, 0, &log, 1, false },
+        { this, storage, 512, 0, &log, 2, false },
+    };
+    SPIBUS_Transaction transactions[] = {
+        makeTransaction(jobs[0], SPIBUS_PRIORITY_TOUCH),
+        makeTransaction(jobs[1], SPIBUS_PRIORITY_UI),
+        makeTransaction(jobs[2], SPIBUS_PRIORITY_PREFETCH),
+    };
+    for (const auto& transaction : transactions)
+    {
+        ASSERT_EQ(SPIBUS_OK, SPIBUS_Submit(hspibus, &transaction));
+    }
+    // nothing is sent before the dispatch
+    ASSERT_TRUE(log.empty());
+
+    ResetSPIStatistics();
+    ASSERT_EQ(3, SPIBUS_Dispatch(hspibus, 0));
+    ASSERT_EQ(std::vector<uint32_t>({ 2, 1, 0 }), log);
+    ASSERT_EQ(3, GetSPIStatistics().transmit_calls);
+    ASSERT_EQ(4 + 128 + 512, GetSPIStatistics().transmit_bytes);
+    for (const Job& job : jobs)
+    {
+        ASSERT_TRUE(job.selected);
+        ASSERT_EQ(GPIO_PIN_SET, device->GetPinState(port, static_cast<uint16_t>(job.device)).state);
+    }
+}
+
+TEST_F(SPIBUS_SchedulerTest, same_priority_runs_by_deadline)
+{
+    std::vector<uint32_t> log;
+    Job jobs[] = {
+        { this, display, 1, 0, &log, 0, false },
+        { this, display, 1, 0, &log, 1, false },
+        { this, display, 1, 0, &log, 2, false },
+        { this, display, 1, 0, &log, 3, false },
+    };
+    SPIBUS_Transaction transactions[] = {
+        makeTransaction(jobs[0], SPIBUS_PRIORITY_UI),
+        makeTransaction(jobs[1], SPIBUS_PRIORITY_UI, 50),
+        makeTransaction(jobs[2], SPIBUS_PRIORITY_UI, 20),
+        makeTransaction(jobs[3], SPIBUS_PRIORITY_UI),
+    };
+    for (const auto& transaction : transactions)
+    {
+        ASSERT_EQ(SPIBUS_OK, SPIBUS_Submit(hspibus, &transaction));
+    }
+    ASSERT_EQ(4, SPIBUS_Dispatch(hspibus, 0));
+    // transactions without deadline keep the submission order
+    ASSERT_EQ(std::vector<uint32_t>({ 2, 1, 0, 3 }), log);
+}
+
+TEST_F(SPIBUS_SchedulerTest, deadline_at_tick_0)
+{
+    std::vector<uint32_t> log;
+    Job jobs[] = {
+        { this, display, 1, 0, &log, 0, false },
+        { this, display, 1, 0, &log, 1, false },
+    };
+    SPIBUS_Transaction transactions[] = {
+        makeTransaction(jobs[0], SPIBUS_PRIORITY_UI),
+        makeTransaction(jobs[1], SPIBUS_PRIORITY_UI, 0),
+    };
+    for (const auto& transaction : transactions)
+    {
+        ASSERT_EQ(SPIBUS_OK, SPIBUS_Submit(hspibus, &transaction));
+    }
+    device->AdvanceTick(1);
+    ASSERT_EQ(2, SPIBUS_Dispatch(hspibus, 0));
+    ASSERT_EQ(std::vector<uint32_t>({ 1, 0 }), log);
+
+    SPIBUS_Statistics statistics;
+    SPIBUS_GetStatistics(hspibus, &statistics);
+    ASSERT_EQ(1, statistics.missed_deadlines);
+}
+
+TEST_F(SPIBUS_SchedulerTest, queue_limit)
+{
+    std::vector<uint32_t> log;
+    Job job = { this, touch, 1, 0, &log, 0, false };
+    SPIBUS_Transaction transaction = makeTransaction(job, SPIBUS_PRIORITY_TOUCH);
+    for (size_t i = 0; i < SPIBUS_QueueLimit; ++i)
+    {
+        ASSERT_EQ(SPIBUS_OK, SPIBUS_Submit(hspibus, &transaction));
+    }
+    ASSERT_EQ(SPIBUS_FAIL, SPIBUS_Submit(hspibus, &transaction));
+
+    SPIBUS_Statistics statistics;
+    SPIBUS_GetStatistics(hspibus, &statistics);
+    ASSERT_EQ(SPIBUS_QueueLimit, statistics.queue_depth);
+    ASSERT_EQ(SPIBUS_QueueLimit, statistics.max_queue_depth);
+
+    ASSERT_EQ(3, SPIBUS_Dispatch(hspibus, 3));
+    SPIBUS_GetStatistics(hspibus, &statistics);
+    ASSERT_EQ(SPIBUS_QueueLimit - 3, statistics.queue_depth);
+    ASSERT_EQ(SPIBUS_OK, SPIBUS_Submit(hspibus, &transaction));
+}
+
+TEST_F(SPIBUS_SchedulerTest, invalid_transaction)
+{
+    std::vector<uint32_t> log;
+    Job job = { this, 5, 1, 0, &log, 0, false };
+    SPIBUS_Transaction transaction = makeTransaction(job, SPIBUS_PRIORITY_UI);
+    ASSERT_EQ(SPIBUS_FAIL, SPIBUS_Submit(hspibus, &transaction));
+    transaction.device = display;
+    transaction.handler = nullptr;
+    ASSERT_EQ(SPIBUS_FAIL, SPIBUS_Submit(hspibus, &transaction));
+    ASSERT_EQ(0, SPIBUS_Dispatch(hspibus, 0));
+}
+
+TEST_F(SPIBUS_SchedulerTest, prefetch_overtakes_ui_redraw)
+{
+    // the long redraw is split to the transactions, prefetch waits for the current one only
+    std::vector<uint32_t> log;
+    std::vector<Job> redraw;
+    for (uint32_t i = 0; i < 6; ++i)
+    {
+        redraw.push_back({ this, display, 1024, 5, &log, i, false });
+    }
+    Job poll = { this, touch, 4, 1, &log, 10, false };
+    for (auto& job : redraw)
+    {
+        SPIBUS_Transaction transaction = makeTransaction(job, SPIBUS_PRIORITY_UI);
+        ASSERT_EQ(SPIBUS_OK, SPIBUS_Submit(hspibus, &transaction));
+    }
+    SPIBUS_Transaction transaction = makeTransaction(poll, SPIBUS_PRIORITY_TOUCH);
+    ASSERT_EQ(SPIBUS_OK, SPIBUS_Submit(hspibus, &transaction));
+
+    ASSERT_EQ(2, SPIBUS_Dispatch(hspibus, 2));
+
+    // prefetch requested by the printer timer in the middle of the redraw
+    Job prefetch = { this, storage, 512, 2, &log, 20, false };
+    transaction = makeTransaction(prefetch, SPIBUS_PRIORITY_PREFETCH, HAL_GetTick() + 5);
+    ASSERT_EQ(SPIBUS_OK, SPIBUS_Submit(hspibus, &transaction));
+    ASSERT_EQ(6, SPIBUS_Dispatch(hspibus, 0));
+    ASSERT_EQ(std::vector<uint32_t>({ 0, 1, 20, 2, 3, 4, 5, 10 }), log);
+
+    SPIBUS_Statistics statistics;
+    SPIBUS_GetStatistics(hspibus, &statistics);
+    ASSERT_EQ(0, statistics.missed_deadlines);
+    ASSERT_EQ(0, statistics.failed);
+    ASSERT_EQ(0, statistics.queue_depth);
+    ASSERT_EQ(7, statistics.max_queue_depth);
+    ASSERT_EQ(1, statistics.executed[SPIBUS_PRIORITY_PREFETCH]);
+    ASSERT_EQ(6, statistics.executed[SPIBUS_PRIORITY_UI]);
+    ASSERT_EQ(1, statistics.executed[SPIBUS_PRIORITY_TOUCH]);
+    ASSERT_EQ(0, statistics.max_wait[SPIBUS_PRIORITY_PREFETCH]);
+    // ui transactions waited for the previous redraw parts and the prefetch
+    ASSERT_EQ(0 + 5 + 12 + 17 + 22 + 27, statistics.total_wait[SPIBUS_PRIORITY_UI]);
+    ASSERT_EQ(27, statistics.max_wait[SPIBUS_PRIORITY_UI]);
+    ASSERT_EQ(32, statistics.max_wait[SPIBUS_PRIORITY_TOUCH]);
+}
+
+TEST_F(SPIBUS_SchedulerTest, missed_deadline)
+{
+    std::vector<uint32_t> log;
+    Job redraw = { this, display, 1024, 10, &log, 0, false };
+    Job prefetch = { this, storage, 512, 1, &log, 1, false };
+    SPIBUS_Transaction transaction = makeTransaction(redraw, SPIBUS_PRIORITY_UI);
+    ASSERT_EQ(SPIBUS_OK, SPIBUS_Submit(hspibus, &transaction));
+    ASSERT_EQ(1, SPIBUS_Dispatch(hspibus, 1));
+    // prefetch submitted with a deadline that passes during the long ui transaction
+    transaction = makeTransaction(prefetch, SPIBUS_PRIORITY_PREFETCH, HAL_GetTick() + 2);
+    ASSERT_EQ(SPIBUS_OK, SPIBUS_Submit(hspibus, &transaction));
+    transaction = makeTransaction(redraw, SPIBUS_PRIORITY_UI);
+    ASSERT_EQ(SPIBUS_OK, SPIBUS_Submit(hspibus, &transaction));
+    device->AdvanceTick(5);
+    ASSERT_EQ(2, SPIBUS_Dispatch(hspibus, 0));
+
+    SPIBUS_Statistics statistics;
+    SPIBUS_GetStatistics(hspibus, &statistics);
+    ASSERT_EQ(1, statistics.missed_deadlines);
+    ASSERT_EQ(5, statistics.max_wait[SPIBUS_PRIORITY_PREFETCH]);
+
+    SPIBUS_ResetStatistics(hspibus);
+    SPIBUS_GetStatistics(hspibus, &statistics);
+    ASSERT_EQ(0, statistics.missed_deadlines);
+    ASSERT_EQ(0, statistics.executed[SPIBUS_PRIORITY_UI]);
+}
+
+// handler which submits the prefetch of the next sector
+static HAL_StatusTypeDef submitPrefetch(HSPIBUS hspi, void* context)
+{
+    SPIBUS_Transaction* next = static_cast<SPIBUS_Transaction*>(context);
+    return (SPIBUS_OK == SPIBUS_Submit(hspi, next) && 0 == SPIBUS_Dispatch(hspi, 0)) ? HAL_OK : HAL_ERROR;
+}
+
+TEST_F(SPIBUS_SchedulerTest, handler_submits_transaction)
+{
+    std::vector<uint32_t> log;
+    Job redraw = { this, display, 16, 0, &log, 0, false };
+    Job prefetch = { this, storage, 512, 0, &log, 1, false };
+    SPIBUS_Transaction next = makeTransaction(prefetch, SPIBUS_PRIORITY_PREFETCH);
+    SPIBUS_Transaction first = { display, SPIBUS_PRIORITY_UI, submitPrefetch, &next };
+    SPIBUS_Transaction transaction = makeTransaction(redraw, SPIBUS_PRIORITY_UI);
+
+    ASSERT_EQ(SPIBUS_OK, SPIBUS_Submit(hspibus, &first));
+    ASSERT_EQ(SPIBUS_OK, SPIBUS_Submit(hspibus, &transaction));
+    // the prefetch submitted by the handler is picked before the rest of the ui transactions
+    ASSERT_EQ(3, SPIBUS_Dispatch(hspibus, 0));
+    ASSERT_EQ(std::vector<uint32_t>({ 1, 0 }), log);
+}
@@ -0,0 +1,219 @@
+#include "include/stepper_group.h"
+#include "include/motor.h"
+#include "device_mock.h"
+#include <gtest/gtest.h>
+#include <chrono>
+
+TEST(STEPPERGROUP_BasicTest, cannot_create_group_without_config)
+{
+    DeviceSettings ds;
+    Device device(ds);
+    AttachDevice(device);
+
+    ASSERT_TRUE(nullptr == STEPPERGROUP_Configure(nullptr, 4));
+
+    GPIO_TypeDef port = 0;
+    MotorConfig configs[STEPPER_GROUP_MAX_AXES + 1];
+    for (uint16_t i = 0; i <= STEPPER_GROUP_MAX_AXES; ++i)
+    {
+        configs[i] = { PULSE_LOWER, &port, i, &port, (uint16_t)(i + STEPPER_GROUP_MAX_AXES) };
+    }
+    ASSERT_TRUE(nullptr == STEPPERGROUP_Configure(configs, 0));
+    ASSERT_TRUE(nullptr == STEPPERGROUP_Configure(configs, STEPPER_GROUP_MAX_AXES + 1));
+    ASSERT_TRUE(nullptr != STEPPERGROUP_Configure(configs, STEPPER_GROUP_MAX_AXES));
+
+    DetachDevice();
+}
+
+class StepperGroupTest : public ::testing::Test
+{
+protected:
+    static const uint8_t axes = 4;
+
+    std::unique_ptr<Device> device;
+    // group and the reference motors use different ports
+    GPIO_TypeDef group_step_port = 1;
+    GPIO_TypeDef group_dir_port = 2;
+    GPIO_TypeDef motor_step_port = 3;
+    GPIO_TypeDef motor_dir_port = 4;
+
+    HSTEPPERGROUP group = nullptr;
+    HMOTOR motors[axes] = { nullptr };
+
+    virtual void SetUp()
+    {
+        DeviceSettings ds;
+        device = std::make_unique<Device>(ds);
+        AttachDevice(*device);
+    }
+
+    virtual void TearDown()
+    {
+        DetachDevice();
+        device = nullptr;
+    }
+
+    void configure(PULSE_SINGAL signal_type)
+    {
+        MotorConfig configs[axes];
+        for (uint16_t i = 0; i < axes; ++i)
+        {
+            configs[i] = { signal_type, &group_step_port, i, &group_dir_port, i };
+            MotorConfig config = { signal_type, &motor_step_port, i, &motor_dir_port, i };
+            motors[i] = MOTOR_Configure(&config);
+        }
+        group = STEPPERGROUP_Configure(configs, axes);
+        ASSERT_TRUE(nullptr != group);
+    }
+
+    void setProgram(uint8_t axis, uint32_t ticks, int32_t distance)
+    {
+        STEPPERGROUP_SetProgram(group, axis, ticks, distance);
+        MOTOR_SetProgram(motors[axis], ticks, distance);
+    }
+
+    // executes programs by the group and by the motors, step masks should match steps of the motors
+    void run(size_t ticks)
+    {
+        for (size_t tick = 0; tick < ticks; ++tick)
+        {
+            uint8_t busy = 0;
+            uint8_t motor_steps = 0;
+            for (uint8_t i = 0; i < axes; ++i)
+            {
+                size_t signals = device->GetPinState(motor_step_port, i).signals_log.size();
+                MOTOR_HandleTick(motors[i]);
+                motor_steps |= (signals != device->GetPinState(motor_step_port, i).signals_log.size()) ? (1 << i) : 0;
+                busy |= (MOTOR_BUSY == MOTOR_GetState(motors[i])) ? (1 << i) : 0;
+            }
+
+            uint8_t steps = STEPPERGROUP_HandleTick(group);
+            STEPPERGROUP_Step(group, steps);
+            ASSERT_EQ(motor_steps, steps) << "on tick " << tick;
+            ASSERT_EQ(busy, STEPPERGROUP_GetBusyMask(group)) << "on tick " << tick;
+        }
+
+        for (uint16_t i = 0; i < axes; ++i)
+        {
+            ASSERT_EQ(device->GetPinState(motor_step_port, i).signals_log, device->GetPinState(group_step_port, i).signals_log) << "axis " << i;
+            ASSERT_EQ(device->GetPinState(motor_dir_port, i).signals_log, device->GetPinState(group_dir_port, i).signals_log) << "axis " << i;
+        }
+    }
+};
+
+TEST_F(StepperGroupTest, group_is_idle_by_default)
+{
+    configure(PULSE_LOWER);
+    ASSERT_EQ(0, STEPPERGROUP_GetBusyMask(group));
+    ASSERT_EQ(0, STEPPERGROUP_HandleTick(group));
+}
+
+TEST_F(StepperGroupTest, group_step_mask)
+{
+    configure(PULSE_LOWER);
+    STEPPERGROUP_SetProgram(group, 0, 2, 2);
+    STEPPERGROUP_SetProgram(group, 2, 2, -1);
+    ASSERT_EQ(0x05, STEPPERGROUP_GetBusyMask(group));
+
+    ASSERT_EQ(0x01, STEPPERGROUP_HandleTick(group));
+    ASSERT_EQ(0x05, STEPPERGROUP_HandleTick(group));
+    ASSERT_EQ(0, STEPPERGROUP_GetBusyMask(group));
+    ASSERT_EQ(0, STEPPERGROUP_HandleTick(group));
+}
+
+TEST_F(StepperGroupTest, group_step_signals)
+{
+    configure(PULSE_LOWER);
+    device->ResetPinGPIOCounters(group_step_port, 1);
+    device->ResetPinGPIOCounters(group_step_port, 3);
+    STEPPERGROUP_Step(group, 0x0A);
+
+    for (uint16_t pin : { 1, 3 })
+    {
+        ASSERT_EQ(2, device->GetPinState(group_step_port, pin).signals_log.size());
+        ASSERT_EQ(GPIO_PIN_SET, device->GetPinState(group_step_port, pin).signals_log[0]);
+        ASSERT_EQ(GPIO_PIN_RESET, device->GetPinState(group_step_port, pin).signals_log[1]);
+    }
+}
+
+TEST_F(StepperGroupTest, group_matches_motors)
+{
+    for (PULSE_SINGAL signal_type : { PULSE_LOWER, PULSE_HIGHER })
+    {
+        configure(signal_type);
+        setProgram(0, 1000, 733);
+        setProgram(1, 1000, -218);
+        setProgram(2, 1000, 3);
+        setProgram(3, 1000, -1000);
+        ASSERT_NO_FATAL_FAILURE(run(1100)) << "signal " << signal_type;
+
+        // programs of different length, some motors are reprogrammed while others are busy
+        setProgram(0, 0x10003, 0x8001);
+        setProgram(1, 17, 16);
+        setProgram(2, 250, 0);
+        ASSERT_NO_FATAL_FAILURE(run(100)) << "signal " << signal_type;
+        setProgram(1, 500, -499);
+        setProgram(3, 1, 1);
+        ASSERT_NO_FATAL_FAILURE(run(0x10100)) << "signal " << signal_type;
+    }
+}
+
+TEST_F(StepperGroupTest, group_steps_port_at_once)
+{
+    // step pins of all motors are on the same port
+    configure(PULSE_LOWER);
+    for (uint8_t i = 0; i < axes; ++i)
+    {
+        setProgram(i, 100, 100);
+    }
+    device->ResetPortWritesCount(group_step_port);
+    device->ResetPortWritesCount(motor_step_port);
+    ASSERT_NO_FATAL_FAILURE(run(100));
+
+    ASSERT_EQ(100 * 2, device->GetPortWritesCount(group_step_port));
+    ASSERT_EQ(100 * 2 * axes, device->GetPortWritesCount(motor_step_port));
+}
+
+TEST_F(StepperGroupTest, tick_benchmark)
+{
+    configure(PULSE_LOWER);
+    const size_t ticks = 1000000;
+    const int32_t distances[axes] = { 1733, -518, 3, 95 };
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t tick = 0; tick < ticks; ++tick)
+    {
+        if (0 == tick % 2400)
+        {
+            for (uint8_t i = 0; i < axes; ++i)
+            {
+                MOTOR_SetProgram(motors[i], 2400, distances[i]);
+            }
+        }
+        uint8_t state = 0;
+        for (uint8_t i = 0; i < axes; ++i)
+        {
+            MOTOR_HandleTick(motors[i]);
+            state |= MOTOR_GetState(motors[i]);
+        }
+    }
+    double motors_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+    start = std::chrono::high_resolution_clock::now();
+    for (size_t tick = 0; tick < ticks; ++tick)
+    {
+        if (0 == tick % 2400)
+        {
+            for (uint8_t i = 0; i < axes; ++i)
+            {
+                STEPPERGROUP_SetProgram(group, i, 2400, distances[i]);
+            }
+        }
+        STEPPERGROUP_Step(group, STEPPERGROUP_HandleTick(group));
+    }
+    double group_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+    std::cout << "Ticks per second of " << (int)axes << " axes" << std::endl
+        << "    motors: " << (size_t)(ticks / motors_time) << std::endl
+        << "    stepper group: " << (size_t)(ticks / group_time) << std::endl;
+}
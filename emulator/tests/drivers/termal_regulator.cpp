@@ -1,6 +1,9 @@
 #include "include/termal_regulator.h"
 #include "device_mock.h"
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
 
 TEST(TermalRegulator_BasicTest, cannot_create_without_config)
 {
@@ -80,6 +83,17 @@ TEST_F(TermalRegulator_Test, set_target)
     ASSERT_EQ(target_temperature, TR_GetTargetTemperature(termal_regulator));
 }
 
+TEST_F(TermalRegulator_Test, last_target_is_applied_by_next_value)
+{
+    TR_SetTargetTemperature(termal_regulator, 260);
+    TR_SetTargetTemperature(termal_regulator, 25);
+    ASSERT_EQ(25, TR_GetTargetTemperature(termal_regulator));
+
+    setTemperature(25);
+    ASSERT_TRUE(TR_IsTemperatureReached(termal_regulator));
+    ASSERT_EQ(25, TR_GetTargetTemperature(termal_regulator));
+}
+
 TEST_F(TermalRegulator_Test, can_update_temperature)
 {
     const uint16_t current_temperature = 25;
@@ -103,6 +117,17 @@ TEST_F(TermalRegulator_Test, update_temperature_complete_backet)
     ASSERT_EQ(current_temperature, TR_GetCurrentTemperature(termal_regulator));
 }
 
+TEST_F(TermalRegulator_Test, backet_of_one_value_updates_on_each_value)
+{
+    TermalRegulatorConfig cfg = { &port, 0, GPIO_PIN_SET, GPIO_PIN_RESET, 1.f, 0.f, 0, 0, 1 };
+    HTERMALREGULATOR decimated = TR_Configure(&cfg);
+
+    TR_SetADCValue(decimated, 25);
+    ASSERT_EQ(25, TR_GetCurrentTemperature(decimated));
+    TR_SetADCValue(decimated, 30);
+    ASSERT_EQ(30, TR_GetCurrentTemperature(decimated));
+}
+
 TEST_F(TermalRegulator_Test, update_temperature_next_backet_incomplete)
 {
     uint16_t current_temperature = 25;
@@ -147,6 +172,25 @@ TEST_F(TermalRegulator_Test, set_target_temperature_restarts_backet)
     ASSERT_EQ(target_temperature, TR_GetCurrentTemperature(termal_regulator));
 }
 
+TEST_F(TermalRegulator_Test, heater_pin_is_written_on_change)
+{
+    TR_SetTargetTemperature(termal_regulator, 260);
+    setTemperature(25);
+    device->ResetPortWritesCount(port);
+    device->ResetPinGPIOCounters(port, 0);
+
+    size_t changes = 0;
+    GPIO_PinState state = GPIO_PIN_SET;
+    for (size_t i = 0; i < TERMAL_REGULATOR_HEAT_PERIOD * 4; ++i)
+    {
+        TR_HandleTick(termal_regulator);
+        changes += (0 == i || state != device->GetPinState(port, 0).state) ? 1 : 0;
+        state = device->GetPinState(port, 0).state;
+    }
+    ASSERT_EQ(changes, device->GetPortWritesCount(port));
+    ASSERT_LT(device->GetPortWritesCount(port), TERMAL_REGULATOR_HEAT_PERIOD * 4);
+}
+
 TEST_F(TermalRegulator_Test, temperature_target_not_reach)
 {
     ASSERT_FALSE(TR_IsTemperatureReached(termal_regulator));
@@ -311,6 +355,166 @@ TEST_F(TermalRegulatorTemperature_Test, V_to_T_target_higer)
     ASSERT_TRUE(TR_IsTemperatureReached(termal_regulator));
 }
 
+TEST(TermalRegulator_BasicTest, cannot_create_with_invalid_table)
+{
+    DeviceSettings ds;
+    Device device(ds);
+    AttachDevice(device);
+
+    GPIO_TypeDef port = 1;
+    TermalCalibrationPoint unsorted[] = { { 100, 3200 }, { 50, 1600 }, { 200, 0 } };
+    TermalCalibrationPoint not_monotonic[] = { { 100, 3200 }, { 150, 1600 }, { 200, 2400 } };
+    TermalCalibrationPoint valid[] = { { 100, 3200 }, { 150, 1600 }, { 200, 0 } };
+
+    TermalRegulatorConfig cfg = { &port, 0, GPIO_PIN_SET, GPIO_PIN_RESET, 0.f, 0.f, unsorted, 3 };
+    ASSERT_TRUE(nullptr == TR_Configure(&cfg));
+    cfg.table = not_monotonic;
+    ASSERT_TRUE(nullptr == TR_Configure(&cfg));
+    cfg.table = valid;
+    cfg.table_size = 1;
+    ASSERT_TRUE(nullptr == TR_Configure(&cfg));
+    // the line isn't required with the table
+    cfg.table_size = 3;
+    ASSERT_TRUE(nullptr != TR_Configure(&cfg));
+
+    DetachDevice();
+}
+
+// 100K NTC thermistor with B = 3950 to the ground and 4.7K pull-up, 12 bit ADC. The temperature decreases with the code
+class TermalRegulatorTable_Test : public ::testing::Test
+{
+protected:
+    std::unique_ptr<Device> device;
+    HTERMALREGULATOR termal_regulator;
+    GPIO_TypeDef port = 1;
+    std::vector<TermalCalibrationPoint> table;
+
+    static double thermistorCode(double temperature)
+    {
+        double resistance = 100000. * std::exp(3950. * (1. / (temperature + 273.15) - 1. / 298.15));
+        return 4095. * resistance / (resistance + 4700.);
+    }
+
+    static double thermistorTemperature(uint16_t code)
+    {
+        double resistance = 4700. * code / (4095. - code);
+        return 1. / (1. / 298.15 + std::log(resistance / 100000.) / 3950.) - 273.15;
+    }
+
+    virtual void SetUp()
+    {
+        DeviceSettings ds;
+        device = std::make_unique<Device>(ds);
+        AttachDevice(*device);
+
+        // points every 10 degrees, codes are increasing
+        for (int temperature = 300; temperature >= 0; temperature -= 10)
+        {
+            table.push_back({ (uint16_t)std::lround(thermistorCode(temperature)), temperature * TERMAL_REGULATOR_TEMPERATURE_SCALE });
+        }
+        TermalRegulatorConfig cfg = { &port, 0, GPIO_PIN_SET, GPIO_PIN_RESET, 0.f, 0.f, table.data(), (uint16_t)table.size() };
+        termal_regulator = TR_Configure(&cfg);
+    }
+
+    virtual void TearDown()
+    {
+        DetachDevice();
+        device = nullptr;
+    }
+
+    void setCode(uint16_t code)
+    {
+        for (size_t i = 0; i < TERMAL_REGULATOR_BACKET_SIZE; ++i)
+        {
+            TR_SetADCValue(termal_regulator, code);
+        }
+    }
+
+    // ticks of the heat period the heater is on
+    uint32_t heatingTicks()
+    {
+        uint32_t ticks = 0;
+        for (size_t i = 0; i < TERMAL_REGULATOR_HEAT_PERIOD; ++i)
+        {
+            TR_HandleTick(termal_regulator);
+            ticks += (GPIO_PIN_SET == device->GetPinState(port, 0).state) ? 1 : 0;
+        }
+        return ticks;
+    }
+};
+
+TEST_F(TermalRegulatorTable_Test, table_follows_thermistor_curve)
+{
+    ASSERT_TRUE(nullptr != termal_regulator);
+    for (uint16_t code = (uint16_t)thermistorCode(260); code <= (uint16_t)thermistorCode(20); code += 7)
+    {
+        setCode(code);
+        ASSERT_NEAR(thermistorTemperature(code), TR_GetCurrentTemperature(termal_regulator), 1.5) << "code " << code;
+    }
+}
+
+TEST_F(TermalRegulatorTable_Test, values_are_clamped_to_table)
+{
+    setCode(50);
+    ASSERT_EQ(300, TR_GetCurrentTemperature(termal_regulator));
+    setCode(4090);
+    ASSERT_EQ(0, TR_GetCurrentTemperature(termal_regulator));
+}
+
+TEST_F(TermalRegulatorTable_Test, target_is_reached_by_decreasing_code)
+{
+    TR_SetTargetTemperature(termal_regulator, 215);
+    ASSERT_EQ(215, TR_GetTargetTemperature(termal_regulator));
+
+    setCode((uint16_t)thermistorCode(25));
+    ASSERT_FALSE(TR_IsTemperatureReached(termal_regulator));
+    setCode((uint16_t)thermistorCode(200));
+    ASSERT_FALSE(TR_IsTemperatureReached(termal_regulator));
+    setCode((uint16_t)thermistorCode(216));
+    ASSERT_TRUE(TR_IsTemperatureReached(termal_regulator));
+}
+
+TEST_F(TermalRegulatorTable_Test, heater_is_on_when_cold)
+{
+    TR_SetTargetTemperature(termal_regulator, 200);
+    setCode((uint16_t)thermistorCode(25));
+    ASSERT_EQ(TERMAL_REGULATOR_HEAT_PERIOD, heatingTicks());
+    setCode((uint16_t)thermistorCode(190));
+    ASSERT_EQ(TERMAL_REGULATOR_HEAT_PERIOD, heatingTicks());
+}
+
+TEST_F(TermalRegulatorTable_Test, heater_is_off_when_hot)
+{
+    TR_SetTargetTemperature(termal_regulator, 200);
+    setCode((uint16_t)thermistorCode(280));
+    ASSERT_EQ(0U, heatingTicks());
+    setCode((uint16_t)thermistorCode(210));
+    ASSERT_EQ(0U, heatingTicks());
+
+    // switched off heater isn't heated at the room temperature
+    TR_SetTargetTemperature(termal_regulator, 0);
+    setCode((uint16_t)thermistorCode(25));
+    ASSERT_EQ(0U, heatingTicks());
+}
+
+TEST_F(TermalRegulatorTable_Test, heater_follows_target)
+{
+    // the heater is switched on below the target and off above it, while the temperature passes the target
+    TR_SetTargetTemperature(termal_regulator, 200);
+    for (int temperature = 25; temperature <= 280; temperature += 15)
+    {
+        setCode((uint16_t)thermistorCode(temperature));
+        if (temperature < 200)
+        {
+            ASSERT_LT(0U, heatingTicks()) << temperature;
+        }
+        else
+        {
+            ASSERT_EQ(0U, heatingTicks()) << temperature;
+        }
+    }
+}
+
 class TermalRegulatorCorrector_Test : public ::testing::Test
 {
 protected:
@@ -606,3 +810,197 @@ TEST_F(TermalRegulatorCorrector_Test, regulator_stabilized_heat)
 }
 
 
+
+// Nozzle heater block and its sensor as two lags: the heater heats the block towards the ambient
+// temperature plus the heater range, the sensor follows the block with a delay. One temperature update
+// takes TERMAL_REGULATOR_HEAT_PERIOD ticks, it is one second of the simulation
+class TermalRegulatorPlant_Test : public ::testing::Test
+{
+protected:
+    std::unique_ptr<Device> device;
+    HTERMALREGULATOR termal_regulator;
+    GPIO_TypeDef port = 1;
+    TermalRegulatorConfig cfg = { &port, 0, GPIO_PIN_SET, GPIO_PIN_RESET, 0.1f, 0.f };
+
+    const double ambient = 25;
+    const double heater_range = 300;
+    const double block_lag = 120;   // seconds
+    const double sensor_lag = 8;    // seconds
+    double block = ambient;
+    double sensor = ambient;
+
+    struct Response
+    {
+        uint32_t time_to_target;    // updates till the sensor gets 1 degree close to the target
+        uint32_t settling_time;     // updates till the sensor stays 1 degree close to the target
+        double   overshoot;         // degrees over the target after it is reached
+        double   deviation;         // max deviation from the target during the last minute
+    };
+
+    virtual void SetUp()
+    {
+        DeviceSettings ds;
+        device = std::make_unique<Device>(ds);
+        AttachDevice(*device);
+
+        termal_regulator = TR_Configure(&cfg);
+        measure();
+    }
+
+    virtual void TearDown()
+    {
+        DetachDevice();
+        device = nullptr;
+    }
+
+    void measure()
+    {
+        for (size_t i = 0; i < TERMAL_REGULATOR_BACKET_SIZE; ++i)
+        {
+            TR_SetADCValue(termal_regulator, (uint16_t)(sensor / cfg.line_angle));
+        }
+    }
+
+    void update()
+    {
+        const double dt = 1.0 / TERMAL_REGULATOR_HEAT_PERIOD;
+        for (size_t i = 0; i < TERMAL_REGULATOR_HEAT_PERIOD; ++i)
+        {
+            TR_HandleTick(termal_regulator);
+            double power = (cfg.heat_value == device->GetPinState(port, 0).state) ? 1.0 : 0.0;
+            block += (ambient + heater_range * power - block) * dt / block_lag;
+            sensor += (block - sensor) * dt / sensor_lag;
+        }
+        measure();
+    }
+
+    Response run(uint16_t target, uint32_t updates)
+    {
+        Response response = { updates, 0, 0, 0 };
+        for (uint32_t i = 0; i < updates; ++i)
+        {
+            update();
+            if (response.time_to_target == updates && std::abs(sensor - target) <= 1)
+            {
+                response.time_to_target = i + 1;
+            }
+            if (response.time_to_target < updates)
+            {
+                response.overshoot = std::max(response.overshoot, sensor - target);
+            }
+            if (std::abs(sensor - target) > 1)
+            {
+                response.settling_time = i + 1;
+            }
+            if (i + 60 >= updates)
+            {
+                response.deviation = std::max(response.deviation, std::abs(sensor - target));
+            }
+        }
+        return response;
+    }
+
+    void autotune(uint16_t temperature)
+    {
+        TR_StartAutotune(termal_regulator, temperature);
+        for (uint32_t i = 0; i < TERMAL_REGULATOR_AUTOTUNE_LIMIT && TR_MODE_AUTOTUNE == TR_GetMode(termal_regulator); ++i)
+        {
+            update();
+        }
+    }
+
+    void cooldown()
+    {
+        block = sensor = ambient;
+        measure();
+    }
+};
+
+TEST_F(TermalRegulatorPlant_Test, autotune_measures_gains)
+{
+    autotune(200);
+    ASSERT_EQ(TR_MODE_PID, TR_GetMode(termal_regulator));
+
+    TermalRegulatorGains gains;
+    TR_GetGains(termal_regulator, &gains);
+    ASSERT_GT(gains.kp, 0);
+    ASSERT_GT(gains.ki, 0);
+    ASSERT_GT(gains.kd, 0);
+    // the steady power keeps 200 degrees
+    ASSERT_NEAR((200 - ambient) / heater_range, gains.feed_forward * 200, 0.05);
+
+    // the heater is switched off after the autotune
+    ASSERT_EQ(0, TR_GetTargetTemperature(termal_regulator));
+}
+
+TEST_F(TermalRegulatorPlant_Test, autotune_fails_without_oscillations)
+{
+    // the heater can't reach the temperature
+    autotune(400);
+    ASSERT_EQ(TR_MODE_STEPPING, TR_GetMode(termal_regulator));
+}
+
+TEST_F(TermalRegulatorPlant_Test, new_target_cancels_autotune)
+{
+    TR_StartAutotune(termal_regulator, 200);
+    ASSERT_EQ(TR_MODE_AUTOTUNE, TR_GetMode(termal_regulator));
+    TR_SetTargetTemperature(termal_regulator, 100);
+    ASSERT_EQ(TR_MODE_STEPPING, TR_GetMode(termal_regulator));
+}
+
+TEST_F(TermalRegulatorPlant_Test, pid_reaches_target_faster)
+{
+    TR_SetTargetTemperature(termal_regulator, 200);
+    Response stepping = run(200, 1800);
+
+    cooldown();
+    autotune(200);
+    cooldown();
+    TR_SetTargetTemperature(termal_regulator, 200);
+    Response pid = run(200, 1800);
+
+    std::cout << "stepping: " << stepping.time_to_target << " s to target, settled in " << stepping.settling_time
+              << " s, overshoot " << stepping.overshoot << ", deviation " << stepping.deviation << std::endl;
+    std::cout << "pid: " << pid.time_to_target << " s to target, settled in " << pid.settling_time
+              << " s, overshoot " << pid.overshoot << ", deviation " << pid.deviation << std::endl;
+
+    ASSERT_LT(pid.settling_time, stepping.settling_time);
+    ASSERT_LT(pid.overshoot, 3);
+    ASSERT_LT(pid.deviation, 1);
+}
+
+TEST_F(TermalRegulatorPlant_Test, pid_holds_other_temperature)
+{
+    autotune(200);
+    cooldown();
+    TR_SetTargetTemperature(termal_regulator, 240);
+    Response pid = run(240, 1800);
+
+    ASSERT_LT(pid.overshoot, 3);
+    ASSERT_LT(pid.deviation, 1);
+}
+
+TEST_F(TermalRegulatorPlant_Test, pid_integral_doesnt_wind_up)
+{
+    autotune(200);
+
+    // the heater is saturated for a long time by the unreachable temperature
+    TR_SetTargetTemperature(termal_regulator, 400);
+    run(400, 1200);
+    ASSERT_GT(sensor, 300);
+
+    // the heater is switched off till the new target is reached
+    TR_SetTargetTemperature(termal_regulator, 250);
+    Response pid = run(250, 1800);
+    ASSERT_LT(pid.time_to_target, 600U);
+    ASSERT_LT(pid.deviation, 1);
+}
+
+TEST_F(TermalRegulatorPlant_Test, pid_switches_heater_off)
+{
+    TermalRegulatorGains gains = { 0.1f, 0.001f, 1.f, 0.003f };
+    TR_SetGains(termal_regulator, &gains);
+    TR_SetTargetTemperature(termal_regulator, 0);
+    run(0, 100);
+    ASSERT_NEAR(ambient, sensor, 0.1);
+}
@@ -3,6 +3,7 @@
 #include "device_mock.h"
 
 #include <gtest/gtest.h>
+#include <chrono>
 
 TEST(GCodeBasicTest, cannot_create_without_config)
 {
@@ -563,7 +564,8 @@ INSTANTIATE_TEST_SUITE_P(
         CompilerCommand{ "enable_cooler",               "M106 S256",                        GCODE_SUBCOMMAND,   GCODE_SET_COOLER_SPEED },
         CompilerCommand{ "disable_cooler",              "M107",                             GCODE_SUBCOMMAND,   GCODE_SET_COOLER_SPEED },
         CompilerCommand{ "wait_nozzle_to_heat",         "M109 S256",                        GCODE_SUBCOMMAND,   GCODE_WAIT_NOZZLE },
-        CompilerCommand{ "wait_table_to_heat",          "M190 S256",                        GCODE_SUBCOMMAND,   GCODE_WAIT_TABLE }
+        CompilerCommand{ "wait_table_to_heat",          "M190 S256",                        GCODE_SUBCOMMAND,   GCODE_WAIT_TABLE },
+        CompilerCommand{ "autotune_regulator",          "M303 S200 P0",                     GCODE_SUBCOMMAND,   GCODE_AUTOTUNE }
     ),
     [](const ::testing::TestParamInfo<GCodeCommandCompilerTest::ParamType>& info)
     {
@@ -1016,6 +1018,319 @@ TEST(GCodeParserSpeedLimitTest, fetch_speed_limited)
     device = nullptr;
 }
 
+class GCodeBufferParserTest : public ::testing::Test
+{
+protected:
+    std::unique_ptr<Device> device;
+    HGCODE code = nullptr;
+    std::vector<uint8_t> output;
+
+    virtual void SetUp()
+    {
+        DeviceSettings ds;
+        device = std::make_unique<Device>(ds);
+        AttachDevice(*device);
+
+        GCodeAxisConfig cfg = { 1, 1, 1, 100 };
+        code = GC_Configure(&cfg, 0);
+        output.resize(512);
+    }
+
+    virtual void TearDown()
+    {
+        DetachDevice();
+        device = nullptr;
+    }
+
+    GCodeBuffer makeBuffer(std::string& text, bool end_of_stream)
+    {
+        return GCodeBuffer{ &text[0], (uint32_t)text.size(), 0, end_of_stream, nullptr };
+    }
+};
+
+TEST_F(GCodeBufferParserTest, whole_block_consumed)
+{
+    std::string text = "G0 X1\nG1 X2 Y3\n;comment\n\nM104 S200\n";
+    GCodeBuffer input = makeBuffer(text, false);
+    uint32_t bytes_written = 0;
+    ASSERT_EQ((int)GCODE_OK_NO_COMMAND, (int)GC_ParseBuffer(code, &input, output.data(), (uint32_t)output.size(), &bytes_written));
+    ASSERT_EQ(3 * GCODE_CHUNK_SIZE, bytes_written);
+    ASSERT_EQ(input.size, input.caret);
+}
+
+TEST_F(GCodeBufferParserTest, commands_content)
+{
+    std::string text = "G0 X1\nG1 X2 Y3\nM104 S200\n";
+    GCodeBuffer input = makeBuffer(text, false);
+    uint32_t bytes_written = 0;
+    GC_ParseBuffer(code, &input, output.data(), (uint32_t)output.size(), &bytes_written);
+
+    GCODE_COMMAND_LIST id;
+    GCodeCommandParams* params = GC_DecompileFromBuffer(output.data() + GCODE_CHUNK_SIZE, &id);
+    ASSERT_TRUE(nullptr != params);
+    ASSERT_EQ(GCODE_MOVE, id);
+    ASSERT_EQ(2, params->x);
+    ASSERT_EQ(3, params->y);
+    ASSERT_EQ((uint32_t)(GCODE_SUBCOMMAND | GCODE_SET_NOZZLE_TEMPERATURE), *(uint32_t*)(output.data() + 2 * GCODE_CHUNK_SIZE));
+}
+
+TEST_F(GCodeBufferParserTest, state_commands_not_written)
+{
+    std::string text = "G91\nG0 X1\nG0 X1\nG90\n";
+    GCodeBuffer input = makeBuffer(text, false);
+    uint32_t bytes_written = 0;
+    GC_ParseBuffer(code, &input, output.data(), (uint32_t)output.size(), &bytes_written);
+    ASSERT_EQ(2 * GCODE_CHUNK_SIZE, bytes_written);
+
+    GCODE_COMMAND_LIST id;
+    ASSERT_EQ(2, GC_DecompileFromBuffer(output.data() + GCODE_CHUNK_SIZE, &id)->x);
+}
+
+TEST_F(GCodeBufferParserTest, unfinished_line_is_carried)
+{
+    std::string first = "G0 X1\nG1 X2";
+    std::string second = "0 Y30\nG1 X5\n";
+    uint32_t bytes_written = 0;
+
+    GCodeBuffer input = makeBuffer(first, false);
+    ASSERT_EQ((int)GCODE_OK_NO_COMMAND, (int)GC_ParseBuffer(code, &input, output.data(), (uint32_t)output.size(), &bytes_written));
+    ASSERT_EQ(GCODE_CHUNK_SIZE, bytes_written);
+
+    input = makeBuffer(second, false);
+    ASSERT_EQ((int)GCODE_OK_NO_COMMAND, (int)GC_ParseBuffer(code, &input, output.data(), (uint32_t)output.size(), &bytes_written));
+    ASSERT_EQ(2 * GCODE_CHUNK_SIZE, bytes_written);
+
+    GCODE_COMMAND_LIST id;
+    GCodeCommandParams* params = GC_DecompileFromBuffer(output.data(), &id);
+    ASSERT_EQ(20, params->x);
+    ASSERT_EQ(30, params->y);
+}
+
+TEST_F(GCodeBufferParserTest, last_line_without_terminator)
+{
+    std::string text = "G0 X1\nG1 X2";
+    GCodeBuffer input = makeBuffer(text, true);
+    uint32_t bytes_written = 0;
+    ASSERT_EQ((int)GCODE_OK_NO_COMMAND, (int)GC_ParseBuffer(code, &input, output.data(), (uint32_t)output.size(), &bytes_written));
+    ASSERT_EQ(2 * GCODE_CHUNK_SIZE, bytes_written);
+}
+
+TEST_F(GCodeBufferParserTest, carried_line_finished_by_end_of_stream)
+{
+    std::string first = "G0 X1\nG1 X2";
+    std::string second = "";
+    uint32_t bytes_written = 0;
+
+    GCodeBuffer input = makeBuffer(first, false);
+    GC_ParseBuffer(code, &input, output.data(), (uint32_t)output.size(), &bytes_written);
+
+    input = GCodeBuffer{ nullptr, 0, 0, true, nullptr };
+    ASSERT_EQ((int)GCODE_OK_NO_COMMAND, (int)GC_ParseBuffer(code, &input, output.data(), (uint32_t)output.size(), &bytes_written));
+    ASSERT_EQ(GCODE_CHUNK_SIZE, bytes_written);
+}
+
+TEST_F(GCodeBufferParserTest, output_overflow)
+{
+    std::string text = "G0 X1\nG0 X2\nG0 X3\n";
+    GCodeBuffer input = makeBuffer(text, false);
+    uint32_t bytes_written = 0;
+    ASSERT_EQ((int)GCODE_OK_COMMAND_CREATED, (int)GC_ParseBuffer(code, &input, output.data(), 2 * GCODE_CHUNK_SIZE, &bytes_written));
+    ASSERT_EQ(2 * GCODE_CHUNK_SIZE, bytes_written);
+
+    ASSERT_EQ((int)GCODE_OK_NO_COMMAND, (int)GC_ParseBuffer(code, &input, output.data(), 2 * GCODE_CHUNK_SIZE, &bytes_written));
+    ASSERT_EQ(GCODE_CHUNK_SIZE, bytes_written);
+
+    GCODE_COMMAND_LIST id;
+    ASSERT_EQ(3, GC_DecompileFromBuffer(output.data(), &id)->x);
+}
+
+TEST_F(GCodeBufferParserTest, invalid_line_reported)
+{
+    std::string text = "G0 X1\nT1\nG0 X2\n";
+    GCodeBuffer input = makeBuffer(text, false);
+    uint32_t bytes_written = 0;
+    ASSERT_EQ((int)GCODE_ERROR_UNKNOWN_COMMAND, (int)GC_ParseBuffer(code, &input, output.data(), (uint32_t)output.size(), &bytes_written));
+    ASSERT_EQ(GCODE_CHUNK_SIZE, bytes_written);
+    ASSERT_STREQ("T1", input.line);
+}
+
+TEST_F(GCodeBufferParserTest, line_too_long)
+{
+    std::string text = "G0 X1 Y" + std::string(GCODE_LINE_LENGTH, '1') + "\n";
+    GCodeBuffer input = makeBuffer(text, false);
+    uint32_t bytes_written = 0;
+    ASSERT_EQ((int)GCODE_ERROR_LINE_TOO_LONG, (int)GC_ParseBuffer(code, &input, output.data(), (uint32_t)output.size(), &bytes_written));
+}
+
+TEST_F(GCodeBufferParserTest, carried_line_too_long)
+{
+    std::string text = "G0 X1 Y" + std::string(GCODE_LINE_LENGTH, '1');
+    GCodeBuffer input = makeBuffer(text, false);
+    uint32_t bytes_written = 0;
+    ASSERT_EQ((int)GCODE_ERROR_LINE_TOO_LONG, (int)GC_ParseBuffer(code, &input, output.data(), (uint32_t)output.size(), &bytes_written));
+}
+
+TEST_F(GCodeBufferParserTest, long_comment_is_truncated)
+{
+    // slicer settings are stored in the long comment lines
+    std::string text = "G0 X1 ;" + std::string(2 * GCODE_LINE_LENGTH, 'A') + "\n;" + std::string(2 * GCODE_LINE_LENGTH, 'B') + "\nG0 X2\n";
+    GCodeBuffer input = makeBuffer(text, true);
+    uint32_t bytes_written = 0;
+    ASSERT_EQ((int)GCODE_OK_NO_COMMAND, (int)GC_ParseBuffer(code, &input, output.data(), (uint32_t)output.size(), &bytes_written));
+    ASSERT_EQ(2 * GCODE_CHUNK_SIZE, bytes_written);
+
+    GCODE_COMMAND_LIST id;
+    ASSERT_EQ(1, GC_DecompileFromBuffer(output.data(), &id)->x);
+    ASSERT_EQ(2, GC_DecompileFromBuffer(output.data() + GCODE_CHUNK_SIZE, &id)->x);
+}
+
+TEST_F(GCodeBufferParserTest, carried_long_comment_is_truncated)
+{
+    std::string first = "G0 X1 ;" + std::string(GCODE_LINE_LENGTH, 'A');
+    std::string second = std::string(GCODE_LINE_LENGTH, 'A') + "\nG0 X2\n";
+    GCodeBuffer input = makeBuffer(first, false);
+    uint32_t bytes_written = 0;
+    ASSERT_EQ((int)GCODE_OK_NO_COMMAND, (int)GC_ParseBuffer(code, &input, output.data(), (uint32_t)output.size(), &bytes_written));
+    ASSERT_EQ(0U, bytes_written);
+
+    input = makeBuffer(second, true);
+    ASSERT_EQ((int)GCODE_OK_NO_COMMAND, (int)GC_ParseBuffer(code, &input, output.data(), (uint32_t)output.size(), &bytes_written));
+    ASSERT_EQ(2 * GCODE_CHUNK_SIZE, bytes_written);
+
+    GCODE_COMMAND_LIST id;
+    ASSERT_EQ(1, GC_DecompileFromBuffer(output.data(), &id)->x);
+    ASSERT_EQ(2, GC_DecompileFromBuffer(output.data() + GCODE_CHUNK_SIZE, &id)->x);
+}
+
+TEST(GCodeCommandIndexTest, stored_commands)
+{
+    ASSERT_EQ((uint32_t)GCODE_MOVE, GC_GetCommandIndex(0));
+    ASSERT_EQ((uint32_t)GCODE_MOVE, GC_GetCommandIndex(1));
+    ASSERT_EQ((uint32_t)GCODE_HOME, GC_GetCommandIndex(28));
+    ASSERT_EQ((uint32_t)GCODE_SAVE_POSITION, GC_GetCommandIndex(60));
+    ASSERT_EQ((uint32_t)GCODE_SET, GC_GetCommandIndex(92));
+    ASSERT_EQ((uint32_t)GCODE_SAVE_STATE, GC_GetCommandIndex(99));
+    // mode switches change the parser state only
+    ASSERT_EQ((uint32_t)GCODE_COMMAND_COUNT, GC_GetCommandIndex(90));
+    ASSERT_EQ((uint32_t)GCODE_COMMAND_COUNT, GC_GetCommandIndex(91));
+    ASSERT_EQ((uint32_t)GCODE_COMMAND_COUNT, GC_GetCommandIndex(2));
+}
+
+class GCodeCompactTest : public ::testing::Test
+{
+protected:
+    GCodeCompactState encoder;
+    GCodeCompactState decoder;
+    std::vector<uint8_t> buffer;
+
+    virtual void SetUp()
+    {
+        GC_ResetCompact(&encoder);
+        GC_ResetCompact(&decoder);
+        buffer.resize(GCODE_COMPACT_MAX_SIZE);
+    }
+
+    std::vector<uint8_t> makeChunk(uint32_t code, const std::vector<int32_t>& params)
+    {
+        std::vector<uint8_t> chunk(GCODE_CHUNK_SIZE, 0);
+        memcpy(chunk.data(), &code, sizeof(code));
+        memcpy(chunk.data() + sizeof(code), params.data(), params.size() * sizeof(int32_t));
+        return chunk;
+    }
+
+    std::vector<uint8_t> roundTrip(const std::vector<uint8_t>& chunk, uint32_t* encoded_size = nullptr)
+    {
+        uint8_t* raw = nullptr;
+        uint32_t size = GC_EncodeCompact(&encoder, chunk.data(), buffer.data(), &raw);
+        std::vector<uint8_t> decoded(GCODE_CHUNK_SIZE, 0xCC);
+        EXPECT_EQ(size, GC_DecodeCompact(&decoder, buffer.data(), decoded.data()));
+        if (encoded_size)
+        {
+            *encoded_size = size;
+        }
+        return decoded;
+    }
+};
+
+TEST_F(GCodeCompactTest, command_round_trip)
+{
+    std::vector<uint8_t> chunk = makeChunk(GCODE_COMMAND | 1, { 1800, 1000, -2000, 30, 400, 0, 0 });
+    ASSERT_EQ(chunk, roundTrip(chunk));
+}
+
+TEST_F(GCodeCompactTest, subcommand_round_trip)
+{
+    std::vector<uint8_t> chunk = makeChunk(GCODE_SUBCOMMAND | 3, { 210, 1, 0, 0 });
+    ASSERT_EQ(chunk, roundTrip(chunk));
+}
+
+TEST_F(GCodeCompactTest, sequence_round_trip)
+{
+    std::vector<std::vector<uint8_t>> chunks = {
+        makeChunk(GCODE_COMMAND | 1, { 1800, 0, 0, 0, 0, 0, 0 }),
+        makeChunk(GCODE_COMMAND | 1, { 1800, 100, 50, 0, 3, 12, 40 }),
+        makeChunk(GCODE_SUBCOMMAND | 2, { 200, 0, 0, 0 }),
+        makeChunk(GCODE_COMMAND | 1, { 1800, -100, 50, 0, 3, 12, 0 }),
+        makeChunk(GCODE_COMMAND | 1, { 2400, INT32_MIN, INT32_MAX, 1, -3, 12, -1 }),
+        makeChunk(GCODE_COMMAND | 1, { 2400, INT32_MAX, INT32_MIN, 1, -3, 12, 0 }),
+    };
+    for (size_t i = 0; i < chunks.size(); ++i)
+    {
+        ASSERT_EQ(chunks[i], roundTrip(chunks[i])) << "on command " << i;
+    }
+}
+
+TEST_F(GCodeCompactTest, repeated_command_size)
+{
+    std::vector<uint8_t> chunk = makeChunk(GCODE_COMMAND | 1, { 1800, 100, 50, 0, 3, 12, 0 });
+    roundTrip(chunk);
+    uint32_t size = 0;
+    ASSERT_EQ(chunk, roundTrip(chunk, &size));
+    // command code and presence mask only
+    ASSERT_EQ(2U, size);
+}
+
+TEST_F(GCodeCompactTest, small_delta_size)
+{
+    roundTrip(makeChunk(GCODE_COMMAND | 1, { 1800, 100000, 50000, 0, 0, 0, 0 }));
+    uint32_t size = 0;
+    roundTrip(makeChunk(GCODE_COMMAND | 1, { 1800, 100010, 49990, 0, 0, 0, 0 }), &size);
+    ASSERT_EQ(4U, size);
+}
+
+TEST_F(GCodeCompactTest, raw_param_is_patchable)
+{
+    std::vector<uint8_t> chunk = makeChunk(GCODE_COMMAND | 1, { 1800, 100, 50, 0, 3, 12, 1 });
+    uint8_t* raw = nullptr;
+    GC_EncodeCompact(&encoder, chunk.data(), buffer.data(), &raw);
+    ASSERT_NE(nullptr, raw);
+    int32_t patched = 123456;
+    memcpy(raw, &patched, sizeof(patched));
+
+    std::vector<uint8_t> decoded(GCODE_CHUNK_SIZE, 0);
+    GC_DecodeCompact(&decoder, buffer.data(), decoded.data());
+    ASSERT_EQ(makeChunk(GCODE_COMMAND | 1, { 1800, 100, 50, 0, 3, 12, patched }), decoded);
+}
+
+TEST_F(GCodeCompactTest, raw_param_not_stored)
+{
+    std::vector<uint8_t> chunk = makeChunk(GCODE_COMMAND | 1, { 1800, 100, 50, 0, 3, 12, 0 });
+    uint8_t* raw = buffer.data();
+    GC_EncodeCompact(&encoder, chunk.data(), buffer.data(), &raw);
+    ASSERT_EQ(nullptr, raw);
+}
+
+TEST_F(GCodeCompactTest, reset_restarts_delta)
+{
+    std::vector<uint8_t> chunk = makeChunk(GCODE_COMMAND | 1, { 1800, 100, 50, 0, 3, 12, 0 });
+    roundTrip(chunk);
+    GC_ResetCompact(&encoder);
+    GC_ResetCompact(&decoder);
+    uint32_t size = 0;
+    ASSERT_EQ(chunk, roundTrip(chunk, &size));
+    ASSERT_LT(2U, size);
+}
+
 class GCodeParserDialectTest : public ::testing::Test
 {
 protected:
@@ -1037,8 +1352,155 @@ protected:
         DetachDevice();
         device = nullptr;
     }
+
+    std::vector<std::string> readLines(const char* name)
+    {
+        std::vector<std::string> lines;
+        FILE* f = nullptr;
+        fopen_s(&f, name, "rb");
+        if (!f)
+        {
+            return lines;
+        }
+
+        std::string line;
+        char symbol;
+        while (1 == fread_s(&symbol, 1, 1, 1, f))
+        {
+            if (symbol == '\n')
+            {
+                lines.push_back(line);
+                line.clear();
+                continue;
+            }
+            line.append(1, symbol);
+        }
+        lines.push_back(line);
+        fclose(f);
+        return lines;
+    }
+
+    // exact decimal to steps conversion, rounding half away from zero
+    static parameterType referenceSteps(const std::string& value, int64_t multiplier)
+    {
+        size_t pos = 0;
+        bool negative = ('-' == value[0]);
+        if ('-' == value[0] || '+' == value[0])
+        {
+            ++pos;
+        }
+
+        int64_t numerator = 0;
+        int64_t denominator = 1;
+        bool fraction = false;
+        for (; pos < value.size() && value[pos] != '\r'; ++pos)
+        {
+            if ('.' == value[pos])
+            {
+                fraction = true;
+                continue;
+            }
+            numerator = numerator * 10 + (value[pos] - '0');
+            if (fraction)
+            {
+                denominator *= 10;
+            }
+        }
+
+        int64_t steps = (2 * numerator * multiplier + denominator) / (2 * denominator);
+        return (parameterType)(negative ? -steps : steps);
+    }
+
+    void coordinatesRoundTrip(const char* name)
+    {
+        std::vector<std::string> lines = readLines(name);
+        ASSERT_FALSE(lines.empty()) << "required file " << name << " not found";
+
+        GCodeAxisConfig cfg = { 80, 80, 800, 104 };
+        HGCODE steps_code = GC_Configure(&cfg, 0);
+
+        size_t values = 0;
+        for (const std::string& line : lines)
+        {
+            std::string command = line.substr(0, line.find(';'));
+            size_t start = command.find_first_not_of(' ');
+            if (start == std::string::npos || command[start] != 'G')
+            {
+                continue;
+            }
+
+            std::stringstream tokens(command.substr(start));
+            std::string token;
+            tokens >> token; // command code
+            while (tokens >> token)
+            {
+                if (token.size() < 2 || token[1] == '\r')
+                {
+                    continue;
+                }
+
+                parameterType multiplier = 1;
+                parameterType GCodeCommandParams::* field = nullptr;
+                switch (token[0])
+                {
+                case 'X': multiplier = cfg.x_steps_per_mm; field = &GCodeCommandParams::x; break;
+                case 'Y': multiplier = cfg.y_steps_per_mm; field = &GCodeCommandParams::y; break;
+                case 'Z': multiplier = cfg.z_steps_per_mm; field = &GCodeCommandParams::z; break;
+                case 'E': multiplier = cfg.e_steps_per_mm; field = &GCodeCommandParams::e; break;
+                case 'F': field = &GCodeCommandParams::fetch_speed; break;
+                default: continue;
+                }
+
+                std::string single = "G1 " + token;
+                ASSERT_EQ((int)GCODE_OK_COMMAND_CREATED, (int)GC_ParseCommand(steps_code, single.c_str())) << line;
+                ASSERT_EQ(referenceSteps(token.substr(1), multiplier), GC_GetCurrentCommand(steps_code)->*field) << "value " << token << " in line: " << line;
+                ++values;
+            }
+        }
+        std::cout << name << ": " << values << " coordinates matched the reference" << std::endl;
+    }
+
+    void parserBenchmark(const char* name)
+    {
+        std::vector<std::string> lines = readLines(name);
+        ASSERT_FALSE(lines.empty()) << "required file " << name << " not found";
+
+        GCodeAxisConfig cfg = { 80, 80, 800, 104 };
+        HGCODE bench_code = GC_Configure(&cfg, 0);
+
+        const size_t iterations = 20;
+        size_t bytes = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < iterations; ++i)
+        {
+            GC_Reset(bench_code, nullptr);
+            for (const std::string& line : lines)
+            {
+                GC_ParseCommand(bench_code, line.c_str());
+                bytes += line.size();
+            }
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start).count();
+
+        std::cout << name << " parser benchmark: " << std::endl
+            << "    Lines parsed: " << lines.size() * iterations << std::endl
+            << "    Time per line: " << elapsed / (lines.size() * iterations) << " ns" << std::endl
+            << "    Throughput: " << (elapsed ? bytes * 1000000000ull / 1024 / 1024 / elapsed : 0) << " MB/s" << std::endl;
+    }
 };
 
+TEST_F(GCodeParserDialectTest, coordinates_round_trip)
+{
+    coordinatesRoundTrip("wanhao.gcode");
+    coordinatesRoundTrip("model.gcode");
+}
+
+TEST_F(GCodeParserDialectTest, parser_benchmark)
+{
+    parserBenchmark("wanhao.gcode");
+    parserBenchmark("model.gcode");
+}
+
 TEST_F(GCodeParserDialectTest, wanhao)
 {
     FILE* f = nullptr;
@@ -1160,4 +1622,62 @@ TEST_F(GCodeParserDialectTest, wanhao_compiled)
         << "    Allocated data chunks: " << compiled_file.size() / 512 + 1 << std::endl;
 
     fclose(f);
-}
\ No newline at end of file
+}
+
+TEST_F(GCodeParserDialectTest, wanhao_sector_parser)
+{
+    FILE* f = nullptr;
+    fopen_s(&f, "wanhao.gcode", "rb");
+    ASSERT_TRUE(nullptr != f) << "required file not found";
+
+    std::vector<char> file_data;
+    char symbol;
+    while (1 == fread_s(&symbol, 1, 1, 1, f))
+    {
+        file_data.push_back(symbol);
+    }
+    fclose(f);
+
+    // reference: line by line parsing
+    std::vector<uint8_t> expected;
+    std::vector<uint8_t> chunk(GCODE_CHUNK_SIZE, 0);
+    std::string line;
+    for (size_t i = 0; i <= file_data.size(); ++i)
+    {
+        if (i < file_data.size() && file_data[i] != '\n')
+        {
+            line.append(1, file_data[i]);
+            continue;
+        }
+        ASSERT_GT(2u, GC_ParseCommand(code, line.c_str())) << "invalid line " << line;
+        std::fill(chunk.begin(), chunk.end(), 0); // subcommands don't fill the whole chunk
+        if (GC_CompressCommand(code, chunk.data()))
+        {
+            expected.insert(expected.end(), chunk.begin(), chunk.end());
+        }
+        line.clear();
+    }
+
+    // sector by sector in place parsing
+    GCodeAxisConfig cfg = { 1, 1, 1, 100 };
+    HGCODE sector_code = GC_Configure(&cfg, 0);
+    std::vector<uint8_t> compiled;
+    std::vector<uint8_t> page(512);
+    for (size_t offset = 0; offset < file_data.size(); offset += 512)
+    {
+        std::vector<char> sector(file_data.begin() + offset, file_data.begin() + std::min(offset + 512, file_data.size()));
+        GCodeBuffer input = { sector.data(), (uint32_t)sector.size(), 0, offset + 512 >= file_data.size(), nullptr };
+        GCODE_ERROR result = GCODE_OK_COMMAND_CREATED;
+        while (GCODE_OK_COMMAND_CREATED == result)
+        {
+            uint32_t bytes_written = 0;
+            std::fill(page.begin(), page.end(), 0);
+            result = GC_ParseBuffer(sector_code, &input, page.data(), (uint32_t)page.size(), &bytes_written);
+            compiled.insert(compiled.end(), page.begin(), page.begin() + bytes_written);
+        }
+        ASSERT_EQ((int)GCODE_OK_NO_COMMAND, (int)result) << "invalid line " << input.line;
+    }
+
+    ASSERT_EQ(expected.size(), compiled.size());
+    ASSERT_TRUE(expected == compiled);
+}
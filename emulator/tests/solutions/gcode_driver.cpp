@@ -8,6 +8,10 @@
 
 #include <gtest/gtest.h>
 #include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <functional>
 #include <memory>
 
 TEST(GCodeDriverBasicTest, printer_cannot_create_without_config)
@@ -38,7 +42,7 @@ public:
 
     std::unique_ptr<SDcardMock> m_storage;
     std::unique_ptr<Device> m_device;
-    std::vector<HMOTOR> m_motors;
+    HSTEPPERGROUP m_steppers = nullptr;
     std::vector<HTERMALREGULATOR> m_trs;
 
     virtual void SetUp()
@@ -51,9 +55,9 @@ public:
 
         TermalRegulatorConfig ts = { &m_port, 0, GPIO_PIN_SET, GPIO_PIN_RESET, 1, 0 };
         MotorConfig motor = { PULSE_LOWER, &m_port, 0, &m_port, 0 };
-        HMOTOR hmotor = MOTOR_Configure(&motor);
+        MotorConfig motors[MOTOR_COUNT] = { motor, motor, motor, motor };
+        m_steppers = STEPPERGROUP_Configure(motors, MOTOR_COUNT);
         HTERMALREGULATOR htr = TR_Configure(&ts);
-        m_motors = { hmotor, hmotor, hmotor, hmotor };
         m_trs = { htr, htr };
     }
 
@@ -67,14 +71,14 @@ public:
 
 TEST_F(GCodeDriverCreationTest, printer_cannot_create_without_memory)
 {
-    DriverConfig cfg = { 0, m_storage.get(), m_motors.data(), m_trs.data(), &m_port, 0, 0, PRINTER_ACCELERATION_DISABLE };
+    DriverConfig cfg = { 0, m_storage.get(), m_steppers, m_trs.data(), &m_port, 0, 0, PRINTER_ACCELERATION_DISABLE };
 
     ASSERT_TRUE(nullptr == PrinterConfigure(&cfg));
 }
 
 TEST_F(GCodeDriverCreationTest, printer_cannot_create_without_area_settings)
 {
-    DriverConfig cfg = { &m_mem, m_storage.get(), m_motors.data(), m_trs.data(), &m_port, 0, 0, PRINTER_ACCELERATION_DISABLE };
+    DriverConfig cfg = { &m_mem, m_storage.get(), m_steppers, m_trs.data(), &m_port, 0, 0, PRINTER_ACCELERATION_DISABLE };
 
     ASSERT_TRUE(nullptr == PrinterConfigure(&cfg));
 }
@@ -88,21 +92,35 @@ TEST_F(GCodeDriverCreationTest, printer_cannot_create_without_motor)
 
 TEST_F(GCodeDriverCreationTest, printer_cannot_create_without_sensor)
 {
-    DriverConfig cfg = { &m_mem,  m_storage.get(), m_motors.data(), 0, &m_port, 0, &m_axis_cfg, PRINTER_ACCELERATION_DISABLE };
+    DriverConfig cfg = { &m_mem,  m_storage.get(), m_steppers, 0, &m_port, 0, &m_axis_cfg, PRINTER_ACCELERATION_DISABLE };
 
     ASSERT_TRUE(nullptr == PrinterConfigure(&cfg));
 }
 
 TEST_F(GCodeDriverCreationTest, printer_cannot_create_without_cooler)
 {
-     DriverConfig cfg = { &m_mem,  m_storage.get(), m_motors.data(), m_trs.data(), 0, 0, &m_axis_cfg, PRINTER_ACCELERATION_DISABLE };
+     DriverConfig cfg = { &m_mem,  m_storage.get(), m_steppers, m_trs.data(), 0, 0, &m_axis_cfg, PRINTER_ACCELERATION_DISABLE };
 
     ASSERT_TRUE(nullptr == PrinterConfigure(&cfg));
 }
 
 TEST_F(GCodeDriverCreationTest, printer_can_create_with_storage)
 {
-    DriverConfig cfg = { &m_mem,  m_storage.get(), m_motors.data(), m_trs.data(), &m_port, 0, &m_axis_cfg, PRINTER_ACCELERATION_DISABLE };
+    DriverConfig cfg = { &m_mem,  m_storage.get(), m_steppers, m_trs.data(), &m_port, 0, &m_axis_cfg, PRINTER_ACCELERATION_DISABLE };
+
+    ASSERT_TRUE(nullptr != PrinterConfigure(&cfg));
+}
+
+TEST_F(GCodeDriverCreationTest, printer_cannot_create_with_too_many_prefetch_pages)
+{
+    DriverConfig cfg = { &m_mem,  m_storage.get(), m_steppers, m_trs.data(), &m_port, 0, &m_axis_cfg, PRINTER_ACCELERATION_DISABLE, 0, MEMORY_PAGES_COUNT };
+
+    ASSERT_TRUE(nullptr == PrinterConfigure(&cfg));
+}
+
+TEST_F(GCodeDriverCreationTest, printer_can_create_with_prefetch_ring)
+{
+    DriverConfig cfg = { &m_mem,  m_storage.get(), m_steppers, m_trs.data(), &m_port, 0, &m_axis_cfg, PRINTER_ACCELERATION_DISABLE, 0, MEMORY_PAGES_COUNT - 1 };
 
     ASSERT_TRUE(nullptr != PrinterConfigure(&cfg));
 }
@@ -117,7 +135,7 @@ public:
 protected:
     GPIO_TypeDef port = 0;
     GCodeAxisConfig axis_cfg = { 1,1,1,1 };
-    std::vector<HMOTOR> m_motors;
+    HSTEPPERGROUP m_steppers = nullptr;
     std::vector<HTERMALREGULATOR> m_regulators;
 
     virtual void SetUp()
@@ -131,14 +149,13 @@ protected:
         MemoryManagerConfigure(&m_memory);
 
         MotorConfig motor_cfg = { PULSE_LOWER, &port, 0, &port, 0 };
-        HMOTOR motor = MOTOR_Configure(&motor_cfg);
-        
-        m_motors = { motor, motor, motor, motor };
+        MotorConfig motors[MOTOR_COUNT] = { motor_cfg, motor_cfg, motor_cfg, motor_cfg };
+        m_steppers = STEPPERGROUP_Configure(motors, MOTOR_COUNT);
 
         TermalRegulatorConfig ts = { &port, 0, GPIO_PIN_SET, GPIO_PIN_RESET, 1.f, 0.f };
         HTERMALREGULATOR regulator = TR_Configure(&ts);
         m_regulators = { regulator, regulator };
-        DriverConfig cfg = { &m_memory, m_storage.get(), m_motors.data(), m_regulators.data(), &port, 0, &axis_cfg, PRINTER_ACCELERATION_DISABLE };
+        DriverConfig cfg = { &m_memory, m_storage.get(), m_steppers, m_regulators.data(), &port, 0, &axis_cfg, PRINTER_ACCELERATION_DISABLE };
 
         printer_driver = PrinterConfigure(&cfg);
         RegisterSDCard();
@@ -209,6 +226,39 @@ TEST_F(GCodeDriverTest, printer_verify_control_block_data)
     ASSERT_STREQ("test_file_#1", control_block.file_name);
 }
 
+TEST_F(GCodeDriverTest, printer_load_regulator_gains_without_stored)
+{
+    ASSERT_EQ(PRINTER_INVALID_CONTROL_BLOCK, PrinterLoadRegulatorGains(printer_driver));
+    ASSERT_EQ(TR_MODE_STEPPING, TR_GetMode(m_regulators[TERMO_NOZZLE]));
+}
+
+TEST_F(GCodeDriverTest, printer_save_and_load_regulator_gains)
+{
+    TermalRegulatorGains gains = { 0.1f, 0.002f, 0.4f, 0.003f };
+    TR_SetGains(m_regulators[TERMO_NOZZLE], &gains);
+    ASSERT_EQ(PRINTER_OK, PrinterSaveRegulatorGains(printer_driver));
+
+    TermalRegulatorGains other = { 1.f, 1.f, 1.f, 1.f };
+    TR_SetGains(m_regulators[TERMO_NOZZLE], &other);
+    ASSERT_EQ(PRINTER_OK, PrinterLoadRegulatorGains(printer_driver));
+
+    TermalRegulatorGains loaded;
+    TR_GetGains(m_regulators[TERMO_NOZZLE], &loaded);
+    ASSERT_EQ(TR_MODE_PID, TR_GetMode(m_regulators[TERMO_NOZZLE]));
+    ASSERT_EQ(gains.kp, loaded.kp);
+    ASSERT_EQ(gains.ki, loaded.ki);
+    ASSERT_EQ(gains.kd, loaded.kd);
+    ASSERT_EQ(gains.feed_forward, loaded.feed_forward);
+}
+
+TEST_F(GCodeDriverTest, printer_tune_regulator)
+{
+    ASSERT_EQ(PRINTER_INVALID_PARAMETER, PrinterTuneRegulator(printer_driver, TERMO_REGULATOR_COUNT, 200));
+    ASSERT_EQ(PRINTER_OK, PrinterTuneRegulator(printer_driver, TERMO_NOZZLE, 200));
+    ASSERT_EQ(TR_MODE_AUTOTUNE, TR_GetMode(m_regulators[TERMO_NOZZLE]));
+    ASSERT_EQ(200, PrinterGetTargetT(printer_driver, TERMO_NOZZLE));
+}
+
 TEST_F(GCodeDriverTest, printer_start_read_command_list)
 {
     WriteControlBlock(CONTROL_BLOCK_SEC_CODE, 124);
@@ -738,6 +788,70 @@ TEST_F(GCodeDriverMemoryTest, printer_command_list_commands_count)
     ASSERT_EQ(commands_count, i - 1);
 }
 
+class GCodeDriverCompactMemoryTest : public ::testing::Test, public PrinterEmulator
+{
+public:
+
+    // use real frequency this time
+    GCodeDriverCompactMemoryTest()
+        : PrinterEmulator(10000)
+    {}
+protected:
+    const size_t command_block_size = SDcardMock::s_sector_size / GCODE_CHUNK_SIZE;
+    size_t commands_count = 0;
+
+    virtual void SetUp()
+    {
+        SetupPrinter(axis_configuration, PRINTER_ACCELERATION_DISABLE);
+        FileManagerSetStorageFormat(m_file_manager, GCODE_FORMAT_COMPACT);
+
+        std::vector<std::string> commands = { "G0 F1800 X0 Y0 Z0 E0" };
+
+        // compact sectors hold several times more commands, make sure a few of them are used
+        for (size_t i = 0; i < command_block_size * 12; ++i)
+        {
+            std::ostringstream command;
+            command << "G0 F1800 X" << (i + 1) * 10 << " Y0";
+            commands.push_back(command.str());
+        }
+        commands_count = commands.size();
+
+        StartPrinting(commands, nullptr);
+    }
+};
+
+TEST_F(GCodeDriverCompactMemoryTest, printer_command_list_paths)
+{
+    PrinterLoadData(printer_driver);
+    CompleteCommand(PrinterNextCommand(printer_driver));
+    for (size_t i = 1; i < commands_count; ++i)
+    {
+        PrinterLoadData(printer_driver);
+        PRINTER_STATUS status = PrinterNextCommand(printer_driver);
+        ASSERT_EQ(GCODE_INCOMPLETE, status) << "on iteration: " << i;
+        GCodeCommandParams* params = PrinterGetCurrentPath(printer_driver);
+        ASSERT_EQ(10, params->x) << "on iteration: " << i;
+        ASSERT_EQ(0, params->y) << "on iteration: " << i;
+        CompleteCommand(status);
+    }
+}
+
+TEST_F(GCodeDriverCompactMemoryTest, printer_command_list_commands_count)
+{
+    size_t i = 0;
+    for (; i < commands_count + 1; ++i)
+    {
+        PrinterLoadData(printer_driver);
+        PRINTER_STATUS status = PrinterNextCommand(printer_driver);
+        if (PRINTER_FINISHED == status)
+        {
+            break;
+        }
+        CompleteCommand(status);
+    }
+    ASSERT_EQ(commands_count, i);
+}
+
 class GCodeDriverCommandsTest : public ::testing::Test, public PrinterEmulator
 {
 public:
@@ -1771,6 +1885,41 @@ TEST_F(GCodeDriverStateTest, restore_state)
     ASSERT_EQ(20, params->e);
 }
 
+TEST_F(GCodeDriverStateTest, restore_state_compact_storage)
+{
+    FileManagerSetStorageFormat(m_file_manager, GCODE_FORMAT_COMPACT);
+    std::vector<std::string> commands = { "G0 F1800 X0 Y0 Z0 E0" };
+    // put the save point into the middle of the 3rd compact sector
+    const size_t moves = 150;
+    for (size_t i = 0; i < moves; ++i)
+    {
+        std::ostringstream command;
+        command << "G0 F1800 X" << (i + 1) * 10 << " Y0 Z0 E" << (i + 1) * 10;
+        commands.push_back(command.str());
+    }
+    commands.push_back("G99");
+    commands.push_back("G0 F1800 X2000 Y0 Z0 E2000");
+    StartPrinting(commands, nullptr);
+    for (size_t i = 0; i < moves + 2; ++i)
+    {
+        PrinterLoadData(printer_driver);
+        CompleteCommand(PrinterNextCommand(printer_driver));
+    }
+    ShutDown();
+
+    ConfigurePrinter(axis_configuration, PRINTER_ACCELERATION_DISABLE);
+    PrinterInitialize(printer_driver);
+    PrinterPrintFromCache(printer_driver, nullptr, PRINTER_RESUME);
+    CompleteCommand(PrinterNextCommand(printer_driver)); // resume add restoration command
+    PrinterNextCommand(printer_driver); // save command will be repeated
+
+    PrinterLoadData(printer_driver);
+    ASSERT_EQ(GCODE_INCOMPLETE, PrinterNextCommand(printer_driver));
+    GCodeCommandParams* params = PrinterGetCurrentPath(printer_driver);
+    ASSERT_EQ(500, params->x);
+    ASSERT_EQ(500, params->e);
+}
+
 TEST_F(GCodeDriverStateTest, reset_state_after_shutdown)
 {
     std::vector<std::string> commands = {
@@ -2071,3 +2220,469 @@ TEST_F(GCodeDriverDistributedLoadingTest, printer_data_loading_advances_commands
 
     ASSERT_EQ(count - 1, PrinterGetRemainingCommandsCount(printer_driver));
 }
+
+class GCodeDriverPrefetchTest : public ::testing::Test, public PrinterEmulator
+{
+public:
+
+    // use real frequency this time
+    GCodeDriverPrefetchTest()
+        : PrinterEmulator(10000)
+    {}
+protected:
+    const size_t command_block_size = SDcardMock::s_sector_size / GCODE_CHUNK_SIZE;
+    const size_t sectors_count = 12;
+    size_t commands_count = 0;
+    size_t stall_ticks = 0;
+
+    virtual void SetUp()
+    {
+        SetupPrinter(axis_configuration, PRINTER_ACCELERATION_DISABLE);
+    }
+
+    void createCommands(size_t count, GCODE_STORAGE_FORMAT format)
+    {
+        FileManagerSetStorageFormat(m_file_manager, format);
+        std::vector<std::string> commands = { "G0 F1800 X0 Y0 Z0 E0" };
+        for (size_t i = 1; i < count; ++i)
+        {
+            std::ostringstream command;
+            command << "G0 F1800 X" << i * 10 << " Y0";
+            commands.push_back(command.str());
+        }
+        commands_count = commands.size();
+        CreateGCodeData(commands);
+    }
+
+    // configures the new driver with the requested prefetch ring and motion queue and starts printing of the cached commands
+    void startPrinting(uint8_t pages, uint8_t blocks = 0, PRINTER_ACCELERATION acceleration = PRINTER_ACCELERATION_DISABLE)
+    {
+        DriverConfig cfg = { &m_memory, m_storage.get(), m_steppers, m_regulators, &port_cooler, 0, &external_config, acceleration, nullptr, pages, blocks };
+        printer_driver = PrinterConfigure(&cfg);
+        ASSERT_TRUE(nullptr != printer_driver);
+        PrinterInitialize(printer_driver);
+        ASSERT_EQ(PRINTER_OK, PrinterPrintFromCache(printer_driver, nullptr, PRINTER_START));
+    }
+
+    // runs the print the same way as the printer does: the main loop loads data and the timer executes commands.
+    // Every read command of the internal storage takes requested amount of timer ticks,
+    // main loop loads data once per main_loop_period ticks
+    size_t runPrint(const std::function<size_t(size_t read_index, uint32_t sectors)>& read_latency, size_t main_loop_period = 1)
+    {
+        size_t ticks = 0;
+        size_t reads = 0;
+        bool finished = false;
+        stall_ticks = 0;
+        auto on_timer = [&]()
+        {
+            if (!finished)
+            {
+                PRINTER_STATUS status = PrinterNextCommand(printer_driver);
+                finished = (PRINTER_FINISHED == status);
+                stall_ticks += (PRINTER_PRELOAD_REQUIRED == status) ? 1 : 0;
+            }
+            PrinterExecuteCommand(printer_driver);
+            ++ticks;
+        };
+
+        m_storage->SetReadCallback([&](uint32_t, uint32_t count)
+        {
+            for (size_t i = read_latency(reads++, count); i > 0; --i)
+            {
+                on_timer();
+            }
+        });
+
+        while (!finished)
+        {
+            EXPECT_EQ(PRINTER_OK, PrinterLoadData(printer_driver));
+            for (size_t i = 0; i < main_loop_period && !finished; ++i)
+            {
+                on_timer();
+            }
+        }
+        m_storage->SetReadCallback(nullptr);
+        return ticks;
+    }
+};
+
+TEST_F(GCodeDriverPrefetchTest, printer_prefetch_fills_ring)
+{
+    createCommands(command_block_size * sectors_count, GCODE_FORMAT_CHUNKS);
+    startPrinting(4);
+    size_t sectors = m_storage->GetReadSectorsCount();
+    ASSERT_EQ(PRINTER_OK, PrinterLoadData(printer_driver));
+    ASSERT_EQ(sectors + 3, m_storage->GetReadSectorsCount());
+
+    // ring is full, nothing to load
+    ASSERT_EQ(PRINTER_OK, PrinterLoadData(printer_driver));
+    ASSERT_EQ(sectors + 3, m_storage->GetReadSectorsCount());
+}
+
+TEST_F(GCodeDriverPrefetchTest, printer_prefetch_reads_free_pages_at_once)
+{
+    createCommands(command_block_size * sectors_count, GCODE_FORMAT_CHUNKS);
+    startPrinting(4);
+    size_t reads = m_storage->GetReadsCount();
+    ASSERT_EQ(PRINTER_OK, PrinterLoadData(printer_driver));
+    ASSERT_EQ(reads + 1, m_storage->GetReadsCount());
+}
+
+TEST_F(GCodeDriverPrefetchTest, printer_prefetch_read_wraps_ring)
+{
+    createCommands(command_block_size * sectors_count, GCODE_FORMAT_CHUNKS);
+    startPrinting(4);
+    PrinterLoadData(printer_driver);
+    for (size_t i = 0; i < command_block_size * 3; ++i)
+    {
+        CompleteCommand(PrinterNextCommand(printer_driver));
+    }
+    PrinterLoadData(printer_driver);
+    for (size_t i = 0; i < command_block_size * 2; ++i)
+    {
+        CompleteCommand(PrinterNextCommand(printer_driver));
+    }
+
+    // two free pages are at the end of the ring and at its beginning, they are not adjacent
+    size_t reads = m_storage->GetReadsCount();
+    size_t sectors = m_storage->GetReadSectorsCount();
+    ASSERT_EQ(PRINTER_OK, PrinterLoadData(printer_driver));
+    ASSERT_EQ(reads + 2, m_storage->GetReadsCount());
+    ASSERT_EQ(sectors + 2, m_storage->GetReadSectorsCount());
+
+    for (size_t i = 0; i < command_block_size * (sectors_count - 5); ++i)
+    {
+        PrinterLoadData(printer_driver);
+        ASSERT_NE(PRINTER_PRELOAD_REQUIRED, PrinterNextCommand(printer_driver)) << "on iteration: " << i;
+        ASSERT_EQ((command_block_size * 5 + i) * 10, PrinterGetCurrentPosition(printer_driver)->x) << "on iteration: " << i;
+        CompleteCommand(GCODE_INCOMPLETE);
+    }
+}
+
+TEST_F(GCodeDriverPrefetchTest, printer_prefetch_releases_executed_page)
+{
+    createCommands(command_block_size * sectors_count, GCODE_FORMAT_CHUNKS);
+    startPrinting(3);
+    PrinterLoadData(printer_driver);
+    for (size_t i = 0; i < command_block_size; ++i)
+    {
+        CompleteCommand(PrinterNextCommand(printer_driver));
+    }
+
+    size_t reads = m_storage->GetReadsCount();
+    ASSERT_EQ(PRINTER_OK, PrinterLoadData(printer_driver));
+    ASSERT_EQ(reads + 1, m_storage->GetReadsCount());
+}
+
+TEST_F(GCodeDriverPrefetchTest, printer_prefetch_stops_at_last_sector)
+{
+    createCommands(command_block_size + 2, GCODE_FORMAT_CHUNKS);
+    startPrinting(MEMORY_PAGES_COUNT - 1);
+    size_t sectors = m_storage->GetReadSectorsCount();
+    ASSERT_EQ(PRINTER_OK, PrinterLoadData(printer_driver));
+    ASSERT_EQ(sectors + 1, m_storage->GetReadSectorsCount());
+}
+
+TEST_F(GCodeDriverPrefetchTest, printer_prefetch_executes_all_commands)
+{
+    for (GCODE_STORAGE_FORMAT format : { GCODE_FORMAT_CHUNKS, GCODE_FORMAT_COMPACT })
+    {
+        createCommands(command_block_size * sectors_count, format);
+        for (uint8_t pages = 2; pages < MEMORY_PAGES_COUNT; ++pages)
+        {
+            startPrinting(pages);
+            runPrint([](size_t, uint32_t) { return 0; });
+            ASSERT_EQ(0, PrinterGetRemainingCommandsCount(printer_driver)) << "format " << format << " pages " << (int)pages;
+            ASSERT_EQ((commands_count - 1) * 10, PrinterGetCurrentPosition(printer_driver)->x) << "format " << format << " pages " << (int)pages;
+            ASSERT_EQ(0, PrinterGetStallsCount(printer_driver)) << "format " << format << " pages " << (int)pages;
+        }
+    }
+}
+
+TEST_F(GCodeDriverPrefetchTest, printer_prefetch_counts_stalls)
+{
+    createCommands(command_block_size * sectors_count, GCODE_FORMAT_CHUNKS);
+    startPrinting(2);
+    PrinterLoadData(printer_driver);
+    for (size_t i = 0; i < command_block_size * 2 - 1; ++i)
+    {
+        CompleteCommand(PrinterNextCommand(printer_driver));
+    }
+    ASSERT_EQ(0, PrinterGetStallsCount(printer_driver));
+
+    // repeated requests during the same stall are counted once
+    ASSERT_EQ(PRINTER_PRELOAD_REQUIRED, PrinterNextCommand(printer_driver));
+    ASSERT_EQ(PRINTER_PRELOAD_REQUIRED, PrinterNextCommand(printer_driver));
+    ASSERT_EQ(1, PrinterGetStallsCount(printer_driver));
+
+    PrinterLoadData(printer_driver);
+    ASSERT_EQ(GCODE_INCOMPLETE, PrinterNextCommand(printer_driver));
+    ASSERT_EQ(1, PrinterGetStallsCount(printer_driver));
+}
+
+TEST_F(GCodeDriverPrefetchTest, printer_prefetch_ring_absorbs_slow_card)
+{
+    createCommands(command_block_size * sectors_count, GCODE_FORMAT_CHUNKS);
+    startPrinting(2);
+    size_t sector_ticks = runPrint([](size_t, uint32_t) { return 0; }) / sectors_count;
+
+    // every 4th read of the card is slower than execution of the sector, but average bandwidth is enough
+    auto slow_card = [sector_ticks](size_t read, uint32_t count) { return ((read % 4 == 3) ? sector_ticks * 2 : sector_ticks / 8) * count; };
+
+    startPrinting(2);
+    size_t double_buffer_ticks = runPrint(slow_card);
+    uint32_t double_buffer_stalls = PrinterGetStallsCount(printer_driver);
+    size_t double_buffer_stall_ticks = stall_ticks;
+
+    startPrinting(MEMORY_PAGES_COUNT - 1);
+    size_t ring_ticks = runPrint(slow_card);
+    uint32_t ring_stalls = PrinterGetStallsCount(printer_driver);
+
+    std::cout << "Slow card, sector execution takes " << sector_ticks << " ticks" << std::endl
+        << "    double buffering: " << double_buffer_ticks << " ticks, " << double_buffer_stalls << " stalls, " << double_buffer_stall_ticks << " ticks stalled" << std::endl
+        << "    ring of " << MEMORY_PAGES_COUNT - 1 << " pages: " << ring_ticks << " ticks, " << ring_stalls << " stalls, " << stall_ticks << " ticks stalled" << std::endl;
+
+    ASSERT_LT(0u, double_buffer_stalls);
+    ASSERT_EQ(0u, ring_stalls);
+    ASSERT_LT(ring_ticks, double_buffer_ticks);
+}
+
+TEST_F(GCodeDriverPrefetchTest, printer_prefetch_read_bandwidth)
+{
+    createCommands(command_block_size * sectors_count * 4, GCODE_FORMAT_CHUNKS);
+    startPrinting(2);
+    size_t sector_ticks = runPrint([](size_t, uint32_t) { return 0; }) / (sectors_count * 4);
+
+    // every read command pays for the command, response and data token wait, data transfer is cheaper
+    size_t command_ticks = sector_ticks / 4;
+    size_t transfer_ticks = sector_ticks / 16;
+    size_t read_ticks = 0;
+    auto card = [&](size_t, uint32_t count)
+    {
+        size_t ticks = command_ticks + transfer_ticks * count;
+        read_ticks += ticks;
+        return ticks;
+    };
+
+    // main loop is busy by the user interface, so several pages are released between its iterations
+    size_t main_loop_period = sector_ticks * 2;
+    std::cout << "Card read costs " << command_ticks << " ticks per command and " << transfer_ticks << " ticks per sector" << std::endl;
+    double sector_cost[2] = { 0 };
+    size_t index = 0;
+    for (uint8_t pages : { 2, MEMORY_PAGES_COUNT - 1 })
+    {
+        startPrinting(pages);
+        read_ticks = 0;
+        size_t reads = m_storage->GetReadsCount();
+        size_t sectors = m_storage->GetReadSectorsCount();
+        runPrint(card, main_loop_period);
+        reads = m_storage->GetReadsCount() - reads;
+        sectors = m_storage->GetReadSectorsCount() - sectors;
+        ASSERT_EQ(0, PrinterGetRemainingCommandsCount(printer_driver));
+
+        sector_cost[index] = (double)read_ticks / sectors;
+        double bandwidth = (double)sectors * SDcardMock::s_sector_size * main_frequency / read_ticks / 1024;
+        std::cout << "    " << (int)pages << " pages: " << reads << " reads, " << sectors << " sectors, "
+            << sector_cost[index] << " ticks per sector, " << bandwidth << " KB/s" << std::endl;
+        ++index;
+    }
+    ASSERT_LT(sector_cost[1], sector_cost[0]);
+}
+
+TEST_F(GCodeDriverPrefetchTest, printer_prefetch_async_load)
+{
+    createCommands(command_block_size * sectors_count, GCODE_FORMAT_CHUNKS);
+    startPrinting(4);
+    const size_t latency = 10;
+    m_storage->SetLatency(latency);
+
+    // the read is started, but printer doesn't wait for the data
+    size_t sectors = m_storage->GetReadSectorsCount();
+    ASSERT_EQ(PRINTER_OK, PrinterLoadData(printer_driver));
+    ASSERT_EQ(sectors, m_storage->GetReadSectorsCount());
+
+    // commands of the loaded sector are executed while the storage transfers the data
+    for (size_t i = 0; i < command_block_size - 1; ++i)
+    {
+        CompleteCommand(PrinterNextCommand(printer_driver));
+    }
+    ASSERT_EQ(PRINTER_PRELOAD_REQUIRED, PrinterNextCommand(printer_driver));
+
+    size_t calls = 1;
+    while (sectors == m_storage->GetReadSectorsCount())
+    {
+        ASSERT_EQ(PRINTER_OK, PrinterLoadData(printer_driver));
+        ++calls;
+    }
+    ASSERT_EQ(latency * 3 + 1, calls);
+    ASSERT_EQ(sectors + 3, m_storage->GetReadSectorsCount());
+
+    for (size_t i = 0; i < command_block_size; ++i)
+    {
+        ASSERT_NE(PRINTER_PRELOAD_REQUIRED, PrinterNextCommand(printer_driver)) << "on iteration: " << i;
+        ASSERT_EQ((command_block_size - 1 + i) * 10, PrinterGetCurrentPosition(printer_driver)->x) << "on iteration: " << i;
+        CompleteCommand(GCODE_INCOMPLETE);
+    }
+    m_storage->SetLatency(0);
+}
+
+TEST_F(GCodeDriverPrefetchTest, printer_prefetch_async_load_executes_all_commands)
+{
+    for (GCODE_STORAGE_FORMAT format : { GCODE_FORMAT_CHUNKS, GCODE_FORMAT_COMPACT })
+    {
+        createCommands(command_block_size * sectors_count, format);
+        startPrinting(MEMORY_PAGES_COUNT - 1);
+        m_storage->SetLatency(5);
+        size_t polls = m_storage->GetPollsCount();
+        runPrint([](size_t, uint32_t) { return 0; });
+        m_storage->SetLatency(0);
+
+        ASSERT_EQ(0, PrinterGetRemainingCommandsCount(printer_driver)) << "format " << format;
+        ASSERT_EQ((commands_count - 1) * 10, PrinterGetCurrentPosition(printer_driver)->x) << "format " << format;
+        ASSERT_LT(polls, m_storage->GetPollsCount());
+    }
+}
+
+TEST_F(GCodeDriverPrefetchTest, printer_motion_queue_executes_all_commands)
+{
+    for (GCODE_STORAGE_FORMAT format : { GCODE_FORMAT_CHUNKS, GCODE_FORMAT_COMPACT })
+    {
+        createCommands(command_block_size * sectors_count, format);
+        for (uint8_t blocks : { 1, MOTION_BLOCKS_COUNT, 40 })
+        {
+            startPrinting(MEMORY_PAGES_COUNT - 1, blocks);
+            runPrint([](size_t, uint32_t) { return 0; });
+            ASSERT_EQ(0, PrinterGetRemainingCommandsCount(printer_driver)) << "format " << format << " blocks " << (int)blocks;
+            ASSERT_EQ((commands_count - 1) * 10, PrinterGetCurrentPosition(printer_driver)->x) << "format " << format << " blocks " << (int)blocks;
+        }
+    }
+}
+
+TEST_F(GCodeDriverPrefetchTest, printer_motion_queue_stalls_without_main_loop)
+{
+    createCommands(command_block_size * sectors_count, GCODE_FORMAT_CHUNKS);
+    startPrinting(MEMORY_PAGES_COUNT - 1, MOTION_BLOCKS_COUNT);
+
+    // blocks are prepared by the print start, the rest is decoded by the main loop
+    for (size_t i = 0; i < MOTION_BLOCKS_COUNT; ++i)
+    {
+        CompleteCommand(PrinterNextCommand(printer_driver));
+    }
+    ASSERT_EQ(MOTION_BLOCKS_COUNT * 10 - 10, PrinterGetCurrentPosition(printer_driver)->x);
+    ASSERT_EQ(PRINTER_PRELOAD_REQUIRED, PrinterNextCommand(printer_driver));
+    ASSERT_EQ(PRINTER_PRELOAD_REQUIRED, PrinterNextCommand(printer_driver));
+    ASSERT_EQ(1, PrinterGetStallsCount(printer_driver));
+
+    ASSERT_EQ(PRINTER_OK, PrinterLoadData(printer_driver));
+    ASSERT_EQ(GCODE_INCOMPLETE, PrinterNextCommand(printer_driver));
+    ASSERT_EQ(MOTION_BLOCKS_COUNT * 10, PrinterGetCurrentPosition(printer_driver)->x);
+}
+
+TEST_F(GCodeDriverPrefetchTest, printer_motion_queue_matches_inline_execution)
+{
+    std::vector<std::string> commands = { "G28", "G0 F1800 X0 Y0 Z0 E0", "M106 S100" };
+    for (size_t i = 1; i < command_block_size * sectors_count; ++i)
+    {
+        std::ostringstream command;
+        switch (i % 7)
+        {
+        case 0: command << "G1 F600 Z" << i * 0.1; break;
+        case 3: command << "G92 E0"; break;
+        case 5: command << "M104 S" << 200 + i % 10; break;
+        default: command << "G1 F" << 1200 + (i % 5) * 600 << " X" << i * 3 << " Y" << (i % 11) * 4 << " E" << i; break;
+        }
+        commands.push_back(command.str());
+    }
+    commands.push_back("G28");
+
+    // records the motion state at the start of every command
+    auto trace = [&](uint8_t blocks)
+    {
+        std::vector<std::vector<int64_t>> records;
+        startPrinting(MEMORY_PAGES_COUNT - 1, blocks, PRINTER_ACCELERATION_ENABLE);
+        uint32_t remaining = PrinterGetRemainingCommandsCount(printer_driver);
+        while (remaining)
+        {
+            EXPECT_EQ(PRINTER_OK, PrinterLoadData(printer_driver));
+            PrinterNextCommand(printer_driver);
+            if (remaining != PrinterGetRemainingCommandsCount(printer_driver))
+            {
+                remaining = PrinterGetRemainingCommandsCount(printer_driver);
+                const GCodeCommandParams* path = PrinterGetCurrentPath(printer_driver);
+                const GCodeCommandParams* position = PrinterGetCurrentPosition(printer_driver);
+                records.push_back({ path->x, path->y, path->z, path->e, path->fetch_speed,
+                    position->x, position->y, position->z, position->e,
+                    PrinterGetAccelerationRegion(printer_driver), PrinterGetAccelTimerPower(printer_driver) });
+            }
+            PrinterExecuteCommand(printer_driver);
+        }
+        return records;
+    };
+
+    for (GCODE_STORAGE_FORMAT format : { GCODE_FORMAT_CHUNKS, GCODE_FORMAT_COMPACT })
+    {
+        FileManagerSetStorageFormat(m_file_manager, format);
+        CreateGCodeData(commands);
+        auto expected = trace(0);
+        auto queued = trace(MOTION_BLOCKS_COUNT);
+        ASSERT_EQ(commands.size(), expected.size()) << "format " << format;
+        ASSERT_EQ(expected.size(), queued.size()) << "format " << format;
+        for (size_t i = 0; i < expected.size(); ++i)
+        {
+            ASSERT_EQ(expected[i], queued[i]) << "format " << format << " command " << i << ": " << commands[i];
+        }
+    }
+}
+
+TEST_F(GCodeDriverPrefetchTest, printer_motion_queue_timer_time)
+{
+    std::vector<std::string> commands = { "G0 F1800 X0 Y0 Z0 E0" };
+    for (size_t i = 1; i < command_block_size * sectors_count; ++i)
+    {
+        // short segments of the different speed, every command is a new acceleration sequence
+        std::ostringstream command;
+        command << "G1 F" << 1200 + (i % 2) * 1800 << " X" << (i % 2) * 2 << " Y" << i % 3 << " E" << i;
+        commands.push_back(command.str());
+    }
+    CreateGCodeData(commands);
+
+    // measures the timer interrupt handler, the main loop is not measured
+    auto measure = [&](uint8_t blocks, double& mean)
+    {
+        using clock = std::chrono::high_resolution_clock;
+        startPrinting(MEMORY_PAGES_COUNT - 1, blocks, PRINTER_ACCELERATION_ENABLE);
+        long long worst = 0;
+        long long total = 0;
+        size_t ticks = 0;
+        while (PrinterGetRemainingCommandsCount(printer_driver))
+        {
+            PrinterLoadData(printer_driver);
+            auto start = clock::now();
+            PrinterNextCommand(printer_driver);
+            PrinterExecuteCommand(printer_driver);
+            long long elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+            worst = std::max(worst, elapsed);
+            total += elapsed;
+            ++ticks;
+        }
+        mean = (double)total / ticks;
+        return worst;
+    };
+
+    // host scheduler adds noise to the worst case, so the best of several runs is taken
+    long long worst[2] = { LLONG_MAX, LLONG_MAX };
+    double mean[2] = { 0 };
+    for (size_t run = 0; run < 5; ++run)
+    {
+        double run_mean = 0;
+        worst[0] = std::min(worst[0], measure(0, run_mean));
+        mean[0] += run_mean / 5;
+        worst[1] = std::min(worst[1], measure(MOTION_BLOCKS_COUNT, run_mean));
+        mean[1] += run_mean / 5;
+        ASSERT_EQ(0, PrinterGetRemainingCommandsCount(printer_driver));
+    }
+
+    std::cout << "Timer interrupt time, " << commands.size() << " commands" << std::endl
+        << "    decoding in the timer: worst " << worst[0] << " ns, mean " << mean[0] << " ns" << std::endl
+        << "    motion queue of " << MOTION_BLOCKS_COUNT << " blocks: worst " << worst[1] << " ns, mean " << mean[1] << " ns" << std::endl;
+}
@@ -4,6 +4,7 @@
 #include "solutions/printer_emulator.h"
 #include <gtest/gtest.h>
 #include <sstream>
+#include <algorithm>
 
 class GCodeDriverAccelerationBasicTest : public ::testing::Test, public PrinterEmulator
 {
@@ -99,8 +100,9 @@ TEST_F(GCodeDriverAccelerationTest, printer_region_series)
     PrinterNextCommand(printer_driver);
     //uint32_t cmd_count = PrinterGetAccelerationRegionsCount(printer_driver);
     //ASSERT_EQ(3U, cmd_count);
+    // every segment has its own planned trapezoid
     uint32_t region_length = PrinterGetAccelerationRegion(printer_driver);
-    ASSERT_EQ(1248U, region_length);
+    ASSERT_EQ(416U, region_length);
 }
 
 //TEST_F(GCodeDriverAccelerationTest, printer_region_series_commands)
@@ -130,7 +132,7 @@ TEST_F(GCodeDriverAccelerationTest, printer_region_ends_by_speed_change)
     PrinterNextCommand(printer_driver);
     PrinterNextCommand(printer_driver);
     uint32_t region_length = PrinterGetAccelerationRegion(printer_driver);
-    ASSERT_EQ(1249U, region_length);
+    ASSERT_EQ(416U, region_length);
 }
 
 //TEST_F(GCodeDriverAccelerationTest, printer_region_ends_by_speed_change_commands)
@@ -232,7 +234,7 @@ TEST_F(GCodeDriverAccelerationTest, printer_region_z_direction_works)
     PrinterNextCommand(printer_driver);
     PrinterNextCommand(printer_driver);
     uint32_t region_length = PrinterGetAccelerationRegion(printer_driver);
-    ASSERT_EQ(832U, region_length);
+    ASSERT_EQ(416U, region_length);
 }
 
 TEST_F(GCodeDriverAccelerationTest, printer_region_subregions)
@@ -246,7 +248,7 @@ TEST_F(GCodeDriverAccelerationTest, printer_region_subregions)
     PrinterNextCommand(printer_driver);
     PRINTER_STATUS status = PrinterNextCommand(printer_driver);
     uint32_t region_length = PrinterGetAccelerationRegion(printer_driver);
-    ASSERT_EQ(832U, region_length);
+    ASSERT_EQ(416U, region_length);
     CompleteCommand(status);
     status = PrinterNextCommand(printer_driver);
     region_length = PrinterGetAccelerationRegion(printer_driver);
@@ -268,7 +270,7 @@ TEST_F(GCodeDriverAccelerationTest, printer_region_subsequent_regions)
     CompleteCommand(PrinterNextCommand(printer_driver));
     PrinterNextCommand(printer_driver);
     uint32_t region_length = PrinterGetAccelerationRegion(printer_driver);
-    ASSERT_EQ(1000U, region_length);
+    ASSERT_EQ(500U, region_length);
 }
 
 //TEST_F(GCodeDriverAccelerationTest, printer_region_subsequent_regions_decrement_commands)
@@ -375,7 +377,7 @@ TEST_F(GCodeDriverAccelerationTest, printer_region_exceeds_single_command_block)
     PrinterNextCommand(printer_driver);
     ASSERT_EQ(GCODE_INCOMPLETE, PrinterNextCommand(printer_driver));
     uint32_t region_length = PrinterGetAccelerationRegion(printer_driver);
-    ASSERT_EQ(41U * command_block_size * 3, region_length);
+    ASSERT_EQ(41U, region_length);
 }
 
 class GCodeDriverAccelLongRegionTest : public ::testing::Test, public PrinterEmulator
@@ -689,4 +691,114 @@ TEST_F(GCodeDriverExtremeAccel, accel_variation_xy)
     {
         ASSERT_EQ(original_steps_count, states[i].signals_log.size()) << "failed on command " << commands[i];
     }
-}
\ No newline at end of file
+}
+class GCodeDriverAccelProfileTest : public ::testing::Test, public PrinterEmulator
+{
+public:
+    GCodeDriverAccelProfileTest()
+        : PrinterEmulator(10000)
+    {}
+protected:
+    // velocity of the head on every tick of the second command
+    std::vector<uint16_t> TraceVelocity(ACCELERATION_PROFILE profile)
+    {
+        SetupAxisRestrictions(axis_configuration);
+        SetupPrinter(axis_configuration, PRINTER_ACCELERATION_ENABLE, profile);
+        StartPrinting(commands, nullptr);
+        PrinterNextCommand(printer_driver);
+
+        std::vector<uint16_t> trace;
+        PRINTER_STATUS status = PrinterNextCommand(printer_driver);
+        while (PRINTER_OK != status)
+        {
+            trace.push_back(PrinterGetVelocity(printer_driver));
+            status = PrinterExecuteCommand(printer_driver);
+        }
+        return trace;
+    }
+
+    // velocity changes once per STANDARD_ACCELERATION_SEGMENT ticks
+    static std::vector<int32_t> VelocityChanges(const std::vector<uint16_t>& trace)
+    {
+        std::vector<int32_t> changes;
+        for (size_t i = STANDARD_ACCELERATION_SEGMENT; i < trace.size(); i += STANDARD_ACCELERATION_SEGMENT)
+        {
+            changes.push_back((int32_t)trace[i] - (int32_t)trace[i - STANDARD_ACCELERATION_SEGMENT]);
+        }
+        return changes;
+    }
+
+    std::vector<std::string> commands = {
+        "G0 F1800 X0 Y0 Z0 E0",
+        "G0 F1800 X100 Y0 Z0 E0",
+    };
+    // velocity change by one region of the trapezoid, mm/min
+    const int32_t region_velocity = SECONDS_IN_MINUTE * STANDARD_ACCELERATION * STANDARD_ACCELERATION_SEGMENT / MAIN_TIMER_FREQUENCY;
+};
+
+TEST_F(GCodeDriverAccelProfileTest, scurve_ramps_are_longer)
+{
+    std::vector<int32_t> trapezoid = VelocityChanges(TraceVelocity(ACCELERATION_PROFILE_TRAPEZOID));
+    std::vector<int32_t> scurve = VelocityChanges(TraceVelocity(ACCELERATION_PROFILE_SCURVE));
+    // changes till the end of the acceleration and from the start of the braking
+    auto ramps = [](const std::vector<int32_t>& changes)
+    {
+        auto acceleration = std::find_if(changes.rbegin(), changes.rend(), [](int32_t change) { return change > 0; });
+        auto braking = std::find_if(changes.begin(), changes.end(), [](int32_t change) { return change < 0; });
+        return std::make_pair(std::distance(acceleration, changes.rend()), std::distance(braking, changes.end()));
+    };
+
+    // the same velocity change with the half of the average acceleration, velocity changes slowly at the ends of the ramp
+    ASSERT_GT(ramps(scurve).first, 3 * ramps(trapezoid).first / 2);
+    ASSERT_LE(ramps(scurve).first, 2 * ramps(trapezoid).first + 1);
+    ASSERT_GT(ramps(scurve).second, 3 * ramps(trapezoid).second / 2);
+    ASSERT_LE(ramps(scurve).second, 2 * ramps(trapezoid).second + 1);
+    ASSERT_GT(scurve.size(), trapezoid.size());
+}
+
+TEST_F(GCodeDriverAccelProfileTest, scurve_has_the_same_speeds)
+{
+    std::vector<uint16_t> trapezoid = TraceVelocity(ACCELERATION_PROFILE_TRAPEZOID);
+    std::vector<uint16_t> scurve = TraceVelocity(ACCELERATION_PROFILE_SCURVE);
+    ASSERT_EQ(trapezoid.front(), scurve.front());
+    ASSERT_EQ(1800, *std::max_element(scurve.begin(), scurve.end()));
+    // the segment ends at the end of braking, S-curve brakes softer at the end
+    ASSERT_LE(scurve.back(), trapezoid.back());
+}
+
+TEST_F(GCodeDriverAccelProfileTest, trapezoid_acceleration_is_constant)
+{
+    std::vector<int32_t> changes = VelocityChanges(TraceVelocity(ACCELERATION_PROFILE_TRAPEZOID));
+    ASSERT_NEAR(region_velocity, changes.front(), 1);
+    ASSERT_NEAR(-region_velocity, changes.back(), 1);
+}
+
+TEST_F(GCodeDriverAccelProfileTest, scurve_acceleration_grows_and_falls)
+{
+    std::vector<int32_t> changes = VelocityChanges(TraceVelocity(ACCELERATION_PROFILE_SCURVE));
+
+    // velocity doesn't jump at the start of the acceleration
+    ASSERT_EQ(0, changes.front());
+
+    // velocity only grows during acceleration and only falls during braking,
+    // max acceleration is the standard one
+    auto braking = std::find_if(changes.begin(), changes.end(), [](int32_t change) { return change < 0; });
+    ASSERT_NE(changes.end(), braking);
+    int32_t max_change = 0;
+    for (auto change = changes.begin(); change != braking; ++change)
+    {
+        ASSERT_GE(*change, 0);
+        max_change = std::max(max_change, *change);
+    }
+    for (auto change = braking; change != changes.end(); ++change)
+    {
+        ASSERT_LE(*change, 0);
+    }
+    int32_t min_change = 0;
+    for (auto change = braking; change != changes.end(); ++change)
+    {
+        min_change = std::min(min_change, *change);
+    }
+    ASSERT_NEAR(region_velocity, max_change, 1);
+    ASSERT_NEAR(-region_velocity, min_change, 1);
+}
@@ -0,0 +1,270 @@
+#include "device_mock.h"
+#include "printer_constants.h"
+#include "printer_entities.h"
+#include "sdcard.h"
+#include "image_compiler.h"
+#include "parallel_compiler.h"
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+class ParallelCompilerTest : public ::testing::Test
+{
+protected:
+    virtual void SetUp()
+    {
+        DeviceSettings ds;
+        ds.available_heap = 0x20000;
+        m_device = std::make_unique<Device>(ds);
+        AttachDevice(*m_device);
+    }
+
+    virtual void TearDown()
+    {
+        DetachDevice();
+    }
+
+    std::vector<char> readResource(const std::string& name)
+    {
+        FILE* file = nullptr;
+        fopen_s(&file, name.c_str(), "rb");
+        if (!file)
+        {
+            return {};
+        }
+
+        std::vector<char> content;
+        char symbol;
+        while (1 == fread_s(&symbol, 1, 1, 1, file))
+        {
+            content.push_back(symbol);
+        }
+        fclose(file);
+        return content;
+    }
+
+    std::vector<char> makeContent(const std::vector<std::string>& lines)
+    {
+        std::vector<char> content;
+        for (const auto& line : lines)
+        {
+            content.insert(content.end(), line.begin(), line.end());
+            content.push_back('\n');
+        }
+        return content;
+    }
+
+    // compiles the content by the file manager and by the parallel compiler and compares images
+    void compareWithSequential(const std::vector<char>& content, uint16_t max_fetch_speed, size_t threads, size_t chunk_size,
+        float coalescing_tolerance = 0, float simplification_tolerance = 0, bool overlap_heating = false)
+    {
+        for (GCODE_STORAGE_FORMAT format : { GCODE_FORMAT_CHUNKS, GCODE_FORMAT_COMPACT })
+        {
+            ImageCompiler sequential(axis_configuration, max_fetch_speed);
+            sequential.SetCoalescing(coalescing_tolerance);
+            sequential.SetSimplification(simplification_tolerance);
+            sequential.SetHeatingOverlap(overlap_heating);
+            ASSERT_EQ(PRINTER_OK, sequential.Compile("file.gcode", content, format)) << sequential.GetError();
+
+            ParallelCompiler parallel(axis_configuration, max_fetch_speed, threads, chunk_size);
+            parallel.SetCoalescing(coalescing_tolerance);
+            parallel.SetSimplification(simplification_tolerance);
+            parallel.SetHeatingOverlap(overlap_heating);
+            ASSERT_EQ(PRINTER_OK, parallel.Compile("file.gcode", content, format)) << parallel.GetError();
+            ASSERT_EQ(sequential.GetControlBlock().commands_count, parallel.GetControlBlock().commands_count);
+            ASSERT_EQ(sequential.GetControlBlock().source_commands_count, parallel.GetControlBlock().source_commands_count);
+            ASSERT_EQ(sequential.GetMaxDeviation(), parallel.GetMaxDeviation());
+            ASSERT_EQ(sequential.GetImage().size(), parallel.GetImage().size()) << "storage format " << format;
+
+            const std::vector<uint8_t>& expected = sequential.GetImage();
+            const std::vector<uint8_t>& image = parallel.GetImage();
+            auto mismatch = std::mismatch(expected.begin(), expected.end(), image.begin());
+            ASSERT_TRUE(mismatch.first == expected.end())
+                << "storage format " << format << ", first difference at byte " << mismatch.first - expected.begin();
+        }
+    }
+
+    std::unique_ptr<Device> m_device;
+};
+
+TEST_F(ParallelCompilerTest, single_thread)
+{
+    std::vector<char> content = readResource("wanhao.gcode");
+    ASSERT_FALSE(content.empty()) << "required file wanhao.gcode not found";
+    compareWithSequential(content, 0, 1, 0);
+}
+
+TEST_F(ParallelCompilerTest, multiple_threads)
+{
+    for (const char* name : { "wanhao.gcode", "model.gcode" })
+    {
+        std::vector<char> content = readResource(name);
+        ASSERT_FALSE(content.empty()) << "required file " << name << " not found";
+        for (size_t threads : { 2, 3, 8 })
+        {
+            ASSERT_NO_FATAL_FAILURE(compareWithSequential(content, MAX_FETCH_SPEED, threads, 0)) << name << " threads " << threads;
+        }
+    }
+}
+
+TEST_F(ParallelCompilerTest, small_chunks)
+{
+    // sequences and modal state cross almost every chunk boundary
+    std::vector<char> content = readResource("wanhao.gcode");
+    ASSERT_FALSE(content.empty()) << "required file wanhao.gcode not found";
+    compareWithSequential(content, MAX_FETCH_SPEED, 4, 64);
+}
+
+TEST_F(ParallelCompilerTest, coalesced_moves)
+{
+    for (const char* name : { "wanhao.gcode", "model.gcode" })
+    {
+        std::vector<char> content = readResource(name);
+        ASSERT_FALSE(content.empty()) << "required file " << name << " not found";
+        ASSERT_NO_FATAL_FAILURE(compareWithSequential(content, MAX_FETCH_SPEED, 4, 0, 0.02f)) << name;
+    }
+}
+
+TEST_F(ParallelCompilerTest, simplified_paths)
+{
+    for (const char* name : { "wanhao.gcode", "model.gcode" })
+    {
+        std::vector<char> content = readResource(name);
+        ASSERT_FALSE(content.empty()) << "required file " << name << " not found";
+        ASSERT_NO_FATAL_FAILURE(compareWithSequential(content, MAX_FETCH_SPEED, 4, 0, 0.02f, 4)) << name;
+    }
+}
+
+TEST_F(ParallelCompilerTest, overlapped_heating)
+{
+    for (const char* name : { "wanhao.gcode", "model.gcode" })
+    {
+        std::vector<char> content = readResource(name);
+        ASSERT_FALSE(content.empty()) << "required file " << name << " not found";
+        ASSERT_NO_FATAL_FAILURE(compareWithSequential(content, MAX_FETCH_SPEED, 4, 0, 0.02f, 4, true)) << name;
+    }
+}
+
+// command reduction and the largest deviation of the simplified paths on the test models
+TEST_F(ParallelCompilerTest, simplification_report)
+{
+    for (const char* name : { "wanhao.gcode", "model.gcode" })
+    {
+        std::vector<char> content = readResource(name);
+        ASSERT_FALSE(content.empty()) << "required file " << name << " not found";
+        for (float tolerance : { 1.f, 2.f, 4.f, 8.f })
+        {
+            ParallelCompiler compiler(axis_configuration, MAX_FETCH_SPEED, 4);
+            compiler.SetSimplification(tolerance);
+            ASSERT_EQ(PRINTER_OK, compiler.Compile("file.gcode", content, GCODE_FORMAT_CHUNKS)) << compiler.GetError();
+
+            const PrinterControlBlock& control_block = compiler.GetControlBlock();
+            ASSERT_LT(control_block.commands_count, control_block.source_commands_count);
+            ASSERT_LE(compiler.GetMaxDeviation(), tolerance);
+            std::cout << name << ", tolerance " << tolerance << " steps: " << control_block.commands_count << " of "
+                      << control_block.source_commands_count << " commands, max deviation " << compiler.GetMaxDeviation() << " steps" << std::endl;
+        }
+    }
+}
+
+TEST_F(ParallelCompilerTest, modal_state)
+{
+    std::vector<char> content = makeContent({
+        "G28 X0 Y0",
+        "M104 S200 I1",
+        "G1 F9000 X10 Y10 Z0.3 E1",
+        "G4 F100",
+        "G1 X20 Y10 E2",
+        "G1 X30 Y10 E3 ; comment",
+        "G1X31",
+        "M107",
+        "G1 X40 Y10 E4",
+        "M104 I1",
+        "M106 S128",
+        "M104 I0",
+        "G92 E0",
+        "M83",
+        "G1 X50 Y10 E1",
+        "G1 X60 Y10 E1",
+        "M82",
+        "G91",
+        "G1 X10 Y5 E1",
+        "G1 F1200 X10 Y5 E1",
+        "G1 X10 Y5",
+        "G90",
+        "  G1 X10 Y10 Z0.5 E5",
+        "G60",
+        "G1 X15 Y10",
+        "G99",
+        "G1 X20 Y10",
+        "G1 X30 Y10",
+        "G28",
+        "G1 F1800 X1 Y1",
+        "G1 X2 Y2",
+        "G1 X3 Y3",
+        "M109 S210",
+        "G1 X4 Y4",
+    });
+    // unterminated line at the end of the file
+    std::string last_line = "G1 X5 Y5 E6";
+    content.insert(content.end(), last_line.begin(), last_line.end());
+
+    for (size_t chunk_size : { 1, 16, 100 })
+    {
+        ASSERT_NO_FATAL_FAILURE(compareWithSequential(content, 3000, 4, chunk_size)) << "chunk size " << chunk_size;
+    }
+}
+
+TEST_F(ParallelCompilerTest, invalid_line)
+{
+    std::vector<char> content = readResource("wanhao.gcode");
+    ASSERT_FALSE(content.empty()) << "required file wanhao.gcode not found";
+    std::string invalid = "G1 X10 Q5\n";
+    auto line = std::find(content.begin() + content.size() / 2, content.end(), '\n') + 1;
+    content.insert(line, invalid.begin(), invalid.end());
+
+    ImageCompiler sequential(axis_configuration, MAX_FETCH_SPEED);
+    ASSERT_EQ(PRINTER_FILE_NOT_GCODE, sequential.Compile("file.gcode", content, GCODE_FORMAT_CHUNKS));
+
+    ParallelCompiler parallel(axis_configuration, MAX_FETCH_SPEED, 4, 1024);
+    ASSERT_EQ(PRINTER_FILE_NOT_GCODE, parallel.Compile("file.gcode", content, GCODE_FORMAT_CHUNKS));
+    ASSERT_EQ(sequential.GetError(), parallel.GetError());
+    ASSERT_TRUE(parallel.GetImage().empty());
+}
+
+TEST_F(ParallelCompilerTest, empty_file)
+{
+    ParallelCompiler parallel(axis_configuration, MAX_FETCH_SPEED, 4);
+    ASSERT_EQ(PRINTER_FILE_NOT_GCODE, parallel.Compile("file.gcode", {}, GCODE_FORMAT_CHUNKS));
+}
+
+TEST_F(ParallelCompilerTest, scaling_benchmark)
+{
+    std::vector<char> model = readResource("wanhao.gcode");
+    ASSERT_FALSE(model.empty()) << "required file wanhao.gcode not found";
+    std::vector<char> content;
+    for (size_t i = 0; i < 8; ++i)
+    {
+        content.insert(content.end(), model.begin(), model.end());
+    }
+
+    ImageCompiler sequential(axis_configuration, MAX_FETCH_SPEED);
+    auto start = std::chrono::high_resolution_clock::now();
+    ASSERT_EQ(PRINTER_OK, sequential.Compile("file.gcode", content, GCODE_FORMAT_CHUNKS));
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count();
+    std::cout << "Compilation of " << content.size() << " bytes, " << sequential.GetControlBlock().commands_count << " commands" << std::endl
+        << "    file manager: " << elapsed << " us" << std::endl;
+
+    size_t max_threads = std::max<size_t>(std::thread::hardware_concurrency(), 4);
+    for (size_t threads = 1; threads <= max_threads; threads *= 2)
+    {
+        ParallelCompiler parallel(axis_configuration, MAX_FETCH_SPEED, threads);
+        start = std::chrono::high_resolution_clock::now();
+        ASSERT_EQ(PRINTER_OK, parallel.Compile("file.gcode", content, GCODE_FORMAT_CHUNKS));
+        elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count();
+        ASSERT_TRUE(sequential.GetImage() == parallel.GetImage()) << "threads " << threads;
+        std::cout << "    " << threads << " threads: " << elapsed << " us" << std::endl;
+    }
+}
@@ -11,8 +11,216 @@
 #include "ff.h"
 
 #include <gtest/gtest.h>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
 
 TEST(PrinterBasicTest, can_create)
 {
-   
+
+}
+
+class PrinterPreheatTest : public ::testing::Test
+{
+protected:
+    // center of the transfer button of the printing frame
+    static const uint16_t s_transfer_x = 160;
+    static const uint16_t s_transfer_y = 105;
+    static const uint16_t s_timeout = 2;
+
+    virtual void SetUp()
+    {
+        DeviceSettings ds;
+        device = std::make_unique<Device>(ds);
+        AttachDevice(*device);
+
+        external = std::make_unique<SDcardMock>(4096);
+        internal = std::make_unique<SDcardMock>(4096);
+        config.storages[STORAGE_EXTERNAL] = external.get();
+        config.storages[STORAGE_INTERNAL] = internal.get();
+        config.hdisplay = &display;
+        MemoryManagerConfigure(&config.memory_manager);
+
+        registerFileSystem();
+
+        TermalRegulatorConfig regulators[TERMO_REGULATOR_COUNT] =
+        {
+            { &port_nozzle, 0, GPIO_PIN_SET, GPIO_PIN_RESET, 1.f, 0.f },
+            { &port_table, 0, GPIO_PIN_RESET, GPIO_PIN_SET, 1.f, 0.f }
+        };
+        for (size_t i = 0; i < TERMO_REGULATOR_COUNT; ++i)
+        {
+            config.termal_regulators[i] = TR_Configure(&regulators[i]);
+        }
+
+        MotorConfig motor[MOTOR_COUNT] =
+        {
+            {PULSE_LOWER, &port_x_step, 0, &port_x_dir, 0 },
+            {PULSE_LOWER, &port_y_step, 0, &port_y_dir, 0 },
+            {PULSE_LOWER, &port_z_step, 0, &port_z_dir, 0 },
+            {PULSE_LOWER, &port_e_step, 0, &port_e_dir, 0 },
+        };
+        config.steppers = STEPPERGROUP_Configure(motor, MOTOR_COUNT);
+        config.cooler_port = &port_cooler;
+
+        config.preheat_on_transfer = true;
+        config.preheat_timeout = s_timeout;
+    }
+
+    virtual void TearDown()
+    {
+        f_mount(0, "", 0);
+        SDcardMock::ResetFS();
+        DetachDevice();
+    }
+
+    void registerFileSystem()
+    {
+        MKFS_PARM fs_params =
+        {
+            FM_FAT,
+            1,
+            0,
+            0,
+            SDcardMock::s_sector_size
+        };
+
+        SDCARD_FAT_Register(external.get(), 0);
+        std::vector<uint8_t> working_buffer(512);
+        f_mkfs("0", &fs_params, working_buffer.data(), working_buffer.size());
+        f_mount(&fatfs, "", 0);
+    }
+
+    // the temperatures are set at the start of the file, the moves make the transfer take several blocks
+    void createModel()
+    {
+        std::stringstream model;
+        model << "M104 S200\r\nM140 S60\r\nG28\r\n";
+        for (int i = 0; i < 200; ++i)
+        {
+            model << "G1 X" << (i % 2 ? 10 : 20) << " Y" << i % 50 << " E" << i << " F1800\r\n";
+        }
+        std::string content = model.str();
+
+        FIL f;
+        uint32_t bytes_written;
+        f_open(&f, "model.gcode", FA_CREATE_ALWAYS | FA_WRITE);
+        f_write(&f, content.data(), content.size(), &bytes_written);
+        f_close(&f);
+    }
+
+    void startTransfer()
+    {
+        TrackAction(printer, s_transfer_x, s_transfer_y, true);
+        TrackAction(printer, s_transfer_x, s_transfer_y, false);
+    }
+
+    // one loop of the main thread, the timer interrupts of the loop duration are emulated by ticks
+    void run(uint32_t ticks)
+    {
+        MainLoop(printer);
+        for (uint32_t i = 0; i < ticks; ++i)
+        {
+            OnTimer(printer);
+        }
+    }
+
+    bool isPreheated()
+    {
+        return 200 == TR_GetTargetTemperature(config.termal_regulators[TERMO_NOZZLE]) &&
+               60 == TR_GetTargetTemperature(config.termal_regulators[TERMO_TABLE]);
+    }
+
+    bool isSwitchedOff()
+    {
+        return 0 == TR_GetTargetTemperature(config.termal_regulators[TERMO_NOZZLE]) &&
+               0 == TR_GetTargetTemperature(config.termal_regulators[TERMO_TABLE]);
+    }
+
+    std::unique_ptr<Device> device;
+    std::unique_ptr<SDcardMock> external;
+    std::unique_ptr<SDcardMock> internal;
+    DisplayMock display;
+    FATFS fatfs;
+    PrinterConfiguration config = {};
+    HPRINTER printer = nullptr;
+
+    GPIO_TypeDef port_x_step = 0;
+    GPIO_TypeDef port_y_step = 1;
+    GPIO_TypeDef port_z_step = 2;
+    GPIO_TypeDef port_e_step = 3;
+    GPIO_TypeDef port_x_dir = 4;
+    GPIO_TypeDef port_y_dir = 5;
+    GPIO_TypeDef port_z_dir = 6;
+    GPIO_TypeDef port_e_dir = 7;
+    GPIO_TypeDef port_nozzle = 8;
+    GPIO_TypeDef port_table = 9;
+    GPIO_TypeDef port_cooler = 10;
+};
+
+TEST_F(PrinterPreheatTest, heaters_are_preheated_by_transfer)
+{
+    createModel();
+    printer = Configure(&config);
+    ASSERT_FALSE(isPreheated());
+
+    startTransfer();
+    run(0);
+    ASSERT_TRUE(isPreheated());
+}
+
+TEST_F(PrinterPreheatTest, timeout_starts_after_transfer)
+{
+    createModel();
+    printer = Configure(&config);
+    startTransfer();
+
+    // the time of the transfer isn't counted by the timeout
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        run(s_timeout * MAIN_TIMER_FREQUENCY);
+        ASSERT_TRUE(isPreheated());
+    }
+    for (uint32_t i = 0; i < 100; ++i)
+    {
+        run(0);
+    }
+    ASSERT_TRUE(isPreheated());
+}
+
+TEST_F(PrinterPreheatTest, heaters_are_switched_off_by_timeout)
+{
+    createModel();
+    printer = Configure(&config);
+    startTransfer();
+
+    // transfer is completed, the timeout starts
+    for (uint32_t i = 0; i < 100; ++i)
+    {
+        run(0);
+    }
+    ASSERT_TRUE(isPreheated());
+
+    run(s_timeout * MAIN_TIMER_FREQUENCY - 1);
+    run(0);
+    ASSERT_TRUE(isPreheated());
+
+    run(1);
+    run(0);
+    ASSERT_TRUE(isSwitchedOff());
+}
+
+TEST_F(PrinterPreheatTest, heaters_are_switched_off_by_transfer_failure)
+{
+    createModel();
+    printer = Configure(&config);
+    startTransfer();
+    run(0);
+    ASSERT_TRUE(isPreheated());
+
+    external->SetCardStatus(SDCARD_CARD_FAILURE);
+    run(0);
+    run(0);
+    ASSERT_TRUE(isSwitchedOff());
 }
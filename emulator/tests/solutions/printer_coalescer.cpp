@@ -0,0 +1,206 @@
+#include "printer_coalescer.h"
+#include "printer_constants.h"
+
+#include <gtest/gtest.h>
+#include <array>
+#include <cmath>
+#include <vector>
+
+class PrinterCoalescerTest : public ::testing::Test
+{
+protected:
+    typedef std::array<uint8_t, GCODE_CHUNK_SIZE> Command;
+
+    virtual void SetUp()
+    {
+        CoalescerReset(&coalescer, &axis_configuration, 0.05f);
+    }
+
+    // move command to the point in mm, extrusion in mm of the filament
+    Command Move(double x, double y, double e = 0, parameterType fetch_speed = 1800)
+    {
+        Command command = { 0 };
+        *(parameterType*)command.data() = GCODE_COMMAND | GCODE_MOVE;
+        GCodeCommandParams* point = (GCodeCommandParams*)(command.data() + sizeof(parameterType));
+        *point = {
+            (parameterType)(x * axis_configuration.x_steps_per_mm),
+            (parameterType)(y * axis_configuration.y_steps_per_mm),
+            0,
+            (parameterType)(e * axis_configuration.e_steps_per_mm),
+            fetch_speed
+        };
+        return command;
+    }
+
+    const GCodeCommandParams& Point(const Command& command)
+    {
+        return *(const GCodeCommandParams*)(command.data() + sizeof(parameterType));
+    }
+
+    // starts the run from the origin by the first command and merges the rest, returns number of merged commands
+    size_t Merge(const std::vector<Command>& commands)
+    {
+        GCodeCommandParams start = { 0 };
+        pending = commands.front();
+        if (!CoalescerStart(&coalescer, &start, pending.data()))
+        {
+            return 0;
+        }
+        size_t merged = 0;
+        for (size_t i = 1; i < commands.size() && CoalescerMerge(&coalescer, pending.data(), commands[i].data()); ++i)
+        {
+            ++merged;
+        }
+        return merged;
+    }
+
+    MoveCoalescer coalescer;
+    Command pending;
+};
+
+TEST_F(PrinterCoalescerTest, collinear_moves_are_merged)
+{
+    ASSERT_EQ(3U, Merge({ Move(1, 1, 0.1), Move(2, 2, 0.2), Move(3, 3, 0.3), Move(4, 4, 0.4) }));
+    ASSERT_EQ(Point(Move(4, 4, 0.4)).x, Point(pending).x);
+    ASSERT_EQ(Point(Move(4, 4, 0.4)).y, Point(pending).y);
+    ASSERT_EQ(Point(Move(4, 4, 0.4)).e, Point(pending).e);
+}
+
+TEST_F(PrinterCoalescerTest, deviation_within_tolerance_is_merged)
+{
+    ASSERT_EQ(2U, Merge({ Move(1, 0), Move(2, 0.04), Move(3, 0) }));
+}
+
+TEST_F(PrinterCoalescerTest, deviation_over_tolerance_breaks_run)
+{
+    ASSERT_EQ(1U, Merge({ Move(1, 0), Move(2, 0.025), Move(3, 0.2) }));
+    ASSERT_EQ(Point(Move(2, 0.025)).y, Point(pending).y);
+}
+
+TEST_F(PrinterCoalescerTest, dropped_points_are_checked_against_merged_move)
+{
+    // every point is within the tolerance from the line of the first move, but not from the merged one
+    ASSERT_EQ(1U, Merge({ Move(1, 0), Move(2, 0.045), Move(3, -0.045) }));
+    ASSERT_EQ(Point(Move(2, 0.045)).y, Point(pending).y);
+}
+
+TEST_F(PrinterCoalescerTest, zigzag_under_tolerance_stays_within_tolerance)
+{
+    std::vector<Command> commands;
+    for (int i = 1; i <= 200; ++i)
+    {
+        commands.push_back(Move(0.5 * i, (i % 2) ? 0.049 : 0, 0.05 * i));
+    }
+
+    // the file is split into the runs, every command dropped by the run is checked against the merged move
+    GCodeCommandParams start = { 0 };
+    std::vector<GCodeCommandParams> dropped;
+    size_t moves = 1;
+    pending = commands.front();
+    ASSERT_TRUE(CoalescerStart(&coalescer, &start, pending.data()));
+    for (size_t i = 1; i <= commands.size(); ++i)
+    {
+        if (i < commands.size() && CoalescerMerge(&coalescer, pending.data(), commands[i].data()))
+        {
+            dropped.push_back(Point(commands[i - 1]));
+            continue;
+        }
+
+        const GCodeCommandParams& end = Point(pending);
+        double dx = (end.x - start.x) / (double)axis_configuration.x_steps_per_mm;
+        double dy = (end.y - start.y) / (double)axis_configuration.y_steps_per_mm;
+        double length = std::sqrt(dx * dx + dy * dy);
+        for (const GCodeCommandParams& point : dropped)
+        {
+            double px = (point.x - start.x) / (double)axis_configuration.x_steps_per_mm;
+            double py = (point.y - start.y) / (double)axis_configuration.y_steps_per_mm;
+            ASSERT_GE(0.05, std::fabs(px * dy - py * dx) / length);
+
+            double along = (px * dx + py * dy) / length;
+            double extrusion = start.e + (end.e - start.e) * along / length;
+            ASSERT_GE(0.05 * 0.1 * axis_configuration.e_steps_per_mm + 1, std::fabs(point.e - extrusion));
+        }
+
+        if (i < commands.size())
+        {
+            start = end;
+            dropped.clear();
+            pending = commands[i];
+            ++moves;
+            ASSERT_TRUE(CoalescerStart(&coalescer, &start, pending.data()));
+        }
+    }
+    ASSERT_LT(moves, commands.size());
+}
+
+TEST_F(PrinterCoalescerTest, run_is_limited_by_dropped_points)
+{
+    std::vector<Command> commands;
+    for (int i = 1; i <= COALESCER_MAX_POINTS + 3; ++i)
+    {
+        commands.push_back(Move(i, 0, 0.1 * i));
+    }
+    ASSERT_EQ((size_t)COALESCER_MAX_POINTS, Merge(commands));
+}
+
+TEST_F(PrinterCoalescerTest, corner_breaks_run)
+{
+    ASSERT_EQ(0U, Merge({ Move(10, 0), Move(10, 10) }));
+}
+
+TEST_F(PrinterCoalescerTest, reversal_breaks_run)
+{
+    ASSERT_EQ(0U, Merge({ Move(10, 0), Move(5, 0) }));
+}
+
+TEST_F(PrinterCoalescerTest, fetch_speed_change_breaks_run)
+{
+    ASSERT_EQ(0U, Merge({ Move(1, 0, 0, 1800), Move(2, 0, 0, 1200) }));
+}
+
+TEST_F(PrinterCoalescerTest, extrusion_change_breaks_run)
+{
+    ASSERT_EQ(1U, Merge({ Move(1, 0, 1), Move(2, 0, 2), Move(3, 0, 4) }));
+}
+
+TEST_F(PrinterCoalescerTest, extrusion_drift_breaks_run)
+{
+    // each point is within the tolerance from the extrusion extrapolated by the run before it, but the drift moves
+    // the merged move away from the first point
+    ASSERT_EQ(2U, Merge({ Move(1, 0, 1), Move(2, 0, 2.058), Move(3, 0, 3.145), Move(4, 0, 4.2513) }));
+}
+
+TEST_F(PrinterCoalescerTest, travel_moves_are_merged)
+{
+    ASSERT_EQ(2U, Merge({ Move(1, 0), Move(2, 0), Move(3, 0) }));
+}
+
+TEST_F(PrinterCoalescerTest, extrusion_start_breaks_travel)
+{
+    ASSERT_EQ(0U, Merge({ Move(1, 0), Move(2, 0, 1) }));
+}
+
+TEST_F(PrinterCoalescerTest, extrusion_without_motion_is_not_merged)
+{
+    ASSERT_EQ(0U, Merge({ Move(0, 0, 1), Move(0, 0, 2) }));
+    ASSERT_EQ(0U, Merge({ Move(1, 0, 1), Move(1, 0, 2) }));
+}
+
+TEST_F(PrinterCoalescerTest, only_moves_are_merged)
+{
+    Command set = Move(2, 0);
+    *(parameterType*)set.data() = GCODE_COMMAND | GCODE_SET;
+    ASSERT_EQ(0U, Merge({ Move(1, 0), set }));
+
+    Command home = Move(2, 0);
+    *(parameterType*)home.data() = GCODE_COMMAND | GCODE_HOME;
+    ASSERT_EQ(0U, Merge({ Move(1, 0), home }));
+}
+
+TEST_F(PrinterCoalescerTest, zero_tolerance_disables_merging)
+{
+    CoalescerReset(&coalescer, &axis_configuration, 0);
+    GCodeCommandParams start = { 0 };
+    Command move = Move(1, 0);
+    ASSERT_FALSE(CoalescerStart(&coalescer, &start, move.data()));
+}
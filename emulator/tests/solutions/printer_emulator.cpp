@@ -29,7 +29,7 @@ void PrinterEmulator::SetupAxisRestrictions(const GCodeAxisConfig& axis_settings
     axis = axis_settings;
 }
 
-void PrinterEmulator::SetupPrinter(GCodeAxisConfig axis_config, PRINTER_ACCELERATION enable_acceleration)
+void PrinterEmulator::SetupPrinter(GCodeAxisConfig axis_config, PRINTER_ACCELERATION enable_acceleration, ACCELERATION_PROFILE profile)
 {
     m_storage = std::make_unique<SDcardMock>(1024);
     m_sdcard = std::make_unique<SDcardMock>(1024);
@@ -55,10 +55,7 @@ void PrinterEmulator::SetupPrinter(GCodeAxisConfig axis_config, PRINTER_ACCELERA
         { &port_table, 0, GPIO_PIN_RESET, GPIO_PIN_SET, 1.f, 0.f }
     };
 
-    for (size_t i = 0; i < MOTOR_COUNT; ++i)
-    {
-        m_motors[i] = MOTOR_Configure(&motor[i]);
-    }
+    m_steppers = STEPPERGROUP_Configure(motor, MOTOR_COUNT);
     for (size_t i = 0; i < TERMO_REGULATOR_COUNT; ++i)
     {
         m_regulators[i] = TR_Configure(&regulators[i]);
@@ -67,12 +64,14 @@ void PrinterEmulator::SetupPrinter(GCodeAxisConfig axis_config, PRINTER_ACCELERA
     MemoryManagerConfigure(&m_memory);
 
     RegisterSDCard();
-    
+    FileManagerSetAccelerationProfile(m_file_manager, profile);
+
     DriverConfig cfg = { &m_memory, m_storage.get(),
-        m_motors,
+        m_steppers,
         m_regulators,
         &port_cooler, 0,
         &external_config , enable_acceleration };
+    cfg.acceleration_profile = profile;
 
     printer_driver = PrinterConfigure(&cfg);
 }
@@ -97,10 +96,7 @@ void PrinterEmulator::ConfigurePrinter(GCodeAxisConfig axis_config, PRINTER_ACCE
         { &port_table, 0, GPIO_PIN_RESET, GPIO_PIN_SET, 1.f, 0.f }
     };
 
-    for (size_t i = 0; i < MOTOR_COUNT; ++i)
-    {
-        m_motors[i] = MOTOR_Configure(&motor[i]);
-    }
+    m_steppers = STEPPERGROUP_Configure(motor, MOTOR_COUNT);
     for (size_t i = 0; i < TERMO_REGULATOR_COUNT; ++i)
     {
         m_regulators[i] = TR_Configure(&regulators[i]);
@@ -108,7 +104,7 @@ void PrinterEmulator::ConfigurePrinter(GCodeAxisConfig axis_config, PRINTER_ACCE
 
     external_config = axis_config;
     DriverConfig cfg = { &m_memory, m_storage.get(),
-        m_motors,
+        m_steppers,
         m_regulators,
         &port_cooler, 0,
         &external_config , enable_acceleration };
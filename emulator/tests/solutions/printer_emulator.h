@@ -25,7 +25,7 @@ public:
     MemoryManager m_memory;
     HFILEMANAGER m_file_manager;
     GCodeAxisConfig axis = { 1,1,1,1 };
-    HMOTOR m_motors[MOTOR_COUNT];
+    HSTEPPERGROUP m_steppers;
     HTERMALREGULATOR m_regulators[TERMO_REGULATOR_COUNT];
     FIL m_f;
     HGCODE m_gc;
@@ -47,7 +47,8 @@ public:
 
     void SetupAxisRestrictions(const GCodeAxisConfig& axis_settings);
 
-    void SetupPrinter(GCodeAxisConfig axis_config, PRINTER_ACCELERATION enable_acceleration);
+    void SetupPrinter(GCodeAxisConfig axis_config, PRINTER_ACCELERATION enable_acceleration,
+        ACCELERATION_PROFILE profile = ACCELERATION_PROFILE_TRAPEZOID);
 
     void ConfigurePrinter(GCodeAxisConfig axis_config, PRINTER_ACCELERATION enable_acceleration);
 
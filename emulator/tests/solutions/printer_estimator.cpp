@@ -0,0 +1,187 @@
+#include "printer_estimator.h"
+#include "printer_constants.h"
+#include "include/gcode.h"
+#include "solutions/printer_emulator.h"
+
+#include <gtest/gtest.h>
+#include <array>
+#include <fstream>
+
+class PrinterEstimatorTest : public ::testing::Test
+{
+protected:
+    typedef std::array<uint8_t, GCODE_CHUNK_SIZE> Command;
+
+    virtual void SetUp()
+    {
+        control_block = {};
+        EstimatorReset(&estimator, &axis_configuration, ACCELERATION_PROFILE_TRAPEZOID, &control_block);
+    }
+
+    Command Move(parameterType x, uint32_t segment_time, uint16_t entry_speed = 0, uint16_t exit_speed = 0)
+    {
+        Command command = { 0 };
+        *(parameterType*)command.data() = GCODE_COMMAND | GCODE_MOVE;
+        ExtendedGCodeCommandParams params = { { x, 0, 0, 0, 1800 }, segment_time, entry_speed, exit_speed };
+        *(ExtendedGCodeCommandParams*)(command.data() + sizeof(parameterType)) = params;
+        return command;
+    }
+
+    void Add(uint32_t count, uint32_t segment_time)
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            EstimatorAddCommand(&estimator, &control_block, Move(i, segment_time).data());
+        }
+        control_block.commands_count = estimator.commands;
+    }
+
+    PrintTimeEstimator estimator;
+    PrinterControlBlock control_block;
+};
+
+TEST_F(PrinterEstimatorTest, unplanned_move_takes_segment_time)
+{
+    ExtendedGCodeCommandParams params = { { 100, 0, 0, 0, 1800 }, 5000, 0, 0 };
+    ASSERT_EQ(5000U, EstimateMotionTime(&params, 5000, ACCELERATION_PROFILE_TRAPEZOID));
+}
+
+TEST_F(PrinterEstimatorTest, acceleration_slows_down_move)
+{
+    ExtendedGCodeCommandParams params = { { 100, 0, 0, 0, 1800 }, 5000, MINIMAL_VELOCITY, MINIMAL_VELOCITY };
+    uint32_t stopped = EstimateMotionTime(&params, 5000, ACCELERATION_PROFILE_TRAPEZOID);
+    ASSERT_GT(stopped, 5000U);
+
+    // the move entered and left with the fetch speed isn't slowed down
+    params.entry_speed = params.exit_speed = 1800;
+    ASSERT_EQ(5000U, EstimateMotionTime(&params, 5000, ACCELERATION_PROFILE_TRAPEZOID));
+
+    // the move entered with the fetch speed brakes only
+    params.exit_speed = MINIMAL_VELOCITY;
+    uint32_t braked = EstimateMotionTime(&params, 5000, ACCELERATION_PROFILE_TRAPEZOID);
+    ASSERT_GT(braked, 5000U);
+    ASSERT_LT(braked, stopped);
+}
+
+TEST_F(PrinterEstimatorTest, scurve_slows_down_move_more)
+{
+    // S-curve ramps take twice the region changes to keep the peak acceleration
+    ExtendedGCodeCommandParams params = { { 100, 0, 0, 0, 1800 }, 5000, MINIMAL_VELOCITY, MINIMAL_VELOCITY };
+    uint32_t trapezoid = EstimateMotionTime(&params, 5000, ACCELERATION_PROFILE_TRAPEZOID);
+    ASSERT_GT(EstimateMotionTime(&params, 5000, ACCELERATION_PROFILE_SCURVE), trapezoid);
+
+    params.entry_speed = params.exit_speed = 1800;
+    ASSERT_EQ(5000U, EstimateMotionTime(&params, 5000, ACCELERATION_PROFILE_SCURVE));
+}
+
+TEST_F(PrinterEstimatorTest, time_is_summed)
+{
+    Add(10, 100);
+    ASSERT_EQ(1000U, control_block.print_time);
+    ASSERT_EQ(1U, control_block.checkpoint_commands);
+    ASSERT_EQ(100U, control_block.checkpoints[0]);
+    ASSERT_EQ(1000U, control_block.checkpoints[9]);
+}
+
+TEST_F(PrinterEstimatorTest, checkpoints_interval_is_doubled)
+{
+    Add(1000, 10);
+    ASSERT_EQ(10000U, control_block.print_time);
+    ASSERT_EQ(16U, control_block.checkpoint_commands);
+    for (uint32_t i = 0; i < 1000 / 16; ++i)
+    {
+        ASSERT_EQ((i + 1) * 16 * 10, control_block.checkpoints[i]);
+    }
+}
+
+TEST_F(PrinterEstimatorTest, remaining_time_is_interpolated)
+{
+    Add(1000, 10);
+    ASSERT_EQ(10000U, EstimatorGetRemainingTime(&control_block, 0));
+    ASSERT_EQ(5000U, EstimatorGetRemainingTime(&control_block, 500));
+    ASSERT_EQ(9990U, EstimatorGetRemainingTime(&control_block, 1));
+    // the last commands are after the last checkpoint
+    ASSERT_EQ(10U, EstimatorGetRemainingTime(&control_block, 999));
+    ASSERT_EQ(0U, EstimatorGetRemainingTime(&control_block, 1000));
+}
+
+TEST_F(PrinterEstimatorTest, no_remaining_time_without_estimation)
+{
+    Add(10, 100);
+    control_block.checkpoint_commands = 0;
+    ASSERT_EQ(0U, EstimatorGetRemainingTime(&control_block, 5));
+}
+
+class PrinterEstimatorEmulationTest : public ::testing::TestWithParam<ACCELERATION_PROFILE>, public PrinterEmulator
+{
+public:
+    PrinterEstimatorEmulationTest() : PrinterEmulator(MAIN_TIMER_FREQUENCY) {}
+
+protected:
+    // heating commands wait for the temperature and aren't estimated
+    std::vector<std::string> loadMotion(const char* name)
+    {
+        std::ifstream file(name);
+        std::vector<std::string> lines;
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (!line.empty() && '\r' == line.back())
+            {
+                line.pop_back();
+            }
+            if (0 == line.rfind("M1", 0) || 0 == line.rfind("M2", 0))
+            {
+                continue;
+            }
+            lines.push_back(line);
+        }
+        return lines;
+    }
+};
+
+TEST_P(PrinterEstimatorEmulationTest, estimate_matches_emulated_print)
+{
+    axis = axis_configuration;
+    SetupPrinter(axis_configuration, PRINTER_ACCELERATION_ENABLE, GetParam());
+    std::vector<std::string> lines = loadMotion("wanhao.gcode");
+    ASSERT_FALSE(lines.empty()) << "required file wanhao.gcode not found";
+    StartPrinting(lines, nullptr);
+
+    PrinterControlBlock control_block;
+    ASSERT_EQ(PRINTER_OK, PrinterReadControlBlock(printer_driver, &control_block));
+    ASSERT_NE(0U, control_block.checkpoint_commands);
+
+    uint64_t ticks = 0;
+    uint32_t half_way_ticks = 0;
+    uint32_t count = PrinterGetRemainingCommandsCount(printer_driver);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (count / 2 == i)
+        {
+            half_way_ticks = (uint32_t)ticks;
+        }
+
+        PRINTER_STATUS status = PRINTER_OK;
+        do
+        {
+            PrinterLoadData(printer_driver);
+            status = PrinterNextCommand(printer_driver);
+        } while (PRINTER_PRELOAD_REQUIRED == status);
+
+        while (PRINTER_OK != status)
+        {
+            ++ticks;
+            status = PrinterExecuteCommand(printer_driver);
+        }
+    }
+
+    std::cout << "emulated " << ticks << " ticks, estimated " << control_block.print_time << " ticks" << std::endl;
+    ASSERT_NEAR((double)ticks, (double)control_block.print_time, ticks * 0.001);
+
+    uint32_t remaining = EstimatorGetRemainingTime(&control_block, count / 2);
+    ASSERT_NEAR((double)(ticks - half_way_ticks), (double)remaining, ticks * 0.001);
+}
+
+INSTANTIATE_TEST_SUITE_P(PrinterEstimatorProfiles, PrinterEstimatorEmulationTest,
+    ::testing::Values(ACCELERATION_PROFILE_TRAPEZOID, ACCELERATION_PROFILE_SCURVE));
@@ -6,8 +6,11 @@
 #include "sdcard.h"
 #include "sdcard_mock.h"
 #include "ff.h"
+#include "image_compiler.h"
 
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
 
 TEST(GCodeFileConverterBasicTest, cannot_create_without_ram)
 {
@@ -126,6 +129,76 @@ protected:
         f_close(&f);
     }
 
+    std::vector<char> readResource(const std::string& name)
+    {
+        FILE* file = nullptr;
+        fopen_s(&file, name.c_str(), "rb");
+        if (!file)
+        {
+            return {};
+        }
+
+        std::vector<char> content;
+        char symbol;
+        while (1 == fread_s(&symbol, 1, 1, 1, file))
+        {
+            content.push_back(symbol);
+        }
+        fclose(file);
+        return content;
+    }
+
+    // translates the file by the printer and by the host compiler, both images should be identical
+    void compareHostImage(GCODE_STORAGE_FORMAT format, float coalescing_tolerance = 0, float simplification_tolerance = 0,
+        bool overlap_heating = false)
+    {
+        // control block stores the whole name buffer
+        char name[FILE_NAME_LEN] = "wanhao.gcode";
+        std::vector<char> content = readResource(name);
+        ASSERT_FALSE(content.empty()) << "required file " << name << " not found";
+        createFile(name, content.data(), content.size());
+
+        FileManagerSetStorageFormat(m_file_manager, format);
+        FileManagerSetCoalescing(m_file_manager, coalescing_tolerance);
+        FileManagerSetSimplification(m_file_manager, simplification_tolerance);
+        FileManagerSetHeatingOverlap(m_file_manager, overlap_heating);
+        uint32_t blocks = FileManagerOpenGCode(m_file_manager, name);
+        for (uint32_t i = 0; i < blocks; ++i)
+        {
+            ASSERT_EQ(PRINTER_OK, FileManagerReadGCodeBlock(m_file_manager)) << i << "th iteration failed";
+            // file manager returns to the main loop while the page is written
+            m_pending_writes += (SDCARD_BUSY == SDCARD_GetStatus(m_ram.get())) ? 1 : 0;
+        }
+        ASSERT_EQ(PRINTER_OK, FileManagerCloseGCode(m_file_manager));
+        ASSERT_EQ(SDCARD_OK, SDCARD_GetStatus(m_ram.get()));
+
+        // host compiler replaces the file system, so it is called after the printer translation
+        ImageCompiler compiler(axis_configuration, 0);
+        compiler.SetCoalescing(coalescing_tolerance);
+        compiler.SetSimplification(simplification_tolerance);
+        compiler.SetHeatingOverlap(overlap_heating);
+        ASSERT_EQ(PRINTER_OK, compiler.Compile(name, content, format)) << compiler.GetError();
+        const std::vector<uint8_t>& image = compiler.GetImage();
+        const PrinterControlBlock& control_block = compiler.GetControlBlock();
+        ASSERT_EQ((uint32_t)format, control_block.storage_format);
+        if (coalescing_tolerance > 0 || simplification_tolerance > 0)
+        {
+            ASSERT_LT(control_block.commands_count, control_block.source_commands_count);
+            std::cout << "reduced to " << control_block.commands_count << " of " << control_block.source_commands_count << " commands" << std::endl;
+            ASSERT_EQ(FileManagerGetMaxDeviation(m_file_manager), compiler.GetMaxDeviation());
+            ASSERT_LE(compiler.GetMaxDeviation(), simplification_tolerance);
+        }
+        else
+        {
+            ASSERT_EQ(control_block.commands_count, control_block.source_commands_count);
+        }
+        ASSERT_EQ(0U, image.size() % SDCARD_BLOCK_SIZE);
+        ASSERT_LT(SDCARD_BLOCK_SIZE + control_block.commands_count * (GCODE_FORMAT_CHUNKS == format ? GCODE_CHUNK_SIZE : 2U), image.size());
+
+        const uint8_t* transferred = (const uint8_t*)m_ram->GetMemoryPtr() + CONTROL_BLOCK_POSITION * SDCARD_BLOCK_SIZE;
+        ASSERT_TRUE(std::equal(image.begin(), image.end(), transferred));
+    }
+
     HFILEMANAGER m_file_manager;
     MemoryManager m_memory_manager;
     std::unique_ptr<FIL> m_f;
@@ -136,7 +209,8 @@ protected:
         
     FATFS m_fatfs;
     HGCODE m_gc;
-    const size_t s_blocks_count = 1024;
+    size_t m_pending_writes = 0;
+    const size_t s_blocks_count = 4096;
 };
 
 TEST_F(GCodeFileConverterTest, open_non_existing_file)
@@ -217,6 +291,25 @@ TEST_F(GCodeFileConverterTest, read_valid_long_line)
     createFile("file.gcode", command.c_str(), command.size());
     FileManagerOpenGCode(m_file_manager, "file.gcode");
     FileManagerReadGCodeBlock(m_file_manager);
+    // the comment is truncated, the command is kept
+    ASSERT_EQ(PRINTER_OK, FileManagerReadGCodeBlock(m_file_manager));
+    ASSERT_EQ(PRINTER_OK, FileManagerCloseGCode(m_file_manager));
+
+    uint8_t data[512];
+    m_ram->ReadSingleBlock(data, CONTROL_BLOCK_POSITION);
+    ASSERT_EQ(1, ((PrinterControlBlock*)data)->commands_count);
+}
+
+TEST_F(GCodeFileConverterTest, read_long_command_line)
+{
+    std::string command = "G0 X0 Y";
+    for (uint32_t i = 0; i < SDCARD_BLOCK_SIZE; ++i)
+    {
+        command += "1";
+    }
+    createFile("file.gcode", command.c_str(), command.size());
+    FileManagerOpenGCode(m_file_manager, "file.gcode");
+    FileManagerReadGCodeBlock(m_file_manager);
     ASSERT_EQ(PRINTER_FILE_NOT_GCODE, FileManagerReadGCodeBlock(m_file_manager));
 }
 
@@ -515,6 +608,273 @@ TEST_F(GCodeFileConverterTest, read_and_transfer_from_file)
     ASSERT_EQ(PRINTER_OK, FileManagerCloseGCode(m_file_manager));
 }
 
+TEST_F(GCodeFileConverterTest, transfer_throughput)
+{
+    for (const char* name : { "wanhao.gcode", "model.gcode" })
+    {
+        std::vector<char> content = readResource(name);
+        ASSERT_FALSE(content.empty()) << "required file " << name << " not found";
+        createFile(name, content.data(), content.size());
+
+        auto start = std::chrono::high_resolution_clock::now();
+        uint32_t blocks = FileManagerOpenGCode(m_file_manager, name);
+        for (uint32_t i = 0; i < blocks; ++i)
+        {
+            ASSERT_EQ(PRINTER_OK, FileManagerReadGCodeBlock(m_file_manager)) << i << "th iteration failed";
+        }
+        ASSERT_EQ(PRINTER_OK, FileManagerCloseGCode(m_file_manager));
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count();
+
+        uint8_t data[512];
+        m_ram->ReadSingleBlock(data, CONTROL_BLOCK_POSITION);
+        PrinterControlBlock control_block = *(PrinterControlBlock*)data;
+
+        std::cout << name << " transferred successfully. " << std::endl
+            << "    File size: " << content.size() << " bytes in " << blocks << " blocks" << std::endl
+            << "    Commands: " << control_block.commands_count << std::endl
+            << "    Transfer time: " << elapsed << " us" << std::endl
+            << "    Throughput: " << (elapsed ? content.size() * 1000000ull / 1024 / elapsed : 0) << " KB/s" << std::endl;
+    }
+}
+
+TEST_F(GCodeFileConverterTest, compact_format_control_block)
+{
+    std::string command = "G0 F1800 X0 Y0\nG1 X10 Y10\n";
+    createFile("file.gcode", command.c_str(), command.size());
+    FileManagerSetStorageFormat(m_file_manager, GCODE_FORMAT_COMPACT);
+    uint32_t blocks = FileManagerOpenGCode(m_file_manager, "file.gcode");
+    for (uint32_t i = 0; i < blocks; ++i)
+    {
+        ASSERT_EQ(PRINTER_OK, FileManagerReadGCodeBlock(m_file_manager));
+    }
+    ASSERT_EQ(PRINTER_OK, FileManagerCloseGCode(m_file_manager));
+
+    uint8_t data[512];
+    m_ram->ReadSingleBlock(data, CONTROL_BLOCK_POSITION);
+    PrinterControlBlock control_block = *(PrinterControlBlock*)data;
+    ASSERT_EQ((uint32_t)GCODE_FORMAT_COMPACT, control_block.storage_format);
+    ASSERT_EQ(2U, control_block.commands_count);
+
+    m_ram->ReadSingleBlock(data, control_block.file_sector);
+    ASSERT_EQ(2U, data[0]);
+}
+
+TEST_F(GCodeFileConverterTest, compact_format_matches_chunks)
+{
+    const char* name = "wanhao.gcode";
+    std::vector<char> content = readResource(name);
+    ASSERT_FALSE(content.empty()) << "required file " << name << " not found";
+    createFile(name, content.data(), content.size());
+
+    std::vector<uint8_t> reference;
+    std::vector<uint8_t> compact;
+    uint32_t sectors[2] = {};
+    for (GCODE_STORAGE_FORMAT format : { GCODE_FORMAT_CHUNKS, GCODE_FORMAT_COMPACT })
+    {
+        FileManagerSetStorageFormat(m_file_manager, format);
+        uint32_t blocks = FileManagerOpenGCode(m_file_manager, name);
+        for (uint32_t i = 0; i < blocks; ++i)
+        {
+            ASSERT_EQ(PRINTER_OK, FileManagerReadGCodeBlock(m_file_manager)) << i << "th iteration failed";
+        }
+        ASSERT_EQ(PRINTER_OK, FileManagerCloseGCode(m_file_manager));
+
+        uint8_t data[512];
+        m_ram->ReadSingleBlock(data, CONTROL_BLOCK_POSITION);
+        PrinterControlBlock control_block = *(PrinterControlBlock*)data;
+        ASSERT_EQ((uint32_t)format, control_block.storage_format);
+
+        std::vector<uint8_t>& commands = (GCODE_FORMAT_CHUNKS == format) ? reference : compact;
+        commands.resize(control_block.commands_count * GCODE_CHUNK_SIZE);
+        uint32_t sector = control_block.file_sector;
+        uint32_t command = 0;
+        while (command < control_block.commands_count)
+        {
+            m_ram->ReadSingleBlock(data, sector++);
+            if (GCODE_FORMAT_CHUNKS == format)
+            {
+                for (uint32_t caret = 0; caret < SDCARD_BLOCK_SIZE && command < control_block.commands_count; caret += GCODE_CHUNK_SIZE)
+                {
+                    memcpy(&commands[GCODE_CHUNK_SIZE * command++], data + caret, GCODE_CHUNK_SIZE);
+                }
+                continue;
+            }
+            GCodeCompactState state;
+            GC_ResetCompact(&state);
+            uint32_t caret = GCODE_COMPACT_SECTOR_HEADER;
+            for (uint8_t i = 0; i < data[0]; ++i)
+            {
+                ASSERT_LT(caret, SDCARD_BLOCK_SIZE);
+                caret += GC_DecodeCompact(&state, data + caret, &commands[GCODE_CHUNK_SIZE * command++]);
+            }
+        }
+        sectors[format] = sector - control_block.file_sector;
+    }
+
+    ASSERT_EQ(reference.size(), compact.size());
+    for (size_t i = 0; i < reference.size(); i += GCODE_CHUNK_SIZE)
+    {
+        uint32_t code = *(uint32_t*)&reference[i];
+        // subcommands do not use the tail of the chunk
+        size_t size = (code & GCODE_SUBCOMMAND) ? 5 * sizeof(parameterType) : GCODE_CHUNK_SIZE;
+        ASSERT_TRUE(std::equal(&reference[i], &reference[i] + size, &compact[i])) << "command index " << i / GCODE_CHUNK_SIZE;
+    }
+
+    std::cout << name << " storage size:" << std::endl
+        << "    Commands: " << reference.size() / GCODE_CHUNK_SIZE << std::endl
+        << "    Chunks: " << sectors[GCODE_FORMAT_CHUNKS] << " sectors" << std::endl
+        << "    Compact: " << sectors[GCODE_FORMAT_COMPACT] << " sectors, "
+        << reference.size() / GCODE_CHUNK_SIZE / sectors[GCODE_FORMAT_COMPACT] << " commands per sector" << std::endl;
+}
+
+TEST_F(GCodeFileConverterTest, host_image_matches_transfer)
+{
+    ASSERT_NO_FATAL_FAILURE(compareHostImage(GCODE_FORMAT_CHUNKS));
+}
+
+TEST_F(GCodeFileConverterTest, host_image_matches_compact_transfer)
+{
+    ASSERT_NO_FATAL_FAILURE(compareHostImage(GCODE_FORMAT_COMPACT));
+}
+
+TEST_F(GCodeFileConverterTest, slow_ram_transfer)
+{
+    // pages are written in background, while the next blocks of the file are read and parsed
+    m_ram->SetLatency(20);
+    compareHostImage(GCODE_FORMAT_COMPACT);
+    ASSERT_LT(0u, m_pending_writes);
+}
+
+TEST_F(GCodeFileConverterTest, coalesced_moves)
+{
+    std::string command = "G0 F1800 X0 Y0\nG1 X10 Y0 E1\nG1 X20 Y0 E2\nG1 X30 Y0 E3\nG1 X30 Y10 E4\nG1 X30 Y20\n";
+    createFile("file.gcode", command.c_str(), command.size());
+    FileManagerSetCoalescing(m_file_manager, 0.01f);
+    uint32_t blocks = FileManagerOpenGCode(m_file_manager, "file.gcode");
+    for (uint32_t i = 0; i < blocks; ++i)
+    {
+        ASSERT_EQ(PRINTER_OK, FileManagerReadGCodeBlock(m_file_manager));
+    }
+    ASSERT_EQ(PRINTER_OK, FileManagerCloseGCode(m_file_manager));
+
+    uint8_t data[512];
+    m_ram->ReadSingleBlock(data, CONTROL_BLOCK_POSITION);
+    PrinterControlBlock control_block = *(PrinterControlBlock*)data;
+    ASSERT_EQ(6U, control_block.source_commands_count);
+    ASSERT_EQ(4U, control_block.commands_count);
+
+    // the merged move goes from the start of the first move to the end of the last one
+    m_ram->ReadSingleBlock(data, control_block.file_sector);
+    const ExtendedGCodeCommandParams* merged = (const ExtendedGCodeCommandParams*)(data + GCODE_CHUNK_SIZE + sizeof(parameterType));
+    ASSERT_EQ(30 * (parameterType)axis_configuration.x_steps_per_mm, merged->g.x);
+    ASSERT_EQ(3 * (parameterType)axis_configuration.e_steps_per_mm, merged->g.e);
+    ASSERT_EQ(10000U, merged->segment_time);
+
+    // the last move is stored at the end of the file
+    const ExtendedGCodeCommandParams* last = (const ExtendedGCodeCommandParams*)(data + 3 * GCODE_CHUNK_SIZE + sizeof(parameterType));
+    ASSERT_EQ(20 * (parameterType)axis_configuration.y_steps_per_mm, last->g.y);
+}
+
+TEST_F(GCodeFileConverterTest, host_image_matches_coalesced_transfer)
+{
+    ASSERT_NO_FATAL_FAILURE(compareHostImage(GCODE_FORMAT_CHUNKS, 0.02f));
+}
+
+TEST_F(GCodeFileConverterTest, host_image_matches_coalesced_compact_transfer)
+{
+    ASSERT_NO_FATAL_FAILURE(compareHostImage(GCODE_FORMAT_COMPACT, 0.02f));
+}
+
+TEST_F(GCodeFileConverterTest, host_image_matches_simplified_transfer)
+{
+    ASSERT_NO_FATAL_FAILURE(compareHostImage(GCODE_FORMAT_CHUNKS, 0.02f, 4));
+}
+
+TEST_F(GCodeFileConverterTest, host_image_matches_simplified_compact_transfer)
+{
+    ASSERT_NO_FATAL_FAILURE(compareHostImage(GCODE_FORMAT_COMPACT, 0, 4));
+}
+
+TEST_F(GCodeFileConverterTest, overlapped_heating)
+{
+    std::string command = "M140 S60\nM190 S60\nM104 S200\nM109 S200\nG28 X0 Y0\nG1 F1800 Z5\nG92 E0\nG1 X10 E5\nM109 S210\n";
+    createFile("file.gcode", command.c_str(), command.size());
+    FileManagerSetHeatingOverlap(m_file_manager, true);
+    uint32_t blocks = FileManagerOpenGCode(m_file_manager, "file.gcode");
+    for (uint32_t i = 0; i < blocks; ++i)
+    {
+        ASSERT_EQ(PRINTER_OK, FileManagerReadGCodeBlock(m_file_manager));
+    }
+    ASSERT_EQ(PRINTER_OK, FileManagerCloseGCode(m_file_manager));
+
+    uint8_t data[512];
+    m_ram->ReadSingleBlock(data, CONTROL_BLOCK_POSITION);
+    PrinterControlBlock control_block = *(PrinterControlBlock*)data;
+    ASSERT_EQ(9U, control_block.source_commands_count);
+    ASSERT_EQ(9U, control_block.commands_count);
+
+    // both heaters are set before homing, waits are moved right before the first extruding move
+    const uint32_t expected[] = {
+        GCODE_SUBCOMMAND | GCODE_SET_TABLE_TEMPERATURE,
+        GCODE_SUBCOMMAND | GCODE_SET_NOZZLE_TEMPERATURE,
+        GCODE_COMMAND | GCODE_HOME,
+        GCODE_COMMAND | GCODE_MOVE,
+        GCODE_COMMAND | GCODE_SET,
+        GCODE_SUBCOMMAND | GCODE_WAIT_TABLE,
+        GCODE_SUBCOMMAND | GCODE_WAIT_NOZZLE,
+        GCODE_COMMAND | GCODE_MOVE,
+        GCODE_SUBCOMMAND | GCODE_WAIT_NOZZLE,
+    };
+    m_ram->ReadSingleBlock(data, control_block.file_sector);
+    for (uint32_t i = 0; i < control_block.commands_count; ++i)
+    {
+        ASSERT_EQ(expected[i], *(const uint32_t*)(data + i * GCODE_CHUNK_SIZE)) << i << "th command";
+    }
+    ASSERT_EQ(60, ((const GCodeSubCommandParams*)(data + 5 * GCODE_CHUNK_SIZE + sizeof(parameterType)))->s);
+    ASSERT_EQ(210, ((const GCodeSubCommandParams*)(data + 8 * GCODE_CHUNK_SIZE + sizeof(parameterType)))->s);
+}
+
+TEST_F(GCodeFileConverterTest, host_image_matches_overlapped_heating_transfer)
+{
+    ASSERT_NO_FATAL_FAILURE(compareHostImage(GCODE_FORMAT_COMPACT, 0, 0, true));
+}
+
+TEST_F(GCodeFileConverterTest, preheat_temperatures)
+{
+    // the first block has no heating commands, the second one switches the nozzle off and heats both heaters
+    std::string command = "G28 X0 Y0\n";
+    while (command.size() < SDCARD_BLOCK_SIZE)
+    {
+        command += "G1 F1800 X10 Y10\n";
+    }
+    command += "M104 S0\nM190 S60\nM109 S210\nM104 S220\nM140 S70\n";
+    createFile("file.gcode", command.c_str(), command.size());
+    ASSERT_EQ(2U, FileManagerOpenGCode(m_file_manager, "file.gcode"));
+    ASSERT_EQ(0, FileManagerGetPreheatTemperature(m_file_manager, TERMO_NOZZLE));
+
+    ASSERT_EQ(PRINTER_OK, FileManagerReadGCodeBlock(m_file_manager));
+    ASSERT_EQ(0, FileManagerGetPreheatTemperature(m_file_manager, TERMO_NOZZLE));
+    ASSERT_EQ(0, FileManagerGetPreheatTemperature(m_file_manager, TERMO_TABLE));
+
+    ASSERT_EQ(PRINTER_OK, FileManagerReadGCodeBlock(m_file_manager));
+    ASSERT_EQ(210, FileManagerGetPreheatTemperature(m_file_manager, TERMO_NOZZLE));
+    ASSERT_EQ(60, FileManagerGetPreheatTemperature(m_file_manager, TERMO_TABLE));
+    ASSERT_EQ(PRINTER_OK, FileManagerCloseGCode(m_file_manager));
+
+    // the next file starts without temperatures
+    FileManagerOpenGCode(m_file_manager, "file.gcode");
+    ASSERT_EQ(0, FileManagerGetPreheatTemperature(m_file_manager, TERMO_TABLE));
+}
+
+TEST_F(GCodeFileConverterTest, host_image_invalid_gcode)
+{
+    std::string command = "G0 X0 Y0\nThis is not a GCODE file\n";
+    ImageCompiler compiler(axis_configuration, 0);
+    ASSERT_EQ(PRINTER_FILE_NOT_GCODE, compiler.Compile("file.gcode", std::vector<char>(command.begin(), command.end()), GCODE_FORMAT_CHUNKS));
+    ASSERT_TRUE(compiler.GetImage().empty());
+    ASSERT_FALSE(compiler.GetError().empty());
+}
+
 class MTLFileConverterTest : public GCodeFileConverterTest
 {
 protected:
@@ -0,0 +1,247 @@
+#include "printer_heating.h"
+#include "printer_constants.h"
+#include "solutions/printer_emulator.h"
+
+#include <gtest/gtest.h>
+#include <array>
+#include <fstream>
+
+class PrinterHeatingTest : public ::testing::Test
+{
+protected:
+    typedef std::array<uint8_t, GCODE_CHUNK_SIZE> Command;
+
+    virtual void SetUp()
+    {
+        HeatingReset(&scheduler, true);
+    }
+
+    Command Move(parameterType x, parameterType e, uint8_t type = GCODE_MOVE)
+    {
+        Command command = { 0 };
+        *(parameterType*)command.data() = GCODE_COMMAND | type;
+        *(GCodeCommandParams*)(command.data() + sizeof(parameterType)) = { x, 0, 0, e, 1800 };
+        return command;
+    }
+
+    Command SubCommand(uint8_t type, parameterType s)
+    {
+        Command command = { 0 };
+        *(parameterType*)command.data() = GCODE_SUBCOMMAND | type;
+        *(GCodeSubCommandParams*)(command.data() + sizeof(parameterType)) = { 0, s, 0, 0 };
+        return command;
+    }
+
+    HeatingScheduler scheduler;
+};
+
+TEST_F(PrinterHeatingTest, waits_are_deferred_till_extrusion)
+{
+    ASSERT_EQ(HEATING_PASS, HeatingAppend(&scheduler, SubCommand(GCODE_SET_TABLE_TEMPERATURE, 60).data()));
+    ASSERT_EQ(HEATING_DEFERRED, HeatingAppend(&scheduler, SubCommand(GCODE_WAIT_TABLE, 60).data()));
+    ASSERT_EQ(HEATING_PASS, HeatingAppend(&scheduler, SubCommand(GCODE_SET_NOZZLE_TEMPERATURE, 210).data()));
+    ASSERT_EQ(HEATING_DEFERRED, HeatingAppend(&scheduler, SubCommand(GCODE_WAIT_NOZZLE, 210).data()));
+
+    // homing, travel and retraction overlap heating
+    ASSERT_EQ(HEATING_PASS, HeatingAppend(&scheduler, Move(0, 0, GCODE_HOME).data()));
+    ASSERT_EQ(HEATING_PASS, HeatingAppend(&scheduler, Move(100, 0).data()));
+    ASSERT_EQ(HEATING_PASS, HeatingAppend(&scheduler, Move(100, -10).data()));
+    ASSERT_EQ(HEATING_PASS, HeatingAppend(&scheduler, SubCommand(GCODE_SET_COOLER_SPEED, 255).data()));
+
+    Command extrusion = Move(200, 10);
+    ASSERT_EQ(HEATING_BREAK, HeatingAppend(&scheduler, extrusion.data()));
+    ASSERT_EQ(2, HeatingFlush(&scheduler));
+    ASSERT_EQ(GCODE_WAIT_TABLE, scheduler.waits[0][0]);
+    ASSERT_EQ(GCODE_WAIT_NOZZLE, scheduler.waits[1][0]);
+    ASSERT_EQ(HEATING_PASS, HeatingAppend(&scheduler, extrusion.data()));
+
+    // waits of the print are kept in place
+    ASSERT_EQ(HEATING_PASS, HeatingAppend(&scheduler, SubCommand(GCODE_WAIT_NOZZLE, 220).data()));
+    ASSERT_EQ(0, HeatingFlush(&scheduler));
+}
+
+TEST_F(PrinterHeatingTest, wait_without_target_sets_temperature)
+{
+    Command wait = SubCommand(GCODE_WAIT_NOZZLE, 210);
+    ASSERT_EQ(HEATING_PASS, HeatingAppend(&scheduler, wait.data()));
+    ASSERT_EQ(GCODE_SET_NOZZLE_TEMPERATURE, wait[0]);
+    ASSERT_EQ(210, ((const GCodeSubCommandParams*)(wait.data() + sizeof(parameterType)))->s);
+
+    ASSERT_EQ(HEATING_BREAK, HeatingAppend(&scheduler, Move(0, 1).data()));
+    ASSERT_EQ(1, HeatingFlush(&scheduler));
+    ASSERT_EQ(GCODE_WAIT_NOZZLE, scheduler.waits[0][0]);
+}
+
+TEST_F(PrinterHeatingTest, heater_change_releases_waits)
+{
+    ASSERT_EQ(HEATING_PASS, HeatingAppend(&scheduler, SubCommand(GCODE_WAIT_NOZZLE, 170).data()));
+    ASSERT_EQ(HEATING_PASS, HeatingAppend(&scheduler, SubCommand(GCODE_WAIT_TABLE, 60).data()));
+    ASSERT_EQ(HEATING_PASS, HeatingAppend(&scheduler, Move(0, 0, GCODE_HOME).data()));
+
+    // the nozzle is heated to 170 before the target is changed
+    Command set = SubCommand(GCODE_SET_NOZZLE_TEMPERATURE, 215);
+    ASSERT_EQ(HEATING_BREAK, HeatingAppend(&scheduler, set.data()));
+    ASSERT_EQ(2, HeatingFlush(&scheduler));
+    ASSERT_EQ(HEATING_PASS, HeatingAppend(&scheduler, set.data()));
+    ASSERT_EQ(HEATING_DEFERRED, HeatingAppend(&scheduler, SubCommand(GCODE_WAIT_NOZZLE, 215).data()));
+    ASSERT_EQ(HEATING_BREAK, HeatingAppend(&scheduler, Move(0, 1).data()));
+    ASSERT_EQ(1, HeatingFlush(&scheduler));
+}
+
+TEST_F(PrinterHeatingTest, zero_temperature_is_not_deferred)
+{
+    ASSERT_EQ(HEATING_PASS, HeatingAppend(&scheduler, SubCommand(GCODE_WAIT_TABLE, 0).data()));
+    ASSERT_EQ(HEATING_PASS, HeatingAppend(&scheduler, Move(0, 1).data()));
+    ASSERT_EQ(0, HeatingFlush(&scheduler));
+}
+
+TEST_F(PrinterHeatingTest, extrusion_is_counted_from_set_position)
+{
+    ASSERT_EQ(HEATING_PASS, HeatingAppend(&scheduler, SubCommand(GCODE_WAIT_NOZZLE, 210).data()));
+    ASSERT_EQ(HEATING_PASS, HeatingAppend(&scheduler, Move(0, 100, GCODE_SET).data()));
+    ASSERT_EQ(HEATING_PASS, HeatingAppend(&scheduler, Move(10, 100).data()));
+    ASSERT_EQ(HEATING_BREAK, HeatingAppend(&scheduler, Move(10, 101).data()));
+}
+
+TEST_F(PrinterHeatingTest, resume_releases_waits)
+{
+    ASSERT_EQ(HEATING_PASS, HeatingAppend(&scheduler, SubCommand(GCODE_WAIT_NOZZLE, 210).data()));
+    ASSERT_EQ(HEATING_BREAK, HeatingAppend(&scheduler, SubCommand(GCODE_START_RESUME, 0).data()));
+    ASSERT_EQ(1, HeatingFlush(&scheduler));
+    ASSERT_EQ(HEATING_PASS, HeatingAppend(&scheduler, SubCommand(GCODE_WAIT_TABLE, 60).data()));
+}
+
+TEST_F(PrinterHeatingTest, disabled_scheduler_passes_commands)
+{
+    HeatingReset(&scheduler, false);
+    Command wait = SubCommand(GCODE_WAIT_NOZZLE, 210);
+    ASSERT_EQ(HEATING_PASS, HeatingAppend(&scheduler, wait.data()));
+    ASSERT_EQ(GCODE_WAIT_NOZZLE, wait[0]);
+    ASSERT_EQ(HEATING_PASS, HeatingAppend(&scheduler, Move(0, 1).data()));
+    ASSERT_EQ(0, HeatingFlush(&scheduler));
+}
+
+class PrinterHeatingEmulationTest : public ::testing::Test, public PrinterEmulator
+{
+public:
+    PrinterHeatingEmulationTest() : PrinterEmulator(MAIN_TIMER_FREQUENCY) {}
+
+protected:
+    // preamble of the file till the first layer
+    std::vector<std::string> loadPreamble(const char* name)
+    {
+        std::ifstream file(name);
+        std::vector<std::string> lines;
+        std::string line;
+        while (std::getline(file, line) && 0 != line.rfind(";LAYER:0", 0))
+        {
+            lines.push_back(line);
+        }
+        return lines;
+    }
+
+    // heaters heat by 5 and 1 degree per second and cool by 1% of the difference with the room temperature
+    void handleEnvironmentTick()
+    {
+        const float room = 20;
+        const float rates[TERMO_REGULATOR_COUNT] = { 0.5f, 0.1f };
+        const GPIO_TypeDef* ports[TERMO_REGULATOR_COUNT] = { &port_nozzle, &port_table };
+        const GPIO_PinState heat[TERMO_REGULATOR_COUNT] = { GPIO_PIN_SET, GPIO_PIN_RESET };
+        for (uint32_t i = 0; i < TERMO_REGULATOR_COUNT; ++i)
+        {
+            temperature[i] += (heat[i] == device->GetPinState(*ports[i], 0).state) ? rates[i] : 0;
+            temperature[i] -= (temperature[i] - room) * 0.001f;
+            PrinterUpdateVoltageT(printer_driver, (TERMO_REGULATOR)i, (uint16_t)temperature[i]);
+        }
+    }
+
+    // executes the commands with the heaters of the environment, returns the number of the main timer ticks
+    uint64_t print(const std::vector<std::string>& lines)
+    {
+        StartPrinting(lines, nullptr);
+
+        temperature[TERMO_NOZZLE] = temperature[TERMO_TABLE] = 20;
+        uint64_t ticks = 0;
+        uint32_t count = PrinterGetRemainingCommandsCount(printer_driver);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            PRINTER_STATUS status = PRINTER_OK;
+            do
+            {
+                PrinterLoadData(printer_driver);
+                status = PrinterNextCommand(printer_driver);
+            } while (PRINTER_PRELOAD_REQUIRED == status);
+
+            while (PRINTER_OK != status)
+            {
+                if (0 == ticks % (MAIN_TIMER_FREQUENCY / 10))
+                {
+                    handleEnvironmentTick();
+                }
+                ++ticks;
+                status = PrinterExecuteCommand(printer_driver);
+            }
+        }
+        return ticks;
+    }
+
+    // time of the preamble in seconds
+    double timeToFirstLayer(bool overlap_heating)
+    {
+        SetupPrinter(axis_configuration, PRINTER_ACCELERATION_ENABLE);
+        FileManagerSetHeatingOverlap(m_file_manager, overlap_heating);
+        std::vector<std::string> lines = loadPreamble("wanhao.gcode");
+        EXPECT_FALSE(lines.empty()) << "required file wanhao.gcode not found";
+        uint64_t ticks = print(lines);
+
+        // the first layer starts with the heated nozzle and table
+        EXPECT_LE(243, PrinterGetCurrentT(printer_driver, TERMO_NOZZLE));
+        EXPECT_LE(55, PrinterGetCurrentT(printer_driver, TERMO_TABLE));
+        return (double)ticks / MAIN_TIMER_FREQUENCY;
+    }
+
+    float temperature[TERMO_REGULATOR_COUNT];
+};
+
+TEST_F(PrinterHeatingEmulationTest, overlapped_heating_shortens_preamble)
+{
+    double sequential = timeToFirstLayer(false);
+    double overlapped = timeToFirstLayer(true);
+    std::cout << "time to the first layer: " << sequential << " s sequential, " << overlapped << " s overlapped" << std::endl;
+    ASSERT_LT(overlapped, sequential * 0.8);
+}
+
+TEST_F(PrinterHeatingEmulationTest, autotune_command_saves_gains)
+{
+    SetupPrinter(axis_configuration, PRINTER_ACCELERATION_ENABLE);
+    ASSERT_EQ(PRINTER_INVALID_CONTROL_BLOCK, PrinterLoadRegulatorGains(printer_driver));
+
+    // the command waits for the autotune, heating to the temperature takes 36 seconds at least. The next main loop
+    // call saves the measured gains
+    ASSERT_LT(36ULL * MAIN_TIMER_FREQUENCY, print({ "M303 S200 P0", "G0 F1800 X1" }));
+    ASSERT_EQ(TR_MODE_PID, TR_GetMode(m_regulators[TERMO_NOZZLE]));
+    ASSERT_EQ(0, PrinterGetTargetT(printer_driver, TERMO_NOZZLE));
+    ASSERT_EQ(PRINTER_OK, PrinterLoadData(printer_driver));
+
+    TermalRegulatorGains measured;
+    TR_GetGains(m_regulators[TERMO_NOZZLE], &measured);
+    TermalRegulatorGains other = { 1.f, 1.f, 1.f, 1.f };
+    TR_SetGains(m_regulators[TERMO_NOZZLE], &other);
+    ASSERT_EQ(PRINTER_OK, PrinterLoadRegulatorGains(printer_driver));
+
+    TermalRegulatorGains loaded;
+    TR_GetGains(m_regulators[TERMO_NOZZLE], &loaded);
+    ASSERT_EQ(measured.kp, loaded.kp);
+    ASSERT_EQ(measured.ki, loaded.ki);
+    ASSERT_EQ(measured.kd, loaded.kd);
+    ASSERT_EQ(measured.feed_forward, loaded.feed_forward);
+}
+
+TEST_F(PrinterHeatingEmulationTest, autotune_command_rejects_unknown_regulator)
+{
+    SetupPrinter(axis_configuration, PRINTER_ACCELERATION_ENABLE);
+    StartPrinting({ "M303 S200 P2" }, nullptr);
+    PrinterLoadData(printer_driver);
+    ASSERT_EQ(GCODE_ERROR_INVALID_PARAM, PrinterNextCommand(printer_driver));
+    ASSERT_EQ(TR_MODE_STEPPING, TR_GetMode(m_regulators[TERMO_NOZZLE]));
+}
@@ -0,0 +1,172 @@
+#include "printer_planner.h"
+#include "printer_math.h"
+#include "printer_constants.h"
+
+#include <gtest/gtest.h>
+#include <array>
+#include <cmath>
+
+class PrinterPlannerTest : public ::testing::Test
+{
+protected:
+    enum { ENTRY = 0, EXIT = 1 };
+
+    virtual void SetUp()
+    {
+        PlannerReset(&planner, &axis_configuration);
+        speeds.fill({ 0, 0 });
+        count = 0;
+    }
+
+    // adds the segment in mm, returns index of its speeds
+    size_t AddSegment(double x, double y, parameterType fetch_speed)
+    {
+        GCodeCommandParams segment = {
+            (parameterType)(x * axis_configuration.x_steps_per_mm),
+            (parameterType)(y * axis_configuration.y_steps_per_mm),
+            0, 0, fetch_speed
+        };
+        PlannerAddSegment(&planner, &segment, CalculateTime(&axis_configuration, &segment), (uint8_t*)speeds[count].data());
+        return count++;
+    }
+
+    MotionPlanner planner;
+    std::array<std::array<uint16_t, 2>, 64> speeds;
+    size_t count;
+};
+
+TEST_F(PrinterPlannerTest, single_segment)
+{
+    size_t segment = AddSegment(100, 0, 1800);
+    ASSERT_EQ(MINIMAL_VELOCITY, speeds[segment][ENTRY]);
+    ASSERT_EQ(MINIMAL_VELOCITY, speeds[segment][EXIT]);
+}
+
+TEST_F(PrinterPlannerTest, slow_segment)
+{
+    // segment slower than the minimal velocity is done without acceleration
+    size_t segment = AddSegment(10, 0, 120);
+    ASSERT_EQ(120, speeds[segment][ENTRY]);
+    ASSERT_EQ(120, speeds[segment][EXIT]);
+}
+
+TEST_F(PrinterPlannerTest, straight_line_keeps_speed)
+{
+    for (size_t i = 0; i < 5; ++i)
+    {
+        AddSegment(10, 0, 1800);
+    }
+
+    ASSERT_EQ(MINIMAL_VELOCITY, speeds[0][ENTRY]);
+    for (size_t i = 0; i < 4; ++i)
+    {
+        ASSERT_EQ(1800, speeds[i][EXIT]) << "segment " << i;
+        ASSERT_EQ(1800, speeds[i + 1][ENTRY]) << "segment " << i + 1;
+    }
+    ASSERT_EQ(MINIMAL_VELOCITY, speeds[4][EXIT]);
+}
+
+TEST_F(PrinterPlannerTest, speed_is_limited_by_acceleration)
+{
+    for (size_t i = 0; i < 4; ++i)
+    {
+        AddSegment(1, 0, 1800);
+    }
+
+    // v^2 = v0^2 + 2*a*d: 1mm from the stop the speed is 16.28 mm/sec, 2mm from the stop 22.47 mm/sec
+    const std::array<std::array<uint16_t, 2>, 4> expected = { { { 300, 977 }, { 977, 1348 }, { 1348, 977 }, { 977, 300 } } };
+    for (size_t i = 0; i < expected.size(); ++i)
+    {
+        ASSERT_NEAR(expected[i][ENTRY], speeds[i][ENTRY], 1) << "segment " << i;
+        ASSERT_NEAR(expected[i][EXIT], speeds[i][EXIT], 1) << "segment " << i;
+    }
+}
+
+TEST_F(PrinterPlannerTest, corner_speed_by_junction_deviation)
+{
+    const double angle = 20 * 3.14159265358979 / 180;
+    AddSegment(20, 0, 1800);
+    AddSegment(20 * cos(angle), 20 * sin(angle), 1800);
+
+    // sin(a/2) = 0.9848, v^2 = acceleration * deviation * sin(a/2) / (1 - sin(a/2)) = 389 (mm/sec)^2
+    ASSERT_NEAR(1183, speeds[0][EXIT], 2);
+    ASSERT_EQ(speeds[0][EXIT], speeds[1][ENTRY]);
+}
+
+TEST_F(PrinterPlannerTest, sharp_corner_speed_is_minimal)
+{
+    AddSegment(20, 0, 1800);
+    AddSegment(0, 20, 1800);
+    ASSERT_EQ(MINIMAL_VELOCITY, speeds[0][EXIT]);
+    ASSERT_EQ(MINIMAL_VELOCITY, speeds[1][ENTRY]);
+}
+
+TEST_F(PrinterPlannerTest, reversal_speed_is_minimal)
+{
+    AddSegment(20, 0, 1800);
+    AddSegment(-20, 0, 1800);
+    ASSERT_EQ(MINIMAL_VELOCITY, speeds[0][EXIT]);
+    ASSERT_EQ(MINIMAL_VELOCITY, speeds[1][ENTRY]);
+}
+
+TEST_F(PrinterPlannerTest, junction_is_limited_by_fetch_speed)
+{
+    AddSegment(20, 0, 3000);
+    AddSegment(20, 0, 1200);
+    AddSegment(20, 0, 3000);
+    ASSERT_EQ(1200, speeds[0][EXIT]);
+    ASSERT_EQ(1200, speeds[1][ENTRY]);
+    ASSERT_EQ(1200, speeds[1][EXIT]);
+    ASSERT_EQ(1200, speeds[2][ENTRY]);
+}
+
+TEST_F(PrinterPlannerTest, stop_finalizes_plan)
+{
+    AddSegment(20, 0, 1800);
+    PlannerStop(&planner);
+    AddSegment(20, 0, 1800);
+    ASSERT_EQ(MINIMAL_VELOCITY, speeds[0][EXIT]);
+    ASSERT_EQ(MINIMAL_VELOCITY, speeds[1][ENTRY]);
+}
+
+TEST_F(PrinterPlannerTest, window_finalizes_oldest_segment)
+{
+    for (size_t i = 0; i < PLANNER_WINDOW; ++i)
+    {
+        AddSegment(0.5, 0, 1800);
+    }
+    // replanning rewrites speeds of every segment in the window
+    speeds[0] = { 0, 0 };
+    speeds[1] = { 0, 0 };
+
+    AddSegment(0.5, 0, 1800);
+    ASSERT_EQ(0, speeds[0][ENTRY]);
+    ASSERT_NE(0, speeds[1][ENTRY]);
+}
+
+TEST_F(PrinterPlannerTest, release_finalizes_segments_out_of_range)
+{
+    for (size_t i = 0; i < 4; ++i)
+    {
+        AddSegment(0.5, 0, 1800);
+    }
+    ASSERT_EQ(2, PlannerRelease(&planner, (uint8_t*)speeds[2].data(), (uint8_t*)speeds[4].data()));
+    speeds[1] = { 0, 0 };
+
+    AddSegment(0.5, 0, 1800);
+    ASSERT_EQ(0, speeds[1][EXIT]);
+    ASSERT_EQ(speeds[2][EXIT], speeds[3][ENTRY]);
+    ASSERT_GT(speeds[3][EXIT], MINIMAL_VELOCITY);
+}
+
+TEST_F(PrinterPlannerTest, relocated_segment_is_updated)
+{
+    AddSegment(10, 0, 1800);
+    std::array<uint16_t, 2> moved = speeds[0];
+    PlannerSetLocation(&planner, (uint8_t*)moved.data());
+
+    AddSegment(10, 0, 1800);
+    ASSERT_EQ(MINIMAL_VELOCITY, speeds[0][EXIT]);
+    ASSERT_EQ(speeds[1][ENTRY], moved[EXIT]);
+    ASSERT_GT(moved[EXIT], MINIMAL_VELOCITY);
+}
@@ -0,0 +1,150 @@
+#include "printer_simplifier.h"
+
+#include <gtest/gtest.h>
+#include <array>
+#include <cmath>
+#include <vector>
+
+class PrinterSimplifierTest : public ::testing::Test
+{
+protected:
+    typedef std::array<uint8_t, GCODE_CHUNK_SIZE> Command;
+
+    virtual void SetUp()
+    {
+        SimplifierReset(&simplifier, window.data(), 2);
+        // the first move gives the start point of the path
+        ASSERT_EQ(SIMPLIFIER_BYPASS, SimplifierAppend(&simplifier, Move(0, 0).data()));
+    }
+
+    // move command to the point in steps
+    Command Move(parameterType x, parameterType y, parameterType e = 0, parameterType fetch_speed = 1800)
+    {
+        Command command = { 0 };
+        *(parameterType*)command.data() = GCODE_COMMAND | GCODE_MOVE;
+        *(GCodeCommandParams*)(command.data() + sizeof(parameterType)) = { x, y, 0, e, fetch_speed };
+        return command;
+    }
+
+    // appends all commands to the window and returns end points of the kept moves
+    std::vector<GCodeCommandParams> Simplify(const std::vector<Command>& commands)
+    {
+        for (const Command& command : commands)
+        {
+            EXPECT_EQ(SIMPLIFIER_BUFFERED, SimplifierAppend(&simplifier, command.data()));
+        }
+
+        std::vector<GCodeCommandParams> points;
+        uint8_t kept = SimplifierFlush(&simplifier);
+        for (uint8_t i = 0; i < kept; ++i)
+        {
+            points.push_back(*(const GCodeCommandParams*)(window.data() + i * GCODE_CHUNK_SIZE + sizeof(parameterType)));
+        }
+        return points;
+    }
+
+    PathSimplifier simplifier;
+    std::array<uint8_t, SIMPLIFIER_WINDOW * GCODE_CHUNK_SIZE> window;
+};
+
+TEST_F(PrinterSimplifierTest, straight_path_keeps_last_point)
+{
+    std::vector<GCodeCommandParams> points = Simplify({ Move(10, 1, 10), Move(20, -1, 20), Move(30, 0, 30) });
+    ASSERT_EQ(1U, points.size());
+    ASSERT_EQ(30, points[0].x);
+    ASSERT_EQ(30, points[0].e);
+    ASSERT_NEAR(1.0f, simplifier.max_deviation, 0.01f);
+}
+
+TEST_F(PrinterSimplifierTest, corner_is_kept)
+{
+    std::vector<GCodeCommandParams> points = Simplify({ Move(10, 0, 10), Move(20, 0, 20), Move(20, 10, 30), Move(20, 20, 40) });
+    ASSERT_EQ(2U, points.size());
+    ASSERT_EQ(20, points[0].x);
+    ASSERT_EQ(0, points[0].y);
+    ASSERT_EQ(20, points[1].y);
+}
+
+TEST_F(PrinterSimplifierTest, arc_is_simplified_within_tolerance)
+{
+    // quarter of the circle with radius 400 steps by 6 degrees, chord of 11 degrees arc deviates from it by 2 steps
+    const double radius = 400;
+    const double pi = 3.14159265358979;
+    std::vector<Command> arc;
+    for (int i = 1; i <= 15; ++i)
+    {
+        double angle = i * pi / 30;
+        arc.push_back(Move((parameterType)(radius * sin(angle)), (parameterType)(radius - radius * cos(angle)), i * 10));
+    }
+
+    std::vector<GCodeCommandParams> points = Simplify(arc);
+    ASSERT_GT(arc.size(), points.size());
+    ASSERT_LE(8U, points.size());
+    ASSERT_LE(simplifier.max_deviation, 2);
+
+    // the path ends at the same point with the same extrusion
+    GCodeCommandParams last = *(const GCodeCommandParams*)(arc.back().data() + sizeof(parameterType));
+    ASSERT_EQ(last.x, points.back().x);
+    ASSERT_EQ(last.y, points.back().y);
+    ASSERT_EQ(150, points.back().e);
+}
+
+TEST_F(PrinterSimplifierTest, extrusion_is_kept_at_kept_points)
+{
+    std::vector<GCodeCommandParams> points = Simplify({ Move(10, 0, 5), Move(20, 0, 7), Move(20, 10, 20), Move(20, 20, 21) });
+    ASSERT_EQ(2U, points.size());
+    ASSERT_EQ(7, points[0].e);
+    ASSERT_EQ(21, points[1].e);
+}
+
+TEST_F(PrinterSimplifierTest, speed_change_breaks_path)
+{
+    ASSERT_EQ(SIMPLIFIER_BUFFERED, SimplifierAppend(&simplifier, Move(10, 0, 0, 1800).data()));
+    ASSERT_EQ(SIMPLIFIER_BREAK, SimplifierAppend(&simplifier, Move(20, 0, 0, 1200).data()));
+    ASSERT_EQ(1, SimplifierFlush(&simplifier));
+    ASSERT_EQ(SIMPLIFIER_BUFFERED, SimplifierAppend(&simplifier, Move(20, 0, 0, 1200).data()));
+    ASSERT_EQ(0, simplifier.start.y);
+    ASSERT_EQ(10, simplifier.start.x);
+}
+
+TEST_F(PrinterSimplifierTest, extrusion_start_breaks_path)
+{
+    ASSERT_EQ(SIMPLIFIER_BUFFERED, SimplifierAppend(&simplifier, Move(10, 0).data()));
+    ASSERT_EQ(SIMPLIFIER_BREAK, SimplifierAppend(&simplifier, Move(20, 0, 10).data()));
+    ASSERT_EQ(1, SimplifierFlush(&simplifier));
+    ASSERT_EQ(SIMPLIFIER_BUFFERED, SimplifierAppend(&simplifier, Move(20, 0, 10).data()));
+    ASSERT_EQ(SIMPLIFIER_BREAK, SimplifierAppend(&simplifier, Move(20, 0, 5).data()));
+}
+
+TEST_F(PrinterSimplifierTest, full_window_breaks_path)
+{
+    for (parameterType i = 1; i <= SIMPLIFIER_WINDOW; ++i)
+    {
+        ASSERT_EQ(SIMPLIFIER_BUFFERED, SimplifierAppend(&simplifier, Move(i * 10, 0).data()));
+    }
+    ASSERT_EQ(SIMPLIFIER_BREAK, SimplifierAppend(&simplifier, Move(1000, 0).data()));
+    ASSERT_EQ(1, SimplifierFlush(&simplifier));
+    ASSERT_EQ(SIMPLIFIER_BUFFERED, SimplifierAppend(&simplifier, Move(1000, 0).data()));
+}
+
+TEST_F(PrinterSimplifierTest, other_commands_reset_position)
+{
+    Command set = Move(100, 100);
+    *(parameterType*)set.data() = GCODE_COMMAND | GCODE_SET;
+    ASSERT_EQ(SIMPLIFIER_BUFFERED, SimplifierAppend(&simplifier, Move(10, 0).data()));
+    ASSERT_EQ(SIMPLIFIER_BYPASS, SimplifierAppend(&simplifier, set.data()));
+    ASSERT_EQ(1, SimplifierFlush(&simplifier));
+
+    // the next move has unknown start and is stored as is
+    ASSERT_EQ(SIMPLIFIER_BYPASS, SimplifierAppend(&simplifier, Move(20, 0).data()));
+    ASSERT_EQ(SIMPLIFIER_BUFFERED, SimplifierAppend(&simplifier, Move(30, 0).data()));
+    ASSERT_EQ(20, simplifier.start.x);
+}
+
+TEST_F(PrinterSimplifierTest, zero_tolerance_disables_simplification)
+{
+    SimplifierReset(&simplifier, window.data(), 0);
+    ASSERT_EQ(SIMPLIFIER_BYPASS, SimplifierAppend(&simplifier, Move(0, 0).data()));
+    ASSERT_EQ(SIMPLIFIER_BYPASS, SimplifierAppend(&simplifier, Move(10, 0).data()));
+    ASSERT_EQ(0, SimplifierFlush(&simplifier));
+}
@@ -48,6 +48,9 @@ void Trace(size_t thread_id, const char* msg);
 
 /* Exported macro ------------------------------------------------------------*/
 /* USER CODE BEGIN EM */
+// pins of the port are changed by a single write of the bit set/reset register, set has priority
+#define GPIO_PIN_MASK(pin) ((uint16_t)(pin))
+#define HAL_GPIO_WritePort(port, set_mask, reset_mask) ((port)->BSRR = (uint32_t)(set_mask) | ((uint32_t)(reset_mask) << 16))
 
 /* USER CODE END EM */
 
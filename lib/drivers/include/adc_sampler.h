@@ -0,0 +1,84 @@
+#include "main.h"
+
+#include <stdbool.h>
+
+#ifndef __ADC_SAMPLER__
+#define __ADC_SAMPLER__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// max number of conversions in the regular sequence of the ADC
+#define ADC_SAMPLER_MAX_CHANNELS 4
+// max code of the 12 bit ADC
+#define ADC_SAMPLER_MAX_CODE 0x0FFF
+
+typedef struct
+{
+    uint32_t id;
+} *HADCSAMPLER;
+
+// called from the DMA interrupt with the next decimated value of the channel
+typedef void(*OnSampleReady)(uint8_t channel, uint16_t value, void* parameter);
+
+// Continuous acquisition of the ADC regular sequence by the circular DMA. The ADC is triggered by the timer, so
+// the samples come at the fixed rate. Each half of the buffer is processed by the DMA interrupt while the other
+// one is filled. Samples of the channel are summed by the decimating filter, one value is produced per decimation
+// samples. Oversampling by 4^extra_bits adds extra_bits of resolution, 0 keeps the scale of the ADC
+typedef struct
+{
+    ADC_HandleTypeDef* adc;
+    uint16_t*          buffer;          // circular DMA buffer, 2 * sequences * channels conversions
+    uint16_t           sequences;       // regular sequences converted into each half of the buffer
+    uint8_t            channels;        // conversions in the regular sequence
+    uint16_t           decimation;      // samples of the channel summed to one value, power of two
+    uint8_t            extra_bits;      // bits of resolution added by oversampling, 4^extra_bits <= decimation, values fit 16 bits
+
+    OnSampleReady      on_sample;
+    void*              parameter;
+} AdcSamplerConfig;
+
+HADCSAMPLER SAMPLER_Configure(AdcSamplerConfig* config);
+
+/// <summary>
+/// Starts the circular DMA acquisition of the ADC
+/// </summary>
+/// <param name="hsampler">handle of the sampler</param>
+/// <returns>true if the DMA is started</returns>
+bool SAMPLER_Start(HADCSAMPLER hsampler);
+
+void SAMPLER_Stop(HADCSAMPLER hsampler);
+
+/// <summary>
+/// Processes the first half of the buffer, has to be called by the DMA half transfer interrupt
+/// </summary>
+/// <param name="hsampler">handle of the sampler</param>
+void SAMPLER_HandleHalfTransfer(HADCSAMPLER hsampler);
+
+/// <summary>
+/// Processes the second half of the buffer, has to be called by the DMA transfer complete interrupt
+/// </summary>
+/// <param name="hsampler">handle of the sampler</param>
+void SAMPLER_HandleTransfer(HADCSAMPLER hsampler);
+
+/// <summary>
+/// Returns the last decimated value of the channel
+/// </summary>
+/// <param name="hsampler">handle of the sampler</param>
+/// <param name="channel">rank of the channel in the regular sequence, starting from 0</param>
+/// <returns>value in the ADC scale shifted by extra_bits, 0 if the first value isn't ready yet</returns>
+uint16_t SAMPLER_GetValue(HADCSAMPLER hsampler, uint8_t channel);
+
+/// <summary>
+/// Number of the buffer halves overwritten by the DMA before they were processed
+/// </summary>
+/// <param name="hsampler">handle of the sampler</param>
+/// <returns>number of the lost halves since the start</returns>
+uint32_t SAMPLER_GetOverruns(HADCSAMPLER hsampler);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__ADC_SAMPLER__
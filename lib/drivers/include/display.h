@@ -89,11 +89,12 @@ DISPLAY_Status DISPLAY_IsInitialized(HDISPLAY hdisplay);
 DISPLAY_Status DISPLAY_FillRect(HDISPLAY hdisplay, Rect rectangle, uint16_t color);
 
 /// <summary>
-/// Indicate driver area on the screen that will be filled by pixels 
+/// Indicate driver area on the screen that will be filled by pixels.
+/// The display keeps the bus until DISPLAY_EndDraw, the bus held by a transfer of another device is waited by dispatching its queued steps
 /// </summary>
 /// <param name="hdisplay">Handle to the display driver</param>
 /// <param name="rectangle">Area for drawing</param>
-/// <returns>DISPLAY_OK in case of success or status otherwise</returns>
+/// <returns>DISPLAY_OK in case of success, DISPLAY_NOT_READY if the bus isn't released or status otherwise</returns>
 DISPLAY_Status DISPLAY_BeginDraw(HDISPLAY hdisplay, Rect rectangle);
 
 /// <summary>
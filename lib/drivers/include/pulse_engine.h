@@ -21,11 +21,19 @@ typedef enum PULSE_SIGNAL_type
 
 typedef void(pulse_callback)(void* parameter);
 
+// step generation algorithm, both modes produce the same sequence of pulses
+typedef enum PULSE_MODE_type
+{
+    PULSE_ACCUMULATOR = 0,  // error accumulator, no divisions in the tick handler
+    PULSE_DIVISION,         // signal index is calculated from the tick index on every tick
+} PULSE_MODE;
+
 //wave type is used to check how pulse engine works, is signal region starts from lower value (off) or from higher (on)
 HPULSE PULSE_Configure(PULSE_SINGAL signal_type);
 void PULSE_Release(HPULSE pulse);
 void PULSE_SetPower(HPULSE pulse, uint32_t power);
 void PULSE_SetPeriod(HPULSE pulse, uint32_t period);
+void PULSE_SetMode(HPULSE pulse, PULSE_MODE mode);
 bool PULSE_HandleTick(HPULSE pulse);
 uint32_t PULSE_GetPower(HPULSE pulse);
 #ifdef __cplusplus
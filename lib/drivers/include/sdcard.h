@@ -57,6 +57,18 @@ SDCARD_Status SDCARD_Read(HSDCARD hsdcard, uint8_t *buffer, uint32_t sector, uin
 SDCARD_Status SDCARD_WriteSingleBlock(HSDCARD hsdcard, const uint8_t *data, uint32_t sector);
 size_t SDCARD_Write(HSDCARD hsdcard, const uint8_t *buffer, uint32_t sector, uint32_t count);
 
+// Asynchronous commands
+// transfer is started by the command and advanced by SDCARD_Poll, that is called from the main loop.
+// The card holds the transaction of the bus from the command to the last block, other devices of the bus can't be selected
+// until the transfer is completed. The next step of the transfer waits in the queue of the bus as SPIBUS_PRIORITY_PREFETCH
+// transaction, every poll dispatches a single step. Buffer must stay valid until the transfer is completed.
+// Card is busy during the transfer, other commands are rejected with SDCARD_BUSY status
+typedef void (*SDCARD_Callback)(HSDCARD hsdcard, SDCARD_Status status, void* context);
+SDCARD_Status SDCARD_ReadAsync(HSDCARD hsdcard, uint8_t *buffer, uint32_t sector, uint32_t count, SDCARD_Callback callback, void* context);
+SDCARD_Status SDCARD_WriteAsync(HSDCARD hsdcard, const uint8_t *buffer, uint32_t sector, uint32_t count, SDCARD_Callback callback, void* context);
+// returns SDCARD_BUSY while the transfer is in progress, otherwise status of the last asynchronous transfer
+SDCARD_Status SDCARD_Poll(HSDCARD hsdcard);
+
 //FAT File System support
 SDCARD_Status SDCARD_FAT_Register(HSDCARD hsdcard, uint8_t drive_index);
 SDCARD_Status SDCARD_FAT_IsInitialized(uint8_t drive_index);
@@ -1,5 +1,7 @@
 #include "main.h"
 
+#include <stdbool.h>
+
 #ifndef __SPIBUS__
 #define __SPIBUS__
 
@@ -20,20 +22,78 @@ typedef enum SPIBUS_Status_type
 
 #define SPIBUS_DeviceLimit 10
 
+// maximum size of data received by a single HAL call
+#define SPIBUS_ReceiveChunk 512
+
 HSPIBUS SPIBUS_Configure(SPI_HandleTypeDef* hspi, uint32_t timeout);
 void SPIBUS_Release(HSPIBUS hspi);
 
 uint32_t SPIBUS_AddPeripherialDevice(HSPIBUS hspi, GPIO_TypeDef* cs_port_array, uint16_t sc_port);
 
 // selected device means all low
+// the bus tracks the selected device, so repeated selection or unselection doesn't write the pins
 uint32_t SPIBUS_SelectDevice(HSPIBUS hspi, uint32_t id);
 uint32_t SPIBUS_UnselectDevice(HSPIBUS hspi, uint32_t id);
+// writes all chip selects and drops an open transaction
 void SPIBUS_UnselectAll(HSPIBUS hspi);
 
+// keeps the device selected between the begin and the end calls, transactions of the same device can be nested.
+// select and unselect of the device inside the transaction don't change the chip select,
+// selection of another device fails until the transaction ends
+uint32_t SPIBUS_BeginTransaction(HSPIBUS hspi, uint32_t id);
+uint32_t SPIBUS_EndTransaction(HSPIBUS hspi, uint32_t id);
+
 // fasade on HAL_SPI functions to hide internal implementation of SPIBUS 'class'
 HAL_StatusTypeDef SPIBUS_SetValue(HSPIBUS hspi, uint8_t* transmit_data, size_t size);
 HAL_StatusTypeDef SPIBUS_Transmit(HSPIBUS hspi, uint8_t* transmit_data, size_t size);
 HAL_StatusTypeDef SPIBUS_TransmitReceive(HSPIBUS hspi, uint8_t* transmit_data, uint8_t* receive_data, size_t size);
+// receives data while the bus transmits 0xFF, data is received by chunks of SPIBUS_ReceiveChunk bytes
+HAL_StatusTypeDef SPIBUS_Receive(HSPIBUS hspi, uint8_t* receive_data, size_t size);
+
+// Transaction scheduler.
+// Devices sharing the bus submit transactions, the main loop dispatches them in priority order,
+// transactions of the same priority run by the earliest deadline and then by submission order.
+typedef enum SPIBUS_Priority_type
+{
+    SPIBUS_PRIORITY_TOUCH,      // touch controller polling
+    SPIBUS_PRIORITY_UI,         // display refresh
+    SPIBUS_PRIORITY_PREFETCH,   // print data prefetch
+    SPIBUS_PRIORITIES_COUNT
+} SPIBUS_Priority;
+
+#define SPIBUS_QueueLimit 8
+
+// transaction body, it is called with the device selected for the whole transaction
+typedef HAL_StatusTypeDef (*SPIBUS_TransactionHandler)(HSPIBUS hspi, void* context);
+
+typedef struct SPIBUS_Transaction_type
+{
+    uint32_t                  device;
+    SPIBUS_Priority           priority;
+    SPIBUS_TransactionHandler handler;
+    void*                     context;
+    // any tick is a valid deadline, so the deadline is used only if the flag is set
+    bool                      has_deadline;
+    uint32_t                  deadline;     // HAL tick the transaction should be started before
+} SPIBUS_Transaction;
+
+typedef struct SPIBUS_Statistics_type
+{
+    uint32_t queue_depth;                           // transactions waiting in the queue now
+    uint32_t max_queue_depth;
+    uint32_t executed[SPIBUS_PRIORITIES_COUNT];
+    uint32_t total_wait[SPIBUS_PRIORITIES_COUNT];   // ticks between submission and start
+    uint32_t max_wait[SPIBUS_PRIORITIES_COUNT];
+    uint32_t missed_deadlines;
+    uint32_t failed;                                // transactions which handler returned an error
+} SPIBUS_Statistics;
+
+// the transaction is copied to the queue, fails if the queue is full
+SPIBUS_Status SPIBUS_Submit(HSPIBUS hspi, const SPIBUS_Transaction* transaction);
+// runs up to max_count queued transactions, 0 runs the queue until it is empty. Returns the number of executed transactions
+uint32_t SPIBUS_Dispatch(HSPIBUS hspi, uint32_t max_count);
+void SPIBUS_GetStatistics(HSPIBUS hspi, SPIBUS_Statistics* statistics);
+void SPIBUS_ResetStatistics(HSPIBUS hspi);
 
 //TODO: understand why DMA was not working with the display
 HAL_StatusTypeDef SPIBUS_TransmitDMA(HSPIBUS hspi, uint8_t* transmit_data, size_t size, size_t lines_count);
@@ -0,0 +1,63 @@
+#include "main.h"
+#include "include/motor.h"
+
+#ifndef __STEPPER_GROUP__
+#define __STEPPER_GROUP__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// maximal number of motors in the group, every motor is represented by a bit in the step mask
+#define STEPPER_GROUP_MAX_AXES 8
+
+typedef struct STEPPER_GROUP_type
+{
+    uint32_t id;
+} * HSTEPPERGROUP;
+
+/// <summary>
+/// Configures group of stepping motors that are programmed and stepped together.
+/// Counters of all motors are stored in contiguous arrays, so the tick of the whole group is a single loop.
+/// Motors produce the same steps as the motor driver with the same configuration and program
+/// </summary>
+/// <param name="configs">Array of motor configurations, index in the array is the axis of the motor in the group</param>
+/// <param name="count">Number of motors in the group, up to STEPPER_GROUP_MAX_AXES</param>
+/// <returns>Handle on created group or null otherwise</returns>
+HSTEPPERGROUP STEPPERGROUP_Configure(const MotorConfig* configs, uint8_t count);
+
+/// <summary>
+/// Initializes program of the single motor of the group
+/// </summary>
+/// <param name="hgroup">Handle to the group</param>
+/// <param name="axis">Index of the motor in the group</param>
+/// <param name="ticks_count">Total number of cicles the program should be executed or Time</param>
+/// <param name="distance">Total number of steps that should be done by the motor, sign selects direction</param>
+void STEPPERGROUP_SetProgram(HSTEPPERGROUP hgroup, uint8_t axis, uint32_t ticks_count, int32_t distance);
+
+/// <summary>
+/// Performs single step of programs of all motors in the group. Step pins are not changed
+/// </summary>
+/// <param name="hgroup">Handle to the group</param>
+/// <returns>Bit mask of the motors that have to step in this tick, bit N corresponds to axis N</returns>
+uint8_t STEPPERGROUP_HandleTick(HSTEPPERGROUP hgroup);
+
+/// <summary>
+/// Makes step signals on the step pins of the requested motors
+/// </summary>
+/// <param name="hgroup">Handle to the group</param>
+/// <param name="step_mask">Bit mask of the motors to step, usually returned by STEPPERGROUP_HandleTick</param>
+void STEPPERGROUP_Step(HSTEPPERGROUP hgroup, uint8_t step_mask);
+
+/// <summary>
+/// Returns motors that execute their programs
+/// </summary>
+/// <param name="hgroup">Handle to the group</param>
+/// <returns>Bit mask of the busy motors, 0 if all programs are completed</returns>
+uint8_t STEPPERGROUP_GetBusyMask(HSTEPPERGROUP hgroup);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__STEPPER_GROUP__
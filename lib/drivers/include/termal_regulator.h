@@ -10,29 +10,73 @@ extern "C" {
 
 #define TERMAL_REGULATOR_BACKET_SIZE 30
 #define TERMAL_REGULATOR_HEAT_PERIOD 10
+// hysteresis of the autotune relay, degrees
+#define TERMAL_REGULATOR_AUTOTUNE_HYSTERESIS 1.f
+// oscillations measured by the autotune, the first one after the heat up isn't counted
+#define TERMAL_REGULATOR_AUTOTUNE_CYCLES 4
+// max duration of the autotune in temperature updates, the autotune fails if oscillations aren't measured till then
+#define TERMAL_REGULATOR_AUTOTUNE_LIMIT 8192
+// temperatures of the calibration are fixed point numbers with this amount of fraction bits
+#define TERMAL_REGULATOR_TEMPERATURE_SHIFT 4
+#define TERMAL_REGULATOR_TEMPERATURE_SCALE (1 << TERMAL_REGULATOR_TEMPERATURE_SHIFT)
 
 typedef struct
 {
     uint32_t id;
 } *HTERMALREGULATOR;
 
+typedef enum
+{
+    TR_MODE_STEPPING = 0,   // heat and cool powers are stepped to balance the temperature
+    TR_MODE_PID,            // PID control with feed-forward
+    TR_MODE_AUTOTUNE,       // relay oscillations to measure PID gains
+} TR_MODE;
+
+// Gains of the PID control. The output is a part of the full heater power, from 0 to 1,
+// time is counted in temperature updates, one update per backet of ADC values
+typedef struct
+{
+    float kp;           // output per degree of the error
+    float ki;           // output per degree of the error per update
+    float kd;           // output per degree of the temperature change per update
+    float feed_forward; // output per degree of the target temperature
+} TermalRegulatorGains;
+
+// point of the sensor calibration: raw ADC value and its temperature in 1/TERMAL_REGULATOR_TEMPERATURE_SCALE degree
+typedef struct
+{
+    uint16_t code;
+    int32_t  temperature;
+} TermalCalibrationPoint;
+
 typedef struct
 {
     GPIO_TypeDef* port;
     uint16_t      pin;
 
-     // dependeing on termal resistor type this values can alter
+    // pin states of the heater switched on and off, the direction of the sensor doesn't affect them
     GPIO_PinState heat_value;
     GPIO_PinState cool_value;
 
     // represents line parameters to interpret raw ADC value into temperature
     float line_angle;
     float line_offset;
+
+    // calibration table replaces the line when it is set, e.g. points of the thermistor curve.
+    // Codes are increasing, temperatures are monotonic, values out of the table are clamped to its ends.
+    // The table isn't copied and has to live as long as the regulator
+    const TermalCalibrationPoint* table;
+    uint16_t                      table_size;
+
+    // ADC values averaged to one temperature update, 0 is TERMAL_REGULATOR_BACKET_SIZE.
+    // Values already decimated by the sampler are passed with 1, the sampler picks the update rate
+    uint8_t backet_capacity;
 } TermalRegulatorConfig;
 
 HTERMALREGULATOR  TR_Configure(TermalRegulatorConfig* config);
 
 uint16_t TR_GetTargetTemperature(HTERMALREGULATOR htr);
+// the target is applied by the next ADC value, so it can be set while the values come from an interrupt
 void TR_SetTargetTemperature(HTERMALREGULATOR htr, uint16_t value);
 
 void TR_SetADCValue(HTERMALREGULATOR htr, uint16_t value);
@@ -43,6 +87,37 @@ bool TR_IsHeaterStabilized(HTERMALREGULATOR htr);
 
 void TR_HandleTick(HTERMALREGULATOR htr);
 
+/// <summary>
+/// Switches the regulator to the PID control with the given gains
+/// </summary>
+/// <param name="htr">Handle of the termal regulator</param>
+/// <param name="gains">PID gains, e.g. measured by the autotune</param>
+void TR_SetGains(HTERMALREGULATOR htr, const TermalRegulatorGains* gains);
+
+/// <summary>
+/// Gets gains of the PID control
+/// </summary>
+/// <param name="htr">Handle of the termal regulator</param>
+/// <param name="gains">[out] PID gains, zeros if they are neither set nor measured</param>
+void TR_GetGains(HTERMALREGULATOR htr, TermalRegulatorGains* gains);
+
+/// <summary>
+/// Gets the current control mode
+/// </summary>
+/// <param name="htr">Handle of the termal regulator</param>
+/// <returns>TR_MODE_AUTOTUNE till the autotune is completed</returns>
+TR_MODE TR_GetMode(HTERMALREGULATOR htr);
+
+/// <summary>
+/// Starts the relay autotune: the heater is switched on and off around the temperature and the oscillations
+/// are measured. Once they are measured the regulator switches to the PID control with the found gains,
+/// otherwise it returns to the previous mode. The heater is switched off after the autotune.
+/// The autotune is started by the next ADC value, as the target
+/// </summary>
+/// <param name="htr">Handle of the termal regulator</param>
+/// <param name="temperature">temperature the gains are measured at</param>
+void TR_StartAutotune(HTERMALREGULATOR htr, uint16_t temperature);
+
 #ifdef __cplusplus
 }
 #endif
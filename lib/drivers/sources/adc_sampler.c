@@ -0,0 +1,145 @@
+#include "include/adc_sampler.h"
+#include "include/memory.h"
+
+// private members part
+typedef struct
+{
+    AdcSamplerConfig config;
+
+    uint8_t  shift;                             // log2(decimation) - extra_bits
+    uint16_t count;                             // samples of each channel in the sums
+    uint32_t sums[ADC_SAMPLER_MAX_CHANNELS];
+    uint16_t values[ADC_SAMPLER_MAX_CHANNELS];
+
+    uint8_t  next_half;                         // half of the buffer expected by the next interrupt
+    uint32_t overruns;
+} AdcSampler;
+
+static uint8_t log2u(uint16_t value)
+{
+    uint8_t result = 0;
+    while (value >>= 1)
+    {
+        ++result;
+    }
+    return result;
+}
+
+// sums are shared by the halves, so the decimation doesn't depend on the size of the half
+static void processHalf(AdcSampler* sampler, uint8_t half)
+{
+    if (half != sampler->next_half)
+    {
+        ++sampler->overruns;
+    }
+    sampler->next_half = half ^ 1;
+
+    const uint8_t channels = sampler->config.channels;
+    const uint16_t* samples = sampler->config.buffer + (uint32_t)half * sampler->config.sequences * channels;
+    for (uint16_t sequence = 0; sequence < sampler->config.sequences; ++sequence, samples += channels)
+    {
+        for (uint8_t channel = 0; channel < channels; ++channel)
+        {
+            sampler->sums[channel] += samples[channel];
+        }
+
+        if (++sampler->count < sampler->config.decimation)
+        {
+            continue;
+        }
+        sampler->count = 0;
+        for (uint8_t channel = 0; channel < channels; ++channel)
+        {
+            sampler->values[channel] = (uint16_t)(sampler->sums[channel] >> sampler->shift);
+            sampler->sums[channel] = 0;
+            if (sampler->config.on_sample)
+            {
+                sampler->config.on_sample(channel, sampler->values[channel], sampler->config.parameter);
+            }
+        }
+    }
+}
+
+HADCSAMPLER SAMPLER_Configure(AdcSamplerConfig* config)
+{
+#ifndef FIRMWARE
+    if (!config || !config->adc || !config->buffer || !config->sequences)
+    {
+        return 0;
+    }
+    if (!config->channels || config->channels > ADC_SAMPLER_MAX_CHANNELS)
+    {
+        return 0;
+    }
+    // decimation has to be the power of two, oversampling needs 4^extra_bits samples at least
+    if (!config->decimation || (config->decimation & (config->decimation - 1)))
+    {
+        return 0;
+    }
+    if (config->extra_bits > 7 || (1U << (2 * config->extra_bits)) > config->decimation)
+    {
+        return 0;
+    }
+    // the value of the max samples has to fit 16 bits
+    uint8_t shift = log2u(config->decimation) - config->extra_bits;
+    if ((((uint32_t)ADC_SAMPLER_MAX_CODE * config->decimation) >> shift) > UINT16_MAX)
+    {
+        return 0;
+    }
+#endif
+
+    AdcSampler* sampler = DeviceAlloc(sizeof(AdcSampler));
+    sampler->config = *config;
+    sampler->shift  = log2u(config->decimation) - config->extra_bits;
+    sampler->count  = 0;
+    for (uint8_t channel = 0; channel < ADC_SAMPLER_MAX_CHANNELS; ++channel)
+    {
+        sampler->sums[channel]   = 0;
+        sampler->values[channel] = 0;
+    }
+    sampler->next_half = 0;
+    sampler->overruns  = 0;
+
+    return (HADCSAMPLER)sampler;
+}
+
+bool SAMPLER_Start(HADCSAMPLER hsampler)
+{
+    AdcSampler* sampler = (AdcSampler*)hsampler;
+    sampler->count     = 0;
+    sampler->next_half = 0;
+    for (uint8_t channel = 0; channel < ADC_SAMPLER_MAX_CHANNELS; ++channel)
+    {
+        sampler->sums[channel] = 0;
+    }
+
+    uint32_t length = 2U * sampler->config.sequences * sampler->config.channels;
+    return HAL_OK == HAL_ADC_Start_DMA(sampler->config.adc, (uint32_t*)sampler->config.buffer, length);
+}
+
+void SAMPLER_Stop(HADCSAMPLER hsampler)
+{
+    AdcSampler* sampler = (AdcSampler*)hsampler;
+    HAL_ADC_Stop_DMA(sampler->config.adc);
+}
+
+void SAMPLER_HandleHalfTransfer(HADCSAMPLER hsampler)
+{
+    processHalf((AdcSampler*)hsampler, 0);
+}
+
+void SAMPLER_HandleTransfer(HADCSAMPLER hsampler)
+{
+    processHalf((AdcSampler*)hsampler, 1);
+}
+
+uint16_t SAMPLER_GetValue(HADCSAMPLER hsampler, uint8_t channel)
+{
+    AdcSampler* sampler = (AdcSampler*)hsampler;
+    return (channel < sampler->config.channels) ? sampler->values[channel] : 0;
+}
+
+uint32_t SAMPLER_GetOverruns(HADCSAMPLER hsampler)
+{
+    return ((AdcSampler*)hsampler)->overruns;
+}
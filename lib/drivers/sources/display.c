@@ -25,6 +25,7 @@ typedef struct
     uint16_t reset_port;
 
     bool initialized;
+    bool drawing;       // the bus is taken by DISPLAY_BeginDraw until DISPLAY_EndDraw
 
     Rect               text_area;
     CharacterPlacement c_placement;
@@ -92,6 +93,20 @@ static DISPLAY_Status AbortProcedure(DisplayInternal* display, int32_t error)
     return (DISPLAY_Status)error;
 }
 
+// the bus can be held by the transfer of another device, like the asynchronous read of the SD card.
+// The queued steps of the transfer are dispatched until the bus is released, the display doesn't wait if nothing is queued
+static bool AcquireBus(DisplayInternal* display)
+{
+    while (SPIBUS_FAIL == SPIBUS_BeginTransaction(display->hspi, display->spi_id))
+    {
+        if (!SPIBUS_Dispatch(display->hspi, 1))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 // Display parameters reset
 static void ResetDisplaySettings(DisplayInternal* display)
 {
@@ -217,7 +232,11 @@ static HAL_StatusTypeDef DrawSymbol(DisplayInternal* display, uint16_t x, uint16
 static HAL_StatusTypeDef DrawString(DisplayInternal* display, CharacterPlacement* placement, const Rect* rect, const char* c_str)
 {
     size_t str_len = strlen(c_str);
-    SPIBUS_SelectDevice(display->hspi, display->spi_id);
+    // the whole string is drawn under one selection, including the screen clearing on overflow
+    if (!AcquireBus(display))
+    {
+        return HAL_ERROR;
+    }
     uint16_t text_color = ((display->font_color >> 8) & 0xFF) | ((display->font_color & 0xFF) << 8);
     uint16_t background_color = ((display->background_color >> 8) & 0xFF) | ((display->background_color & 0xFF) << 8);
     
@@ -247,11 +266,11 @@ static HAL_StatusTypeDef DrawString(DisplayInternal* display, CharacterPlacement
         
         if ( HAL_OK != status)
         {
-            return status;
+            break;
         }
             
     }
-    SPIBUS_UnselectDevice(display->hspi, display->spi_id);
+    SPIBUS_EndTransaction(display->hspi, display->spi_id);
     
     return status;
 }
@@ -274,6 +293,7 @@ HDISPLAY DISPLAY_Configure(const DisplayConfig* config)
     display->reset_port = config->reset_port;
     
 	display->initialized = false;
+	display->drawing = false;
 
 	return (HDISPLAY)display;
 }
@@ -376,15 +396,20 @@ DISPLAY_Status DISPLAY_BeginDraw(HDISPLAY hdisplay, Rect rectangle)
 	}
 #endif
 
-    SPIBUS_SelectDevice(display->hspi, display->spi_id);
+    if (!AcquireBus(display))
+    {
+        return DISPLAY_NOT_READY;
+    }
     rectangle.x1 -= 1;
     rectangle.y1 -= 1;
     
     if (HAL_OK != SetAddressWindow(display, &rectangle))
     {
+        SPIBUS_EndTransaction(display->hspi, display->spi_id);
         return AbortProcedure(display, DISPLAY_FAILURE);
     }
     
+    display->drawing = true;
     return DISPLAY_OK;
 }
 
@@ -398,7 +423,12 @@ DISPLAY_Status DISPLAY_WritePixels(HDISPLAY hdisplay, const uint16_t* pixels, si
 		return DISPLAY_INCORRECT_STATE;
 	}
 #endif
-    
+
+    // the pixels would be sent to the device that holds the bus
+    if (!display->drawing)
+    {
+        return DISPLAY_NOT_READY;
+    }
     WriteData(display, (uint8_t*)pixels, count*2);
     return DISPLAY_OK;
 }
@@ -414,7 +444,11 @@ DISPLAY_Status DISPLAY_EndDraw(HDISPLAY hdisplay)
 	}
 #endif
     
-    SPIBUS_UnselectDevice(display->hspi, display->spi_id);
+    if (display->drawing)
+    {
+        SPIBUS_EndTransaction(display->hspi, display->spi_id);
+        display->drawing = false;
+    }
     
     return DISPLAY_OK;
 }
@@ -444,10 +478,14 @@ DISPLAY_Status DISPLAY_FillRect(HDISPLAY hdisplay, Rect rectangle, uint16_t colo
     // all borders of access window are inclusive
     rectangle.x1 -= 1;
     rectangle.y1 -= 1;
-    SPIBUS_SelectDevice(display->hspi, display->spi_id);
+    if (!AcquireBus(display))
+    {
+        return DISPLAY_NOT_READY;
+    }
     
     if (HAL_OK != SetAddressWindow(display, &rectangle))
     {
+        SPIBUS_EndTransaction(display->hspi, display->spi_id);
         return AbortProcedure(display, DISPLAY_FAILURE);
     }
     
@@ -456,7 +494,7 @@ DISPLAY_Status DISPLAY_FillRect(HDISPLAY hdisplay, Rect rectangle, uint16_t colo
         WriteData(display, (uint8_t*)&display_line, 2*line_width);
     }
     
-    SPIBUS_UnselectDevice(display->hspi, display->spi_id);
+    SPIBUS_EndTransaction(display->hspi, display->spi_id);
     return DISPLAY_OK;
 }
 
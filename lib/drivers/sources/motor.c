@@ -5,6 +5,8 @@
 typedef struct
 {
     MotorConfig port_config;
+    uint16_t step_mask;
+    uint16_t dir_mask;
     HPULSE pulse_engine;
     uint32_t programmable_ticks;
 } MotorInternal;
@@ -18,9 +20,11 @@ HMOTOR MOTOR_Configure(MotorConfig* config)
 
     MotorInternal* motor = DeviceAlloc(sizeof(MotorInternal));
     motor->port_config = *config;
+    motor->step_mask = GPIO_PIN_MASK(config->step_pin);
+    motor->dir_mask = GPIO_PIN_MASK(config->dir_pin);
 
-    HAL_GPIO_WritePin(motor->port_config.step_port, motor->port_config.step_pin, GPIO_PIN_RESET);
-    HAL_GPIO_WritePin(motor->port_config.dir_port, motor->port_config.dir_pin, GPIO_PIN_RESET);
+    HAL_GPIO_WritePort(motor->port_config.step_port, 0, motor->step_mask);
+    HAL_GPIO_WritePort(motor->port_config.dir_port, 0, motor->dir_mask);
 
     motor->pulse_engine = PULSE_Configure(config->signal_type);
     motor->programmable_ticks = 0;
@@ -32,8 +36,8 @@ void MOTOR_Step(HMOTOR hmotor)
 {
     MotorInternal* motor = (MotorInternal*)hmotor;
     // step requires front signal ampl, so do it, and then return to reset state, for the next step
-    HAL_GPIO_WritePin(motor->port_config.step_port, motor->port_config.step_pin, GPIO_PIN_SET);
-    HAL_GPIO_WritePin(motor->port_config.step_port, motor->port_config.step_pin, GPIO_PIN_RESET);
+    HAL_GPIO_WritePort(motor->port_config.step_port, motor->step_mask, 0);
+    HAL_GPIO_WritePort(motor->port_config.step_port, 0, motor->step_mask);
 }
 
 void MOTOR_SetDirection(HMOTOR hmotor, MOTOR_DIRECTION direction)
@@ -41,11 +45,11 @@ void MOTOR_SetDirection(HMOTOR hmotor, MOTOR_DIRECTION direction)
     MotorInternal* motor = (MotorInternal*)hmotor;
     if (MOTOR_CW == direction)
     {
-        HAL_GPIO_WritePin(motor->port_config.dir_port, motor->port_config.dir_pin, GPIO_PIN_SET);
+        HAL_GPIO_WritePort(motor->port_config.dir_port, motor->dir_mask, 0);
     }
     else
     {
-        HAL_GPIO_WritePin(motor->port_config.dir_port, motor->port_config.dir_pin, GPIO_PIN_RESET);
+        HAL_GPIO_WritePort(motor->port_config.dir_port, 0, motor->dir_mask);
     }
 }
 
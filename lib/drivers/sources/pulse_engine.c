@@ -12,6 +12,9 @@ typedef struct PulseInternal_type
 	uint32_t signal_tick;
 	uint32_t tick;
 
+	PULSE_MODE mode;
+	uint32_t error; // accumulated power, that is not converted to the signal yet
+
 } PulseInternal;
 
 HPULSE PULSE_Configure(PULSE_SINGAL signal_type)
@@ -21,6 +24,10 @@ HPULSE PULSE_Configure(PULSE_SINGAL signal_type)
 	pulse->period = 1;
 	pulse->power = 0;
 	pulse->signal_type = signal_type;
+	pulse->mode = PULSE_ACCUMULATOR;
+	pulse->signal_tick = 0;
+	pulse->tick = 0;
+	pulse->error = 0;
 
 	return (HPULSE)pulse;
 }
@@ -37,21 +44,31 @@ void PULSE_SetPeriod(HPULSE pulse, uint32_t period)
 	// Reset internal signal counters
 	internal_pulse->signal_tick = 0;
 	internal_pulse->tick = 0;
+	internal_pulse->error = 0;
 }
 
-void PULSE_SetPower(HPULSE pulse, uint32_t power)
+void PULSE_SetMode(HPULSE pulse, PULSE_MODE mode)
 {
 	PulseInternal* internal_pulse = (PulseInternal*)pulse;
-	internal_pulse->power = power;
+	internal_pulse->mode = mode;
 	// Reset internal signal counters
 	internal_pulse->signal_tick = 0;
 	internal_pulse->tick = 0;
+	internal_pulse->error = 0;
 }
 
-bool PULSE_HandleTick(HPULSE pulse)
+void PULSE_SetPower(HPULSE pulse, uint32_t power)
 {
 	PulseInternal* internal_pulse = (PulseInternal*)pulse;
+	internal_pulse->power = power;
+	// Reset internal signal counters
+	internal_pulse->signal_tick = 0;
+	internal_pulse->tick = 0;
+	internal_pulse->error = 0;
+}
 
+static bool handleTickDivision(PulseInternal* internal_pulse)
+{
 	// Calculate signal state
 	//
 	// n > 0
@@ -90,6 +107,53 @@ bool PULSE_HandleTick(HPULSE pulse)
 	return result;
 }
 
+static bool handleTickAccumulator(PulseInternal* internal_pulse)
+{
+	// The same signal as the division mode produces:
+	// n-th signal is produced when the accumulated power n * P crosses the next multiple of T.
+	// Error keeps n * P mod T, so the tick requires only addition and comparison.
+	// HIGHER signal produces the 1st signal immediately and then follows the LOWER signal delayed by 1 tick
+
+	++internal_pulse->tick;
+
+	bool result = false;
+	if (internal_pulse->power >= internal_pulse->period)
+	{
+		// every tick crosses at least one multiple of the period
+		result = true;
+	}
+	else if (internal_pulse->signal_type && 1 == internal_pulse->tick)
+	{
+		result = internal_pulse->power > 0;
+	}
+	else
+	{
+		internal_pulse->error += internal_pulse->power;
+		result = internal_pulse->error >= internal_pulse->period;
+		if (result)
+		{
+			internal_pulse->error -= internal_pulse->period;
+		}
+	}
+
+	if (internal_pulse->tick == internal_pulse->period)
+	{
+		internal_pulse->tick = 0;
+		internal_pulse->error = 0;
+	}
+	return result;
+}
+
+bool PULSE_HandleTick(HPULSE pulse)
+{
+	PulseInternal* internal_pulse = (PulseInternal*)pulse;
+	if (PULSE_DIVISION == internal_pulse->mode)
+	{
+		return handleTickDivision(internal_pulse);
+	}
+	return handleTickAccumulator(internal_pulse);
+}
+
 uint32_t PULSE_GetPower(HPULSE hpulse)
 {
 	PulseInternal* pulse = (PulseInternal*)hpulse;
@@ -1,6 +1,19 @@
 #include "include/sdcard.h"
 #include "include/memory.h"
 
+// state of the asynchronous transfer
+typedef enum
+{
+    ASYNC_IDLE = 0,
+    ASYNC_READ_TOKEN,   // waiting for the data token of the next block
+    ASYNC_WRITE_DATA,   // card is ready to receive the next block
+    ASYNC_WRITE_BUSY,   // card programs the received block
+    ASYNC_WRITE_STOP,   // card finalizes multiple blocks write
+} SDCARD_AsyncState;
+
+// number of bytes checked by a single poll while the card is not ready
+#define ASYNC_POLL_BYTES 16
+
 // private members part
 typedef struct
 {
@@ -15,6 +28,16 @@ typedef struct
 
     bool initialized;
     bool busy;
+
+    // asynchronous transfer
+    SDCARD_AsyncState async_state;
+    uint8_t*          async_buffer;
+    uint32_t          async_count;      // blocks left to transfer
+    bool              async_multiple;
+    SDCARD_Status     async_status;     // status of the last completed transfer
+    SDCARD_Callback   async_callback;
+    void*             async_context;
+    bool              async_queued;     // the next step waits in the queue of the bus
 } SDCardInternal;
 
 #define FAT_DRIVES 10
@@ -157,22 +180,10 @@ static HAL_StatusTypeDef ReadResponse(SDCardInternal* sdcard, uint8_t token)
 }
 
 // read data block of given size from SPI protocol.
+// the whole block is received by a single bus transaction
 static HAL_StatusTypeDef ReadData(SDCardInternal* sdcard, uint8_t* buffer, size_t buffer_size)
 {
-    uint8_t transmission_guard = 0xFF;
-    HAL_StatusTypeDef status = HAL_OK;
-    
-    while (buffer_size)
-    {
-        status = SPIBUS_TransmitReceive(sdcard->hspi, &transmission_guard, buffer++, sizeof(uint8_t));
-        if (status != HAL_OK)
-        {
-            break;
-        }
-        
-        --buffer_size;
-    }
-    return status;
+    return SPIBUS_Receive(sdcard->hspi, buffer, buffer_size);
 }
 
 // read data chunk formatted according to SD-MMC spec SPI protocol
@@ -219,9 +230,9 @@ static HAL_StatusTypeDef WaitReady(SDCardInternal* sdcard)
     return status;
 }
 
-// writes single block of data to SD card.
-// return number of bites written
-static size_t WriteSingleDataChunk(SDCardInternal* sdcard, uint8_t token, const uint8_t* data, size_t data_size, uint8_t *respond)
+// sends single block of data to SD card and checks that card accepted it.
+// card is busy after this call, until the block is programmed
+static HAL_StatusTypeDef SendDataChunk(SDCardInternal* sdcard, uint8_t token, const uint8_t* data, size_t data_size, uint8_t *respond)
 {
     HAL_StatusTypeDef status = HAL_OK;
     // data format is: Data token[1], data[512], crc[2]
@@ -229,20 +240,20 @@ static size_t WriteSingleDataChunk(SDCardInternal* sdcard, uint8_t token, const
     status = SPIBUS_Transmit(sdcard->hspi, &token, sizeof(token));
     if (status != HAL_OK)
     {
-        return 0;
+        return status;
     }
     
     status = SPIBUS_Transmit(sdcard->hspi, (uint8_t*)data, data_size);
     if (status != HAL_OK)
     {
-        return 0;
+        return status;
     }
 
     uint8_t crc[2] = {0xFF, 0xFF};    
     status = SPIBUS_Transmit(sdcard->hspi, crc, sizeof(crc));
     if (status != HAL_OK)
     {
-        return 0;
+        return status;
     }
     
     // verify that data received properly
@@ -254,6 +265,18 @@ static size_t WriteSingleDataChunk(SDCardInternal* sdcard, uint8_t token, const
             101 - Data rejected due to CRC error
             110 - Data rejected due to write error
         */
+        return HAL_ERROR;
+    }
+    return HAL_OK;
+}
+
+// writes single block of data to SD card.
+// return number of bites written
+static size_t WriteSingleDataChunk(SDCardInternal* sdcard, uint8_t token, const uint8_t* data, size_t data_size, uint8_t *respond)
+{
+    HAL_StatusTypeDef status = SendDataChunk(sdcard, token, data, data_size, respond);
+    if (status != HAL_OK)
+    {
         return 0;
     }
     //wait write operation to complete
@@ -336,6 +359,12 @@ HSDCARD SDCARD_Configure(HSPIBUS hspi, GPIO_TypeDef* cs_port_array, uint16_t cs_
     sdcard->initialized = false;
     sdcard->busy = false;
 
+    sdcard->async_state = ASYNC_IDLE;
+    sdcard->async_status = SDCARD_OK;
+    sdcard->async_callback = 0;
+    sdcard->async_context = 0;
+    sdcard->async_queued = false;
+
     return (HSDCARD)sdcard;
 }
 
@@ -754,6 +783,262 @@ size_t SDCARD_Write(HSDCARD hsdcard, const uint8_t *buffer, uint32_t sector, uin
     return data_written;
 }
 
+// Asynchronous commands
+// transfer is split to the steps, every poll performs one step and doesn't wait for the card.
+// Command is sent by the start call, each poll checks a few bytes of the card respond or transfers the whole block.
+// The card stays selected from the command to the last block, the transfer holds the transaction of the bus
+static SDCARD_Status CompleteAsync(SDCardInternal* sdcard, SDCARD_Status status)
+{
+    SPIBUS_EndTransaction(sdcard->hspi, sdcard->spi_id);
+    if (SDCARD_OK == status)
+    {
+        sdcard->busy = false;
+    }
+    else
+    {
+        AbortProcedure(sdcard, status);
+    }
+
+    sdcard->async_state = ASYNC_IDLE;
+    sdcard->async_status = status;
+    if (sdcard->async_callback)
+    {
+        sdcard->async_callback((HSDCARD)sdcard, status, sdcard->async_context);
+    }
+    return status;
+}
+
+// reads up to ASYNC_POLL_BYTES from the card, until the non 0xFF byte is received
+static HAL_StatusTypeDef PollRespond(SDCardInternal* sdcard, uint8_t* respond)
+{
+    uint8_t transmission_guard = 0xFF;
+    HAL_StatusTypeDef status = HAL_OK;
+
+    *respond = 0xFF;
+    for (uint32_t i = 0; i < ASYNC_POLL_BYTES && 0xFF == *respond && HAL_OK == status; ++i)
+    {
+        status = SPIBUS_TransmitReceive(sdcard->hspi, &transmission_guard, respond, sizeof(uint8_t));
+    }
+    return status;
+}
+
+static SDCARD_Status PollRead(SDCardInternal* sdcard)
+{
+    uint8_t token = 0xFF;
+    if (HAL_OK != PollRespond(sdcard, &token))
+    {
+        return CompleteAsync(sdcard, SDCARD_CARD_FAILURE);
+    }
+
+    // card still prepares the data
+    if (0xFF == token)
+    {
+        return SDCARD_BUSY;
+    }
+
+    // any other token is the error token
+    if (COMMAND_TOKEN_READ_MULTIPLE_BLOCK != token)
+    {
+        return CompleteAsync(sdcard, SDCARD_CARD_FAILURE);
+    }
+
+    uint16_t crc;
+    if (HAL_OK != ReadData(sdcard, sdcard->async_buffer, sdcard->block_size) ||
+        HAL_OK != ReadData(sdcard, (uint8_t*)&crc, sizeof(crc)))
+    {
+        return CompleteAsync(sdcard, SDCARD_CARD_FAILURE);
+    }
+    sdcard->async_buffer += sdcard->block_size;
+
+    if (--sdcard->async_count)
+    {
+        return SDCARD_BUSY;
+    }
+
+    if (sdcard->async_multiple)
+    {
+        //Stop transmission is R1b command
+        uint8_t r1b = 0;
+        ReturnValueR1 return_value = SendCommand(sdcard, STOP_TRANSMISSION, 0, &r1b);
+        if (return_value.command_status != HAL_OK || return_value.r1 != 0x00)
+        {
+            return CompleteAsync(sdcard, SDCARD_CARD_FAILURE);
+        }
+    }
+    return CompleteAsync(sdcard, SDCARD_OK);
+}
+
+static SDCARD_Status PollWriteData(SDCardInternal* sdcard)
+{
+    uint8_t token = sdcard->async_multiple ? COMMAND_TOKEN_WRITE_MULTIPLE_BLOCK : COMMAND_TOKEN_WRITE_BLOCK;
+    uint8_t respond = 0;
+    if (HAL_OK != SendDataChunk(sdcard, token, sdcard->async_buffer, sdcard->block_size, &respond))
+    {
+        return CompleteAsync(sdcard, ((respond & 0x1F) != 5) ? SDCARD_WRITE_REJECTED : SDCARD_CARD_FAILURE);
+    }
+
+    sdcard->async_buffer += sdcard->block_size;
+    --sdcard->async_count;
+    sdcard->async_state = ASYNC_WRITE_BUSY;
+    return SDCARD_BUSY;
+}
+
+static SDCARD_Status PollWriteBusy(SDCardInternal* sdcard)
+{
+    uint8_t busy_flag = 0;
+    if (HAL_OK != PollRespond(sdcard, &busy_flag))
+    {
+        return CompleteAsync(sdcard, SDCARD_CARD_FAILURE);
+    }
+
+    // card still programs the data
+    if (0xFF != busy_flag)
+    {
+        return SDCARD_BUSY;
+    }
+
+    if (ASYNC_WRITE_STOP == sdcard->async_state || (!sdcard->async_count && !sdcard->async_multiple))
+    {
+        return CompleteAsync(sdcard, SDCARD_OK);
+    }
+
+    if (sdcard->async_count)
+    {
+        return PollWriteData(sdcard);
+    }
+
+    // stop writting data by sending STOP_WRITE_MULTIPLE_BLOCK data token
+    uint8_t stop_transaction = COMMAND_TOKEN_STOP_WRITE_MULTIPLE_BLOCK;
+    uint8_t busy_byte = 0;
+    if (HAL_OK != SPIBUS_Transmit(sdcard->hspi, &stop_transaction, 1) ||
+        HAL_OK != ReadData(sdcard, &busy_byte, 1))
+    {
+        return CompleteAsync(sdcard, SDCARD_CARD_FAILURE);
+    }
+    sdcard->async_state = ASYNC_WRITE_STOP;
+    return SDCARD_BUSY;
+}
+
+static SDCARD_Status StartAsync(SDCardInternal* sdcard, uint8_t command, const uint8_t* buffer, uint32_t sector, uint32_t count, SDCARD_Callback callback, void* context)
+{
+    if (!sdcard || !sdcard->initialized || !sdcard->block_size)
+    {
+        return SDCARD_INCORRECT_STATE;
+    }
+    if (!buffer || !count)
+    {
+        return SDCARD_INVALID_ARGUMENT;
+    }
+    if (sdcard->busy)
+    {
+        return SDCARD_BUSY;
+    }
+    // another device holds the bus
+    if (SPIBUS_FAIL == SPIBUS_BeginTransaction(sdcard->hspi, sdcard->spi_id))
+    {
+        return SDCARD_BUSY;
+    }
+    sdcard->busy = true;
+
+    ReturnValueR1 return_value = SendCommand(sdcard, command, sector, 0);
+    if (return_value.command_status != HAL_OK || return_value.r1 != 0x00)
+    {
+        SPIBUS_EndTransaction(sdcard->hspi, sdcard->spi_id);
+        return AbortProcedure(sdcard, SDCARD_CARD_FAILURE);
+    }
+
+    sdcard->async_buffer   = (uint8_t*)buffer;
+    sdcard->async_count    = count;
+    sdcard->async_callback = callback;
+    sdcard->async_context  = context;
+    return SDCARD_OK;
+}
+
+static HAL_StatusTypeDef PollTransaction(HSPIBUS hspi, void* context);
+
+// the next step of the transfer waits in the queue of the bus, so any device waiting for the bus can complete the transfer by dispatching it
+static bool QueueStep(SDCardInternal* sdcard)
+{
+    SPIBUS_Transaction transaction = { sdcard->spi_id, SPIBUS_PRIORITY_PREFETCH, PollTransaction, sdcard, false, 0 };
+    sdcard->async_queued = (SPIBUS_OK == SPIBUS_Submit(sdcard->hspi, &transaction));
+    return sdcard->async_queued;
+}
+
+SDCARD_Status SDCARD_ReadAsync(HSDCARD hsdcard, uint8_t *buffer, uint32_t sector, uint32_t count, SDCARD_Callback callback, void* context)
+{
+    SDCardInternal* sdcard = (SDCardInternal*)hsdcard;
+    SDCARD_Status status = StartAsync(sdcard, (1 == count) ? READ_SINGLE_BLOCK : READ_MULTIPLE_BLOCK, buffer, sector, count, callback, context);
+    if (SDCARD_OK == status)
+    {
+        sdcard->async_multiple = (1 != count);
+        sdcard->async_state    = ASYNC_READ_TOKEN;
+        QueueStep(sdcard);
+    }
+    return status;
+}
+
+SDCARD_Status SDCARD_WriteAsync(HSDCARD hsdcard, const uint8_t *buffer, uint32_t sector, uint32_t count, SDCARD_Callback callback, void* context)
+{
+    SDCardInternal* sdcard = (SDCardInternal*)hsdcard;
+    SDCARD_Status status = StartAsync(sdcard, (1 == count) ? WRITE_BLOCK : WRITE_MULTIPLE_BLOCK, buffer, sector, count, callback, context);
+    if (SDCARD_OK == status)
+    {
+        sdcard->async_multiple = (1 != count);
+        sdcard->async_state    = ASYNC_WRITE_DATA;
+        QueueStep(sdcard);
+    }
+    return status;
+}
+
+static SDCARD_Status PollStep(SDCardInternal* sdcard)
+{
+    switch (sdcard->async_state)
+    {
+        case ASYNC_READ_TOKEN:
+            return PollRead(sdcard);
+        case ASYNC_WRITE_DATA:
+            return PollWriteData(sdcard);
+        case ASYNC_WRITE_BUSY:
+        case ASYNC_WRITE_STOP:
+            return PollWriteBusy(sdcard);
+        default:
+            return sdcard->async_status;
+    }
+}
+
+// runs nested into the transaction of the transfer, so the card isn't unselected between the steps
+static HAL_StatusTypeDef PollTransaction(HSPIBUS hspi, void* context)
+{
+    SDCardInternal* sdcard = (SDCardInternal*)context;
+    sdcard->async_queued = false;
+    SDCARD_Status status = PollStep(sdcard);
+    if (SDCARD_BUSY == status)
+    {
+        QueueStep(sdcard);
+    }
+    return (SDCARD_OK == status || SDCARD_BUSY == status) ? HAL_OK : HAL_ERROR;
+}
+
+SDCARD_Status SDCARD_Poll(HSDCARD hsdcard)
+{
+    SDCardInternal* sdcard = (SDCardInternal*)hsdcard;
+    if (ASYNC_IDLE == sdcard->async_state)
+    {
+        return sdcard->async_status;
+    }
+
+    if (!sdcard->async_queued && !QueueStep(sdcard))
+    {
+        // the queue is full, the step doesn't wait for it
+        return PollStep(sdcard);
+    }
+
+    // every poll performs a single step, the step of the transfer has the highest priority of the queue.
+    // the call from a running transaction leaves the step to the outer dispatch
+    SPIBUS_Dispatch(sdcard->hspi, 1);
+    return (ASYNC_IDLE == sdcard->async_state) ? sdcard->async_status : SDCARD_BUSY;
+}
+
 // FAT FILE SYSTEM SUPPORT
 SDCARD_Status SDCARD_FAT_Register(HSDCARD hsdcard, uint8_t drive_index)
 {
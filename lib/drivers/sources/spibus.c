@@ -1,31 +1,76 @@
 #include "include/spibus.h"
 #include "include/memory.h"
+#include <string.h>
 
 // private members part
 typedef struct
 {
     GPIO_TypeDef* cs_port_array;
 	uint16_t sc_port;
+    uint8_t  port_index; // index of the chip select port of the device
 } PeripherialDevice;
 
+// chip select pins of all devices on the same port, they are changed by a single write
+typedef struct
+{
+    GPIO_TypeDef* port;
+    uint16_t      mask;
+} ChipSelectPort;
+
+// tracked chip select state, values besides device ids
+enum
+{
+    CS_NONE    = SPIBUS_DeviceLimit, // all chip selects are high
+    CS_UNKNOWN = SPIBUS_FAIL,        // chip selects were not written yet
+};
+
+typedef struct
+{
+    SPIBUS_Transaction transaction;
+    uint32_t           submitted;   // tick of the submission
+    uint32_t           sequence;    // submission order
+} QueuedTransaction;
+
 typedef struct SPIBUS_Internal_type
 {
 	// SD CARD protocol
 	SPI_HandleTypeDef* hspi;
-	PeripherialDevice devices[10];
+	PeripherialDevice devices[SPIBUS_DeviceLimit];
     uint8_t device_count;
+    ChipSelectPort cs_ports[SPIBUS_DeviceLimit];
+    uint8_t cs_ports_count;
+    uint8_t selected;          // device with the low chip select, or CS_NONE, CS_UNKNOWN
+    uint8_t transaction_depth; // nested transactions of the selected device
     uint8_t dma_lines;
     uint32_t timeout;
+
+    // transaction scheduler
+    QueuedTransaction queue[SPIBUS_QueueLimit];
+    uint8_t           queue_size;
+    bool              dispatching;
+    uint32_t          sequence;
+    SPIBUS_Statistics statistics;
 	
 } SPIBus;
 
+// data transmitted by the master while it receives data from the device
+static uint8_t s_receive_guard[SPIBUS_ReceiveChunk];
+
 HSPIBUS SPIBUS_Configure(SPI_HandleTypeDef* hspi, uint32_t timeout)
 {
     SPIBus* spibus = DeviceAlloc(sizeof(SPIBus));
     spibus->hspi = hspi;
     spibus->device_count = 0;
+    spibus->cs_ports_count = 0;
+    spibus->selected = CS_UNKNOWN;
+    spibus->transaction_depth = 0;
     spibus->dma_lines = 0;
     spibus->timeout = timeout;
+    spibus->queue_size = 0;
+    spibus->dispatching = false;
+    spibus->sequence = 0;
+    memset(&spibus->statistics, 0, sizeof(SPIBUS_Statistics));
+    memset(s_receive_guard, 0xFF, sizeof(s_receive_guard));
     
     return (HSPIBUS)spibus;
 }
@@ -46,8 +91,29 @@ uint32_t SPIBUS_AddPeripherialDevice(HSPIBUS hspi, GPIO_TypeDef* cs_port_array,
         return SPIBUS_FAIL;
     }
 #endif
+
+    // group chip select pins by ports
+    uint8_t port_index = 0;
+    while (port_index < spibus->cs_ports_count && spibus->cs_ports[port_index].port != cs_port_array)
+    {
+        ++port_index;
+    }
+    if (port_index == spibus->cs_ports_count)
+    {
+        spibus->cs_ports[port_index].port = cs_port_array;
+        spibus->cs_ports[port_index].mask = 0;
+        ++spibus->cs_ports_count;
+    }
+    spibus->cs_ports[port_index].mask |= GPIO_PIN_MASK(sc_port);
+
     spibus->devices[spibus->device_count].cs_port_array = cs_port_array;
     spibus->devices[spibus->device_count].sc_port = sc_port;
+    spibus->devices[spibus->device_count].port_index = port_index;
+    // the state of the new pin is not known until the next full write
+    if (0 == spibus->transaction_depth)
+    {
+        spibus->selected = CS_UNKNOWN;
+    }
     
     return spibus->device_count++;
 }
@@ -61,8 +127,54 @@ uint32_t SPIBUS_SelectDevice(HSPIBUS hspi, uint32_t id)
         return SPIBUS_FAIL;
     }
 #endif
-    SPIBUS_UnselectAll(hspi);
-	HAL_GPIO_WritePin(spibus->devices[id].cs_port_array, spibus->devices[id].sc_port, GPIO_PIN_RESET);
+    // the bus is owned by the transaction of another device, it is checked in the firmware too
+    // to keep the chip select of the owner low
+    if (spibus->transaction_depth && spibus->selected != id)
+    {
+        return SPIBUS_FAIL;
+    }
+    if (spibus->selected == id)
+    {
+        return id;
+    }
+
+    const PeripherialDevice* device = &spibus->devices[id];
+    uint16_t select_mask = GPIO_PIN_MASK(device->sc_port);
+    if (CS_UNKNOWN == spibus->selected)
+    {
+        // the selected device is enabled by the same write that disables the rest devices on its port
+        for (uint8_t i = 0; i < spibus->cs_ports_count; ++i)
+        {
+            if (i == device->port_index)
+            {
+                HAL_GPIO_WritePort(spibus->cs_ports[i].port, spibus->cs_ports[i].mask & ~select_mask, select_mask);
+            }
+            else
+            {
+                HAL_GPIO_WritePort(spibus->cs_ports[i].port, spibus->cs_ports[i].mask, 0);
+            }
+        }
+    }
+    else if (CS_NONE == spibus->selected)
+    {
+        HAL_GPIO_WritePort(device->cs_port_array, 0, select_mask);
+    }
+    else
+    {
+        // only the previously selected device has to be disabled
+        const PeripherialDevice* previous = &spibus->devices[spibus->selected];
+        uint16_t unselect_mask = GPIO_PIN_MASK(previous->sc_port);
+        if (previous->port_index == device->port_index)
+        {
+            HAL_GPIO_WritePort(device->cs_port_array, unselect_mask & ~select_mask, select_mask);
+        }
+        else
+        {
+            HAL_GPIO_WritePort(previous->cs_port_array, unselect_mask, 0);
+            HAL_GPIO_WritePort(device->cs_port_array, 0, select_mask);
+        }
+    }
+    spibus->selected = (uint8_t)id;
     return id;
 }
 
@@ -75,17 +187,59 @@ uint32_t SPIBUS_UnselectDevice(HSPIBUS hspi, uint32_t id)
         return SPIBUS_FAIL;
     }
 #endif
-	HAL_GPIO_WritePin(spibus->devices[id].cs_port_array, spibus->devices[id].sc_port, GPIO_PIN_SET);
+    if (spibus->selected == id)
+    {
+        // the device stays selected until the end of its transaction
+        if (spibus->transaction_depth)
+        {
+            return id;
+        }
+        spibus->selected = CS_NONE;
+    }
+    else if (CS_UNKNOWN != spibus->selected)
+    {
+        // chip select of the device is already high
+        return id;
+    }
+	HAL_GPIO_WritePort(spibus->devices[id].cs_port_array, GPIO_PIN_MASK(spibus->devices[id].sc_port), 0);
     return id;
 }
 
 void SPIBUS_UnselectAll(HSPIBUS hspi)
 {
     SPIBus* spibus = (SPIBus*)hspi;
-    for (uint8_t i = 0; i < spibus->device_count; ++i)
+    for (uint8_t i = 0; i < spibus->cs_ports_count; ++i)
+    {
+        HAL_GPIO_WritePort(spibus->cs_ports[i].port, spibus->cs_ports[i].mask, 0);
+    }
+    spibus->selected = CS_NONE;
+    spibus->transaction_depth = 0;
+}
+
+uint32_t SPIBUS_BeginTransaction(HSPIBUS hspi, uint32_t id)
+{
+    SPIBus* spibus = (SPIBus*)hspi;
+    if (SPIBUS_FAIL == SPIBUS_SelectDevice(hspi, id))
+    {
+        return SPIBUS_FAIL;
+    }
+    ++spibus->transaction_depth;
+    return id;
+}
+
+uint32_t SPIBUS_EndTransaction(HSPIBUS hspi, uint32_t id)
+{
+    SPIBus* spibus = (SPIBus*)hspi;
+    // unbalanced end would wrap the depth and lock the bus forever
+    if (!spibus->transaction_depth || spibus->selected != id)
     {
-        HAL_GPIO_WritePin(spibus->devices[i].cs_port_array, spibus->devices[i].sc_port, GPIO_PIN_SET);
+        return SPIBUS_FAIL;
+    }
+    if (--spibus->transaction_depth)
+    {
+        return id;
     }
+    return SPIBUS_UnselectDevice(hspi, id);
 }
 
 HAL_StatusTypeDef SPIBUS_SetValue(HSPIBUS hspi, uint8_t* transmit_data, size_t size)
@@ -107,6 +261,139 @@ HAL_StatusTypeDef SPIBUS_TransmitReceive(HSPIBUS hspi, uint8_t* transmit_data, u
     return HAL_SPI_TransmitReceive(spibus->hspi, transmit_data, receive_data, size, spibus->timeout);
 }
 
+HAL_StatusTypeDef SPIBUS_Receive(HSPIBUS hspi, uint8_t* receive_data, size_t size)
+{
+    SPIBus* spibus = (SPIBus*)hspi;
+    HAL_StatusTypeDef status = HAL_OK;
+    while (size && HAL_OK == status)
+    {
+        size_t chunk = (size < SPIBUS_ReceiveChunk) ? size : SPIBUS_ReceiveChunk;
+        status = HAL_SPI_TransmitReceive(spibus->hspi, s_receive_guard, receive_data, chunk, spibus->timeout);
+        receive_data += chunk;
+        size -= chunk;
+    }
+    return status;
+}
+
+// checks if the queued transaction a should run before b
+static bool RunsBefore(const QueuedTransaction* a, const QueuedTransaction* b)
+{
+    if (a->transaction.priority != b->transaction.priority)
+    {
+        return a->transaction.priority > b->transaction.priority;
+    }
+    if (a->transaction.has_deadline != b->transaction.has_deadline)
+    {
+        return a->transaction.has_deadline;
+    }
+    if (a->transaction.has_deadline && a->transaction.deadline != b->transaction.deadline)
+    {
+        // tick counter wraps around
+        return (int32_t)(a->transaction.deadline - b->transaction.deadline) < 0;
+    }
+    return (int32_t)(a->sequence - b->sequence) < 0;
+}
+
+SPIBUS_Status SPIBUS_Submit(HSPIBUS hspi, const SPIBUS_Transaction* transaction)
+{
+    SPIBus* spibus = (SPIBus*)hspi;
+#ifndef FIRMWARE
+    if (!transaction || !transaction->handler || transaction->device >= spibus->device_count || transaction->priority >= SPIBUS_PRIORITIES_COUNT)
+    {
+        return SPIBUS_FAIL;
+    }
+#endif
+    if (spibus->queue_size >= SPIBUS_QueueLimit)
+    {
+        return SPIBUS_FAIL;
+    }
+
+    QueuedTransaction* queued = &spibus->queue[spibus->queue_size++];
+    queued->transaction = *transaction;
+    queued->submitted = HAL_GetTick();
+    queued->sequence = spibus->sequence++;
+
+    spibus->statistics.queue_depth = spibus->queue_size;
+    if (spibus->statistics.max_queue_depth < spibus->queue_size)
+    {
+        spibus->statistics.max_queue_depth = spibus->queue_size;
+    }
+    return SPIBUS_OK;
+}
+
+uint32_t SPIBUS_Dispatch(HSPIBUS hspi, uint32_t max_count)
+{
+    SPIBus* spibus = (SPIBus*)hspi;
+    // transactions submitted by a running handler wait for the next pick of the outer dispatch
+    if (spibus->dispatching)
+    {
+        return 0;
+    }
+    spibus->dispatching = true;
+
+    uint32_t executed = 0;
+    while (spibus->queue_size && (0 == max_count || executed < max_count))
+    {
+        // the queue is short, linear search of the next transaction is cheaper than keeping it sorted
+        uint8_t next = 0;
+        for (uint8_t i = 1; i < spibus->queue_size; ++i)
+        {
+            if (RunsBefore(&spibus->queue[i], &spibus->queue[next]))
+            {
+                next = i;
+            }
+        }
+
+        // the handler may submit new transactions, so the slot is released before the call
+        QueuedTransaction current = spibus->queue[next];
+        spibus->queue[next] = spibus->queue[--spibus->queue_size];
+        spibus->statistics.queue_depth = spibus->queue_size;
+
+        const SPIBUS_Transaction* transaction = &current.transaction;
+        uint32_t start = HAL_GetTick();
+        uint32_t wait = start - current.submitted;
+        spibus->statistics.total_wait[transaction->priority] += wait;
+        if (spibus->statistics.max_wait[transaction->priority] < wait)
+        {
+            spibus->statistics.max_wait[transaction->priority] = wait;
+        }
+        if (transaction->has_deadline && (int32_t)(start - transaction->deadline) > 0)
+        {
+            ++spibus->statistics.missed_deadlines;
+        }
+
+        HAL_StatusTypeDef status = HAL_ERROR;
+        if (SPIBUS_FAIL != SPIBUS_BeginTransaction(hspi, transaction->device))
+        {
+            status = transaction->handler(hspi, transaction->context);
+            SPIBUS_EndTransaction(hspi, transaction->device);
+        }
+        if (HAL_OK != status)
+        {
+            ++spibus->statistics.failed;
+        }
+        ++spibus->statistics.executed[transaction->priority];
+        ++executed;
+    }
+
+    spibus->dispatching = false;
+    return executed;
+}
+
+void SPIBUS_GetStatistics(HSPIBUS hspi, SPIBUS_Statistics* statistics)
+{
+    SPIBus* spibus = (SPIBus*)hspi;
+    *statistics = spibus->statistics;
+}
+
+void SPIBUS_ResetStatistics(HSPIBUS hspi)
+{
+    SPIBus* spibus = (SPIBus*)hspi;
+    memset(&spibus->statistics, 0, sizeof(SPIBUS_Statistics));
+    spibus->statistics.queue_depth = spibus->queue_size;
+    spibus->statistics.max_queue_depth = spibus->queue_size;
+}
+
 /* //Temporary commented out. the functionality is not supported in the initial version
 HAL_StatusTypeDef SPIBUS_TransmitDMA(HSPIBUS hspi, uint8_t* transmit_data, size_t size, size_t lines_count)
 {
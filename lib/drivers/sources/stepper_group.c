@@ -0,0 +1,184 @@
+#include "include/stepper_group.h"
+#include "include/memory.h"
+
+// private members part
+typedef struct
+{
+    uint8_t  count;
+    uint8_t  busy;          // bit mask of motors with active program
+    uint8_t  higher;        // bit mask of motors with PULSE_HIGHER signal type
+
+    // program state, the same as pulse engine state of the single motor in accumulator mode
+    uint32_t programmable_ticks[STEPPER_GROUP_MAX_AXES];
+    uint32_t period[STEPPER_GROUP_MAX_AXES];
+    uint32_t power[STEPPER_GROUP_MAX_AXES];
+    uint32_t tick[STEPPER_GROUP_MAX_AXES];
+    uint32_t error[STEPPER_GROUP_MAX_AXES];
+
+    // ports are used only when the step is done or direction is changed
+    MotorConfig ports[STEPPER_GROUP_MAX_AXES];
+    uint16_t    dir_mask[STEPPER_GROUP_MAX_AXES];
+
+    // step pins of the motors on the same port are changed by a single write
+    GPIO_TypeDef* step_ports[STEPPER_GROUP_MAX_AXES];
+    uint8_t       step_ports_count;
+    uint8_t       step_port_index[STEPPER_GROUP_MAX_AXES];
+    uint16_t      step_mask[STEPPER_GROUP_MAX_AXES];
+} StepperGroupInternal;
+
+HSTEPPERGROUP STEPPERGROUP_Configure(const MotorConfig* configs, uint8_t count)
+{
+#ifndef FIRMWARE
+    if (!configs || 0 == count || count > STEPPER_GROUP_MAX_AXES)
+    {
+        return 0;
+    }
+#endif
+
+    StepperGroupInternal* group = DeviceAlloc(sizeof(StepperGroupInternal));
+    group->count = count;
+    group->busy = 0;
+    group->higher = 0;
+    group->step_ports_count = 0;
+
+    for (uint8_t i = 0; i < count; ++i)
+    {
+        group->ports[i] = configs[i];
+        group->dir_mask[i] = GPIO_PIN_MASK(configs[i].dir_pin);
+        group->step_mask[i] = GPIO_PIN_MASK(configs[i].step_pin);
+
+        uint8_t port_index = 0;
+        while (port_index < group->step_ports_count && group->step_ports[port_index] != configs[i].step_port)
+        {
+            ++port_index;
+        }
+        if (port_index == group->step_ports_count)
+        {
+            group->step_ports[group->step_ports_count++] = configs[i].step_port;
+        }
+        group->step_port_index[i] = port_index;
+
+        group->higher |= (PULSE_HIGHER == configs[i].signal_type) ? (1 << i) : 0;
+
+        group->programmable_ticks[i] = 0;
+        group->period[i] = 1;
+        group->power[i] = 0;
+        group->tick[i] = 0;
+        group->error[i] = 0;
+
+        HAL_GPIO_WritePort(configs[i].step_port, 0, group->step_mask[i]);
+        HAL_GPIO_WritePort(configs[i].dir_port, 0, group->dir_mask[i]);
+    }
+
+    return (HSTEPPERGROUP)group;
+}
+
+void STEPPERGROUP_SetProgram(HSTEPPERGROUP hgroup, uint8_t axis, uint32_t ticks_count, int32_t distance)
+{
+    StepperGroupInternal* group = (StepperGroupInternal*)hgroup;
+
+    // direction pin is set the same way as motor driver does
+    if (distance < 0)
+    {
+        distance *= -1;
+        HAL_GPIO_WritePort(group->ports[axis].dir_port, 0, group->dir_mask[axis]);
+    }
+    else
+    {
+        HAL_GPIO_WritePort(group->ports[axis].dir_port, group->dir_mask[axis], 0);
+    }
+
+    group->programmable_ticks[axis] = ticks_count;
+    group->period[axis] = ticks_count > 0 ? ticks_count : 1;
+    group->power[axis] = distance;
+    group->tick[axis] = 0;
+    group->error[axis] = 0;
+
+    group->busy &= ~(1 << axis);
+    group->busy |= ticks_count > 0 ? (1 << axis) : 0;
+}
+
+uint8_t STEPPERGROUP_HandleTick(HSTEPPERGROUP hgroup)
+{
+    StepperGroupInternal* group = (StepperGroupInternal*)hgroup;
+
+    uint8_t steps = 0;
+    for (uint8_t i = 0; i < group->count; ++i)
+    {
+        if (0 == group->programmable_ticks[i])
+        {
+            continue;
+        }
+
+        // see pulse engine accumulator mode for the details
+        bool step = false;
+        ++group->tick[i];
+        if (group->power[i] >= group->period[i])
+        {
+            step = true;
+        }
+        else if ((group->higher & (1 << i)) && 1 == group->tick[i])
+        {
+            step = group->power[i] > 0;
+        }
+        else
+        {
+            group->error[i] += group->power[i];
+            step = group->error[i] >= group->period[i];
+            if (step)
+            {
+                group->error[i] -= group->period[i];
+            }
+        }
+
+        if (group->tick[i] == group->period[i])
+        {
+            group->tick[i] = 0;
+            group->error[i] = 0;
+        }
+
+        steps |= step ? (1 << i) : 0;
+        if (0 == --group->programmable_ticks[i])
+        {
+            group->busy &= ~(1 << i);
+        }
+    }
+    return steps;
+}
+
+void STEPPERGROUP_Step(HSTEPPERGROUP hgroup, uint8_t step_mask)
+{
+    StepperGroupInternal* group = (StepperGroupInternal*)hgroup;
+    if (!step_mask)
+    {
+        return;
+    }
+
+    uint16_t pins[STEPPER_GROUP_MAX_AXES] = { 0 };
+    for (uint8_t i = 0; i < group->count; ++i)
+    {
+        pins[group->step_port_index[i]] |= (step_mask & (1 << i)) ? group->step_mask[i] : 0;
+    }
+
+    // step requires front signal, so all stepping pins are set and then returned to reset state
+    for (uint8_t i = 0; i < group->step_ports_count; ++i)
+    {
+        if (pins[i])
+        {
+            HAL_GPIO_WritePort(group->step_ports[i], pins[i], 0);
+        }
+    }
+    for (uint8_t i = 0; i < group->step_ports_count; ++i)
+    {
+        if (pins[i])
+        {
+            HAL_GPIO_WritePort(group->step_ports[i], 0, pins[i]);
+        }
+    }
+}
+
+uint8_t STEPPERGROUP_GetBusyMask(HSTEPPERGROUP hgroup)
+{
+    StepperGroupInternal* group = (StepperGroupInternal*)hgroup;
+    return group->busy;
+}
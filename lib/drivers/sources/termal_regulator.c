@@ -4,6 +4,9 @@
 
 #define POWER_REVERT_INDEX 1
 #define OVERTEMPERATURE_PROBE_LIMIT 10
+// flags of the target request, the low half of the request is the target in degrees
+#define REQUEST_TARGET   0x80000000U
+#define REQUEST_AUTOTUNE 0x40000000U
 // private members part
 typedef struct
 {
@@ -15,11 +18,23 @@ typedef struct
 
     int16_t initial_voltage;
     int16_t target_voltage;
-    
-    float angle;
-    float offset;
+    int32_t target_temperature;     // fixed point, as it was set
+
+    // targets are set by the main loop and the timer interrupt while the ADC values come from the DMA interrupt.
+    // The target is requested by a single write and applied by the next ADC value, before the update of the control
+    volatile uint32_t request;
+
+    // calibration of the sensor, the line is converted to the table of its end points
+    const TermalCalibrationPoint* points;
+    uint16_t                      points_count;
+    TermalCalibrationPoint        line[2];
+    int8_t                        sign;     // 1 if the temperature rises with the code, -1 otherwise
 
     HPULSE heatup_regulator;
+    // heater pin is written only when its state is changed
+    uint16_t pin_mask;
+    bool     pin_heating;
+    bool     pin_written;
 
     uint8_t heat_power;
     uint8_t heat_power_min;
@@ -31,6 +46,28 @@ typedef struct
     int8_t  heat_probe_index;
 
     bool temperature_reached;
+
+    TR_MODE mode;
+    TermalRegulatorGains gains;
+
+    // PID state
+    float integral;             // integral part of the output
+    float previous_temperature;
+    bool  has_previous;
+    float residual;             // part of the heat power not applied by the previous update
+
+    // relay autotune state
+    TR_MODE  autotune_return_mode;
+    bool     autotune_heating;
+    uint8_t  autotune_cycles;
+    uint32_t autotune_updates;
+    uint32_t autotune_cycle_start;
+    uint32_t autotune_heating_updates;
+    float    autotune_max;
+    float    autotune_min;
+    float    autotune_amplitude; // sums of the measured oscillations
+    float    autotune_period;
+    float    autotune_duty;
 } TermalRegulator;
 
 static void resetTermalRegulator(TermalRegulator* tr)
@@ -44,25 +81,296 @@ static void resetTermalRegulator(TermalRegulator* tr)
     tr->heat_probe_index = 0;
 }
 
+static int32_t interpolate(int32_t x, int32_t x0, int32_t x1, int32_t y0, int32_t y1)
+{
+    return y0 + (int32_t)((int64_t)(y1 - y0) * (x - x0) / (x1 - x0));
+}
+
+// fixed point temperature of the raw ADC value, the segment of the table is found by the binary search
+static int32_t codeToTemperature(const TermalRegulator* tr, int16_t voltage)
+{
+    const TermalCalibrationPoint* points = tr->points;
+    uint16_t low = 0;
+    uint16_t high = tr->points_count - 1;
+    if (voltage <= points[low].code)
+    {
+        return points[low].temperature;
+    }
+    if (voltage >= points[high].code)
+    {
+        return points[high].temperature;
+    }
+
+    while (high - low > 1)
+    {
+        uint16_t middle = (low + high) / 2;
+        if (voltage < points[middle].code)
+        {
+            high = middle;
+        }
+        else
+        {
+            low = middle;
+        }
+    }
+    return interpolate(voltage, points[low].code, points[high].code, points[low].temperature, points[high].temperature);
+}
+
+// raw ADC value of the fixed point temperature, temperatures of the table are either increasing or decreasing
+static int16_t temperatureToCode(const TermalRegulator* tr, int32_t temperature)
+{
+    const TermalCalibrationPoint* points = tr->points;
+    uint16_t low = 0;
+    uint16_t high = tr->points_count - 1;
+    // the sign turns decreasing temperatures into increasing ones
+    const int32_t sign = tr->sign;
+    int32_t code = 0;
+    if (sign * temperature <= sign * points[low].temperature)
+    {
+        code = points[low].code;
+    }
+    else if (sign * temperature >= sign * points[high].temperature)
+    {
+        code = points[high].code;
+    }
+    else
+    {
+        while (high - low > 1)
+        {
+            uint16_t middle = (low + high) / 2;
+            if (sign * temperature < sign * points[middle].temperature)
+            {
+                high = middle;
+            }
+            else
+            {
+                low = middle;
+            }
+        }
+        code = interpolate(temperature, points[low].temperature, points[high].temperature, points[low].code, points[high].code);
+    }
+    return (int16_t)((code < INT16_MAX) ? code : INT16_MAX);
+}
+
+static float toTemperature(const TermalRegulator* tr, int16_t voltage)
+{
+    return (float)codeToTemperature(tr, voltage) / TERMAL_REGULATOR_TEMPERATURE_SCALE;
+}
+
+static uint16_t toDegrees(int32_t temperature)
+{
+    return (uint16_t)((temperature > 0) ? (temperature >> TERMAL_REGULATOR_TEMPERATURE_SHIFT) : 0);
+}
+
+static bool isTableValid(const TermalCalibrationPoint* table, uint16_t size)
+{
+    if (!table || size < 2 || table[0].temperature == table[1].temperature)
+    {
+        return false;
+    }
+    const bool increasing = table[1].temperature > table[0].temperature;
+    for (uint16_t i = 1; i < size; ++i)
+    {
+        if (table[i].code <= table[i - 1].code || table[i].code > INT16_MAX ||
+            (table[i].temperature > table[i - 1].temperature) != increasing ||
+            table[i].temperature == table[i - 1].temperature)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// output of the PID is converted to the heat power, fraction of the power is carried to the next update
+static uint16_t heatPower(TermalRegulator* tr, float output)
+{
+    float power = output * TERMAL_REGULATOR_HEAT_PERIOD + tr->residual;
+    uint16_t result = (uint16_t)power;
+    result = (result < TERMAL_REGULATOR_HEAT_PERIOD) ? result : TERMAL_REGULATOR_HEAT_PERIOD;
+    tr->residual = power - result;
+    return result;
+}
+
+static uint16_t pidPower(TermalRegulator* tr)
+{
+    const TermalRegulatorGains* gains = &tr->gains;
+    float temperature = toTemperature(tr, tr->current_voltage);
+    float target = (float)tr->target_temperature / TERMAL_REGULATOR_TEMPERATURE_SCALE;
+
+    // derivative of the measurement instead of the error, so the target change doesn't kick the output
+    float error = target - temperature;
+    float change = tr->has_previous ? temperature - tr->previous_temperature : 0;
+    tr->previous_temperature = temperature;
+    tr->has_previous = true;
+
+    float output = gains->feed_forward * target + gains->kp * error + tr->integral - gains->kd * change;
+
+    // anti-windup: the integral isn't accumulated while the output is saturated in the direction of the error
+    if (!(output >= 1.f && error > 0) && !(output <= 0 && error < 0))
+    {
+        tr->integral += gains->ki * error;
+        tr->integral = (tr->integral > 1.f) ? 1.f : ((tr->integral < -1.f) ? -1.f : tr->integral);
+        output += gains->ki * error;
+    }
+    output = (output > 1.f) ? 1.f : ((output < 0) ? 0 : output);
+    return heatPower(tr, output);
+}
+
+static void applyTarget(TermalRegulator* tr, uint16_t value)
+{
+    tr->target_temperature = (int32_t)value << TERMAL_REGULATOR_TEMPERATURE_SHIFT;
+    tr->target_voltage = temperatureToCode(tr, tr->target_temperature);
+    tr->initial_voltage = tr->current_voltage;
+    tr->backet_size = 0;
+    tr->intermediate_voltage = 0;
+    tr->temperature_reached = false;
+    tr->integral = 0;
+
+    // new target cancels the autotune
+    if (TR_MODE_AUTOTUNE == tr->mode)
+    {
+        tr->mode = tr->autotune_return_mode;
+    }
+    
+    resetTermalRegulator(tr);
+}
+
+static void completeAutotune(TermalRegulator* tr)
+{
+    const uint8_t cycles = tr->autotune_cycles ? tr->autotune_cycles - 1 : 0;
+    if (cycles && tr->autotune_amplitude > 0)
+    {
+        // relay switches the output by 1, its amplitude is 1/2. Ultimate gain and period of the oscillations give
+        // the gains by Tyreus-Luyben rule, it has a small overshoot. Steady power at the tuned temperature gives
+        // the feed-forward
+        const float pi = 3.14159265f;
+        float ultimate_gain = 4.f * 0.5f * cycles / (pi * tr->autotune_amplitude);
+        float ultimate_period = tr->autotune_period / cycles;
+        float target = (float)tr->target_temperature / TERMAL_REGULATOR_TEMPERATURE_SCALE;
+
+        tr->gains.kp = 0.45f * ultimate_gain;
+        tr->gains.ki = tr->gains.kp / (2.2f * ultimate_period);
+        tr->gains.kd = tr->gains.kp * ultimate_period / 6.3f;
+        tr->gains.feed_forward = (target > 0) ? tr->autotune_duty / cycles / target : 0;
+        tr->mode = TR_MODE_PID;
+    }
+    else
+    {
+        tr->mode = tr->autotune_return_mode;
+    }
+    applyTarget(tr, 0);
+}
+
+static uint16_t autotunePower(TermalRegulator* tr)
+{
+    float temperature = toTemperature(tr, tr->current_voltage);
+    float target = (float)tr->target_temperature / TERMAL_REGULATOR_TEMPERATURE_SCALE;
+    ++tr->autotune_updates;
+    tr->autotune_max = (temperature > tr->autotune_max) ? temperature : tr->autotune_max;
+    tr->autotune_min = (temperature < tr->autotune_min) ? temperature : tr->autotune_min;
+
+    if (tr->autotune_heating && temperature > target + TERMAL_REGULATOR_AUTOTUNE_HYSTERESIS)
+    {
+        tr->autotune_heating = false;
+    }
+    else if (!tr->autotune_heating && temperature < target - TERMAL_REGULATOR_AUTOTUNE_HYSTERESIS)
+    {
+        // the cycle is completed by the heater switch on, the first cycle includes the heat up and isn't measured
+        if (tr->autotune_cycles)
+        {
+            float period = (float)(tr->autotune_updates - tr->autotune_cycle_start);
+            tr->autotune_amplitude += (tr->autotune_max - tr->autotune_min) / 2;
+            tr->autotune_period += period;
+            tr->autotune_duty += tr->autotune_heating_updates / period;
+        }
+        ++tr->autotune_cycles;
+        tr->autotune_cycle_start = tr->autotune_updates;
+        tr->autotune_heating_updates = 0;
+        tr->autotune_max = tr->autotune_min = temperature;
+        tr->autotune_heating = true;
+    }
+
+    if (tr->autotune_cycles > TERMAL_REGULATOR_AUTOTUNE_CYCLES || tr->autotune_updates >= TERMAL_REGULATOR_AUTOTUNE_LIMIT)
+    {
+        completeAutotune(tr);
+        return 0;
+    }
+
+    tr->autotune_heating_updates += tr->autotune_heating ? 1 : 0;
+    return tr->autotune_heating ? TERMAL_REGULATOR_HEAT_PERIOD : 0;
+}
+
+// the target of the autotune is applied already
+static void startAutotune(TermalRegulator* tr)
+{
+    tr->autotune_return_mode = tr->mode;
+    tr->mode = TR_MODE_AUTOTUNE;
+    tr->autotune_heating = true;
+    tr->autotune_cycles = 0;
+    tr->autotune_updates = 0;
+    tr->autotune_cycle_start = 0;
+    tr->autotune_heating_updates = 0;
+    tr->autotune_max = tr->autotune_min = toTemperature(tr, tr->current_voltage);
+    tr->autotune_amplitude = 0;
+    tr->autotune_period = 0;
+    tr->autotune_duty = 0;
+}
+
 HTERMALREGULATOR TR_Configure(TermalRegulatorConfig* config)
 {
-    if (!config || (config->line_angle < 0.00001f && config->line_angle > -0.00001f))
+    if (!config)
+    {
+        return 0;
+    }
+    if (config->table ? !isTableValid(config->table, config->table_size) :
+        (config->line_angle < 0.00001f && config->line_angle > -0.00001f))
     {
         return 0;
     }
     TermalRegulator* tr = (TermalRegulator*)DeviceAlloc(sizeof(TermalRegulator));
     tr->config = *config;
+    if (!tr->config.backet_capacity)
+    {
+        tr->config.backet_capacity = TERMAL_REGULATOR_BACKET_SIZE;
+    }
     tr->current_voltage = 0;
     tr->backet_size = 0;
+    tr->target_voltage = 0;
+    tr->target_temperature = 0;
+    tr->request = 0;
 
     tr->temperature_reached = false;
-    tr->angle = config->line_angle;
-    tr->offset = config->line_offset;
+    if (config->table)
+    {
+        tr->points = config->table;
+        tr->points_count = config->table_size;
+    }
+    else
+    {
+        // the line is evaluated once, the conversions interpolate between its ends
+        const float scale = TERMAL_REGULATOR_TEMPERATURE_SCALE;
+        tr->line[0].code = 0;
+        tr->line[0].temperature = (int32_t)(config->line_offset * scale);
+        tr->line[1].code = INT16_MAX;
+        tr->line[1].temperature = (int32_t)((config->line_angle * INT16_MAX + config->line_offset) * scale);
+        tr->points = tr->line;
+        tr->points_count = 2;
+    }
+    tr->sign = (tr->points[tr->points_count - 1].temperature > tr->points[0].temperature) ? 1 : -1;
 
     tr->heatup_regulator = PULSE_Configure(PULSE_HIGHER);
+    tr->pin_mask = GPIO_PIN_MASK(config->pin);
+    tr->pin_heating = false;
+    tr->pin_written = false;
     
     PULSE_SetPeriod(tr->heatup_regulator, TERMAL_REGULATOR_HEAT_PERIOD);
 
+    tr->mode = TR_MODE_STEPPING;
+    TermalRegulatorGains gains = { 0 };
+    tr->gains = gains;
+    tr->has_previous = false;
+    tr->residual = 0;
+
     resetTermalRegulator(tr);
 
     return (HTERMALREGULATOR)tr;
@@ -71,43 +379,50 @@ HTERMALREGULATOR TR_Configure(TermalRegulatorConfig* config)
 void TR_SetTargetTemperature(HTERMALREGULATOR htr, uint16_t value)
 {
     TermalRegulator* tr = (TermalRegulator*)htr;
-    tr->target_voltage = (int16_t)((value - tr->offset)/tr->angle);
-    tr->initial_voltage = tr->current_voltage;
-    tr->backet_size = 0;
-    tr->intermediate_voltage = 0;
-    tr->temperature_reached = false;
-    
-    resetTermalRegulator(tr);
+    tr->request = REQUEST_TARGET | value;
 }
 
 uint16_t TR_GetTargetTemperature(HTERMALREGULATOR htr)
 {
     TermalRegulator* tr = (TermalRegulator*)htr;
-    return (uint16_t)(tr->angle * tr->target_voltage + tr->offset);
+    uint32_t request = tr->request;
+    return (request & REQUEST_TARGET) ? (uint16_t)request : toDegrees(tr->target_temperature);
 }
 
 uint16_t TR_GetCurrentTemperature(HTERMALREGULATOR htr)
 {
     TermalRegulator* tr = (TermalRegulator*)htr;
-    float result = tr->angle * tr->current_voltage + tr->offset;
-    return (uint16_t)(result > 0 ? result : 0);
+    return toDegrees(codeToTemperature(tr, tr->current_voltage));
 }
 
 void TR_SetADCValue(HTERMALREGULATOR htr, uint16_t value)
 {
     TermalRegulator* tr = (TermalRegulator*)htr;
 
+    // the interrupts setting the target have the same priority as the DMA interrupt, so they don't preempt it
+    uint32_t request = tr->request;
+    if (request)
+    {
+        tr->request = 0;
+        applyTarget(tr, (uint16_t)request);
+        if (request & REQUEST_AUTOTUNE)
+        {
+            startAutotune(tr);
+        }
+    }
+
     tr->intermediate_voltage += value;
     ++tr->backet_size;
-    if (TERMAL_REGULATOR_BACKET_SIZE != tr->backet_size)
+    if (tr->config.backet_capacity != tr->backet_size)
     {
         return;
     }
 
-    // once backet size is full start processing of the temperature
-    int16_t delta = (tr->intermediate_voltage / TERMAL_REGULATOR_BACKET_SIZE) - tr->current_voltage;
+    // once backet size is full start processing of the temperature. The stepping compares the codes multiplied
+    // by the sign, so the delta is positive and the current is below the target while the heater is heating
+    int16_t delta = tr->sign * ((tr->intermediate_voltage / tr->config.backet_capacity) - tr->current_voltage);
 
-    tr->current_voltage = tr->intermediate_voltage / TERMAL_REGULATOR_BACKET_SIZE;
+    tr->current_voltage = tr->intermediate_voltage / tr->config.backet_capacity;
     tr->backet_size = 0;
     tr->intermediate_voltage = 0;
     if (!tr->initial_voltage)
@@ -119,8 +434,14 @@ void TR_SetADCValue(HTERMALREGULATOR htr, uint16_t value)
     tr->temperature_reached = tr->temperature_reached ||
         ((tr->current_voltage - tr->target_voltage) * (tr->initial_voltage - tr->target_voltage) <= 0);
 
+    if (TR_MODE_STEPPING != tr->mode)
+    {
+        PULSE_SetPower(tr->heatup_regulator, (TR_MODE_PID == tr->mode) ? pidPower(tr) : autotunePower(tr));
+        return;
+    }
+
     uint16_t power = 0;
-    if (tr->current_voltage < tr->target_voltage)
+    if (tr->sign * tr->current_voltage < tr->sign * tr->target_voltage)
     {
         power = tr->heat_power;
 
@@ -199,18 +520,63 @@ void TR_SetADCValue(HTERMALREGULATOR htr, uint16_t value)
 void TR_HandleTick(HTERMALREGULATOR htr)
 {
     TermalRegulator* tr = (TermalRegulator*)htr;
-    GPIO_PinState state = (PULSE_HandleTick(tr->heatup_regulator)) ? tr->config.heat_value : tr->config.cool_value;
-    HAL_GPIO_WritePin(tr->config.port, tr->config.pin, state);
+    bool heating = PULSE_HandleTick(tr->heatup_regulator);
+    if (tr->pin_written && heating == tr->pin_heating)
+    {
+        return;
+    }
+
+    GPIO_PinState state = heating ? tr->config.heat_value : tr->config.cool_value;
+    uint16_t set_mask = (GPIO_PIN_SET == state) ? tr->pin_mask : 0;
+    HAL_GPIO_WritePort(tr->config.port, set_mask, tr->pin_mask & ~set_mask);
+    tr->pin_heating = heating;
+    tr->pin_written = true;
 }
 
 bool TR_IsTemperatureReached(HTERMALREGULATOR htr)
 {
     TermalRegulator* tr = (TermalRegulator*)htr;
-    return tr->temperature_reached;
+    return !(tr->request & REQUEST_TARGET) && tr->temperature_reached;
 }
 
 bool TR_IsHeaterStabilized(HTERMALREGULATOR htr)
 {
     TermalRegulator* tr = (TermalRegulator*)htr;
-    return (tr->heat_power - tr->heat_power_min > 0) && (tr->cool_power_max - tr->cool_power > 0);
+    return !(tr->request & REQUEST_TARGET) && (tr->heat_power - tr->heat_power_min > 0) && (tr->cool_power_max - tr->cool_power > 0);
+}
+
+void TR_SetGains(HTERMALREGULATOR htr, const TermalRegulatorGains* gains)
+{
+    TermalRegulator* tr = (TermalRegulator*)htr;
+    tr->gains = *gains;
+    tr->integral = 0;
+    tr->mode = TR_MODE_PID;
+}
+
+void TR_GetGains(HTERMALREGULATOR htr, TermalRegulatorGains* gains)
+{
+    TermalRegulator* tr = (TermalRegulator*)htr;
+    *gains = tr->gains;
+}
+
+TR_MODE TR_GetMode(HTERMALREGULATOR htr)
+{
+    TermalRegulator* tr = (TermalRegulator*)htr;
+    uint32_t request = tr->request;
+    if (request & REQUEST_AUTOTUNE)
+    {
+        return TR_MODE_AUTOTUNE;
+    }
+    // the requested target cancels the running autotune
+    if ((request & REQUEST_TARGET) && TR_MODE_AUTOTUNE == tr->mode)
+    {
+        return tr->autotune_return_mode;
+    }
+    return tr->mode;
+}
+
+void TR_StartAutotune(HTERMALREGULATOR htr, uint16_t temperature)
+{
+    TermalRegulator* tr = (TermalRegulator*)htr;
+    tr->request = REQUEST_TARGET | REQUEST_AUTOTUNE | temperature;
 }
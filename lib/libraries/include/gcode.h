@@ -38,6 +38,7 @@ typedef enum
     GCODE_WAIT_TABLE,
     GCODE_SET_COOLER_SPEED,
     GCODE_START_RESUME,
+    GCODE_AUTOTUNE,             // M303 S<temperature> P<regulator>, P0 is the nozzle, P1 is the table
     GCODE_SUBCOMMAND_COUNT,
 } GCODE_SUBCOMMAND_LIST;
 
@@ -60,6 +61,7 @@ enum GCODE_ERROR_Type
     GCODE_ERROR_INVALID_PARAM,
     GCODE_ERROR_UNKNOWN_PARAM,
     GCODE_ERROR_UNKNOWN_COMMAND,
+    GCODE_ERROR_LINE_TOO_LONG,
     GCODE_ERROR_UNKNOWN,
 } ;
 
@@ -101,6 +103,42 @@ typedef struct GCodeFunctionList_type
 //number of elements. so chunk size is bigger than both commands.
 #define GCODE_CHUNK_SIZE 32U
 
+// maximal length of the command part of the single gcode line.
+// lines that cross the boundary of the input buffer are collected in the parser
+// carry buffer of this size, so the same limit is applied to all lines.
+// comment that crosses the limit is truncated, the line fails only if the command doesn't fit
+#define GCODE_LINE_LENGTH 128U
+
+// number of 32 bit parameters that follow the command code in the chunk
+#define GCODE_CHUNK_PARAMS ((GCODE_CHUNK_SIZE - sizeof(parameterType)) / sizeof(parameterType))
+
+/// <summary>
+/// Storage formats of the compiled gcode commands
+/// </summary>
+typedef enum
+{
+    GCODE_FORMAT_CHUNKS = 0,    // every command occupies GCODE_CHUNK_SIZE bytes
+    GCODE_FORMAT_COMPACT,       // variable length delta encoded commands
+} GCODE_STORAGE_FORMAT;
+
+// Compact command layout:
+//  byte 0:   command type in high bit (0 - command, 1 - subcommand) and command index
+//  byte 1:   presence bitmask, bit N is set if parameter N is stored
+//  payload:  present parameters in order. parameters are stored as zigzag varint of the difference
+//            with the same parameter of the previous command of the same type.
+//            the last parameter of the command is stored as is, in 4 bytes without delta and
+//            it is zero if not present, so it can be updated after the command is encoded.
+// Every sector starts with the number of commands in it, delta state is reset at the sector start,
+// so each sector can be decoded independently
+#define GCODE_COMPACT_SECTOR_HEADER 1U
+#define GCODE_COMPACT_MAX_SIZE      (2U + (GCODE_CHUNK_PARAMS - 1U) * 5U + sizeof(uint32_t))
+
+typedef struct GCodeCompactState_type
+{
+    parameterType command[GCODE_CHUNK_PARAMS];      // parameters of the previous command
+    parameterType subcommand[GCODE_CHUNK_PARAMS];   // parameters of the previous subcommand
+} GCodeCompactState;
+
 typedef struct GCodeAxisConfig_type
 {
     parameterType x_steps_per_mm;
@@ -111,16 +149,91 @@ typedef struct GCodeAxisConfig_type
 
 typedef GCode_Type* HGCODE;
 
+/// <summary>
+/// Modal state of the parser that is carried from line to line.
+/// Allows to continue parsing of the stream from any line if the state at this line is known
+/// </summary>
+typedef struct GCodeParserState_type
+{
+    GCodeCommandParams      g;              // current position and fetch speed
+    GCodeSubCommandParams   m;              // last subcommand parameters
+    GCODE_COODRINATES_MODE  motion_mode;
+    GCODE_COODRINATES_MODE  extrusion_mode;
+} GCodeParserState;
+
+/// <summary>
+/// Block of the text data (usually a sector of the file) to be parsed in place.
+/// Line endings are replaced by string terminators inside the block, so lines 
+/// that completely fit in the block are parsed without copying
+/// </summary>
+typedef struct GCodeBuffer_type
+{
+    char*       data;           // text data, modified by the parser
+    uint32_t    size;           // amount of valid bytes in data
+    uint32_t    caret;          // current parsing position, advanced by the parser
+    bool        end_of_stream;  // last block of the stream, unterminated line at the end is parsed as is
+    const char* line;           // last parsed line, valid until the next call to the parser
+} GCodeBuffer;
+
 HGCODE                  GC_Configure(const GCodeAxisConfig* config, uint16_t max_fetch_speed);
 void                    GC_Reset(HGCODE hcode, const GCodeCommandParams* initial_state);
 //parser
 GCODE_ERROR             GC_ParseCommand(HGCODE hcode, const char* command_line);
+void                    GC_SaveState(HGCODE hcode, GCodeParserState* state);
+
+/// <summary>
+/// Resets the parser like GC_Reset does, but restores the complete modal state instead of the initial one
+/// </summary>
+/// <param name="hcode">handle to the gcode parser</param>
+/// <param name="state">state saved by GC_SaveState</param>
+void                    GC_RestoreState(HGCODE hcode, const GCodeParserState* state);
+
+/// <summary>
+/// Parses the block of text data and compresses all produced commands directly into the output buffer.
+/// Line that is not finished at the end of the block is kept in the parser and completed on the next call
+/// </summary>
+/// <param name="hcode">handle to the gcode parser</param>
+/// <param name="input">block of text data to be parsed</param>
+/// <param name="output">buffer for compressed commands</param>
+/// <param name="output_size">size of the output buffer, at least GCODE_CHUNK_SIZE</param>
+/// <param name="bytes_written">amount of bytes written to the output buffer</param>
+/// <returns>GCODE_OK_COMMAND_CREATED if output is full and parsing should be continued with the same input,
+/// GCODE_OK_NO_COMMAND if whole input is consumed, parsing error otherwise. In case of error input->line points to the invalid line</returns>
+GCODE_ERROR             GC_ParseBuffer(HGCODE hcode, GCodeBuffer* input, uint8_t* output, uint32_t output_size, uint32_t* bytes_written);
 
 //compressor and validator
 uint32_t                GC_CompressCommand(HGCODE hcode, uint8_t* buffer);
+/// <summary>
+/// Maps number of the G command to the compiled command
+/// </summary>
+/// <param name="number">number of the G command, e.g. 28 for G28</param>
+/// <returns>index of the compiled command, GCODE_COMMAND_COUNT if the command isn't stored</returns>
+uint32_t                GC_GetCommandIndex(uint32_t number);
 GCodeCommandParams*     GC_DecompileFromBuffer(uint8_t* buffer, GCODE_COMMAND_LIST* out_command_id); // Unsafe
 GCODE_COMMAND_STATE     GC_ExecuteFromBuffer(GCodeFunctionList* functions, void* additional_parameter, const uint8_t* buffer);
 
+//compact storage format
+void                    GC_ResetCompact(GCodeCompactState* state);
+
+/// <summary>
+/// Encodes command chunk to the compact format
+/// </summary>
+/// <param name="state">delta encoding state</param>
+/// <param name="chunk">command in GCODE_CHUNK_SIZE format</param>
+/// <param name="buffer">output buffer, at least GCODE_COMPACT_MAX_SIZE bytes</param>
+/// <param name="raw_param">[out] position of the last command parameter in the buffer or nullptr if it is not stored</param>
+/// <returns>size of the encoded command</returns>
+uint32_t                GC_EncodeCompact(GCodeCompactState* state, const uint8_t* chunk, uint8_t* buffer, uint8_t** raw_param);
+
+/// <summary>
+/// Decodes compact command to the command chunk
+/// </summary>
+/// <param name="state">delta encoding state</param>
+/// <param name="buffer">encoded command</param>
+/// <param name="chunk">output GCODE_CHUNK_SIZE buffer</param>
+/// <returns>size of the encoded command</returns>
+uint32_t                GC_DecodeCompact(GCodeCompactState* state, const uint8_t* buffer, uint8_t* chunk);
+
 //diagnostics
 parameterType           GC_GetCurrentCommandCode(HGCODE hcode);
 GCodeCommandParams*     GC_GetCurrentCommand(HGCODE hcode);
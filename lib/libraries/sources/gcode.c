@@ -10,7 +10,8 @@
 
 typedef struct
 {
-    parameterType           code;
+    parameterType           code;       // command type and the low byte of the number
+    parameterType           number;     // number of the G or M command, it can exceed the low byte, e.g. M303
     GCodeCommandParams      g;
     GCodeSubCommandParams   m;
 } GCodeCommand;
@@ -22,6 +23,8 @@ typedef struct
     GCodeCommand            command;
     GCODE_COODRINATES_MODE  motion_mode;
     GCODE_COODRINATES_MODE  extrusion_mode;
+    char                    carry[GCODE_LINE_LENGTH + 1]; // line that crosses the boundary of the input buffer
+    uint32_t                carry_size;
 } GCode;
 
 static const char* trimSpaces(const char* command_line)
@@ -33,36 +36,55 @@ static const char* trimSpaces(const char* command_line)
     return command_line;
 }
 
+// fractional part of the value is kept as fixed point number with this amount of digits.
+// the rest of digits is ignored
+#define GCODE_FRACTION_DIGITS 9
+
+static const uint32_t s_decimal_scale[GCODE_FRACTION_DIGITS + 1] =
+{
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+static bool isValueSymbol(char symbol)
+{
+    return symbol && symbol != ' ' && symbol != '\r' && symbol != '\n';
+}
+
 //simple atof introduce 5kb of new code, that i cannot afford. lets replace it by home brewed function
+//value is parsed as integer and fixed point fraction and converted to steps with rounding to the nearest step
 static const char* parseValue(const char* command_line, parameterType multiplier, parameterType* value)
 {
-    parameterType sign = 1;
-    float result = 0;
+    bool negative = false;
     if ('-' == *command_line)
     {
-        sign = -1;
+        negative = true;
         command_line++;
     }
     else if ('+' == *command_line)
     {
         ++command_line;
     }
-    
-    for (; (*command_line && *command_line != ' ' && *command_line != '\r' && *command_line != '\n'); ++command_line)
+
+    uint32_t integer = 0;
+    for (; isValueSymbol(*command_line); ++command_line)
     {
         if (*command_line == '.')
         {
             ++command_line;
             break;
         }
-        result = result * 10 + (*command_line - '0');
+        integer = integer * 10 + (*command_line - '0');
     }
 
-    float divider = 10.f;
-    for (; (*command_line && *command_line != ' ' && *command_line != '\r' && *command_line != '\n'); ++command_line)
+    uint32_t fraction = 0;
+    uint8_t  digits   = 0;
+    for (; isValueSymbol(*command_line); ++command_line)
     {
-        result = result + (*command_line - '0') / divider;
-        divider *= 10.f;
+        if (digits < GCODE_FRACTION_DIGITS)
+        {
+            fraction = fraction * 10 + (*command_line - '0');
+            ++digits;
+        }
     }
 
     if (*command_line)
@@ -70,7 +92,20 @@ static const char* parseValue(const char* command_line, parameterType multiplier
         ++command_line;
     }
 
-    *value = (parameterType)(sign * result * multiplier);
+    // fraction of the step is rounded to the nearest step. usual gcode values have up to 5 fractional digits 
+    // and product fits 32 bits, otherwise 64 bits is required: fraction is less than 10^9 and multiplier is less than 2^16
+    uint32_t scale = s_decimal_scale[digits];
+    uint32_t steps = integer * multiplier;
+    if (multiplier && fraction <= (UINT32_MAX - scale / 2) / (uint32_t)multiplier)
+    {
+        steps += (fraction * multiplier + scale / 2) / scale;
+    }
+    else
+    {
+        steps += (uint32_t)(((uint64_t)fraction * (uint32_t)multiplier + scale / 2) / scale);
+    }
+
+    *value = negative ? -(parameterType)steps : (parameterType)steps;
     return trimSpaces(command_line);
 }
 
@@ -78,7 +113,8 @@ static const char* parseCommand(GCodeCommand* command, GCODE_COMMAND_TYPE comman
 {
     parameterType command_index = 0;
     command_line = parseValue(command_line, 1, &command_index);
-    command->code = (parameterType)(command_type | command_index);
+    command->number = command_index;
+    command->code   = (parameterType)(command_type | (command_index & 0x00FF));
 
     return command_line;
 }
@@ -188,6 +224,29 @@ void GC_Reset(HGCODE hcode, const GCodeCommandParams* initial_state)
     gcode->command.m        = m;
     gcode->motion_mode      = GCODE_ABSOLUTE;
     gcode->extrusion_mode   = GCODE_ABSOLUTE;
+    gcode->carry_size       = 0;
+    gcode->carry[0]         = 0;
+}
+
+void GC_SaveState(HGCODE hcode, GCodeParserState* state)
+{
+    GCode* gcode = (GCode*)hcode;
+    state->g                = gcode->command.g;
+    state->m                = gcode->command.m;
+    state->motion_mode      = gcode->motion_mode;
+    state->extrusion_mode   = gcode->extrusion_mode;
+}
+
+void GC_RestoreState(HGCODE hcode, const GCodeParserState* state)
+{
+    GCode* gcode = (GCode*)hcode;
+    gcode->command.code     = GCODE_COMMAND_NOOP;
+    gcode->command.g        = state->g;
+    gcode->command.m        = state->m;
+    gcode->motion_mode      = state->motion_mode;
+    gcode->extrusion_mode   = state->extrusion_mode;
+    gcode->carry_size       = 0;
+    gcode->carry[0]         = 0;
 }
 
 GCODE_ERROR GC_ParseCommand(HGCODE hcode, const char* command_line)
@@ -205,8 +264,8 @@ GCODE_ERROR GC_ParseCommand(HGCODE hcode, const char* command_line)
         {
             // HOME command is always absolute motion and relative extrusion. 
             // It disregards motion and extrusion settings
-            bool absolute_motion    = (GCODE_ABSOLUTE == gcode->motion_mode)    || CMD_HOME == (gcode->command.code & 0xFF);
-            bool relative_extrusion = (GCODE_RELATIVE == gcode->extrusion_mode) || CMD_HOME == (gcode->command.code & 0xFF);
+            bool absolute_motion    = (GCODE_ABSOLUTE == gcode->motion_mode)    || CMD_HOME == gcode->command.number;
+            bool relative_extrusion = (GCODE_RELATIVE == gcode->extrusion_mode) || CMD_HOME == gcode->command.number;
 
             GCodeCommandParams g_param = (absolute_motion) ? gcode->command.g : zero_command;
 
@@ -274,6 +333,110 @@ GCODE_ERROR GC_ParseCommand(HGCODE hcode, const char* command_line)
     return result;
 }
 
+// true if the command part of the line ends within the limit, the rest of the line is a comment
+static bool isCommentCut(const char* line, uint32_t size)
+{
+    return 0 != memchr(line, ';', (size < GCODE_LINE_LENGTH) ? size : GCODE_LINE_LENGTH);
+}
+
+// appends part of the line to the carry buffer, line is truncated if it doesn't fit.
+// Truncated comment doesn't fail the line, only the command text has to fit
+static bool appendCarry(GCode* gcode, const char* data, uint32_t size)
+{
+    bool fits = (gcode->carry_size + size <= GCODE_LINE_LENGTH);
+    if (!fits)
+    {
+        size = GCODE_LINE_LENGTH - gcode->carry_size;
+    }
+    memcpy(gcode->carry + gcode->carry_size, data, size);
+    fits = fits || isCommentCut(gcode->carry, gcode->carry_size + size);
+    gcode->carry_size += size;
+    gcode->carry[gcode->carry_size] = 0;
+    return fits;
+}
+
+GCODE_ERROR GC_ParseBuffer(HGCODE hcode, GCodeBuffer* input, uint8_t* output, uint32_t output_size, uint32_t* bytes_written)
+{
+#ifndef FIRMWARE
+    if (!hcode || !input || !output || !bytes_written)
+    {
+        return GCODE_ERROR_UNKNOWN;
+    }
+#endif
+    GCode* gcode = (GCode*)hcode;
+    *bytes_written = 0;
+
+    while (input->caret < input->size || (input->end_of_stream && gcode->carry_size))
+    {
+        // check the space before the line is consumed, so parsing can be continued from the same place
+        if (output_size - *bytes_written < GCODE_CHUNK_SIZE)
+        {
+            return GCODE_OK_COMMAND_CREATED;
+        }
+
+        char*    line_start  = input->data + input->caret;
+        uint32_t bytes_left  = input->size - input->caret;
+        char*    line_end    = memchr(line_start, '\n', bytes_left);
+        uint32_t line_length = line_end ? (uint32_t)(line_end - line_start) : bytes_left;
+
+        input->caret += line_length;
+        if (!line_end && !input->end_of_stream)
+        {
+            // line continues in the next block
+            if (!appendCarry(gcode, line_start, line_length))
+            {
+                gcode->carry_size = 0;
+                input->line = gcode->carry;
+                return GCODE_ERROR_LINE_TOO_LONG;
+            }
+            continue;
+        }
+
+        const char* line = line_start;
+        if (line_end)
+        {
+            *line_end = 0;
+            ++input->caret;
+        }
+
+        if (gcode->carry_size || !line_end)
+        {
+            // the only line that requires copying: beginning of it is in the previous block or
+            // it is the last line of the stream that has no terminator
+            bool fits = appendCarry(gcode, line_start, line_length);
+            line = gcode->carry;
+            line_length = gcode->carry_size;
+            gcode->carry_size = 0;
+            if (!fits)
+            {
+                input->line = line;
+                return GCODE_ERROR_LINE_TOO_LONG;
+            }
+        }
+
+        input->line = line;
+        if (line_length > GCODE_LINE_LENGTH && !isCommentCut(line, line_length))
+        {
+            return GCODE_ERROR_LINE_TOO_LONG;
+        }
+
+        GCODE_ERROR result = GC_ParseCommand(hcode, line);
+        if (GCODE_OK_NO_COMMAND == result)
+        {
+            continue;
+        }
+
+        if (GCODE_OK_COMMAND_CREATED != result)
+        {
+            return result;
+        }
+
+        *bytes_written += GC_CompressCommand(hcode, output + *bytes_written);
+    }
+
+    return GCODE_OK_NO_COMMAND;
+}
+
 parameterType GC_GetCurrentCommandCode(HGCODE hcode)
 {
     GCode* gcode = (GCode*)hcode;
@@ -306,6 +469,25 @@ GCodeAxisConfig* GC_GetAxisConfig(HGCODE hcode)
     return &gcode->cfg;
 }
 
+uint32_t GC_GetCommandIndex(uint32_t number)
+{
+    switch (number)
+    {
+    case 0:
+    case 1:
+        return GCODE_MOVE;
+    case 28:
+        return GCODE_HOME;
+    case 60:
+        return GCODE_SAVE_POSITION;
+    case 92:
+        return GCODE_SET;
+    case 99:
+        return GCODE_SAVE_STATE;
+    }
+    return GCODE_COMMAND_COUNT;
+}
+
 uint32_t GC_CompressCommand(HGCODE hcode, uint8_t* buffer)
 {
     GCode* gcode = (GCode*)hcode;
@@ -319,19 +501,8 @@ uint32_t GC_CompressCommand(HGCODE hcode, uint8_t* buffer)
         // current implementation supports necessary commands only. 
         // Absolute mode is used and cannot be overrided
         // Metric coordinates are suported
-        uint32_t index = GCODE_MOVE;
-        switch (gcode->command.code & 0x00FF)
+        switch (gcode->command.number)
         {
-        case 0:
-        case 1:
-            index = GCODE_MOVE;
-            break;
-        case 28:
-            index = GCODE_HOME;
-            break;
-        case 60:
-            index = GCODE_SAVE_POSITION;
-            break;
     // G90 and G91 are options for code interpreter.
     // they are not produce actual commands, just change state of interpreter
     // to simplify processing printer works in absolute coordinates only;
@@ -343,13 +514,11 @@ uint32_t GC_CompressCommand(HGCODE hcode, uint8_t* buffer)
             gcode->motion_mode = GCODE_RELATIVE;
             gcode->extrusion_mode = GCODE_RELATIVE;
             return 0;
-        case 92:
-            index = GCODE_SET;
-            break;
-        case 99:
-            index = GCODE_SAVE_STATE;
-            break;
-        default:
+        }
+
+        uint32_t index = GC_GetCommandIndex(gcode->command.number);
+        if (GCODE_COMMAND_COUNT == index)
+        {
             //the rest of commands is ignored
             return 0;
         }
@@ -367,7 +536,7 @@ uint32_t GC_CompressCommand(HGCODE hcode, uint8_t* buffer)
     else if (gcode->command.code & GCODE_SUBCOMMAND)
     {
         uint32_t index = GCODE_SET_NOZZLE_TEMPERATURE;
-        switch (gcode->command.code & 0x00FF)
+        switch (gcode->command.number)
         {
         case 24:
             index = GCODE_START_RESUME;
@@ -401,10 +570,15 @@ uint32_t GC_CompressCommand(HGCODE hcode, uint8_t* buffer)
         case 190:
             index = GCODE_WAIT_TABLE;
             break;
+        case 303:
+            index = GCODE_AUTOTUNE;
+            break;
         default:
             //others are just ignored
             return 0;
         }
+        // unused tail of the chunk is cleared, so compiled data doesn't depend on the buffer content
+        memset(buffer, 0, GCODE_CHUNK_SIZE);
         *(GCodeSubCommandParams*)(buffer + sizeof(parameterType)) = gcode->command.m;
         *(parameterType*)buffer = GCODE_SUBCOMMAND | index;
     }
@@ -449,3 +623,115 @@ GCODE_COMMAND_STATE GC_ExecuteFromBuffer(GCodeFunctionList* functions, void* add
     }
     return GCODE_FATAL_ERROR_UNKNOWN_COMMAND;
 }
+
+#define COMPACT_SUBCOMMAND_FLAG 0x80
+#define COMPACT_INDEX_MASK      0x7F
+#define COMPACT_RAW_PARAM       (GCODE_CHUNK_PARAMS - 1)
+#define SUBCOMMAND_PARAMS       (sizeof(GCodeSubCommandParams) / sizeof(parameterType))
+
+void GC_ResetCompact(GCodeCompactState* state)
+{
+    memset(state, 0, sizeof(GCodeCompactState));
+}
+
+static uint8_t* writeVarint(uint8_t* buffer, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        *buffer++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *buffer++ = (uint8_t)value;
+    return buffer;
+}
+
+static const uint8_t* readVarint(const uint8_t* buffer, uint32_t* value)
+{
+    uint32_t result = 0;
+    uint8_t  shift  = 0;
+    do
+    {
+        result |= (uint32_t)(*buffer & 0x7F) << shift;
+        shift += 7;
+    } while (*buffer++ & 0x80);
+
+    *value = result;
+    return buffer;
+}
+
+uint32_t GC_EncodeCompact(GCodeCompactState* state, const uint8_t* chunk, uint8_t* buffer, uint8_t** raw_param)
+{
+    parameterType code = *(parameterType*)chunk;
+    const parameterType* params = (const parameterType*)(chunk + sizeof(parameterType));
+
+    bool subcommand = (code & GCODE_SUBCOMMAND) != 0;
+    parameterType* previous = subcommand ? state->subcommand : state->command;
+    uint8_t params_count    = subcommand ? SUBCOMMAND_PARAMS : GCODE_CHUNK_PARAMS;
+
+    uint8_t* caret = buffer + 2;
+    uint8_t  mask  = 0;
+    *raw_param = 0;
+
+    for (uint8_t i = 0; i < params_count; ++i)
+    {
+        if (!subcommand && COMPACT_RAW_PARAM == i)
+        {
+            if (params[i])
+            {
+                mask |= 1 << i;
+                *raw_param = caret;
+                memcpy(caret, &params[i], sizeof(uint32_t));
+                caret += sizeof(uint32_t);
+            }
+            continue;
+        }
+
+        uint32_t delta = (uint32_t)params[i] - (uint32_t)previous[i];
+        if (delta)
+        {
+            mask |= 1 << i;
+            caret = writeVarint(caret, (delta << 1) ^ (uint32_t)((int32_t)delta >> 31));
+            previous[i] = params[i];
+        }
+    }
+
+    buffer[0] = (uint8_t)((subcommand ? COMPACT_SUBCOMMAND_FLAG : 0) | (code & COMPACT_INDEX_MASK));
+    buffer[1] = mask;
+    return (uint32_t)(caret - buffer);
+}
+
+uint32_t GC_DecodeCompact(GCodeCompactState* state, const uint8_t* buffer, uint8_t* chunk)
+{
+    bool subcommand = (buffer[0] & COMPACT_SUBCOMMAND_FLAG) != 0;
+    uint8_t mask    = buffer[1];
+    parameterType* previous = subcommand ? state->subcommand : state->command;
+    uint8_t params_count    = subcommand ? SUBCOMMAND_PARAMS : GCODE_CHUNK_PARAMS;
+
+    memset(chunk, 0, GCODE_CHUNK_SIZE);
+    *(uint32_t*)chunk = (subcommand ? GCODE_SUBCOMMAND : GCODE_COMMAND) | (buffer[0] & COMPACT_INDEX_MASK);
+    parameterType* params = (parameterType*)(chunk + sizeof(parameterType));
+
+    const uint8_t* caret = buffer + 2;
+    for (uint8_t i = 0; i < params_count; ++i)
+    {
+        if (!subcommand && COMPACT_RAW_PARAM == i)
+        {
+            if (mask & (1 << i))
+            {
+                memcpy(&params[i], caret, sizeof(uint32_t));
+                caret += sizeof(uint32_t);
+            }
+            continue;
+        }
+
+        if (mask & (1 << i))
+        {
+            uint32_t value = 0;
+            caret = readVarint(caret, &value);
+            previous[i] = (parameterType)((uint32_t)previous[i] + ((value >> 1) ^ (0 - (value & 1))));
+        }
+        params[i] = previous[i];
+    }
+
+    return (uint32_t)(caret - buffer);
+}
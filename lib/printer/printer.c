@@ -1,6 +1,7 @@
 #include "printer.h"
 #include "printer_gcode_driver.h"
 #include "printer_file_manager.h"
+#include "printer_estimator.h"
 #include "printer_constants.h"
 
 #include "memory.h"
@@ -46,14 +47,59 @@ typedef struct
     Rect       status_bar;
 
     uint32_t   total_commands_count;
+    // print time estimated by the file transfer, checkpoint_commands is 0 if the time isn't known
+    PrinterControlBlock control_block;
+    uint32_t   remaining_seconds;
     uint8_t    service_stream[3 * GCODE_CHUNK_SIZE];
     uint32_t   fail_count;
+
+    // heaters are preheated while the file is transferred and switched off if the transfer fails or
+    // the print isn't started till the timeout counted from the end of the transfer
+    bool              preheat_on_transfer;
+    uint8_t           preheated;        // mask of the preheated regulators
+    uint32_t          preheat_timeout;  // MAIN_TIMER_FREQUENCY ticks
+    volatile uint32_t preheat_ticks;
 } Printer;
 
+// heaters are heated to the first temperatures found in the transferred part of the file
+static void preheat(Printer* printer)
+{
+    for (uint8_t i = 0; i < TERMO_REGULATOR_COUNT; ++i)
+    {
+        uint16_t temperature = FileManagerGetPreheatTemperature(printer->file_manager, i);
+        if (temperature && !(printer->preheated & (1U << i)))
+        {
+            PrinterSetTemperature(printer->driver, i, temperature, 0);
+            printer->preheated |= 1U << i;
+        }
+    }
+}
+
+static void stopPreheat(Printer* printer)
+{
+    for (uint8_t i = 0; i < TERMO_REGULATOR_COUNT; ++i)
+    {
+        if (printer->preheated & (1U << i))
+        {
+            PrinterSetTemperature(printer->driver, i, 0, 0);
+        }
+    }
+    printer->preheated = 0;
+}
+
+// control block of the cached file is read to the one of the printer, it is reread by the start of the print
+static bool isPrintable(Printer* printer)
+{
+    PrinterReadControlBlock(printer->driver, &printer->control_block);
+    return CONTROL_BLOCK_SEC_CODE == printer->control_block.secure_id && printer->control_block.commands_count;
+}
+
 // on file select
 static bool startTransfer(ActionParameter* param)
 {
     Printer* printer = (Printer*)param->metadata;
+    stopPreheat(printer);
+    printer->preheat_ticks = 0;
     printer->gcode_blocks_count = FileManagerOpenGCode(printer->file_manager, "model.gcode");
     if (0 != printer->gcode_blocks_count)
     {
@@ -71,13 +117,21 @@ static bool startPrinting(ActionParameter* param)
     UI_EnableButton(printer->start_button, false);
     UI_EnableButton(printer->transfer_button, false);
 
+    // heaters are controlled by the print from now
+    printer->preheated = 0;
     PrinterInitialize(printer->driver);
     PrinterPrintFromCache(printer->driver, 0, PRINTER_START);
 
     UI_SetIndicatorLabel(printer->operation_name, "Printing");
     printer->total_commands_count = PrinterGetRemainingCommandsCount(printer->driver);
-    UI_SetProgressMaximum(printer->progress, printer->total_commands_count);
+    PrinterReadControlBlock(printer->driver, &printer->control_block);
+    printer->remaining_seconds = 0;
+
+    // progress shows the estimated time if it is known, commands differ a lot in duration
+    bool is_time_known = printer->control_block.checkpoint_commands && printer->control_block.print_time;
+    UI_SetProgressMaximum(printer->progress, is_time_known ? printer->control_block.print_time / MAIN_TIMER_FREQUENCY : printer->total_commands_count);
     UI_SetProgressValue(printer->progress, 0);
+    printer->control_block.checkpoint_commands = is_time_known ? printer->control_block.checkpoint_commands : 0;
 
     printer->current_mode = PRINTING;
     return true;
@@ -112,6 +166,7 @@ static bool runCommand(ActionParameter* param)
     }
 
     PrinterPrintFromBuffer(printer->driver, printer->service_stream, count);
+    printer->control_block.checkpoint_commands = 0;
     printer->current_mode = PRINTING;
 
     return true;
@@ -124,6 +179,10 @@ HPRINTER Configure(PrinterConfiguration* cfg)
     printer->memory_manager = &cfg->memory_manager;
     printer->file = &cfg->file_handle;
     printer->htouch = cfg->htouch;
+    printer->preheat_on_transfer = cfg->preheat_on_transfer;
+    printer->preheated = 0;
+    printer->preheat_timeout = (uint32_t)(cfg->preheat_timeout ? cfg->preheat_timeout : PREHEAT_TIMEOUT) * MAIN_TIMER_FREQUENCY;
+    printer->preheat_ticks = 0;
 
     printer->storages = cfg->storages;
 
@@ -139,6 +198,11 @@ HPRINTER Configure(PrinterConfiguration* cfg)
         0,
         &cfg->file_handle, 
         printer);
+    FileManagerSetStorageFormat(printer->file_manager, cfg->storage_format);
+    FileManagerSetCoalescing(printer->file_manager, cfg->coalescing_tolerance);
+    FileManagerSetSimplification(printer->file_manager, cfg->simplification_tolerance);
+    FileManagerSetHeatingOverlap(printer->file_manager, cfg->overlap_heating);
+    FileManagerSetAccelerationProfile(printer->file_manager, cfg->acceleration_profile);
     
     printer->ui_handle = UI_Configure(cfg->hdisplay, viewport, 1, 1, false);
 
@@ -148,16 +212,21 @@ HPRINTER Configure(PrinterConfiguration* cfg)
     DriverConfig drv_cfg = {
         &cfg->memory_manager,
         cfg->storages[STORAGE_INTERNAL],
-        cfg->motors,
+        cfg->steppers,
         cfg->termal_regulators,
         cfg->cooler_port,
         cfg->cooler_pin,
         &axis_configuration,
         PRINTER_ACCELERATION_ENABLE,
         printer->file,
+        cfg->prefetch_pages,
+        cfg->motion_blocks,
+        cfg->acceleration_profile,
     };
 
     printer->driver = PrinterConfigure(&drv_cfg);
+    // regulators without the autotune gains keep the stepping control
+    PrinterLoadRegulatorGains(printer->driver);
 
     for (uint8_t i = 0; i < TERMO_REGULATOR_COUNT; ++i)
     {
@@ -192,10 +261,8 @@ HPRINTER Configure(PrinterConfiguration* cfg)
         (SDCARD_OK == SDCARD_IsInitialized(printer->storages[STORAGE_EXTERNAL])), startTransfer, printer, 0);
 
     Rect button_start = { 100, 50, 220, 90 };
-    PrinterControlBlock cbl;
-    PrinterReadControlBlock(printer->driver, &cbl);
     printer->start_button = UI_CreateButton(printer->ui_handle, printer->printing_frame, button_start, "Start", LARGE_FONT,
-        (CONTROL_BLOCK_SEC_CODE == cbl.secure_id && cbl.commands_count), startPrinting, printer, 0);
+        isPrintable(printer), startPrinting, printer, 0);
 
     UI_Refresh(printer->ui_handle);
     return (HPRINTER)printer;
@@ -204,14 +271,18 @@ HPRINTER Configure(PrinterConfiguration* cfg)
 void MainLoop(HPRINTER hprinter)
 {
     Printer* printer = (Printer*)hprinter;
+    if (printer->preheated && printer->preheat_ticks >= printer->preheat_timeout)
+    {
+        // the print isn't started, preheated heaters aren't left on
+        stopPreheat(printer);
+    }
+
     if (FINISHING == printer->current_mode )
     {
         PrinterSaveState(printer->driver);
         UI_EnableButton(printer->transfer_button, (SDCARD_OK == SDCARD_IsInitialized(printer->storages[STORAGE_EXTERNAL])));
 
-        PrinterControlBlock cbl;
-        PrinterReadControlBlock(printer->driver, &cbl);
-        UI_EnableButton(printer->start_button, (CONTROL_BLOCK_SEC_CODE == cbl.secure_id && cbl.commands_count));
+        UI_EnableButton(printer->start_button, isPrintable(printer));
 
         UI_SetIndicatorLabel(printer->operation_name, "DONE");
         UI_ProgressStep(printer->progress);
@@ -240,6 +311,20 @@ void MainLoop(HPRINTER hprinter)
             UI_SetIndicatorLabel(printer->operation_name, name);
             printer->current_mode = CONFIGURATION;
         }
+        else if (printer->control_block.checkpoint_commands)
+        {
+            uint32_t commands_count = printer->total_commands_count - PrinterGetRemainingCommandsCount(printer->driver);
+            uint32_t remaining = EstimatorGetRemainingTime(&printer->control_block, commands_count) / MAIN_TIMER_FREQUENCY;
+            if (remaining != printer->remaining_seconds)
+            {
+                printer->remaining_seconds = remaining;
+                UI_SetProgressValue(printer->progress, printer->control_block.print_time / MAIN_TIMER_FREQUENCY - remaining);
+
+                char name[16];
+                sprintf(name, "%lu:%02lu:%02lu", (unsigned long)(remaining / 3600), (unsigned long)(remaining / 60 % 60), (unsigned long)(remaining % 60));
+                UI_SetIndicatorLabel(printer->operation_name, name);
+            }
+        }
         else
         {
             uint32_t commands_count = printer->total_commands_count - PrinterGetRemainingCommandsCount(printer->driver);
@@ -306,6 +391,8 @@ void MainLoop(HPRINTER hprinter)
         if (0 == printer->gcode_blocks_count)
         {
             FileManagerCloseGCode(printer->file_manager);
+            // the timeout of the preheat starts when the file is ready to print
+            printer->preheat_ticks = 0;
             UI_SetIndicatorLabel(printer->operation_name, "DONE");
             UI_ProgressStep(printer->progress);
             UI_EnableButton(printer->transfer_button, true);
@@ -321,12 +408,17 @@ void MainLoop(HPRINTER hprinter)
             UI_SetIndicatorLabel(printer->operation_name, FileManagerGetError(printer->file_manager));
             return;
         }
+        if (printer->preheat_on_transfer)
+        {
+            preheat(printer);
+        }
         UI_ProgressStep(printer->progress);
         --printer->gcode_blocks_count;
     }
         
     if (FAILURE == printer->current_mode)
     {
+        stopPreheat(printer);
         UI_SetIndicatorLabel(printer->operation_name, "ERROR");
         printer->current_mode = CONFIGURATION;
     }
@@ -342,6 +434,10 @@ void OnTimer(HPRINTER hprinter)
 {
     Printer* printer = (Printer*)hprinter;
     PRINTER_STATUS state = PRINTER_OK;
+    if (printer->preheated && FILE_TRANSFERING != printer->current_mode)
+    {
+        ++printer->preheat_ticks;
+    }
     if (printer->current_mode == PRINTING)
     {
         state = PrinterNextCommand(printer->driver);
@@ -364,3 +460,9 @@ uint8_t   GetTimerPower(HPRINTER hprinter)
     Printer* printer = (Printer*)hprinter;
     return PrinterGetAccelTimerPower(printer->driver);
 }
+
+uint16_t  GetVelocity(HPRINTER hprinter)
+{
+    Printer* printer = (Printer*)hprinter;
+    return PrinterGetVelocity(printer->driver);
+}
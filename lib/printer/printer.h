@@ -12,9 +12,10 @@
 
 #include "include/user_interface.h"
 #include "include/termal_regulator.h"
+#include "include/adc_sampler.h"
 #include "printer_entities.h"
 #include "printer_memory_manager.h"
-#include "include/motor.h"
+#include "include/stepper_group.h"
 #include "ff.h"
 
 #ifndef __PRINTER__
@@ -31,12 +32,11 @@ typedef struct
 
 typedef struct 
 {
-    volatile uint16_t voltage[2];
-    uint8_t flag;
     uint16_t timer_steps;
 
     HDISPLAY hdisplay;
     HPRINTER hprinter;
+    HADCSAMPLER hsampler;
 
 } Application;
 
@@ -63,7 +63,7 @@ typedef struct
     FIL                     file_handle;
     DIR                     directory_handle;
 
-    HMOTOR                  motors[MOTOR_COUNT];
+    HSTEPPERGROUP           steppers;
     HTERMALREGULATOR        termal_regulators[TERMO_REGULATOR_COUNT];
 
     GPIO_TypeDef*           cooler_port;
@@ -71,6 +71,33 @@ typedef struct
 
     HDISPLAY                hdisplay;
     HTOUCH                  htouch;
+
+    // format of the cached gcode commands in the internal storage
+    GCODE_STORAGE_FORMAT    storage_format;
+
+    // max deviation in mm of the collinear moves merged during the file transfer, 0 disables merging
+    float                   coalescing_tolerance;
+
+    // max deviation in XYZ steps of the points dropped from dense paths during the file transfer, 0 disables simplification
+    float                   simplification_tolerance;
+
+    // waits for the heaters before the first extruding move are deferred, so heating overlaps homing and preamble moves
+    bool                    overlap_heating;
+
+    // heaters are heated to the first temperatures of the file while it is transferred
+    bool                    preheat_on_transfer;
+
+    // seconds the preheated heaters are kept on till the print is started, 0 selects PREHEAT_TIMEOUT
+    uint16_t                preheat_timeout;
+
+    // number of memory pages to prefetch cached gcode commands, 0 selects double buffering
+    uint8_t                 prefetch_pages;
+
+    // number of motion blocks prepared by the main loop ahead of the execution, 0 decodes commands in the timer interrupt
+    uint8_t                 motion_blocks;
+
+    // velocity profile of the acceleration and braking of the head
+    ACCELERATION_PROFILE    acceleration_profile;
 } PrinterConfiguration;
 
 /// <summary>
@@ -115,6 +142,12 @@ void      TrackAction(HPRINTER hprinter, uint16_t x, uint16_t y, bool pressed);
 /// </summary>
 /// <param name="hprinter">Handle for the configured printer</param>
 uint8_t   GetTimerPower(HPRINTER hprinter);
+/// <summary>
+/// Returns current velocity of the printing head
+/// </summary>
+/// <param name="hprinter">Handle for the configured printer</param>
+/// <returns>Velocity in mm/min, 0 if the head doesn't move</returns>
+uint16_t  GetVelocity(HPRINTER hprinter);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,102 @@
+#include "printer_coalescer.h"
+
+#include <math.h>
+#include <string.h>
+
+static bool isMove(const uint8_t* command)
+{
+    return (*(const parameterType*)command & GCODE_COMMAND) && GCODE_MOVE == command[0];
+}
+
+static GCodeCommandParams* movePoint(const uint8_t* command)
+{
+    return (GCodeCommandParams*)(command + sizeof(parameterType));
+}
+
+// XYZ offset of the point from the start of the run in mm
+static float offset(const MoveCoalescer* coalescer, const GCodeCommandParams* point, float* offset_mm)
+{
+    offset_mm[0] = (float)(point->x - coalescer->start.x) / coalescer->axis_config.x_steps_per_mm;
+    offset_mm[1] = (float)(point->y - coalescer->start.y) / coalescer->axis_config.y_steps_per_mm;
+    offset_mm[2] = (float)(point->z - coalescer->start.z) / coalescer->axis_config.z_steps_per_mm;
+    return offset_mm[0] * offset_mm[0] + offset_mm[1] * offset_mm[1] + offset_mm[2] * offset_mm[2];
+}
+
+void CoalescerReset(MoveCoalescer* coalescer, const GCodeAxisConfig* axis_cfg, float tolerance)
+{
+    memset(coalescer, 0, sizeof(MoveCoalescer));
+    coalescer->axis_config = *axis_cfg;
+    coalescer->tolerance   = tolerance;
+}
+
+bool CoalescerStart(MoveCoalescer* coalescer, const GCodeCommandParams* start, const uint8_t* command)
+{
+    if (coalescer->tolerance <= 0 || !isMove(command))
+    {
+        return false;
+    }
+
+    coalescer->start        = *start;
+    coalescer->points_count = 0;
+
+    // extrusion without motion of the head can't be the part of the run
+    float offset_mm[3];
+    return offset(coalescer, movePoint(command), offset_mm) > 0;
+}
+
+bool CoalescerMerge(MoveCoalescer* coalescer, uint8_t* pending, const uint8_t* command)
+{
+    if (!isMove(command) || COALESCER_MAX_POINTS == coalescer->points_count)
+    {
+        return false;
+    }
+
+    GCodeCommandParams* end = movePoint(pending);
+    const GCodeCommandParams* point = movePoint(command);
+    if (point->fetch_speed != end->fetch_speed)
+    {
+        return false;
+    }
+
+    // the end of the pending move is dropped by the merge, it is checked together with the points dropped before
+    const uint8_t count = coalescer->points_count;
+    offset(coalescer, end, coalescer->points[count]);
+    coalescer->extrusions[count] = end->e - coalescer->start.e;
+
+    float chord[3];
+    const float length = sqrtf(offset(coalescer, point, chord));
+    if (length <= 0)
+    {
+        return false;
+    }
+    const float extrusion = (float)(point->e - coalescer->start.e) / length;
+    const float tolerance_sqr = coalescer->tolerance * coalescer->tolerance;
+    float previous = 0;
+    for (uint8_t i = 0; i <= count; ++i)
+    {
+        const float* dropped = coalescer->points[i];
+        float along = (dropped[0] * chord[0] + dropped[1] * chord[1] + dropped[2] * chord[2]) / length;
+        float distance_sqr = dropped[0] * dropped[0] + dropped[1] * dropped[1] + dropped[2] * dropped[2] - along * along;
+        if (along <= previous || distance_sqr > tolerance_sqr)
+        {
+            // the run goes forward along the merged move only
+            return false;
+        }
+        previous = along;
+
+        // extrusion can be shifted along the run by the tolerance, extruder position is rounded to the step
+        float extrusion_error = fabsf((float)coalescer->extrusions[i] - extrusion * along);
+        if (extrusion_error > fabsf(extrusion) * coalescer->tolerance + 1.0f)
+        {
+            return false;
+        }
+    }
+    if (length <= previous)
+    {
+        return false;
+    }
+
+    *end = *point;
+    coalescer->points_count = count + 1;
+    return true;
+}
@@ -0,0 +1,60 @@
+#include "main.h"
+#include "printer_entities.h"
+
+#include <stdbool.h>
+
+#ifndef __PRINTER_COALESCER__
+#define __PRINTER_COALESCER__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// max number of the intermediate points of the run kept for the check of the merged move
+#define COALESCER_MAX_POINTS 8
+
+// Merges runs of short moves into a single move. The run is kept by the caller as the pending move command, every
+// next move of the run replaces the end point of the pending one. Each intermediate point dropped by the merge is
+// within the tolerance from the resulting move, and its extrusion is within the tolerance from the extrusion
+// interpolated along the resulting move
+typedef struct
+{
+    GCodeAxisConfig    axis_config;
+    float              tolerance;                               // mm, 0 disables merging
+    GCodeCommandParams start;                                   // start point of the pending move
+    float              points[COALESCER_MAX_POINTS][3];         // XYZ offsets of the dropped points from the start, mm
+    parameterType      extrusions[COALESCER_MAX_POINTS];        // E offsets of the dropped points from the start, steps
+    uint8_t            points_count;
+} MoveCoalescer;
+
+/// <summary>
+/// Prepares coalescer for the new file
+/// </summary>
+/// <param name="coalescer">coalescer to be reset</param>
+/// <param name="axis_cfg">steps per mm of each axis</param>
+/// <param name="tolerance">max distance of the dropped points from the merged move in mm, 0 disables merging</param>
+void CoalescerReset(MoveCoalescer* coalescer, const GCodeAxisConfig* axis_cfg, float tolerance);
+
+/// <summary>
+/// Starts the new run by the command if it is a move of the head
+/// </summary>
+/// <param name="coalescer">move coalescer</param>
+/// <param name="start">position of the head before the command</param>
+/// <param name="command">command in the GCODE_CHUNK_SIZE format</param>
+/// <returns>true if next commands can be merged to the command, the command should be kept as the pending one</returns>
+bool CoalescerStart(MoveCoalescer* coalescer, const GCodeCommandParams* start, const uint8_t* command);
+
+/// <summary>
+/// Merges the command to the pending one if the command continues the run
+/// </summary>
+/// <param name="coalescer">move coalescer</param>
+/// <param name="pending">pending move command, its end point is replaced by the end point of the merged command</param>
+/// <param name="command">next command in the GCODE_CHUNK_SIZE format</param>
+/// <returns>true if the command is merged and shouldn't be stored</returns>
+bool CoalescerMerge(MoveCoalescer* coalescer, uint8_t* pending, const uint8_t* command);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__PRINTER_COALESCER__
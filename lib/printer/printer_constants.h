@@ -20,6 +20,9 @@ const GCodeAxisConfig axis_configuration =
 
 #define COMMAND_LENGTH 27
 
+// seconds the heaters preheated by the file transfer are kept on till the print is started
+#define PREHEAT_TIMEOUT 600
+
 typedef struct
 {
     char name[8];
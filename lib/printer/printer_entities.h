@@ -23,6 +23,13 @@ typedef enum
     PRINTER_ACCELERATION_ENABLE = 1
 } PRINTER_ACCELERATION;
 
+// Velocity profile of the acceleration and braking of the head
+typedef enum
+{
+    ACCELERATION_PROFILE_TRAPEZOID = 0, // constant acceleration, velocity is changed by the equal steps
+    ACCELERATION_PROFILE_SCURVE = 1     // jerk limited acceleration, velocity follows the S-curve
+} ACCELERATION_PROFILE;
+
 // Printer initialization method.
 // it can be either start new print or resume print from the state block
 typedef enum
@@ -65,6 +72,9 @@ typedef uint32_t TERMO_REGULATOR;
 #define CONTROL_BLOCK_POSITION 10
 // Security marker for printer control block section. literal value is 'prnt'
 #define CONTROL_BLOCK_SEC_CODE 0x70726E74
+// Number of the print time checkpoints in the control block. Checkpoints are spread evenly over the commands,
+// the interval between them is doubled when they run out
+#define PRINT_TIME_CHECKPOINTS 64
 /// <summary>
 /// Cached file control block structure
 /// </summary>
@@ -74,6 +84,11 @@ typedef struct
     uint32_t file_sector;
     char     file_name[FILE_NAME_LEN];
     uint32_t commands_count;
+    uint32_t storage_format; // GCODE_STORAGE_FORMAT of the command sectors
+    uint32_t source_commands_count; // commands in the source file, before merging of collinear moves
+    uint32_t print_time;            // estimated time of the print in MAIN_TIMER_FREQUENCY ticks, heating isn't included
+    uint32_t checkpoint_commands;   // commands between the print time checkpoints, 0 if the time isn't estimated
+    uint32_t checkpoints[PRINT_TIME_CHECKPOINTS]; // estimated time after every checkpoint_commands commands
 } PrinterControlBlock;
 
 // Here all material overrides are stored. 
@@ -94,6 +109,11 @@ typedef struct
 } MaterialFile;
 // maximum number of materials that can be stored in the printer cache
 #define MATERIALS_MAX_COUNT SDCARD_BLOCK_SIZE/sizeof(MaterialFile)
+
+// Here gains of the termo regulators measured by the autotune are stored
+#define REGULATOR_BLOCK_POSITION 6
+// Security marker for regulator section. literal value is 'regl'
+#define REGULATOR_SEC_CODE 0x7265676C
     
 //Priter constants
 #define SECONDS_IN_MINUTE 60
@@ -122,15 +142,22 @@ typedef struct
 // Which is equal to 10000 tacts per second
 #define MAIN_TIMER_FREQUENCY 10000
 
-// Max cosinus of the contignous region angle, segments that connects by lesser angle does not
-// lead to acceleration and deacceleration. if angle is bigger, than contignous segment will end. 
-// Current value is cos30
-#define CONTINUOUS_SEGMENT_COS 0.866
+// Max deviation of the nozzle from the corner of two segments in mm. The head doesn't stop on the corner,
+// it passes it with the speed of the circle arc that deviates from the corner by this distance
+#define JUNCTION_DEVIATION 0.05f
+
+// Number of the last segments that are replanned by the file manager when the next segment is added.
+// Older segments are final, so the window should be long enough to stop from the max fetch speed
+#define PLANNER_WINDOW 16
 
 // Number of attempts to restore connection to Internal SDCARD
 // if connection cannot be restored by this number of attempts overall execution will be stopped
 #define SDCARD_READ_FAIL_ATTEMPTS 10
 
+// Number of motion blocks decoded by the main loop ahead of the execution in the timer interrupt.
+// Queue should cover the longest period of the main loop when it is busy with the other work.
+#define MOTION_BLOCKS_COUNT 8
+
 // to keep gcode parser as it is, will reconstruct command parameters at the moment of storing
 // them in the internal storage
 // max structure size should be 32B.
@@ -140,7 +167,8 @@ typedef struct
 {
     GCodeCommandParams g;           // original g code parameters. the structure valid only for commands
     uint32_t      segment_time;     // time to complete the segment
-    uint32_t      sequence_time;    // time to complete the whole acceleration sequence. 0 for intermediate segments
+    uint16_t      entry_speed;      // planned speed at the start of the segment, mm/min. 0 if the segment isn't planned
+    uint16_t      exit_speed;       // planned speed at the end of the segment, mm/min
 } ExtendedGCodeCommandParams;
 #pragma pack(pop)
 
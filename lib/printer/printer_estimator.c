@@ -0,0 +1,214 @@
+#include "printer_estimator.h"
+#include "printer_math.h"
+
+#ifndef _WIN32
+#include "include/sdcard.h"
+#else
+#include "sdcard.h"
+#endif
+
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+void EstimatorReset(PrintTimeEstimator* estimator, const GCodeAxisConfig* axis_cfg, ACCELERATION_PROFILE profile,
+    PrinterControlBlock* control_block)
+{
+    memset(estimator, 0, sizeof(PrintTimeEstimator));
+    estimator->axis_config = *axis_cfg;
+    estimator->profile     = profile;
+
+    control_block->print_time          = 0;
+    control_block->checkpoint_commands = 1;
+    memset(control_block->checkpoints, 0, sizeof(control_block->checkpoints));
+}
+
+// ticks of the accelerator to pass the motor ticks with the given power, the first tick of each period passes
+static uint32_t passTicks(uint32_t motor_ticks, uint32_t power)
+{
+    const uint32_t rest = motor_ticks - 1;
+    return rest / power * STANDARD_ACCELERATION_SEGMENT + 1 + ((rest % power) * STANDARD_ACCELERATION_SEGMENT + power - 1) / power;
+}
+
+uint32_t EstimateMotionTime(const ExtendedGCodeCommandParams* segment_data, uint32_t time, ACCELERATION_PROFILE profile)
+{
+    // the same ramps as the driver prepares: speed is changed by one region every STANDARD_ACCELERATION_SEGMENT
+    // ticks, or by the S-curve ramp of the same region changes, the motors pass region * STANDARD_ACCELERATION_SEGMENT
+    // / segments ticks of the segment time meanwhile
+    const bool scurve = (ACCELERATION_PROFILE_SCURVE == profile);
+    const uint32_t ramp_length = scurve ? PROFILE_RAMP_LENGTH : 1;
+    const uint32_t fetch_speed = (uint32_t)segment_data->g.fetch_speed;
+    const uint32_t segments = MAIN_TIMER_FREQUENCY * fetch_speed /
+        (SECONDS_IN_MINUTE * STANDARD_ACCELERATION * STANDARD_ACCELERATION_SEGMENT);
+    if (!time || !segments || !segment_data->entry_speed || !segment_data->exit_speed)
+    {
+        return time;
+    }
+
+    uint32_t entry = segments * segment_data->entry_speed / fetch_speed;
+    uint32_t exit  = segments * segment_data->exit_speed / fetch_speed;
+    entry = entry ? (entry < segments ? entry : segments) : 1;
+    exit  = exit ? (exit < segments ? exit : segments) : 1;
+
+    uint64_t peak_sqr = (uint64_t)time * segments / (STANDARD_ACCELERATION_SEGMENT * ramp_length) + (entry * entry + exit * exit) / 2;
+    uint32_t peak = (peak_sqr < (uint64_t)segments * segments) ? (uint32_t)sqrtf((float)peak_sqr) : segments;
+    peak = (peak > entry) ? peak : entry;
+    peak = (peak > exit) ? peak : exit;
+    const uint32_t braking_distance = ramp_length * STANDARD_ACCELERATION_SEGMENT * (peak * peak - exit * exit) / (2 * segments);
+
+    // the tick counter of the period starts together with the first tick, so the first period is one tick shorter.
+    // Braking starts at the tick when the rest of the segment gets equal to the braking distance, it restarts the
+    // period and the ramp with the current region, then the region is decremented every period or by the ramp
+    uint32_t elapsed   = 0;
+    uint32_t remaining = time;
+    uint32_t region    = entry;
+    uint32_t period    = STANDARD_ACCELERATION_SEGMENT - 1;
+    bool     braking   = remaining <= braking_distance;
+    ProfileRamp ramp;
+    ProfileStartRamp(&ramp, braking ? (region > exit ? region - exit : exit - region) : peak - region);
+    while (remaining)
+    {
+        uint32_t power = (region < segments) ? region * STANDARD_ACCELERATION_SEGMENT / segments : STANDARD_ACCELERATION_SEGMENT;
+        power = power ? power : 1;
+
+        // motor ticks passed by the period
+        uint32_t passed = power;
+        if (!braking)
+        {
+            const uint32_t distance = remaining - braking_distance;
+            if (peak == region || distance <= power)
+            {
+                // motion with the current speed till the braking, the pulse of the restarted period is already passed
+                elapsed  += passTicks(distance, power);
+                remaining = braking_distance;
+                braking   = true;
+                period    = STANDARD_ACCELERATION_SEGMENT - 1;
+                passed    = power - 1;
+                ProfileStartRamp(&ramp, region > exit ? region - exit : exit - region);
+                if (!remaining)
+                {
+                    break;
+                }
+            }
+        }
+
+        if (remaining <= passed)
+        {
+            elapsed += passTicks(remaining, power);
+            break;
+        }
+        elapsed   += period;
+        remaining -= passed;
+        period     = STANDARD_ACCELERATION_SEGMENT;
+        if (scurve)
+        {
+            region = ProfileNextChange(&ramp) ? (braking ? region - 1 : region + 1) : region;
+        }
+        else if (braking)
+        {
+            region = (region > exit) ? region - 1 : exit;
+        }
+        else
+        {
+            region = (region < peak) ? region + 1 : peak;
+        }
+    }
+    return elapsed;
+}
+
+void EstimatorAddCommand(PrintTimeEstimator* estimator, PrinterControlBlock* control_block, const uint8_t* command)
+{
+    if (*(const parameterType*)command & GCODE_COMMAND)
+    {
+        ExtendedGCodeCommandParams segment_data = *(const ExtendedGCodeCommandParams*)(command + sizeof(parameterType));
+        switch (command[0])
+        {
+        case GCODE_HOME:
+            segment_data.g.fetch_speed = 1800;
+            // fall through
+        case GCODE_MOVE:
+        {
+            // initial and configuration segments don't have time precalculated
+            GCodeCommandParams segment = {
+                segment_data.g.x - estimator->position.x,
+                segment_data.g.y - estimator->position.y,
+                segment_data.g.z - estimator->position.z,
+                segment_data.g.e - estimator->position.e,
+                segment_data.g.fetch_speed
+            };
+            uint32_t time = segment_data.segment_time ? segment_data.segment_time : CalculateTime(&estimator->axis_config, &segment);
+            control_block->print_time += EstimateMotionTime(&segment_data, time, estimator->profile);
+            estimator->position = segment_data.g;
+            break;
+        }
+        case GCODE_SET:
+            estimator->position = segment_data.g;
+            break;
+        }
+    }
+
+    ++estimator->commands;
+    if (estimator->commands % control_block->checkpoint_commands)
+    {
+        return;
+    }
+
+    uint32_t checkpoint = estimator->commands / control_block->checkpoint_commands - 1;
+    control_block->checkpoints[checkpoint] = control_block->print_time;
+    if (PRINT_TIME_CHECKPOINTS == checkpoint + 1)
+    {
+        // every second checkpoint is kept, the interval is doubled
+        for (uint32_t i = 0; i < PRINT_TIME_CHECKPOINTS / 2; ++i)
+        {
+            control_block->checkpoints[i] = control_block->checkpoints[2 * i + 1];
+        }
+        control_block->checkpoint_commands *= 2;
+    }
+}
+
+void EstimatorAddPage(PrintTimeEstimator* estimator, PrinterControlBlock* control_block, const uint8_t* page)
+{
+    if (GCODE_FORMAT_COMPACT != control_block->storage_format)
+    {
+        // the last page of the file isn't full
+        uint32_t count = control_block->commands_count - estimator->commands;
+        count = (count < SDCARD_BLOCK_SIZE / GCODE_CHUNK_SIZE) ? count : SDCARD_BLOCK_SIZE / GCODE_CHUNK_SIZE;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            EstimatorAddCommand(estimator, control_block, page + i * GCODE_CHUNK_SIZE);
+        }
+        return;
+    }
+
+    // compact sector keeps the number of its commands in the header
+    GCodeCompactState compact;
+    GC_ResetCompact(&compact);
+    uint8_t command[GCODE_CHUNK_SIZE];
+    uint32_t caret = GCODE_COMPACT_SECTOR_HEADER;
+    for (uint8_t i = 0; i < page[0]; ++i)
+    {
+        caret += GC_DecodeCompact(&compact, page + caret, command);
+        EstimatorAddCommand(estimator, control_block, command);
+    }
+}
+
+uint32_t EstimatorGetRemainingTime(const PrinterControlBlock* control_block, uint32_t executed_commands)
+{
+    const uint32_t interval = control_block->checkpoint_commands;
+    if (!interval || executed_commands >= control_block->commands_count)
+    {
+        return 0;
+    }
+
+    // elapsed time is interpolated between the checkpoints around the executed command, the last one is the end of the print
+    uint32_t checkpoint = executed_commands / interval;
+    uint32_t checkpoints_count = control_block->commands_count / interval;
+    checkpoints_count = (checkpoints_count < PRINT_TIME_CHECKPOINTS) ? checkpoints_count : PRINT_TIME_CHECKPOINTS;
+
+    uint32_t start = checkpoint ? control_block->checkpoints[checkpoint - 1] : 0;
+    uint32_t end   = (checkpoint < checkpoints_count) ? control_block->checkpoints[checkpoint] : control_block->print_time;
+    uint32_t span  = (checkpoint < checkpoints_count) ? interval : control_block->commands_count - checkpoint * interval;
+
+    uint32_t elapsed = start + (uint32_t)((uint64_t)(end - start) * (executed_commands - checkpoint * interval) / span);
+    return control_block->print_time - elapsed;
+}
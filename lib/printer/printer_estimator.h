@@ -0,0 +1,68 @@
+#include "main.h"
+#include "printer_entities.h"
+
+#ifndef __PRINTER_ESTIMATOR__
+#define __PRINTER_ESTIMATOR__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Estimates the print time by the stored commands with their final planned speeds. The time of the move is
+// calculated by the same acceleration model as the driver executes it, the time of heating isn't known
+typedef struct
+{
+    GCodeAxisConfig      axis_config;
+    ACCELERATION_PROFILE profile;       // velocity profile executed by the driver
+    GCodeCommandParams   position;      // position of the head after the last estimated command
+    uint32_t             commands;      // number of the estimated commands
+} PrintTimeEstimator;
+
+/// <summary>
+/// Prepares estimator for the new file and clears the print time of the control block
+/// </summary>
+/// <param name="estimator">estimator to be reset</param>
+/// <param name="axis_cfg">steps per mm of each axis, used for the segments without precalculated time</param>
+/// <param name="profile">velocity profile of the acceleration and braking executed by the driver</param>
+/// <param name="control_block">control block of the file</param>
+void EstimatorReset(PrintTimeEstimator* estimator, const GCodeAxisConfig* axis_cfg, ACCELERATION_PROFILE profile,
+    PrinterControlBlock* control_block);
+
+/// <summary>
+/// Adds time of the next stored command to the print time and to the checkpoints of the control block
+/// </summary>
+/// <param name="estimator">print time estimator</param>
+/// <param name="control_block">control block of the file</param>
+/// <param name="command">command in the GCODE_CHUNK_SIZE format, with planned speeds</param>
+void EstimatorAddCommand(PrintTimeEstimator* estimator, PrinterControlBlock* control_block, const uint8_t* command);
+
+/// <summary>
+/// Adds time of the stored commands of the page in the storage format of the control block
+/// </summary>
+/// <param name="estimator">print time estimator</param>
+/// <param name="control_block">control block of the file</param>
+/// <param name="page">sector of the stored commands, with planned speeds</param>
+void EstimatorAddPage(PrintTimeEstimator* estimator, PrinterControlBlock* control_block, const uint8_t* page);
+
+/// <summary>
+/// Time of the move executed with the acceleration from the entry to the exit speed
+/// </summary>
+/// <param name="segment_data">move with the planned speeds</param>
+/// <param name="time">time of the move with the fetch speed</param>
+/// <param name="profile">velocity profile of the acceleration and braking</param>
+/// <returns>time in MAIN_TIMER_FREQUENCY ticks</returns>
+uint32_t EstimateMotionTime(const ExtendedGCodeCommandParams* segment_data, uint32_t time, ACCELERATION_PROFILE profile);
+
+/// <summary>
+/// Estimated time remaining after the executed commands
+/// </summary>
+/// <param name="control_block">control block of the file</param>
+/// <param name="executed_commands">number of the commands executed from the file start</param>
+/// <returns>time in MAIN_TIMER_FREQUENCY ticks, 0 if the print time isn't estimated</returns>
+uint32_t EstimatorGetRemainingTime(const PrinterControlBlock* control_block, uint32_t executed_commands);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__PRINTER_ESTIMATOR__
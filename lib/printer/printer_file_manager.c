@@ -1,22 +1,26 @@
 #include "printer_file_manager.h"
 #include "printer_math.h"
+#include "printer_planner.h"
+#include "printer_pipeline.h"
+#include "printer_estimator.h"
 
 #include <assert.h>
 #include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "printer.h"
 #include "include/memory.h"
 #include "ff.h"
 
 #define DEFAULT_DRIVE_ID 0
-#define GCODE_LINE_LENGTH 64
 
 typedef enum
 {
     PAGE_ONE = 0,
     PAGE_TWO,
+    PAGE_THREE,     // keeps parsing going while one page is locked by the planner and another one is written
     PAGES_COUNT,
     ALL_PAGES_ARE_FREE = PAGES_COUNT
 } MemoryPages;
@@ -48,23 +52,45 @@ typedef struct
     // Current path processing
     GCodeAxisConfig              axis_config;
     HGCODE gcode_interpreter;
-    ExtendedGCodeCommandParams  *base_point;    // initial point of continuous segments sequence
-    ExtendedGCodeCommandParams   previous_point;// previous point
-    GCodeCommandParams           segment;       // current path segment
+    GCodeCommandParams           previous_point;// previous point
+    MotionPlanner                planner;       // speeds of the segments in the current and the locked page can be replanned
     GCodeFunctionList            cmd_processors;
 
     // File data
     FIL* file;
-    uint8_t  caret;
     uint32_t bytes_read;
     uint32_t current_block;
     uint32_t buffer_size;
     PrinterControlBlock gcode;
     uint8_t  current_page;
     uint8_t  locked_page;
-    uint8_t* page[2];
-    bool     is_page_finished[2];
-    uint32_t page_sector[2];
+    uint8_t* page[PAGES_COUNT];
+    bool     is_page_finished[PAGES_COUNT];
+    uint32_t page_sector[PAGES_COUNT];
+    // finished page is written asynchronously, while the next block of the file is read and parsed
+    volatile uint8_t writing_page;
+    SDCARD_Status    write_status;
+
+    // Compact storage format
+    GCODE_STORAGE_FORMAT        storage_format;
+    GCodeCompactState           compact;
+    uint8_t                     page_commands;  // number of commands in the current page
+
+    // Merging of collinear moves: the last move is kept till the next command shows if it continues the move
+    float                       coalescing_tolerance;
+    // Simplification of dense paths: moves are buffered in the free memory page
+    float                       simplification_tolerance;
+    // Waits for the heaters are deferred till the first extruding move, so heating overlaps homing
+    bool                        overlap_heating;
+    CommandPipeline             pipeline;
+
+    // the first target temperatures of the file, heaters are preheated by them while the file is transferred
+    uint16_t                    preheat[TERMO_REGULATOR_COUNT];
+
+    // Print time is estimated by the final pages in the order of the file, right before they are written
+    ACCELERATION_PROFILE        acceleration_profile;
+    PrintTimeEstimator          estimator;
+    uint32_t                    estimated_block;
 
     uint8_t mtl_caret;
     char *error;
@@ -72,45 +98,7 @@ typedef struct
 } FileManager;
 
 
-static ExtendedGCodeCommandParams  s_initial_point = {0};
-static GCodeCommandParams          s_zero_segment  = {0};
-
-/// <summary>
-/// Calculate the length of the segment that driver will do with a constant speed
-/// On the beginning and the end of the region head will accelerate to prevent nozzle oscillations
-/// </summary>
-/// <param name="previous_segment">Previous segment of the gcode command</param>
-/// <param name="start_point">Initial point of the current segment</param>
-/// <param name="end_point">End point of the current segment</param>
-static bool isSequential(const GCodeCommandParams* previous_segment,
-                         const GCodeCommandParams* start_point, 
-                         const GCodeCommandParams* end_point)
-{
-    // looking for the different command or fetch speed
-    // get the next chunk of commands to continue calculation of accelerated sector size;
-    if (end_point->fetch_speed != start_point->fetch_speed)
-    {
-        return false; // sequence finished
-    }
-
-    GCodeCommandParams segment = { 
-        end_point->x - start_point->x, 
-        end_point->y - start_point->y, 
-        end_point->z - start_point->z 
-    };
-
-    double scalar_mul  = Dot(&segment, previous_segment);
-    double last_length = Dot(previous_segment, previous_segment);
-    double length      = Dot(&segment, &segment);
-
-    if (0.000001 > length * last_length ||
-        scalar_mul / sqrt(last_length * length) < CONTINUOUS_SEGMENT_COS)
-    {
-        return false;
-    }
-
-    return true;
-}
+static GCodeCommandParams s_initial_point = {0};
 
 /////////////////////////////////////////////////////////////////////
 // commands processing
@@ -118,23 +106,23 @@ static GCODE_COMMAND_STATE processMove(GCodeCommandParams* params, void* hfm)
 {
     FileManager* fm = (FileManager*)hfm;
     ExtendedGCodeCommandParams* current_point = (ExtendedGCodeCommandParams*)params;
-    current_point->sequence_time = 0;
-    current_point->segment_time  = CalculateSegmentTime(&fm->axis_config, 
-                                                        &current_point->g, &fm->previous_point.g);
+    current_point->entry_speed  = 0;
+    current_point->exit_speed   = 0;
+    current_point->segment_time = CalculateSegmentTime(&fm->axis_config, &current_point->g, &fm->previous_point);
 
-    if (!isSequential(&fm->segment, &fm->previous_point.g, &current_point->g)) // start new sequence
+    // segment without motion doesn't change the plan
+    if (current_point->segment_time)
     {
-        fm->base_point  = current_point;
-        fm->locked_page = fm->current_page;
+        GCodeCommandParams segment = {
+            current_point->g.x - fm->previous_point.x,
+            current_point->g.y - fm->previous_point.y,
+            current_point->g.z - fm->previous_point.z,
+            current_point->g.e - fm->previous_point.e,
+            current_point->g.fetch_speed
+        };
+        PlannerAddSegment(&fm->planner, &segment, current_point->segment_time, (uint8_t*)&current_point->entry_speed);
     }
-    
-    fm->segment.x = current_point->g.x - fm->previous_point.g.x;
-    fm->segment.y = current_point->g.y - fm->previous_point.g.y;
-    fm->segment.z = current_point->g.z - fm->previous_point.g.z;
-    fm->segment.e = current_point->g.e - fm->previous_point.g.e;
-    
-    fm->base_point->sequence_time += current_point->segment_time;
-    fm->previous_point = *current_point;
+    fm->previous_point = current_point->g;
     
     return GCODE_OK;
 }
@@ -149,21 +137,16 @@ static GCODE_COMMAND_STATE processHome(GCodeCommandParams* params, void* hfm)
 static GCODE_COMMAND_STATE processSet(GCodeCommandParams* params, void* hfm)
 {
     FileManager* fm = (FileManager*)hfm;
-    ExtendedGCodeCommandParams* current_point = (ExtendedGCodeCommandParams*)params;
-    fm->previous_point  = *current_point;
-    fm->base_point      = current_point;
-    fm->segment         = s_zero_segment;
-    fm->locked_page     = ALL_PAGES_ARE_FREE;
+    fm->previous_point = *params;
+    PlannerStop(&fm->planner);
     return GCODE_OK;
 }
 
 static GCODE_COMMAND_STATE cmdStub(GCodeCommandParams* params, void* hfm)
 {
     FileManager* fm = (FileManager*)hfm;
-    ExtendedGCodeCommandParams* current_point = (ExtendedGCodeCommandParams*)params;
-    fm->base_point  = current_point;
-    fm->segment     = s_zero_segment;
-    fm->locked_page = ALL_PAGES_ARE_FREE;
+    params = params;
+    PlannerStop(&fm->planner);
 
     return GCODE_OK;
 }
@@ -171,41 +154,165 @@ static GCODE_COMMAND_STATE cmdStub(GCodeCommandParams* params, void* hfm)
 static GCODE_COMMAND_STATE subCmdStub(GCodeSubCommandParams* params, void* hfm)
 {
     FileManager* fm = (FileManager*)hfm;
-    fm->segment = s_zero_segment;
-    fm->locked_page = ALL_PAGES_ARE_FREE;
+    params = params;
+    PlannerStop(&fm->planner);
 
     return GCODE_OK;
 }
 
+static void storePreheat(FileManager* fm, TERMO_REGULATOR regulator, parameterType temperature)
+{
+    PlannerStop(&fm->planner);
+    if (!fm->preheat[regulator] && temperature > 0)
+    {
+        fm->preheat[regulator] = (uint16_t)temperature;
+    }
+}
+
+static GCODE_COMMAND_STATE processNozzleTemperature(GCodeSubCommandParams* params, void* hfm)
+{
+    storePreheat((FileManager*)hfm, TERMO_NOZZLE, params->s);
+    return GCODE_OK;
+}
+
+static GCODE_COMMAND_STATE processTableTemperature(GCodeSubCommandParams* params, void* hfm)
+{
+    storePreheat((FileManager*)hfm, TERMO_TABLE, params->s);
+    return GCODE_OK;
+}
+
+static void onPageWritten(HSDCARD ram, SDCARD_Status status, void* hfm)
+{
+    FileManager* fm = (FileManager*)hfm;
+    fm->write_status = status;
+    if (SDCARD_OK == status)
+    {
+        fm->is_page_finished[fm->writing_page] = false;
+    }
+    fm->writing_page = ALL_PAGES_ARE_FREE;
+}
+
+// storage writes one page at once, so the next write or synchronous storage access waits for the current write
+static SDCARD_Status waitPageWritten(FileManager* fm)
+{
+    while (ALL_PAGES_ARE_FREE != fm->writing_page && SDCARD_BUSY == SDCARD_Poll(fm->ram));
+    return fm->write_status;
+}
+
 static PRINTER_STATUS flushPages(FileManager* fm)
 {
+    // segments of the finished page can be replanned by the next commands, so the page stays in memory.
+    // Segments of the older pages are final
+    const uint8_t* finished_page = fm->page[fm->current_page];
+    fm->locked_page = PlannerRelease(&fm->planner, finished_page, finished_page + SDCARD_BLOCK_SIZE) ? fm->current_page : ALL_PAGES_ARE_FREE;
+
+    // unused tail of the page is cleared, so stored data doesn't depend on previous content of the page
+    memset(fm->page[fm->current_page] + fm->buffer_size, 0, SDCARD_BLOCK_SIZE - fm->buffer_size);
     fm->is_page_finished[fm->current_page] = true;
     fm->buffer_size = 0;
     fm->current_block++;
 
+    if (GCODE_FORMAT_COMPACT == fm->gcode.storage_format)
+    {
+        // compact sectors are independent, so each one has its own commands counter and delta state
+        fm->page[fm->current_page][0] = fm->page_commands;
+        fm->page_commands = 0;
+        fm->buffer_size = GCODE_COMPACT_SECTOR_HEADER;
+        GC_ResetCompact(&fm->compact);
+    }
+
+    // only the last finished page can be locked, so the unlocked ones are estimated in the order of the file
+    bool estimated = true;
+    while (estimated)
+    {
+        estimated = false;
+        for (uint8_t p = 0; p < PAGES_COUNT; ++p)
+        {
+            if (fm->is_page_finished[p] && p != fm->locked_page && fm->page_sector[p] == fm->estimated_block)
+            {
+                // commands of the page have final planned speeds
+                EstimatorAddPage(&fm->estimator, &fm->gcode, fm->page[p]);
+                ++fm->estimated_block;
+                estimated = true;
+            }
+        }
+    }
+
     for (uint8_t p = 0; p < PAGES_COUNT; ++p)
     {
-        if (fm->is_page_finished[p] && p != fm->locked_page)
+        if (fm->is_page_finished[p] && p != fm->locked_page && p != fm->writing_page)
         {
-            if (SDCARD_OK != SDCARD_WriteSingleBlock(fm->ram, fm->page[p], fm->page_sector[p]))
+            if (SDCARD_OK != waitPageWritten(fm))
+            {
+                return PRINTER_RAM_FAILURE;
+            }
+
+            fm->writing_page = p;
+            if (SDCARD_OK != SDCARD_WriteAsync(fm->ram, fm->page[p], fm->page_sector[p], 1, onPageWritten, fm))
             {
+                fm->writing_page = ALL_PAGES_ARE_FREE;
                 return PRINTER_RAM_FAILURE;
             }
-            fm->is_page_finished[p] = false;
+            // the page is sent right away, the storage programs it in background
+            SDCARD_Poll(fm->ram);
         }
     }
 
-    for (uint8_t p = 0; p < PAGES_COUNT; ++p)
+    // if the only unlocked page is still being written, wait for it
+    do
     {
-        if (!fm->is_page_finished[p] && p != fm->locked_page)
+        for (uint8_t p = 0; p < PAGES_COUNT; ++p)
         {
-            fm->current_page        = p;
-            fm->page_sector[p]      = fm->current_block;
-            break;
+            if (!fm->is_page_finished[p] && p != fm->locked_page)
+            {
+                fm->current_page        = p;
+                fm->page_sector[p]      = fm->current_block;
+                return PRINTER_OK;
+            }
         }
     }
+    while (ALL_PAGES_ARE_FREE != fm->writing_page && SDCARD_OK == waitPageWritten(fm));
 
-    return PRINTER_OK;
+    return PRINTER_RAM_FAILURE;
+}
+
+// command is processed and stored to the current page in the storage format
+static void storeCommand(uint8_t* command, void* hfm)
+{
+    FileManager* fm = (FileManager*)hfm;
+    if (GCODE_FORMAT_COMPACT != fm->gcode.storage_format)
+    {
+        uint8_t* stored = fm->page[fm->current_page] + fm->buffer_size;
+        memcpy(stored, command, GCODE_CHUNK_SIZE);
+        GC_ExecuteFromBuffer(&fm->cmd_processors, fm, stored);
+        ++fm->gcode.commands_count;
+
+        fm->buffer_size += GCODE_CHUNK_SIZE;
+        if (SDCARD_BLOCK_SIZE == fm->buffer_size)
+        {
+            flushPages(fm);
+        }
+        return;
+    }
+
+    // page is switched before the command processing, so the planned segment is stored in the current page
+    if (SDCARD_BLOCK_SIZE - fm->buffer_size < GCODE_COMPACT_MAX_SIZE)
+    {
+        flushPages(fm);
+    }
+
+    GC_ExecuteFromBuffer(&fm->cmd_processors, fm, command);
+
+    // planned speeds are encoded as is, so the planner updates them in the page
+    uint8_t* speeds = 0;
+    fm->buffer_size += GC_EncodeCompact(&fm->compact, command, fm->page[fm->current_page] + fm->buffer_size, &speeds);
+    if (speeds)
+    {
+        PlannerSetLocation(&fm->planner, speeds);
+    }
+
+    ++fm->page_commands;
+    ++fm->gcode.commands_count;
 }
 
 HFILEMANAGER FileManagerConfigure(HSDCARD sdcard, HSDCARD ram, MemoryManager* memory, HGCODE interpreter, GCodeAxisConfig* axis_cfg, FIL* file_handle, void* logger)
@@ -230,9 +337,17 @@ HFILEMANAGER FileManagerConfigure(HSDCARD sdcard, HSDCARD ram, MemoryManager* me
     fm->mtl_caret = 0;
     fm->file = file_handle;
     fm->logger = logger;
+    fm->storage_format = GCODE_FORMAT_CHUNKS;
+    fm->coalescing_tolerance = 0;
+    fm->simplification_tolerance = 0;
+    fm->overlap_heating = false;
+    fm->acceleration_profile = ACCELERATION_PROFILE_TRAPEZOID;
     fm->axis_config = axis_cfg ? *axis_cfg : *GC_GetAxisConfig(interpreter);
     fm->page[PAGE_ONE] = fm->memory->pages[1];
     fm->page[PAGE_TWO] = fm->memory->pages[3];
+    fm->page[PAGE_THREE] = fm->memory->pages[4];
+    fm->writing_page = ALL_PAGES_ARE_FREE;
+    fm->write_status = SDCARD_OK;
 
     fm->cmd_processors.commands[GCODE_MOVE]                       = processMove;
     fm->cmd_processors.commands[GCODE_HOME]                       = processHome;
@@ -244,6 +359,10 @@ HFILEMANAGER FileManagerConfigure(HSDCARD sdcard, HSDCARD ram, MemoryManager* me
     {
         fm->cmd_processors.subcommands[c]  = subCmdStub;
     }
+    fm->cmd_processors.subcommands[GCODE_SET_NOZZLE_TEMPERATURE]  = processNozzleTemperature;
+    fm->cmd_processors.subcommands[GCODE_WAIT_NOZZLE]             = processNozzleTemperature;
+    fm->cmd_processors.subcommands[GCODE_SET_TABLE_TEMPERATURE]   = processTableTemperature;
+    fm->cmd_processors.subcommands[GCODE_WAIT_TABLE]              = processTableTemperature;
 
     SDCARD_FAT_Register(sdcard, DEFAULT_DRIVE_ID);
     f_mount(&fm->file_system, "", 0);
@@ -263,6 +382,8 @@ size_t FileManagerOpenGCode(HFILEMANAGER hfile, const char* filename)
     }
     // Reset control block and clear control block in the ram. in this case if any error happened during transferring
     // printer will not have invalid file stored in the RAM
+    waitPageWritten(fm);
+    fm->write_status = SDCARD_OK;
 
     PrinterControlBlock* cb = (PrinterControlBlock*)fm->memory->pages[1];
     cb->file_name[0] = 0;
@@ -285,13 +406,23 @@ size_t FileManagerOpenGCode(HFILEMANAGER hfile, const char* filename)
     new_cb->secure_id      = CONTROL_BLOCK_SEC_CODE;
     new_cb->file_sector    = CONTROL_BLOCK_POSITION + 1;
     new_cb->commands_count = 0;
+    new_cb->source_commands_count = 0;
+    new_cb->storage_format = fm->storage_format;
     fm->bytes_read         = 0;
-    fm->caret              = 0;
-    fm->buffer_size        = 0;
+    fm->buffer_size        = (GCODE_FORMAT_COMPACT == fm->storage_format) ? GCODE_COMPACT_SECTOR_HEADER : 0;
+    fm->page_commands      = 0;
     fm->current_block      = new_cb->file_sector;
-    fm->base_point         = &s_initial_point;
     fm->previous_point     = s_initial_point;
-    fm->segment            = s_zero_segment;
+    fm->locked_page        = ALL_PAGES_ARE_FREE;
+    PlannerReset(&fm->planner, &fm->axis_config);
+    CommandPipelineConfig pipeline_cfg = {
+        &fm->axis_config, fm->memory->pages[5], fm->simplification_tolerance, fm->coalescing_tolerance,
+        fm->overlap_heating, &fm->previous_point, storeCommand, fm
+    };
+    PipelineReset(&fm->pipeline, &pipeline_cfg);
+    memset(fm->preheat, 0, sizeof(fm->preheat));
+    EstimatorReset(&fm->estimator, &fm->axis_config, fm->acceleration_profile, new_cb);
+    fm->estimated_block    = new_cb->file_sector;
 
     // Page one is free and ready to be filled with data    
     for (uint8_t p = 0; p < PAGES_COUNT; ++p)
@@ -300,10 +431,58 @@ size_t FileManagerOpenGCode(HFILEMANAGER hfile, const char* filename)
         fm->is_page_finished[p]  = false;
     }
     fm->current_page         = PAGE_ONE;
+    GC_ResetCompact(&fm->compact);
     
     return (f_size(fm->file) + SDCARD_BLOCK_SIZE - 1)/SDCARD_BLOCK_SIZE;
 }
 
+// commands are compressed directly into the current page
+static GCODE_ERROR storeCommands(FileManager* fm, GCodeBuffer* input)
+{
+    GCODE_ERROR error = GCODE_OK_COMMAND_CREATED;
+
+    while (GCODE_OK_COMMAND_CREATED == error)
+    {
+        uint8_t* commands = fm->page[fm->current_page] + fm->buffer_size;
+        uint32_t bytes_written = 0;
+        error = GC_ParseBuffer(fm->gcode_interpreter, input, commands, SDCARD_BLOCK_SIZE - fm->buffer_size, &bytes_written);
+
+        for (uint32_t offset = 0; offset < bytes_written; offset += GCODE_CHUNK_SIZE)
+        {
+            GC_ExecuteFromBuffer(&fm->cmd_processors, fm, commands + offset);
+            ++fm->gcode.commands_count;
+            ++fm->gcode.source_commands_count;
+        }
+
+        fm->buffer_size += bytes_written;
+        if (SDCARD_BLOCK_SIZE == fm->buffer_size)
+        {
+            flushPages(fm);
+        }
+    }
+    return error;
+}
+
+// commands are compressed to the temporary page, scheduled, simplified, merged and stored to the current page
+static GCODE_ERROR storeParsedCommands(FileManager* fm, GCodeBuffer* input)
+{
+    GCODE_ERROR error = GCODE_OK_COMMAND_CREATED;
+    uint8_t* commands = fm->memory->pages[2];
+
+    while (GCODE_OK_COMMAND_CREATED == error)
+    {
+        uint32_t bytes_written = 0;
+        error = GC_ParseBuffer(fm->gcode_interpreter, input, commands, SDCARD_BLOCK_SIZE, &bytes_written);
+
+        for (uint32_t offset = 0; offset < bytes_written; offset += GCODE_CHUNK_SIZE)
+        {
+            ++fm->gcode.source_commands_count;
+            PipelineAppend(&fm->pipeline, commands + offset);
+        }
+    }
+    return error;
+}
+
 PRINTER_STATUS FileManagerReadGCodeBlock(HFILEMANAGER hfile)
 {
     FileManager* fm = (FileManager*)hfile;
@@ -321,53 +500,24 @@ PRINTER_STATUS FileManagerReadGCodeBlock(HFILEMANAGER hfile)
         return PRINTER_FILE_NOT_GCODE;
     }
 
-    for (uint16_t i = 0; i < byte_read; ++i)
-    {
-        char caret = *(fm->memory->pages[0] + i);
-        *(fm->memory->pages[2] + fm->caret++) = (caret == '\n') ? 0 : caret;
-        ++fm->bytes_read;
+    fm->bytes_read += byte_read;
 
-        bool eof = (f_size(fm->file) == fm->bytes_read);
+    // the previous page has been programmed while the file block was read
+    SDCARD_Poll(fm->ram);
 
-        if (caret != '\n' && !eof)
-        {
-            continue;
-        }
+    // sector is parsed in place
+    GCodeBuffer input = { (char*)fm->memory->pages[0], byte_read, 0, f_size(fm->file) == fm->bytes_read, 0 };
+    // commands are parsed directly to the page if they are stored as is
+    bool in_place = GCODE_FORMAT_COMPACT != cb->storage_format && PipelineIsPassThrough(&fm->pipeline);
+    GCODE_ERROR error = in_place ? storeCommands(fm, &input) : storeParsedCommands(fm, &input);
 
-        GCODE_ERROR error = GC_ParseCommand(fm->gcode_interpreter, (const char*)fm->memory->pages[2]);
-        if (GCODE_OK_NO_COMMAND == error)
-        {
-            // Comment or empty line
-            fm->caret = 0;
-            continue;
-        }
-
-        if (GCODE_OK != error)
-        {
-            fm->error = fm->memory->pages[2];
-            return PRINTER_FILE_NOT_GCODE;
-        }
-
-        uint32_t bytes_written = GC_CompressCommand(fm->gcode_interpreter, fm->page[fm->current_page] + fm->buffer_size);
-        if ( 0 == bytes_written )
-        {
-            // State change command
-            fm->caret = 0;
-            continue;
-        }
-
-        GC_ExecuteFromBuffer(&fm->cmd_processors, fm, (fm->page[fm->current_page] + fm->buffer_size));
-        
-        fm->buffer_size += bytes_written;
-        fm->caret = 0;
-        ++cb->commands_count;
-        if (SDCARD_BLOCK_SIZE == fm->buffer_size)
-        {
-            flushPages(fm);
-        }
+    if (GCODE_OK_NO_COMMAND != error)
+    {
+        fm->error = (char*)input.line;
+        return PRINTER_FILE_NOT_GCODE;
     }
 
-    return PRINTER_OK;
+    return (SDCARD_OK == fm->write_status) ? PRINTER_OK : PRINTER_RAM_FAILURE;
 }
 
 // final step: write control block
@@ -375,8 +525,14 @@ PRINTER_STATUS FileManagerCloseGCode(HFILEMANAGER hfile)
 {
     FileManager* fm = (FileManager*)hfile;
 
-    fm->locked_page = ALL_PAGES_ARE_FREE; // unlock all pages. we should store everything;
+    PipelineFlush(&fm->pipeline);
+    PlannerStop(&fm->planner); // unlock all pages. we should store everything;
     flushPages(fm);
+    // control block is written through the page one
+    if (SDCARD_OK != waitPageWritten(fm))
+    {
+        return PRINTER_RAM_FAILURE;
+    }
 
     if (FR_OK != f_close(fm->file))
     {
@@ -384,6 +540,7 @@ PRINTER_STATUS FileManagerCloseGCode(HFILEMANAGER hfile)
     }
 
     PrinterControlBlock* control_block = (PrinterControlBlock*)fm->memory->pages[1];
+    memset(control_block, 0, SDCARD_BLOCK_SIZE);
     *control_block = fm->gcode;
     if (SDCARD_OK != SDCARD_WriteSingleBlock(fm->ram, fm->memory->pages[1], CONTROL_BLOCK_POSITION))
     {
@@ -393,6 +550,48 @@ PRINTER_STATUS FileManagerCloseGCode(HFILEMANAGER hfile)
     return PRINTER_OK;
 }
 
+void FileManagerSetStorageFormat(HFILEMANAGER hfile, GCODE_STORAGE_FORMAT format)
+{
+    FileManager* fm = (FileManager*)hfile;
+    fm->storage_format = format;
+}
+
+void FileManagerSetCoalescing(HFILEMANAGER hfile, float tolerance)
+{
+    FileManager* fm = (FileManager*)hfile;
+    fm->coalescing_tolerance = tolerance;
+}
+
+void FileManagerSetSimplification(HFILEMANAGER hfile, float tolerance)
+{
+    FileManager* fm = (FileManager*)hfile;
+    fm->simplification_tolerance = tolerance;
+}
+
+void FileManagerSetHeatingOverlap(HFILEMANAGER hfile, bool enable)
+{
+    FileManager* fm = (FileManager*)hfile;
+    fm->overlap_heating = enable;
+}
+
+void FileManagerSetAccelerationProfile(HFILEMANAGER hfile, ACCELERATION_PROFILE profile)
+{
+    FileManager* fm = (FileManager*)hfile;
+    fm->acceleration_profile = profile;
+}
+
+uint16_t FileManagerGetPreheatTemperature(HFILEMANAGER hfile, TERMO_REGULATOR regulator)
+{
+    FileManager* fm = (FileManager*)hfile;
+    return fm->preheat[regulator];
+}
+
+float FileManagerGetMaxDeviation(HFILEMANAGER hfile)
+{
+    FileManager* fm = (FileManager*)hfile;
+    return fm->pipeline.simplifier.max_deviation;
+}
+
 char* FileManagerGetError(HFILEMANAGER hfile)
 {
     FileManager* fm = (FileManager*)hfile;
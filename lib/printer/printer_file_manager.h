@@ -10,6 +10,8 @@
 #include "printer_memory_manager.h"
 #include "ff.h"
 
+#include <stdbool.h>
+
 #ifndef __PRINTER_GCODE_FILE__
 #define __PRINTER_GCODE_FILE__
 
@@ -48,6 +50,60 @@ PRINTER_STATUS FileManagerReadGCodeBlock(HFILEMANAGER hfile);
 /// <returns>Operation status. PRINTER_OK if no error ocured</returns>
 PRINTER_STATUS FileManagerCloseGCode(HFILEMANAGER hfile);
 
+/// <summary>
+/// Selects format of the commands in the internal storage for the next file translation
+/// </summary>
+/// <param name="hfile">handle to file manager</param>
+/// <param name="format">storage format, GCODE_FORMAT_CHUNKS by default</param>
+void FileManagerSetStorageFormat(HFILEMANAGER hfile, GCODE_STORAGE_FORMAT format);
+
+/// <summary>
+/// Enables merging of the consecutive collinear moves with the same fetch speed and proportional extrusion
+/// for the next file translation. Number of commands before and after merging is stored in the control block
+/// </summary>
+/// <param name="hfile">handle to file manager</param>
+/// <param name="tolerance">max distance of the dropped points from the merged move in mm, 0 disables merging</param>
+void FileManagerSetCoalescing(HFILEMANAGER hfile, float tolerance);
+
+/// <summary>
+/// Enables simplification of dense paths for the next file translation. Moves are dropped while the path
+/// deviates from the original one by no more than the tolerance, total extrusion of the path is kept
+/// </summary>
+/// <param name="hfile">handle to file manager</param>
+/// <param name="tolerance">max deviation of the dropped points in XYZ steps, 0 disables simplification</param>
+void FileManagerSetSimplification(HFILEMANAGER hfile, float tolerance);
+
+/// <summary>
+/// Enables overlapping of heating with the preamble of the next translated file. Waits for the heaters before
+/// the first extruding move are stored right before it, heaters are switched on at the place of the wait
+/// </summary>
+/// <param name="hfile">handle to file manager</param>
+/// <param name="enable">true defers the waits, false keeps the commands order of the file</param>
+void FileManagerSetHeatingOverlap(HFILEMANAGER hfile, bool enable);
+
+/// <summary>
+/// Sets the velocity profile executed by the driver, print time of the next translated file is estimated by it
+/// </summary>
+/// <param name="hfile">handle to file manager</param>
+/// <param name="profile">velocity profile of the acceleration and braking</param>
+void FileManagerSetAccelerationProfile(HFILEMANAGER hfile, ACCELERATION_PROFILE profile);
+
+/// <summary>
+/// Returns the first target temperature of the regulator set by M104/M109 or M140/M190 in the part of the file
+/// translated so far. It is known after the block with the command is read, so heaters can be preheated during the transfer
+/// </summary>
+/// <param name="hfile">handle to file manager</param>
+/// <param name="regulator">TERMO_NOZZLE or TERMO_TABLE</param>
+/// <returns>temperature in degrees, 0 if the file doesn't heat the regulator yet</returns>
+uint16_t FileManagerGetPreheatTemperature(HFILEMANAGER hfile, TERMO_REGULATOR regulator);
+
+/// <summary>
+/// Returns the largest deviation of the dropped points of the translated file from the simplified path
+/// </summary>
+/// <param name="hfile">handle to file manager</param>
+/// <returns>deviation in XYZ steps</returns>
+float FileManagerGetMaxDeviation(HFILEMANAGER hfile);
+
 char* FileManagerGetError(HFILEMANAGER hfile);
 /// <summary>
 /// Flash mtl file into RAM
@@ -5,13 +5,12 @@
 #include "include/memory.h"
 #include <math.h>
 #include <stdio.h>
+#include <string.h>
 
 typedef enum
 {
-    MAIN_COMMANDS_PAGE = 0,
-    PRELOAD_COMMANDS_PAGE,
-    LOOKUP_COMMANDS_PAGE,
-    STATE_PAGE,
+    STATE_PAGE = 0,
+    PREFETCH_FIRST_PAGE,    // pages from this one to the end of the memory are used by the prefetch ring
     
 } MEMORY_PAGES;
 
@@ -21,6 +20,7 @@ typedef enum
     MODE_MOVE = 0x01,
     MODE_WAIT_NOZZLE = 0x02,
     MODE_WAIT_TABLE  = 0x04,
+    MODE_AUTOTUNE    = 0x08,
 } PRINTER_COMMAD_MODE;
 
 typedef struct
@@ -36,6 +36,35 @@ typedef struct
     uint8_t                 caret_position;
 } PrinterState;
 
+// gains of the termo regulators in the internal storage
+typedef struct
+{
+    uint32_t                security_code;      // REGULATOR_SEC_CODE
+    uint32_t                tuned_regulators;   // mask of the regulators with the valid gains
+    TermalRegulatorGains    gains[TERMO_REGULATOR_COUNT];
+} RegulatorBlock;
+
+// motion of the single move command, prepared to be started without any calculations
+typedef struct
+{
+    GCodeCommandParams segment;
+    uint32_t           time;
+    uint32_t           acceleration_segments;   // 0 if motion is done without acceleration
+    uint32_t           acceleration_region;     // region of the entry speed
+    uint32_t           peak_region;             // region of the max speed of the segment
+    uint32_t           exit_region;             // region of the exit speed
+    uint32_t           braking_distance;        // time of the segment remaining at the start of braking
+} MotionProgram;
+
+// element of the motion queue. Commands other than moves are executed from the copy of the command
+typedef struct
+{
+    MotionProgram motion;
+    bool          is_move;
+    bool          last_in_sector;
+    uint8_t       command[GCODE_CHUNK_SIZE];
+} MotionBlock;
+
 #ifdef _WIN32
 #pragma pack(1)
 #endif
@@ -53,13 +82,41 @@ typedef struct
     // General gcode settings, interpreter and code execution
     GCodeFunctionList  setup_calls;
     GCodeCommandParams current_segment;
-    bool               resume; // marker that before printing we should return to position of pause
+    volatile bool      resume; // marker that before printing we should return to position of pause
     
-    // to create seamless data loading for the printer, loading will be made in 2 steps: load actual data and preload the next chunk,
-    // preloading and loading will be performed in a different threads to avoid glitches during printing
-    bool               pre_load_required;
-    MEMORY_PAGES       main_load_page;
-    MEMORY_PAGES       secondary_load_page;
+    // to create seamless data loading for the printer, sectors are prefetched to the ring of memory pages.
+    // The main loop fills the ring and the timer interrupt consumes sectors from its head, so each counter
+    // is written by one side only.
+    uint8_t            prefetch_pages;      // configured size of the ring
+    uint8_t            ring_pages;          // size of the ring for the current print, 0 when printing from buffer
+    volatile uint32_t  loaded_sectors;      // sectors loaded since the print start, written by PrinterLoadData
+    uint32_t           next_sector;         // the next sector to be loaded to the ring
+    volatile uint32_t  consumed_sectors;    // sectors completely executed, written by PrinterNextCommand or by the decoder
+    uint32_t           loaded_commands;     // commands available in the loaded sectors
+    uint32_t           print_commands;      // commands to be executed since the print start
+    uint32_t           stalls_count;        // number of times execution waited for the data
+    bool               stalled;
+    // sectors are read asynchronously, the main loop continues its work while the storage transfers the data
+    volatile bool      loading;
+    uint32_t           loading_count;       // sectors requested by the current read
+    SDCARD_Status      load_status;         // status of the last completed read
+
+    // commands of the ring are decoded by the main loop to the queue of prepared motion blocks, the timer
+    // interrupt only starts them. The main loop writes blocks_head, the timer interrupt writes blocks_tail.
+    // In this mode consumed_sectors is written by the decoder, pages are released as soon as they are decoded
+    GCodeFunctionList  prepare_calls;
+    MotionBlock*       blocks;
+    uint8_t            motion_blocks;       // configured size of the queue
+    uint8_t            queue_blocks;        // size of the queue for the current print, 0 when commands are decoded by the timer
+    volatile uint32_t  blocks_head;
+    volatile uint32_t  blocks_tail;
+    uint32_t           decoded_commands;
+    uint8_t            decode_caret;
+    bool               sector_ready;        // current sector of the decoder is loaded and started
+    bool               barrier;             // decoding waits for the execution of the command that changes the position
+    GCodeCommandParams decode_position;     // position of the head after the last decoded command
+    const uint8_t*     decode_command;
+    MotionBlock*       decode_block;
 
     const uint8_t*     data_pointer;
     uint32_t           commands_count;
@@ -73,7 +130,7 @@ typedef struct
     PRINTER_STATUS last_command_status;
 
     // Motors configuration and acceleration settings
-    HMOTOR *motors;
+    HSTEPPERGROUP steppers;
     const GCodeAxisConfig* axis_cfg;
 
     PRINTER_ACCELERATION acceleration_enabled;
@@ -82,14 +139,21 @@ typedef struct
     uint32_t  acceleration_region;
     uint32_t  acceleration_segments;
     int8_t    acceleration_region_increment;
-    uint32_t  acceleration_distance;
-    uint8_t   acceleration_distance_increment;
+    uint32_t  acceleration_peak_region;
+    uint32_t  acceleration_exit_region;
+    uint32_t  acceleration_braking_distance;
     uint32_t  acceleration_subsequent_region_length;
 
+    ACCELERATION_PROFILE acceleration_profile;
+    ProfileRamp profile_ramp;       // current S-curve ramp
+
     MaterialFile *material_override;
     // Heaters: nozzle and table
     HTERMALREGULATOR* regulators;
     uint8_t termo_regulators_state;
+    // gains measured by the autotune are saved by the main loop once it is completed
+    TERMO_REGULATOR tuned_regulator;
+    volatile bool   save_gains;
 
     //Cooler pulse engine and connection ports
     HPULSE cooler;
@@ -97,6 +161,13 @@ typedef struct
     uint16_t      cooler_pin;
 
     FIL* log_file;
+
+    // Storage format of the printing commands
+    GCODE_STORAGE_FORMAT storage_format;
+    uint8_t              sector_commands;   // number of commands in the current sector
+    uint32_t             data_caret;        // position of the next compact command in the current sector
+    GCodeCompactState    compact;
+    uint8_t              command[GCODE_CHUNK_SIZE]; // decoded compact command
 } Driver;
 
 static PRINTER_STATUS restoreState(Driver* driver)
@@ -117,85 +188,203 @@ static PRINTER_STATUS restoreState(Driver* driver)
 
 
 
-// setup commands
-static GCODE_COMMAND_STATE setupMove(GCodeCommandParams* params, void* hdriver)
+// returns number of commands stored in the sector
+static uint8_t sectorCommands(Driver* driver, const uint8_t* sector)
 {
-    Driver* driver = (Driver*)hdriver;
-    ExtendedGCodeCommandParams* segment_data = params;
-    if (segment_data->g.fetch_speed <= 0)
+    return (GCODE_FORMAT_COMPACT == driver->storage_format) ? sector[0] : SDCARD_BLOCK_SIZE / GCODE_CHUNK_SIZE;
+}
+
+static uint8_t* ringPage(Driver* driver, uint32_t sector_index)
+{
+    return driver->memory->pages[PREFETCH_FIRST_PAGE + sector_index % driver->ring_pages];
+}
+
+// completion of the asynchronous read of the ring pages
+static void onSectorsLoaded(HSDCARD storage, SDCARD_Status status, void* context)
+{
+    Driver* driver = (Driver*)context;
+    driver->load_status = status;
+    if (SDCARD_OK == status)
     {
-        return GCODE_ERROR_INVALID_PARAM;
+        const uint8_t* page = ringPage(driver, driver->loaded_sectors);
+        for (uint32_t i = 0; i < driver->loading_count; ++i)
+        {
+            driver->loaded_commands += sectorCommands(driver, page + i * SDCARD_BLOCK_SIZE);
+        }
+        driver->next_sector += driver->loading_count;
+        driver->loaded_sectors += driver->loading_count;
     }
+    driver->loading = false;
+}
 
-    // calulate the current segment length
-    driver->current_segment.fetch_speed = params->fetch_speed;
-    driver->current_segment.x = params->x - driver->active_state->position.x;
-    driver->current_segment.y = params->y - driver->active_state->position.y;
-    driver->current_segment.z = params->z - driver->active_state->position.z;
-    driver->current_segment.e = params->e - driver->active_state->position.e;
+// advances the asynchronous read, returns true while the read is in progress
+static bool isLoading(Driver* driver)
+{
+    return driver->loading && SDCARD_BUSY == SDCARD_Poll(driver->storage);
+}
 
-    // update final position of the head
-    driver->active_state->position.fetch_speed = driver->current_segment.fetch_speed;
-    driver->active_state->position.x += driver->current_segment.x;
-    driver->active_state->position.y += driver->current_segment.y;
-    driver->active_state->position.z += driver->current_segment.z;
-    driver->active_state->position.e += driver->current_segment.e;
+// synchronous access to the storage has to wait until the asynchronous read is completed
+static void waitLoading(Driver* driver)
+{
+    while (isLoading(driver));
+}
 
-    driver->last_command_status = GCODE_OK;
+// prepares decoding of the current sector
+static void startSector(Driver* driver)
+{
+    driver->sector_commands = sectorCommands(driver, driver->data_pointer);
+    if (GCODE_FORMAT_COMPACT == driver->storage_format)
+    {
+        driver->data_caret = GCODE_COMPACT_SECTOR_HEADER;
+        GC_ResetCompact(&driver->compact);
+    }
+}
+
+static const uint8_t* nextCommand(Driver* driver, uint8_t caret_position)
+{
+    if (GCODE_FORMAT_COMPACT != driver->storage_format)
+    {
+        return driver->data_pointer + (size_t)(GCODE_CHUNK_SIZE * caret_position);
+    }
+
+    driver->data_caret += GC_DecodeCompact(&driver->compact, driver->data_pointer + driver->data_caret, driver->command);
+    return driver->command;
+}
+
+// calculates motion of the segment from the start position. Heavy part of the move setup, it doesn't change the driver state
+
+static void prepareMotion(Driver* driver, const ExtendedGCodeCommandParams* segment_data, const GCodeCommandParams* start, MotionProgram* motion)
+{
+    // calulate the current segment length
+    motion->segment.fetch_speed = segment_data->g.fetch_speed;
+    motion->segment.x = segment_data->g.x - start->x;
+    motion->segment.y = segment_data->g.y - start->y;
+    motion->segment.z = segment_data->g.z - start->z;
+    motion->segment.e = segment_data->g.e - start->e;
 
     // basic fetch speed is calculated as velocity of the head, without velocity of the table, it is calculated independently.
-    uint32_t time = segment_data->segment_time;
-    if (0 == time)
+    motion->time = segment_data->segment_time;
+    if (0 == motion->time)
     {
         // initial and configuration segments doesn't have time precalculated. so calculate it;
-        time = CalculateTime(driver->axis_cfg, &driver->current_segment);
+        motion->time = CalculateTime(driver->axis_cfg, &motion->segment);
     }
+
+    motion->acceleration_segments = 0;
+    if (motion->time && driver->acceleration_enabled && segment_data->entry_speed && segment_data->exit_speed)
+    {
+        // the segment is done by the trapezoid planned by the file manager: acceleration from the entry speed,
+        // motion with the peak speed and braking to the exit speed. Speed is changed by one region every
+        // STANDARD_ACCELERATION_SEGMENT ticks, number of segments is required to get the fetch speed from 0.
+        // S-curve ramps are longer to keep the same peak acceleration
+        const uint32_t ramp_length = (ACCELERATION_PROFILE_SCURVE == driver->acceleration_profile) ? PROFILE_RAMP_LENGTH : 1;
+        const uint32_t fetch_speed = (uint32_t)motion->segment.fetch_speed;
+        const uint32_t segments = MAIN_TIMER_FREQUENCY * fetch_speed / 
+            (SECONDS_IN_MINUTE * STANDARD_ACCELERATION * STANDARD_ACCELERATION_SEGMENT);
+        if (segments)
+        {
+            uint32_t entry = segments * segment_data->entry_speed / fetch_speed;
+            uint32_t exit  = segments * segment_data->exit_speed / fetch_speed;
+            entry = entry ? (entry < segments ? entry : segments) : 1;
+            exit  = exit ? (exit < segments ? exit : segments) : 1;
+
+            // region k moves the head by STANDARD_ACCELERATION_SEGMENT * k / segments ticks of the fetch speed,
+            // so the segment time is passed by the acceleration from the entry to the peak and braking to the exit
+            uint64_t peak_sqr = (uint64_t)motion->time * segments / (STANDARD_ACCELERATION_SEGMENT * ramp_length) +
+                (entry * entry + exit * exit) / 2;
+            uint32_t peak = (peak_sqr < (uint64_t)segments * segments) ? (uint32_t)sqrtf((float)peak_sqr) : segments;
+            peak = (peak > entry) ? peak : entry;
+            peak = (peak > exit) ? peak : exit;
+
+            motion->acceleration_segments = segments;
+            motion->acceleration_region   = entry;
+            motion->peak_region           = peak;
+            motion->exit_region           = exit;
+            motion->braking_distance      = ramp_length * STANDARD_ACCELERATION_SEGMENT * (peak * peak - exit * exit) / (2 * segments);
+        }
+    }
+}
+
+// power of the accelerator pulse engine is a part of the fetch speed for the current region
+static uint32_t accelerationPower(const Driver* driver)
+{
+    uint32_t power = driver->acceleration_region * STANDARD_ACCELERATION_SEGMENT / driver->acceleration_segments;
+    return power ? power : 1;
+}
+
+// starts the S-curve ramp from the current region to the target one, direction is set by acceleration_region_increment
+static void startProfile(Driver* driver, uint32_t target_region)
+{
+    const uint32_t regions = (target_region > driver->acceleration_region) ?
+        target_region - driver->acceleration_region : driver->acceleration_region - target_region;
+    ProfileStartRamp(&driver->profile_ramp, regions);
+}
+
+// moves the S-curve ramp to the next region change
+static uint32_t nextProfileRegion(Driver* driver)
+{
+    return ProfileNextChange(&driver->profile_ramp) ?
+        driver->acceleration_region + driver->acceleration_region_increment : driver->acceleration_region;
+}
+
+// starts prepared motion, only assignments are allowed here, it is called by the timer interrupt
+static GCODE_COMMAND_STATE startMotion(Driver* driver, const MotionProgram* motion)
+{
+    driver->current_segment = motion->segment;
+
+    // update final position of the head
+    driver->active_state->position.fetch_speed = motion->segment.fetch_speed;
+    driver->active_state->position.x += motion->segment.x;
+    driver->active_state->position.y += motion->segment.y;
+    driver->active_state->position.z += motion->segment.z;
+    driver->active_state->position.e += motion->segment.e;
+
+    driver->last_command_status = GCODE_OK;
+
     // program motors to performa requested amount of steps using max time segment
-    MOTOR_SetProgram(driver->motors[MOTOR_X], time, driver->current_segment.x);
-    MOTOR_SetProgram(driver->motors[MOTOR_Y], time, driver->current_segment.y);
-    MOTOR_SetProgram(driver->motors[MOTOR_Z], time, driver->current_segment.z);
-    MOTOR_SetProgram(driver->motors[MOTOR_E], time, driver->current_segment.e);
+    STEPPERGROUP_SetProgram(driver->steppers, MOTOR_X, motion->time, motion->segment.x);
+    STEPPERGROUP_SetProgram(driver->steppers, MOTOR_Y, motion->time, motion->segment.y);
+    STEPPERGROUP_SetProgram(driver->steppers, MOTOR_Z, motion->time, motion->segment.z);
+    STEPPERGROUP_SetProgram(driver->steppers, MOTOR_E, motion->time, motion->segment.e);
     
-    if (time)
+    driver->acceleration_segments = motion->acceleration_segments;
+    driver->acceleration_subsequent_region_length = 0;
+    if (motion->time)
     {
         driver->last_command_status = GCODE_INCOMPLETE;
 
-        if (driver->acceleration_enabled && segment_data->sequence_time)
+        if (motion->acceleration_segments)
         {
-            // at least one command form this acceleration region
-            // calculate length of contignous acceleration region by looking for segments with big angles, or another command
-            driver->acceleration_subsequent_region_length = segment_data->sequence_time;
-
-            parameterType fetch_speed_delta = (driver->current_segment.fetch_speed - MINIMAL_VELOCITY) / SECONDS_IN_MINUTE;
-            parameterType base_velocity = MINIMAL_VELOCITY / SECONDS_IN_MINUTE;
-            // if velocity is small assume that acceleration is required from 0 
-            // this is Z and E cases
-            if (fetch_speed_delta <= 0)
-            {
-                fetch_speed_delta = driver->current_segment.fetch_speed / SECONDS_IN_MINUTE;
-                base_velocity = 0;
-            }
-
-            uint32_t acceleration_time = MAIN_TIMER_FREQUENCY * fetch_speed_delta / STANDARD_ACCELERATION;
-
-            const uint32_t base_velocity_acceleration_time = MAIN_TIMER_FREQUENCY * base_velocity / STANDARD_ACCELERATION;
-            
-            // number of segments required to get the full speed;
-            driver->acceleration_segments = (base_velocity_acceleration_time + acceleration_time) / STANDARD_ACCELERATION_SEGMENT;
+            driver->acceleration_subsequent_region_length = motion->time;
             driver->acceleration_tick = 0;
 
-            driver->acceleration_distance = 0;
-            driver->acceleration_distance_increment = 1;
-
-            //Tricky thing. here we start not from 1/50th of max speed but from 1/10th
-            driver->acceleration_region = base_velocity_acceleration_time / STANDARD_ACCELERATION_SEGMENT + 1;
+            driver->acceleration_region = motion->acceleration_region;
             driver->acceleration_region_increment = 1;
+            driver->acceleration_peak_region = motion->peak_region;
+            driver->acceleration_exit_region = motion->exit_region;
+            driver->acceleration_braking_distance = motion->braking_distance;
+            startProfile(driver, motion->peak_region);
 
-            PULSE_SetPower(driver->accelerator, driver->acceleration_region);
+            PULSE_SetPower(driver->accelerator, accelerationPower(driver));
         }
     }
     driver->mode = MODE_MOVE;
     return driver->last_command_status;
+}
+
+// setup commands
+static GCODE_COMMAND_STATE setupMove(GCodeCommandParams* params, void* hdriver)
+{
+    Driver* driver = (Driver*)hdriver;
+    ExtendedGCodeCommandParams* segment_data = (ExtendedGCodeCommandParams*)params;
+    if (segment_data->g.fetch_speed <= 0)
+    {
+        return GCODE_ERROR_INVALID_PARAM;
+    }
+
+    MotionProgram motion;
+    prepareMotion(driver, segment_data, &driver->active_state->position, &motion);
+    return startMotion(driver, &motion);
 };
 
 static GCODE_COMMAND_STATE setupHome(GCodeCommandParams* params, void* hdriver)
@@ -325,14 +514,149 @@ static GCODE_COMMAND_STATE resumePrint(GCodeSubCommandParams* params, void* hdri
     return GCODE_OK;
 }
 
+static GCODE_COMMAND_STATE tuneRegulator(GCodeSubCommandParams* params, void* hdriver)
+{
+    Driver* driver = (Driver*)hdriver;
+    if (params->s <= 0 || params->p < 0 || params->p >= TERMO_REGULATOR_COUNT)
+    {
+        return GCODE_ERROR_INVALID_PARAM;
+    }
+
+    // the command is completed when the autotune is over, the heater is switched off then
+    PrinterTuneRegulator(hdriver, (TERMO_REGULATOR)params->p, (uint16_t)params->s);
+    driver->mode = MODE_AUTOTUNE;
+    driver->termo_regulators_state |= MODE_AUTOTUNE;
+    return GCODE_INCOMPLETE;
+}
+
+// decoder commands. They are executed by the main loop and fill the motion block for the timer interrupt
+static void copyCommand(Driver* driver)
+{
+    driver->decode_block->is_move = false;
+    memcpy(driver->decode_block->command, driver->decode_command, GCODE_CHUNK_SIZE);
+}
+
+static GCODE_COMMAND_STATE prepareCommand(GCodeCommandParams* params, void* hdriver)
+{
+    params = params;
+    copyCommand((Driver*)hdriver);
+    return GCODE_OK;
+}
+
+static GCODE_COMMAND_STATE prepareSubCommand(GCodeSubCommandParams* params, void* hdriver)
+{
+    params = params;
+    copyCommand((Driver*)hdriver);
+    return GCODE_OK;
+}
+
+static GCODE_COMMAND_STATE prepareMove(GCodeCommandParams* params, void* hdriver)
+{
+    Driver* driver = (Driver*)hdriver;
+    ExtendedGCodeCommandParams* segment_data = (ExtendedGCodeCommandParams*)params;
+    if (segment_data->g.fetch_speed <= 0)
+    {
+        // invalid command is executed by the timer interrupt to report the error in the right order
+        copyCommand(driver);
+        return GCODE_ERROR_INVALID_PARAM;
+    }
+
+    prepareMotion(driver, segment_data, &driver->decode_position, &driver->decode_block->motion);
+    driver->decode_block->is_move = true;
+    driver->decode_position = segment_data->g;
+    return GCODE_OK;
+}
+
+static GCODE_COMMAND_STATE prepareHome(GCodeCommandParams* params, void* hdriver)
+{
+    ExtendedGCodeCommandParams home_params = *((ExtendedGCodeCommandParams*)params);
+    home_params.g.fetch_speed = 1800;
+    return prepareMove(&home_params.g, hdriver);
+}
+
+static GCODE_COMMAND_STATE prepareSet(GCodeCommandParams* params, void* hdriver)
+{
+    Driver* driver = (Driver*)hdriver;
+    copyCommand(driver);
+    driver->decode_position = *params;
+    return GCODE_OK;
+}
+
+static GCODE_COMMAND_STATE prepareResume(GCodeSubCommandParams* params, void* hdriver)
+{
+    Driver* driver = (Driver*)hdriver;
+    params = params;
+    // the final position of resume is known after the execution only
+    copyCommand(driver);
+    driver->barrier = true;
+    return GCODE_OK;
+}
+
+// decodes loaded commands to the motion queue, called by the main loop only
+static void prepareBlocks(Driver* driver)
+{
+    if (!driver->queue_blocks)
+    {
+        return;
+    }
+
+    if (driver->barrier)
+    {
+        if (driver->blocks_head != driver->blocks_tail)
+        {
+            return;
+        }
+#ifndef FIRMWARE
+        if (driver->resume)
+        {
+            return;
+        }
+#endif
+        driver->barrier = false;
+        driver->decode_position = driver->active_state->position;
+    }
+
+    while (!driver->barrier && driver->decoded_commands < driver->print_commands &&
+           driver->blocks_head - driver->blocks_tail < driver->queue_blocks)
+    {
+        if (!driver->sector_ready)
+        {
+            if (driver->loaded_sectors == driver->consumed_sectors)
+            {
+                break;
+            }
+            driver->data_pointer = ringPage(driver, driver->consumed_sectors);
+            startSector(driver);
+            driver->sector_ready = true;
+        }
+
+        MotionBlock* block = &driver->blocks[driver->blocks_head % driver->queue_blocks];
+        driver->decode_block = block;
+        driver->decode_command = nextCommand(driver, driver->decode_caret);
+        GC_ExecuteFromBuffer(&driver->prepare_calls, driver, driver->decode_command);
+        ++driver->decoded_commands;
+
+        block->last_in_sector = (++driver->decode_caret == driver->sector_commands);
+        if (block->last_in_sector)
+        {
+            // the sector is completely decoded, release its page for loading
+            driver->decode_caret = 0;
+            driver->sector_ready = false;
+            ++driver->consumed_sectors;
+        }
+        ++driver->blocks_head;
+    }
+}
+
 // main body of driver code
 HDRIVER PrinterConfigure(DriverConfig* printer_cfg)
 {
 #ifndef FIRMWARE
 
     if (!printer_cfg || !printer_cfg->bytecode_storage || !printer_cfg->memory || !printer_cfg->axis_configuration ||
-        !printer_cfg->motors || !printer_cfg->motors[MOTOR_X] || !printer_cfg->motors[MOTOR_Y] || !printer_cfg->motors[MOTOR_Z] || !printer_cfg->motors[MOTOR_E] ||
-        !printer_cfg->termo_regulators || !printer_cfg->termo_regulators[TERMO_NOZZLE] || !printer_cfg->termo_regulators[TERMO_TABLE] || !printer_cfg->cooler_port)
+        !printer_cfg->steppers ||
+        !printer_cfg->termo_regulators || !printer_cfg->termo_regulators[TERMO_NOZZLE] || !printer_cfg->termo_regulators[TERMO_TABLE] || !printer_cfg->cooler_port ||
+        printer_cfg->prefetch_pages > MEMORY_PAGES_COUNT - PREFETCH_FIRST_PAGE)
     {
         return 0;
     }
@@ -359,9 +683,25 @@ HDRIVER PrinterConfigure(DriverConfig* printer_cfg)
     driver->setup_calls.subcommands[GCODE_WAIT_TABLE]              = setTableTemperatureBlocking;
     driver->setup_calls.subcommands[GCODE_SET_COOLER_SPEED]        = setCoolerSpeed;
     driver->setup_calls.subcommands[GCODE_START_RESUME]            = resumePrint;
+    driver->setup_calls.subcommands[GCODE_AUTOTUNE]                = tuneRegulator;
+
+    // setup decoder commands, everything except moves is copied to be executed by the timer interrupt
+    for (uint8_t i = 0; i < GCODE_COMMAND_COUNT; ++i)
+    {
+        driver->prepare_calls.commands[i] = prepareCommand;
+    }
+    for (uint8_t i = 0; i < GCODE_SUBCOMMAND_COUNT; ++i)
+    {
+        driver->prepare_calls.subcommands[i] = prepareSubCommand;
+    }
+    driver->prepare_calls.commands[GCODE_MOVE]                     = prepareMove;
+    driver->prepare_calls.commands[GCODE_HOME]                     = prepareHome;
+    driver->prepare_calls.commands[GCODE_SET]                      = prepareSet;
+    driver->prepare_calls.subcommands[GCODE_START_RESUME]          = prepareResume;
 
     // enables acceleration parameters: TODO: move to Initialize parameter
     driver->acceleration_enabled = printer_cfg->acceleration_enabled;
+    driver->acceleration_profile = printer_cfg->acceleration_profile;
     driver->accelerator = PULSE_Configure(PULSE_HIGHER);
     driver->acceleration_subsequent_region_length = 0;
     driver->acceleration_region                   = 0;
@@ -371,13 +711,15 @@ HDRIVER PrinterConfigure(DriverConfig* printer_cfg)
     driver->axis_cfg = printer_cfg->axis_configuration;
 
     // enables motors and termo regulators
-    driver->motors = printer_cfg->motors;
+    driver->steppers = printer_cfg->steppers;
     driver->regulators = printer_cfg->termo_regulators;
     
     // resets printer state
     driver->mode = MODE_IDLE;
     driver->tick_index = 0;
     driver->termo_regulators_state = 0;
+    driver->tuned_regulator = TERMO_NOZZLE;
+    driver->save_gains = false;
 
     // setup nozzle cooler
     driver->cooler = PULSE_Configure(PULSE_LOWER);
@@ -386,7 +728,16 @@ HDRIVER PrinterConfigure(DriverConfig* printer_cfg)
 
     // setup printer motion state
     driver->active_state = &driver->state;
-    driver->pre_load_required = false;
+
+    // the ring requires at least one page to execute commands from and one page to load the next sector
+    driver->prefetch_pages = printer_cfg->prefetch_pages < 2 ? 2 : printer_cfg->prefetch_pages;
+    driver->ring_pages = 0;
+    driver->loading = false;
+    driver->load_status = SDCARD_OK;
+
+    driver->motion_blocks = printer_cfg->motion_blocks;
+    driver->queue_blocks = 0;
+    driver->blocks = driver->motion_blocks ? DeviceAlloc(driver->motion_blocks * sizeof(MotionBlock)) : 0;
 
     // Resets accelerator and cooler state
     PULSE_SetPeriod(driver->accelerator, STANDARD_ACCELERATION_SEGMENT);
@@ -408,6 +759,7 @@ PRINTER_STATUS PrinterReadControlBlock(HDRIVER hdriver, PrinterControlBlock* con
 
     Driver* driver = (Driver*)hdriver;
 
+    waitLoading(driver);
     SDCARD_ReadSingleBlock(driver->storage, driver->memory->pages[STATE_PAGE], CONTROL_BLOCK_POSITION);
     *control_block = *(PrinterControlBlock*)driver->memory->pages[STATE_PAGE];
     if (control_block->secure_id != CONTROL_BLOCK_SEC_CODE)
@@ -438,8 +790,10 @@ PRINTER_STATUS PrinterInitialize(HDRIVER hdriver)
     driver->tick_index = 0;
     driver->termo_regulators_state = 0;
     driver->last_command_status = GCODE_OK;
-    driver->pre_load_required = false;
+    driver->ring_pages = 0;
+    driver->queue_blocks = 0;
 
+    waitLoading(driver);
     restoreState(driver);
 
     return PRINTER_OK;
@@ -454,9 +808,8 @@ PRINTER_STATUS PrinterPrintFromBuffer(HDRIVER hdriver, const uint8_t* command_st
         return PRINTER_INVALID_PARAMETER;
     }
 
-    driver->main_load_page                  = MAIN_COMMANDS_PAGE;
-    driver->secondary_load_page             = PRELOAD_COMMANDS_PAGE;
-
+    // ring pages are not used by the buffer, but the pending read still updates the ring state
+    waitLoading(driver);
     driver->resume                          = false;
     driver->material_override               = 0;
     driver->service_state                   = *driver->active_state;
@@ -467,8 +820,11 @@ PRINTER_STATUS PrinterPrintFromBuffer(HDRIVER hdriver, const uint8_t* command_st
     driver->active_state->caret_position    = 0;
     driver->commands_count                  = commands_count;
     driver->data_pointer                    = command_stream;
-    driver->pre_load_required               = false;
+    driver->ring_pages                      = 0;
+    driver->queue_blocks                    = 0;
     driver->acceleration_region             = 0;
+    driver->storage_format                  = GCODE_FORMAT_CHUNKS;
+    startSector(driver);
 
     PULSE_SetPower(driver->accelerator, STANDARD_ACCELERATION_SEGMENT);
 
@@ -516,34 +872,134 @@ PRINTER_STATUS PrinterPrintFromCache(HDRIVER hdriver, MaterialFile * material_ov
         driver->last_command_status = setTableTemperatureBlocking(&temperature, hdriver);
     }
 
-    // read data for the current sector to start/continue print
-    driver->main_load_page = MAIN_COMMANDS_PAGE;
-    driver->secondary_load_page = PRELOAD_COMMANDS_PAGE;
-
-    SDCARD_ReadSingleBlock(driver->storage, driver->memory->pages[driver->main_load_page], driver->active_state->current_sector);
-    driver->data_pointer = driver->memory->pages[driver->main_load_page];
-    driver->pre_load_required = true;
+    // read data for the current sector to start/continue print, the rest of the ring is filled by PrinterLoadData
+    driver->ring_pages       = driver->prefetch_pages;
+    driver->consumed_sectors = 0;
+    driver->loaded_sectors   = 0;
+    driver->stalls_count     = 0;
+    driver->stalled          = false;
+    driver->load_status      = SDCARD_OK;
+    driver->print_commands   = driver->commands_count - driver->active_state->current_command;
+
+    driver->data_pointer = ringPage(driver, 0);
+    SDCARD_ReadSingleBlock(driver->storage, (uint8_t*)driver->data_pointer, driver->active_state->current_sector);
+    driver->loaded_sectors = 1;
+    driver->next_sector    = driver->active_state->current_sector + 1;
+
+    driver->storage_format = control_block.storage_format;
+    startSector(driver);
+    driver->loaded_commands = driver->sector_commands - driver->active_state->caret_position;
+    if (GCODE_FORMAT_COMPACT == driver->storage_format)
+    {
+        // compact commands have variable length, skip already executed commands of the sector
+        for (uint8_t i = 0; i < driver->active_state->caret_position; ++i)
+        {
+            nextCommand(driver, i);
+        }
+    }
     PULSE_SetPower(driver->accelerator, STANDARD_ACCELERATION_SEGMENT);
 
+    // decoder starts from the current command of the loaded sector
+    driver->queue_blocks     = driver->motion_blocks;
+    driver->blocks_head      = 0;
+    driver->blocks_tail      = 0;
+    driver->decoded_commands = 0;
+    driver->decode_caret     = driver->active_state->caret_position;
+    driver->sector_ready     = true;
+    driver->barrier          = false;
+    driver->decode_position  = driver->active_state->position;
+#ifndef FIRMWARE
+    if (driver->resume)
+    {
+        // timer interrupt returns the head to the paused position before the first command
+        driver->decode_position = driver->active_state->actual_position;
+    }
+#endif
+    prepareBlocks(driver);
+
     return status;
 }
 
-PRINTER_STATUS PrinterLoadData(HDRIVER hdriver)
+static PRINTER_STATUS loadSectors(Driver* driver)
 {
-    Driver* driver = (Driver*)hdriver;
-    if (driver->pre_load_required)
+    if (isLoading(driver))
     {
-        if (SDCARD_OK != SDCARD_ReadSingleBlock(driver->storage, driver->memory->pages[driver->secondary_load_page], driver->active_state->current_sector + 1))
+        return PRINTER_OK;
+    }
+
+    // keep the ring as full as possible, but don't read sectors behind the last command
+    while (SDCARD_OK == driver->load_status && driver->ring_pages && driver->loaded_sectors - driver->consumed_sectors < driver->ring_pages &&
+           driver->loaded_commands < driver->print_commands)
+    {
+        // ring pages are adjacent in the memory pool, so all free pages up to the end of the ring are
+        // loaded by a single multi-block read. Ring head is not overwritten, it is still executed
+        uint32_t slot = driver->loaded_sectors % driver->ring_pages;
+        uint32_t count = driver->ring_pages - (driver->loaded_sectors - driver->consumed_sectors);
+        if (count > driver->ring_pages - slot)
+        {
+            count = driver->ring_pages - slot;
+        }
+
+        // every sector contains at least one command, chunks sectors are always full
+        uint32_t required = driver->print_commands - driver->loaded_commands;
+        if (GCODE_FORMAT_COMPACT != driver->storage_format)
+        {
+            required = (required + SDCARD_BLOCK_SIZE / GCODE_CHUNK_SIZE - 1) / (SDCARD_BLOCK_SIZE / GCODE_CHUNK_SIZE);
+        }
+        if (count > required)
+        {
+            count = required;
+        }
+
+        driver->loading_count = count;
+        driver->loading = true;
+        if (SDCARD_OK != SDCARD_ReadAsync(driver->storage, ringPage(driver, driver->loaded_sectors), driver->next_sector, count, onSectorsLoaded, driver))
         {
+            driver->loading = false;
             return PRINTER_RAM_FAILURE;
         }
-        driver->pre_load_required = false;
+
+        // the rest of the transfer is advanced by the next calls, printer continues other main loop work meanwhile
+        if (isLoading(driver))
+        {
+            return PRINTER_OK;
+        }
+    }
+
+    // failed read is reported once, the next call retries it
+    if (SDCARD_OK != driver->load_status)
+    {
+        driver->load_status = SDCARD_OK;
+        return PRINTER_RAM_FAILURE;
     }
     return PRINTER_OK;
 }
 
+// saves the gains once the autotune is over, failed autotune keeps the stored gains
+static PRINTER_STATUS saveTunedGains(Driver* driver)
+{
+    TR_MODE mode = TR_GetMode(driver->regulators[driver->tuned_regulator]);
+    if (!driver->save_gains || TR_MODE_AUTOTUNE == mode)
+    {
+        return PRINTER_OK;
+    }
+
+    driver->save_gains = false;
+    return (TR_MODE_PID == mode) ? PrinterSaveRegulatorGains((HDRIVER)driver) : PRINTER_OK;
+}
+
+PRINTER_STATUS PrinterLoadData(HDRIVER hdriver)
+{
+    Driver* driver = (Driver*)hdriver;
+
+    PRINTER_STATUS status = loadSectors(driver);
+    prepareBlocks(driver);
+    return (PRINTER_OK == status) ? saveTunedGains(driver) : status;
+}
+
 PRINTER_STATUS PrinterSaveState(HDRIVER hdriver)
 {
+    waitLoading((Driver*)hdriver);
     return saveState(0, hdriver);
 }
 
@@ -559,6 +1015,12 @@ PRINTER_STATUS PrinterGetStatus(HDRIVER hdriver)
     return driver->last_command_status;
 }
 
+uint32_t PrinterGetStallsCount(HDRIVER hdriver)
+{
+    Driver* driver = (Driver*)hdriver;
+    return driver->stalls_count;
+}
+
 uint32_t PrinterGetAccelerationRegion(HDRIVER hdriver)
 {
     Driver* driver = (Driver*)hdriver;
@@ -595,11 +1057,13 @@ PRINTER_STATUS PrinterNextCommand(HDRIVER hdriver)
         // beacuse it calls itself in the end
         
         
-        ExtendedGCodeCommandParams extended_params = {driver->active_state->actual_position, 0, 0};
+        ExtendedGCodeCommandParams extended_params = {driver->active_state->actual_position, 0, 0, 0};
         extended_params.segment_time = CalculateSegmentTime(driver->axis_cfg, 
             &driver->active_state->actual_position, 
             &driver->active_state->position);
-        extended_params.sequence_time = extended_params.segment_time;
+        // the head starts and stops with the minimal velocity
+        extended_params.entry_speed = MINIMAL_VELOCITY;
+        extended_params.exit_speed  = MINIMAL_VELOCITY;
 
         driver->last_command_status = setupHome(&extended_params, driver);
         driver->resume = false;
@@ -607,30 +1071,56 @@ PRINTER_STATUS PrinterNextCommand(HDRIVER hdriver)
     } 
 #endif 
 
-    if (driver->commands_count - driver->active_state->current_command)
+    if (driver->queue_blocks && driver->commands_count - driver->active_state->current_command)
+    {
+        // start the prepared block, the main loop decodes the next ones
+        if (driver->blocks_head == driver->blocks_tail)
+        {
+            driver->stalls_count += driver->stalled ? 0 : 1;
+            driver->stalled = true;
+            driver->last_command_status = GCODE_OK;
+            return PRINTER_PRELOAD_REQUIRED;
+        }
+        driver->stalled = false;
+
+        ++driver->active_state->current_command;
+        const MotionBlock* block = &driver->blocks[driver->blocks_tail % driver->queue_blocks];
+        driver->last_command_status = block->is_move ? startMotion(driver, &block->motion) : GC_ExecuteFromBuffer(&driver->setup_calls, driver, block->command);
+        ++driver->active_state->caret_position;
+        if (block->last_in_sector)
+        {
+            driver->active_state->caret_position = 0;
+            ++driver->active_state->current_sector;
+        }
+        ++driver->blocks_tail;
+    }
+    else if (driver->commands_count - driver->active_state->current_command)
     {
         // dont advance in commands execution if next data block is not ready
-        if (driver->pre_load_required && driver->active_state->caret_position + 1 == SDCARD_BLOCK_SIZE / GCODE_CHUNK_SIZE)
+        if (driver->ring_pages && driver->active_state->caret_position + 1 == driver->sector_commands &&
+            driver->commands_count - driver->active_state->current_command > 1 &&
+            driver->loaded_sectors - driver->consumed_sectors < 2)
         {
+            driver->stalls_count += driver->stalled ? 0 : 1;
+            driver->stalled = true;
             driver->last_command_status = GCODE_OK;
             return PRINTER_PRELOAD_REQUIRED;
         };
+        driver->stalled = false;
 
         // execute the next command
         ++driver->active_state->current_command;
         static int cmd_number = 0;
         ++cmd_number;
-        driver->last_command_status = GC_ExecuteFromBuffer(&driver->setup_calls, driver, driver->data_pointer + (size_t)(GCODE_CHUNK_SIZE * driver->active_state->caret_position));
-        if (++driver->active_state->caret_position == SDCARD_BLOCK_SIZE / GCODE_CHUNK_SIZE)
+        driver->last_command_status = GC_ExecuteFromBuffer(&driver->setup_calls, driver, nextCommand(driver, driver->active_state->caret_position));
+        if (++driver->active_state->caret_position == driver->sector_commands)
         {
-            // if the last command in the block is executed, swap current buffer by the preloaded one and request for the next block to be loaded
-            MEMORY_PAGES tmp = driver->main_load_page;
-            driver->main_load_page = driver->secondary_load_page;
-            driver->secondary_load_page = tmp;
-            driver->data_pointer = driver->memory->pages[driver->main_load_page];
+            // if the last command in the block is executed, move to the next sector of the ring and release the page for loading
+            driver->data_pointer = driver->ring_pages ? ringPage(driver, driver->consumed_sectors + 1) : driver->data_pointer + SDCARD_BLOCK_SIZE;
             driver->active_state->caret_position = 0;
             ++driver->active_state->current_sector;
-            driver->pre_load_required = true;
+            ++driver->consumed_sectors;
+            startSector(driver);
         }
     }
 
@@ -655,12 +1145,94 @@ uint16_t PrinterGetCurrentT(HDRIVER hdriver, TERMO_REGULATOR regulator)
     return TR_GetCurrentTemperature(driver->regulators[regulator]);
 }
 
+PRINTER_STATUS PrinterTuneRegulator(HDRIVER hdriver, TERMO_REGULATOR regulator, uint16_t temperature)
+{
+#ifndef FIRMWARE
+
+    if (regulator >= TERMO_REGULATOR_COUNT)
+    {
+        return PRINTER_INVALID_PARAMETER;
+    }
+
+#endif
+
+    Driver* driver = (Driver*)hdriver;
+    driver->active_state->temperature[regulator] = temperature;
+    driver->tuned_regulator = regulator;
+    driver->save_gains      = true;
+    TR_StartAutotune(driver->regulators[regulator], temperature);
+    return PRINTER_OK;
+}
+
+PRINTER_STATUS PrinterSaveRegulatorGains(HDRIVER hdriver)
+{
+    Driver* driver = (Driver*)hdriver;
+
+    waitLoading(driver);
+    RegulatorBlock* block = (RegulatorBlock*)driver->memory->pages[STATE_PAGE];
+    memset(block, 0, SDCARD_BLOCK_SIZE);
+    block->security_code = REGULATOR_SEC_CODE;
+    for (uint32_t i = 0; i < TERMO_REGULATOR_COUNT; ++i)
+    {
+        if (TR_MODE_PID == TR_GetMode(driver->regulators[i]))
+        {
+            block->tuned_regulators |= 1U << i;
+            TR_GetGains(driver->regulators[i], &block->gains[i]);
+        }
+    }
+
+    if (SDCARD_OK != SDCARD_WriteSingleBlock(driver->storage, driver->memory->pages[STATE_PAGE], REGULATOR_BLOCK_POSITION))
+    {
+        return PRINTER_RAM_FAILURE;
+    }
+    return PRINTER_OK;
+}
+
+PRINTER_STATUS PrinterLoadRegulatorGains(HDRIVER hdriver)
+{
+    Driver* driver = (Driver*)hdriver;
+
+    waitLoading(driver);
+    if (SDCARD_OK != SDCARD_ReadSingleBlock(driver->storage, driver->memory->pages[STATE_PAGE], REGULATOR_BLOCK_POSITION))
+    {
+        return PRINTER_RAM_FAILURE;
+    }
+
+    const RegulatorBlock* block = (const RegulatorBlock*)driver->memory->pages[STATE_PAGE];
+    if (REGULATOR_SEC_CODE != block->security_code)
+    {
+        return PRINTER_INVALID_CONTROL_BLOCK;
+    }
+    for (uint32_t i = 0; i < TERMO_REGULATOR_COUNT; ++i)
+    {
+        if (block->tuned_regulators & (1U << i))
+        {
+            TR_SetGains(driver->regulators[i], &block->gains[i]);
+        }
+    }
+    return PRINTER_OK;
+}
+
 uint8_t PrinterGetCoolerSpeed(HDRIVER hdriver)
 {
     Driver* driver = (Driver*)hdriver;
     return (uint8_t)PULSE_GetPower(driver->cooler);
 }
 
+uint16_t PrinterGetVelocity(HDRIVER hdriver)
+{
+    Driver* driver = (Driver*)hdriver;
+    if (!(driver->mode & MODE_MOVE))
+    {
+        return 0;
+    }
+    if (driver->acceleration_enabled && driver->acceleration_segments && driver->acceleration_region < driver->acceleration_segments)
+    {
+        return (uint16_t)(driver->current_segment.fetch_speed * driver->acceleration_region / driver->acceleration_segments);
+    }
+    return (uint16_t)driver->current_segment.fetch_speed;
+}
+
 uint8_t PrinterGetAccelTimerPower(HDRIVER hdriver)
 {
     Driver* driver = (Driver*)hdriver;
@@ -681,6 +1253,10 @@ PRINTER_STATUS PrinterExecuteCommand(HDRIVER hdriver)
             TR_HandleTick(driver->regulators[i]);
             driver->termo_regulators_state |= (driver->mode & modes[i]) && !TR_IsTemperatureReached(driver->regulators[i]) ? modes[i] : 0;
         }
+        if ((driver->mode & MODE_AUTOTUNE) && TR_MODE_AUTOTUNE == TR_GetMode(driver->regulators[driver->tuned_regulator]))
+        {
+            driver->termo_regulators_state |= MODE_AUTOTUNE;
+        }
     }
 
     if (0 == driver->tick_index % (MAIN_TIMER_FREQUENCY / COOLER_RESOLUTION_PER_SECOND))
@@ -695,57 +1271,50 @@ PRINTER_STATUS PrinterExecuteCommand(HDRIVER hdriver)
         driver->tick_index = 0;
     }
 
-    // Acceleration region is on a both sides of subsequent regions
-    // Length of braking region is calculated and equal to acceleration region
-    if ((driver->acceleration_enabled) && (driver->acceleration_segments) &&
-        ((driver->acceleration_region < driver->acceleration_segments) ||
-        (driver->acceleration_subsequent_region_length <= (driver->acceleration_distance - 1))))
+    // Segment is accelerated from the entry region to the peak one and brakes to the exit region.
+    // Braking starts when the rest of the segment is equal to the braking distance
+    if ((driver->acceleration_enabled) && (driver->acceleration_segments))
     {
-        // Reaching apogee point in a middle of acceleration lead to revert of steps count an acceleration, 
-        // This gave symetric picture of acceleration/braking pair. but dufference can be in 1 segment, due to 
-        // Non symmetrical directions of signals in the pulse_engine.
-        if (driver->acceleration_distance > driver->acceleration_subsequent_region_length && 
-            driver->acceleration_distance_increment)
+        if (driver->acceleration_region_increment >= 0 &&
+            driver->acceleration_subsequent_region_length <= driver->acceleration_braking_distance)
         {
             driver->acceleration_region_increment = -1;
-            driver->acceleration_tick = STANDARD_ACCELERATION_SEGMENT - driver->acceleration_tick;
-            driver->acceleration_distance_increment = 0;
+            driver->acceleration_tick = 0;
+            startProfile(driver, driver->acceleration_exit_region);
         }
 
         ++driver->acceleration_tick;
         if (STANDARD_ACCELERATION_SEGMENT <= driver->acceleration_tick)
         {
-            //FIXME: 
-            // hmm, after all steps are passed 1 step remains on power lower than minimal requested
-            // need to understand why is this +1 happened...
             driver->acceleration_tick = 0;
-            if (driver->acceleration_region)
+            if (ACCELERATION_PROFILE_SCURVE == driver->acceleration_profile)
+            {
+                driver->acceleration_region = nextProfileRegion(driver);
+            }
+            else
             {
                 driver->acceleration_region += driver->acceleration_region_increment;
-                uint32_t acceleration_power = (driver->acceleration_region * STANDARD_ACCELERATION_SEGMENT)/driver->acceleration_segments;
-                if (0 == acceleration_power)
+                if (driver->acceleration_region > driver->acceleration_peak_region)
+                {
+                    driver->acceleration_region = driver->acceleration_peak_region;
+                }
+                if (driver->acceleration_region_increment < 0 && driver->acceleration_region < driver->acceleration_exit_region)
                 {
-                    acceleration_power = 1;
+                    driver->acceleration_region = driver->acceleration_exit_region;
                 }
-                PULSE_SetPower(driver->accelerator, acceleration_power);
             }
+            PULSE_SetPower(driver->accelerator, accelerationPower(driver));
         }
 
-        if (!PULSE_HandleTick(driver->accelerator))
+        if (driver->acceleration_region < driver->acceleration_segments && !PULSE_HandleTick(driver->accelerator))
         {
             return driver->last_command_status;
         }
-
-        driver->acceleration_distance += driver->acceleration_distance_increment;
     }
 
     // do actual steps
-    uint8_t state = driver->termo_regulators_state;
-    for (uint8_t i = 0; i < MOTOR_COUNT; ++i)
-    {
-        MOTOR_HandleTick(driver->motors[i]);
-        state |= MOTOR_GetState(driver->motors[i]);
-    }
+    STEPPERGROUP_Step(driver->steppers, STEPPERGROUP_HandleTick(driver->steppers));
+    uint8_t state = driver->termo_regulators_state | STEPPERGROUP_GetBusyMask(driver->steppers);
 
     // if all steps done and required temperature reached, move to the next command
     if (0 == state)
@@ -10,7 +10,7 @@
 
 #include "include/gcode.h"
 #include "include/user_interface.h"
-#include "include/motor.h"
+#include "include/stepper_group.h"
 #include "include/termal_regulator.h"
 #include "printer_entities.h"
 #include "printer_memory_manager.h"
@@ -33,9 +33,8 @@ typedef struct
     // internal Flash drive
     HSDCARD bytecode_storage;
 
-    // Configuration settings of printer motors.
-    // size == MOTOR_COUNT
-    HMOTOR* motors;
+    // Printer motors stepped together, axis of the group is MOTOR_TYPES
+    HSTEPPERGROUP steppers;
 
     // Termal sensors configuration
     // size == TERMO_REGULATOR_COUNT
@@ -53,6 +52,17 @@ typedef struct
     PRINTER_ACCELERATION acceleration_enabled;
 
     FIL* log_file;
+
+    // Number of memory pages used to prefetch printing commands from the internal storage.
+    // Pages are taken after the state page, 0 selects double buffering.
+    uint8_t prefetch_pages;
+
+    // Number of motion blocks prepared ahead by the main loop while printing from the internal storage.
+    // 0 decodes commands in the timer interrupt.
+    uint8_t motion_blocks;
+
+    // Velocity profile of the acceleration and braking, used when acceleration is enabled
+    ACCELERATION_PROFILE acceleration_profile;
 } DriverConfig;
 
 /// <summary>
@@ -79,7 +89,10 @@ HDRIVER        PrinterConfigure(DriverConfig* printer_cfg);
 PRINTER_STATUS PrinterReadControlBlock(HDRIVER hdriver, PrinterControlBlock* control_block);
 
 /// <summary>
-/// Loads the next segment of printing commands list if driver requested it. 
+/// Fills the prefetch ring by the next segments of printing commands list. 
+/// Sectors are read asynchronously, the call doesn't wait for the storage and the next calls continue the read.
+/// If motion blocks are configured, loaded commands are decoded to the queue of prepared motion blocks.
+/// Gains measured by the completed autotune are saved to the internal storage.
 /// </summary>
 /// <param name="hdriver">Handle on the valid printing driver</param>
 /// <returns>PRINTER_OK in case of success or error code</returns>
@@ -186,6 +199,32 @@ uint16_t PrinterGetTargetT(HDRIVER hdriver, TERMO_REGULATOR regulator);
 /// <returns>Current temperature in Celsies</returns>
 uint16_t PrinterGetCurrentT(HDRIVER hdriver, TERMO_REGULATOR regulator);
 
+/// <summary>
+/// Starts the relay autotune of the termo regulator, M303 S[temperature] P[regulator] does the same from the file.
+/// Once it is completed the regulator works with the PID control and the next PrinterLoadData call saves its gains
+/// by PrinterSaveRegulatorGains
+/// </summary>
+/// <param name="hdriver">Handle on the valid printing driver</param>
+/// <param name="regulator">ID of the termo regulator to be tuned</param>
+/// <param name="temperature">Temperature the regulator is tuned at</param>
+/// <returns>PRINTER_OK in case of success or error code</returns>
+PRINTER_STATUS PrinterTuneRegulator(HDRIVER hdriver, TERMO_REGULATOR regulator, uint16_t temperature);
+
+/// <summary>
+/// Saves gains of the termo regulators with the PID control to the internal storage
+/// </summary>
+/// <param name="hdriver">Handle on the valid printing driver</param>
+/// <returns>PRINTER_OK in case of success or error code</returns>
+PRINTER_STATUS PrinterSaveRegulatorGains(HDRIVER hdriver);
+
+/// <summary>
+/// Loads gains of the termo regulators from the internal storage and switches them to the PID control.
+/// Regulators without stored gains keep their control mode
+/// </summary>
+/// <param name="hdriver">Handle on the valid printing driver</param>
+/// <returns>PRINTER_OK in case of success, PRINTER_INVALID_CONTROL_BLOCK if gains aren't stored</returns>
+PRINTER_STATUS PrinterLoadRegulatorGains(HDRIVER hdriver);
+
 /// <summary>
 /// Returns current nozzle cooler speed
 /// </summary>
@@ -193,6 +232,13 @@ uint16_t PrinterGetCurrentT(HDRIVER hdriver, TERMO_REGULATOR regulator);
 /// <returns>Cooler speed in range [0-255]</returns>
 uint8_t PrinterGetCoolerSpeed(HDRIVER hdriver);
 
+/// <summary>
+/// Returns number of times the printing was stopped because the next sector was not loaded in time
+/// </summary>
+/// <param name="hdriver">Handle on the valid printing driver</param>
+/// <returns>Number of stalls since the print start</returns>
+uint32_t PrinterGetStallsCount(HDRIVER hdriver);
+
 /// <summary>
 /// Test command. Returns the length of acceleration region
 /// </summary>
@@ -214,6 +260,13 @@ GCodeCommandParams* PrinterGetCurrentPath(HDRIVER hdriver);
 /// <returns>Fetch speed and position in motor steps</returns>
 GCodeCommandParams* PrinterGetCurrentPosition(HDRIVER hdriver);
 
+/// <summary>
+/// Test function. Returns current velocity of the head set by the acceleration profile
+/// </summary>
+/// <param name="hdriver">Handle on the valid printing driver</param>
+/// <returns>Velocity in mm/min, 0 if the head doesn't move</returns>
+uint16_t PrinterGetVelocity(HDRIVER hdriver);
+
 /// <summary>
 /// Test function. Returns current acceleration timer value
 /// </summary>
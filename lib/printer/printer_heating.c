@@ -0,0 +1,109 @@
+#include "printer_heating.h"
+
+#include <string.h>
+
+// the first extruding move ends the preamble, the deferred waits are stored before it
+static HEATING_RESULT endPreamble(HeatingScheduler* scheduler)
+{
+    scheduler->preamble = false;
+    return scheduler->count ? HEATING_BREAK : HEATING_PASS;
+}
+
+static HEATING_RESULT appendMove(HeatingScheduler* scheduler, const uint8_t* command)
+{
+    const GCodeCommandParams* point = (const GCodeCommandParams*)(command + sizeof(parameterType));
+    switch (command[0])
+    {
+    case GCODE_MOVE:
+        if (point->e > scheduler->e)
+        {
+            return endPreamble(scheduler);
+        }
+        scheduler->e = point->e;
+        return HEATING_PASS;
+    case GCODE_SET:
+        scheduler->e = point->e;
+        return HEATING_PASS;
+    case GCODE_HOME:
+        return HEATING_PASS;
+    }
+    // saved position and state are restored with the heated nozzle
+    return endPreamble(scheduler);
+}
+
+void HeatingReset(HeatingScheduler* scheduler, bool enable)
+{
+    memset(scheduler, 0, sizeof(HeatingScheduler));
+    scheduler->preamble = enable;
+}
+
+HEATING_RESULT HeatingAppend(HeatingScheduler* scheduler, uint8_t* command)
+{
+    if (!scheduler->preamble)
+    {
+        return HEATING_PASS;
+    }
+    if (*(const parameterType*)command & GCODE_COMMAND)
+    {
+        return appendMove(scheduler, command);
+    }
+
+    TERMO_REGULATOR heater = TERMO_NOZZLE;
+    bool wait = false;
+    switch (command[0])
+    {
+    case GCODE_SET_NOZZLE_TEMPERATURE:
+        break;
+    case GCODE_WAIT_NOZZLE:
+        wait = true;
+        break;
+    case GCODE_SET_TABLE_TEMPERATURE:
+        heater = TERMO_TABLE;
+        break;
+    case GCODE_WAIT_TABLE:
+        heater = TERMO_TABLE;
+        wait = true;
+        break;
+    case GCODE_SET_COOLER_SPEED:
+        return HEATING_PASS;
+    default:
+        return endPreamble(scheduler);
+    }
+
+    // the heater is changed again before the print, so the deferred waits keep their order with the change
+    if (scheduler->pending & (1U << heater))
+    {
+        return HEATING_BREAK;
+    }
+
+    const GCodeSubCommandParams* params = (const GCodeSubCommandParams*)(command + sizeof(parameterType));
+    bool has_target = scheduler->has_target[heater] && scheduler->target[heater] == params->s;
+    scheduler->target[heater]     = params->s;
+    scheduler->has_target[heater] = true;
+
+    // zero temperature switches the heater off without waiting
+    if (!wait || params->s <= 0)
+    {
+        return HEATING_PASS;
+    }
+
+    memcpy(scheduler->waits[scheduler->count], command, GCODE_CHUNK_SIZE);
+    ++scheduler->count;
+    scheduler->pending |= 1U << heater;
+    if (has_target)
+    {
+        return HEATING_DEFERRED;
+    }
+
+    // heating is started by the set command in place of the wait
+    command[0] = (TERMO_NOZZLE == heater) ? GCODE_SET_NOZZLE_TEMPERATURE : GCODE_SET_TABLE_TEMPERATURE;
+    return HEATING_PASS;
+}
+
+uint8_t HeatingFlush(HeatingScheduler* scheduler)
+{
+    uint8_t count = scheduler->count;
+    scheduler->count   = 0;
+    scheduler->pending = 0;
+    return count;
+}
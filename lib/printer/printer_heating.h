@@ -0,0 +1,62 @@
+#include "main.h"
+#include "printer_entities.h"
+
+#include <stdbool.h>
+
+#ifndef __PRINTER_HEATING__
+#define __PRINTER_HEATING__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Overlaps heating with the preamble of the file. Slicers wait for the table and then for the nozzle before homing,
+// so the heaters are heated one after another while the head stands. Till the first extruding move the waits are
+// deferred: the heater target is set at once and the wait is stored right before the first extrusion, so both heaters
+// are heated together while the head is homed and travels to the start of the print
+typedef struct
+{
+    bool               preamble;                                    // the first extruding move isn't reached yet
+    parameterType      e;                                           // absolute E of the head after the last move
+    parameterType      target[TERMO_REGULATOR_COUNT];               // the last temperature set to the heater
+    bool               has_target[TERMO_REGULATOR_COUNT];
+    uint8_t            pending;                                     // mask of the heaters with the deferred wait
+    uint8_t            count;                                       // amount of the deferred waits
+    uint8_t            waits[TERMO_REGULATOR_COUNT][GCODE_CHUNK_SIZE]; // deferred wait commands in the file order
+} HeatingScheduler;
+
+typedef enum
+{
+    HEATING_PASS = 0,       // the command is stored as is
+    HEATING_DEFERRED,       // the wait is deferred and the command shouldn't be stored
+    HEATING_BREAK,          // the deferred waits have to be flushed before the command and the command is appended again
+} HEATING_RESULT;
+
+/// <summary>
+/// Prepares scheduler for the new file
+/// </summary>
+/// <param name="scheduler">scheduler to be reset</param>
+/// <param name="enable">true defers the waits of the preamble, false passes all commands as is</param>
+void HeatingReset(HeatingScheduler* scheduler, bool enable);
+
+/// <summary>
+/// Appends the next command of the file. The deferred wait of the heater without the same target
+/// is replaced by the set temperature command in the buffer, the replaced command is stored
+/// </summary>
+/// <param name="scheduler">heating scheduler</param>
+/// <param name="command">command in the GCODE_CHUNK_SIZE format</param>
+/// <returns>HEATING_PASS if the command has to be stored</returns>
+HEATING_RESULT HeatingAppend(HeatingScheduler* scheduler, uint8_t* command);
+
+/// <summary>
+/// Releases the deferred waits, they are kept in the waits buffer and have to be stored in order
+/// </summary>
+/// <param name="scheduler">heating scheduler</param>
+/// <returns>amount of the released waits</returns>
+uint8_t HeatingFlush(HeatingScheduler* scheduler);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__PRINTER_HEATING__
@@ -1,4 +1,5 @@
 #include "printer_file_manager.h"
+#include "printer_math.h"
 
 #include <assert.h>
 #include <math.h>
@@ -60,4 +61,42 @@ uint32_t CalculateSegmentTime(const GCodeAxisConfig* axis_cfg,
 double Dot(const GCodeCommandParams* vector1, const GCodeCommandParams* vector2)
 {
     return (double)vector1->x * vector2->x + (double)vector1->y * vector2->y + (double)vector1->z * vector2->z;
-}
\ No newline at end of file
+}
+
+void ProfileStartRamp(ProfileRamp* ramp, uint32_t regions)
+{
+    ramp->changes     = PROFILE_RAMP_LENGTH * regions;
+    ramp->half        = regions;
+    ramp->increment   = 1;
+    ramp->region_size = 2 * regions;
+    // half of the region rounds the sum to the nearest region
+    ramp->sum         = regions;
+}
+
+bool ProfileNextChange(ProfileRamp* ramp)
+{
+    if (!ramp->changes)
+    {
+        return false;
+    }
+
+    bool next = false;
+    ramp->sum += ramp->increment;
+    if (ramp->sum >= ramp->region_size)
+    {
+        ramp->sum -= ramp->region_size;
+        next = true;
+    }
+
+    // acceleration grows by the first half of the ramp and falls by the second one, it is kept in the middle
+    --ramp->changes;
+    if (ramp->changes > ramp->half)
+    {
+        ramp->increment += 2;
+    }
+    else if (ramp->changes < ramp->half)
+    {
+        ramp->increment -= 2;
+    }
+    return next;
+}
@@ -1,6 +1,8 @@
 #include "main.h"
 #include "printer_entities.h"
 
+#include <stdbool.h>
+
 #ifndef __PRINTER_MATH__
 #define __PRINTER_MATH__
 
@@ -16,6 +18,37 @@ uint32_t CalculateSegmentTime(const GCodeAxisConfig* axis_cfg,
 
 double Dot(const GCodeCommandParams* vector1, const GCodeCommandParams* vector2);
 
+// S-curve of the jerk limited velocity change. Acceleration grows linearly in the first half of the ramp and falls
+// in the second one, the speed follows v = 2t^2 and v = 1 - 2(1-t)^2. Peak acceleration of the curve is twice the
+// average one, so the ramp of D regions takes PROFILE_RAMP_LENGTH * D region changes to keep the peak at the standard
+// acceleration. Then the ramp passes the region i^2 / 2D after change i of the first half, so the region is tracked by
+// the integer sum of the increments 1, 3, 5 ... 2D-1, 2D-1 ... 3, 1 in the units of 1/2D region. The sum is rounded
+// to the nearest region, the increment is less than a region and the timer interrupt does no multiplication or division.
+// The curve is symmetric, so the ramp passes PROFILE_RAMP_LENGTH times the distance of the linear one
+#define PROFILE_RAMP_LENGTH 2
+
+typedef struct
+{
+    uint32_t changes;       // region changes left till the end of the ramp
+    uint32_t half;          // changes left at the middle of the ramp
+    int32_t  increment;     // part of the region added by the next change, 1/2D units
+    uint32_t sum;           // part of the region passed since the last region change, 1/2D units
+    uint32_t region_size;   // 2D
+} ProfileRamp;
+
+/// <summary>
+/// Starts the S-curve ramp by the given number of regions
+/// </summary>
+/// <param name="ramp">ramp to be started</param>
+/// <param name="regions">difference between the current and the target region</param>
+void ProfileStartRamp(ProfileRamp* ramp, uint32_t regions);
+
+/// <summary>
+/// Moves the S-curve ramp to the next region change, it is called by the timer interrupt
+/// </summary>
+/// <param name="ramp">started ramp</param>
+/// <returns>true if the ramp passes to the next region, false if the region is kept or the ramp is over</returns>
+bool ProfileNextChange(ProfileRamp* ramp);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,115 @@
+#include "printer_pipeline.h"
+
+#include <string.h>
+
+// collinear move is kept pending till the next command shows if it continues the move
+static void coalesceCommand(CommandPipeline* pipeline, uint8_t* command)
+{
+    if (pipeline->has_pending && CoalescerMerge(&pipeline->coalescer, pipeline->pending, command))
+    {
+        return;
+    }
+    if (pipeline->has_pending)
+    {
+        pipeline->has_pending = false;
+        pipeline->store(pipeline->pending, pipeline->parameter);
+    }
+
+    // start point of the move is known after all previous commands are stored
+    if (CoalescerStart(&pipeline->coalescer, pipeline->previous_point, command))
+    {
+        memcpy(pipeline->pending, command, GCODE_CHUNK_SIZE);
+        pipeline->has_pending = true;
+    }
+    else
+    {
+        pipeline->store(command, pipeline->parameter);
+    }
+}
+
+static void flushSimplifier(CommandPipeline* pipeline)
+{
+    uint8_t kept = SimplifierFlush(&pipeline->simplifier);
+    for (uint8_t i = 0; i < kept; ++i)
+    {
+        coalesceCommand(pipeline, pipeline->simplifier.window + i * GCODE_CHUNK_SIZE);
+    }
+}
+
+// moves are buffered by the simplifier, kept ones are passed to the coalescer
+static void simplifyCommand(CommandPipeline* pipeline, uint8_t* command)
+{
+    SIMPLIFIER_RESULT result = SimplifierAppend(&pipeline->simplifier, command);
+    if (SIMPLIFIER_BUFFERED == result)
+    {
+        return;
+    }
+
+    flushSimplifier(pipeline);
+    if (SIMPLIFIER_BREAK == result)
+    {
+        SimplifierAppend(&pipeline->simplifier, command);
+    }
+    else
+    {
+        coalesceCommand(pipeline, command);
+    }
+}
+
+static void flushHeating(CommandPipeline* pipeline)
+{
+    uint8_t count = HeatingFlush(&pipeline->heating);
+    for (uint8_t i = 0; i < count; ++i)
+    {
+        simplifyCommand(pipeline, pipeline->heating.waits[i]);
+    }
+}
+
+void PipelineReset(CommandPipeline* pipeline, const CommandPipelineConfig* config)
+{
+    HeatingReset(&pipeline->heating, config->overlap_heating);
+    SimplifierReset(&pipeline->simplifier, config->window, config->simplification_tolerance);
+    CoalescerReset(&pipeline->coalescer, config->axis_config, config->coalescing_tolerance);
+    pipeline->has_pending    = false;
+    pipeline->pass_through   = !config->overlap_heating && 0 == config->simplification_tolerance &&
+                               0 == config->coalescing_tolerance;
+    pipeline->previous_point = config->previous_point;
+    pipeline->store          = config->store;
+    pipeline->parameter      = config->parameter;
+}
+
+bool PipelineIsPassThrough(const CommandPipeline* pipeline)
+{
+    return pipeline->pass_through;
+}
+
+// waits for the heaters of the preamble are deferred, other commands are passed to the simplifier
+void PipelineAppend(CommandPipeline* pipeline, uint8_t* command)
+{
+    HEATING_RESULT result = HeatingAppend(&pipeline->heating, command);
+    if (HEATING_DEFERRED == result)
+    {
+        return;
+    }
+
+    if (HEATING_BREAK == result)
+    {
+        flushHeating(pipeline);
+        result = HeatingAppend(&pipeline->heating, command);
+    }
+    if (HEATING_PASS == result)
+    {
+        simplifyCommand(pipeline, command);
+    }
+}
+
+void PipelineFlush(CommandPipeline* pipeline)
+{
+    flushHeating(pipeline);
+    flushSimplifier(pipeline);
+    if (pipeline->has_pending)
+    {
+        pipeline->has_pending = false;
+        pipeline->store(pipeline->pending, pipeline->parameter);
+    }
+}
@@ -0,0 +1,79 @@
+#include "main.h"
+#include "printer_entities.h"
+#include "printer_coalescer.h"
+#include "printer_simplifier.h"
+#include "printer_heating.h"
+
+#include <stdbool.h>
+
+#ifndef __PRINTER_PIPELINE__
+#define __PRINTER_PIPELINE__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// receives the processed command, the command is stored in the order of the file
+typedef void(*PipelineStoreFunction)(uint8_t* command, void* parameter);
+
+// Passes of the compiled commands before they are stored. The order is fixed: waits of the heaters are deferred
+// by the heating scheduler, dense paths are simplified, collinear moves are merged by the coalescer and the result
+// is stored. The file manager and the host compilers share the pipeline, so their images are the same
+typedef struct
+{
+    HeatingScheduler    heating;
+    PathSimplifier      simplifier;
+    MoveCoalescer       coalescer;
+    uint8_t             pending[GCODE_CHUNK_SIZE];  // the last move of the coalesced run
+    bool                has_pending;
+    bool                pass_through;               // every pass is disabled
+
+    const GCodeCommandParams* previous_point;       // end point of the last stored move, it is updated by the store
+    PipelineStoreFunction     store;
+    void*                     parameter;
+} CommandPipeline;
+
+typedef struct
+{
+    const GCodeAxisConfig*    axis_config;
+    uint8_t*                  window;               // SIMPLIFIER_WINDOW commands buffer of the simplifier
+    float                     simplification_tolerance;
+    float                     coalescing_tolerance;
+    bool                      overlap_heating;
+    const GCodeCommandParams* previous_point;
+    PipelineStoreFunction     store;
+    void*                     parameter;
+} CommandPipelineConfig;
+
+/// <summary>
+/// Prepares pipeline for the new file
+/// </summary>
+/// <param name="pipeline">pipeline to be reset</param>
+/// <param name="config">passes settings and the store function</param>
+void PipelineReset(CommandPipeline* pipeline, const CommandPipelineConfig* config);
+
+/// <summary>
+/// Checks if the commands are stored as is, so they can be compiled directly into the storage
+/// </summary>
+/// <param name="pipeline">command pipeline</param>
+/// <returns>true if every pass is disabled</returns>
+bool PipelineIsPassThrough(const CommandPipeline* pipeline);
+
+/// <summary>
+/// Appends the next command of the file, the command can be changed in place
+/// </summary>
+/// <param name="pipeline">command pipeline</param>
+/// <param name="command">command in the GCODE_CHUNK_SIZE format</param>
+void PipelineAppend(CommandPipeline* pipeline, uint8_t* command);
+
+/// <summary>
+/// Stores the commands kept by the passes, has to be called at the end of the file
+/// </summary>
+/// <param name="pipeline">command pipeline</param>
+void PipelineFlush(CommandPipeline* pipeline);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__PRINTER_PIPELINE__
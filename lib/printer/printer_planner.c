@@ -0,0 +1,161 @@
+#include "printer_planner.h"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+// junctions closer to the straight line or to the reversal are not calculated
+#define JUNCTION_COS_LIMIT 0.999999f
+
+static PlannerSegment* segmentAt(MotionPlanner* planner, uint8_t index)
+{
+    return &planner->segments[(planner->first + index) % PLANNER_WINDOW];
+}
+
+static float minimum(float a, float b)
+{
+    return a < b ? a : b;
+}
+
+static float maximum(float a, float b)
+{
+    return a > b ? a : b;
+}
+
+// converts planned speed to the fetch speed units, speed cannot be lower than the start speed of the segment
+static uint16_t storedSpeed(const PlannerSegment* segment, float speed_sqr)
+{
+    float speed = sqrtf(maximum(speed_sqr, segment->minimal_sqr)) * SECONDS_IN_MINUTE + 0.5f;
+    return (speed < segment->fetch_speed) ? (uint16_t)speed : segment->fetch_speed;
+}
+
+static void storeSpeeds(MotionPlanner* planner)
+{
+    for (uint8_t i = 0; i < planner->count; ++i)
+    {
+        PlannerSegment* segment = segmentAt(planner, i);
+        float exit_sqr = (i + 1 < planner->count) ? segmentAt(planner, i + 1)->entry_sqr : segment->minimal_sqr;
+        uint16_t speeds[2] = { storedSpeed(segment, segment->entry_sqr), storedSpeed(segment, exit_sqr) };
+        memcpy(segment->speeds, speeds, sizeof(speeds));
+    }
+}
+
+// entry speed of the first segment is final. The others are limited by the braking till the stop
+// at the end of the window and by the acceleration from the first segment
+static void replan(MotionPlanner* planner)
+{
+    float next_entry_sqr = segmentAt(planner, planner->count - 1)->minimal_sqr;
+    for (uint8_t i = planner->count - 1; i > 0; --i)
+    {
+        PlannerSegment* segment = segmentAt(planner, i);
+        segment->entry_sqr = minimum(segment->max_entry_sqr, next_entry_sqr + 2.0f * STANDARD_ACCELERATION * segment->distance);
+        next_entry_sqr = segment->entry_sqr;
+    }
+
+    for (uint8_t i = 1; i < planner->count; ++i)
+    {
+        PlannerSegment* previous = segmentAt(planner, i - 1);
+        PlannerSegment* segment  = segmentAt(planner, i);
+        segment->entry_sqr = minimum(segment->entry_sqr, previous->entry_sqr + 2.0f * STANDARD_ACCELERATION * previous->distance);
+    }
+
+    storeSpeeds(planner);
+}
+
+// max speed of the corner by the junction deviation: the head passes the arc that touches both segments
+// and deviates from the corner by JUNCTION_DEVIATION, with the centripetal acceleration equal to the standard one
+static float junctionSpeed(const float* previous_direction, const float* direction)
+{
+    float cos_theta = 0;
+    for (uint8_t i = 0; i < MOTOR_COUNT; ++i)
+    {
+        cos_theta -= previous_direction[i] * direction[i];
+    }
+
+    if (cos_theta > JUNCTION_COS_LIMIT)
+    {
+        return 0; // reversal
+    }
+    if (cos_theta < -JUNCTION_COS_LIMIT)
+    {
+        return FLT_MAX; // straight line
+    }
+
+    float sin_half_theta = sqrtf(0.5f * (1.0f - cos_theta));
+    return STANDARD_ACCELERATION * JUNCTION_DEVIATION * sin_half_theta / (1.0f - sin_half_theta);
+}
+
+void PlannerReset(MotionPlanner* planner, const GCodeAxisConfig* axis_cfg)
+{
+    memset(planner, 0, sizeof(MotionPlanner));
+    planner->axis_config = *axis_cfg;
+}
+
+void PlannerAddSegment(MotionPlanner* planner, const GCodeCommandParams* segment, uint32_t segment_time, uint8_t* speeds)
+{
+    float direction[MOTOR_COUNT] = {
+        (float)segment->x / planner->axis_config.x_steps_per_mm,
+        (float)segment->y / planner->axis_config.y_steps_per_mm,
+        (float)segment->z / planner->axis_config.z_steps_per_mm,
+        (float)segment->e / planner->axis_config.e_steps_per_mm,
+    };
+    float length = sqrtf(direction[MOTOR_X] * direction[MOTOR_X] + direction[MOTOR_Y] * direction[MOTOR_Y] +
+                         direction[MOTOR_Z] * direction[MOTOR_Z] + direction[MOTOR_E] * direction[MOTOR_E]);
+    for (uint8_t i = 0; length > 0 && i < MOTOR_COUNT; ++i)
+    {
+        direction[i] /= length;
+    }
+
+    if (PLANNER_WINDOW == planner->count)
+    {
+        planner->first = (planner->first + 1) % PLANNER_WINDOW;
+        --planner->count;
+    }
+
+    float fetch_speed   = (float)segment->fetch_speed / SECONDS_IN_MINUTE;
+    float minimal_speed = minimum(fetch_speed, (float)MINIMAL_VELOCITY / SECONDS_IN_MINUTE);
+
+    PlannerSegment* current = segmentAt(planner, planner->count);
+    current->speeds        = speeds;
+    current->fetch_speed   = (uint16_t)segment->fetch_speed;
+    current->distance      = fetch_speed * segment_time / MAIN_TIMER_FREQUENCY;
+    current->nominal_sqr   = fetch_speed * fetch_speed;
+    current->minimal_sqr   = minimal_speed * minimal_speed;
+    current->max_entry_sqr = current->minimal_sqr;
+
+    if (planner->count)
+    {
+        const PlannerSegment* previous = segmentAt(planner, planner->count - 1);
+        float junction_sqr = minimum(junctionSpeed(planner->direction, direction), minimum(previous->nominal_sqr, current->nominal_sqr));
+        current->max_entry_sqr = maximum(junction_sqr, minimum(previous->minimal_sqr, current->minimal_sqr));
+    }
+    current->entry_sqr = current->max_entry_sqr;
+
+    memcpy(planner->direction, direction, sizeof(direction));
+    ++planner->count;
+    replan(planner);
+}
+
+void PlannerSetLocation(MotionPlanner* planner, uint8_t* speeds)
+{
+    if (planner->count)
+    {
+        segmentAt(planner, planner->count - 1)->speeds = speeds;
+    }
+}
+
+uint8_t PlannerRelease(MotionPlanner* planner, const uint8_t* begin, const uint8_t* end)
+{
+    while (planner->count && (segmentAt(planner, 0)->speeds < begin || segmentAt(planner, 0)->speeds >= end))
+    {
+        planner->first = (planner->first + 1) % PLANNER_WINDOW;
+        --planner->count;
+    }
+    return planner->count;
+}
+
+void PlannerStop(MotionPlanner* planner)
+{
+    planner->first = 0;
+    planner->count = 0;
+}
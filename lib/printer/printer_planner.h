@@ -0,0 +1,79 @@
+#include "main.h"
+#include "printer_entities.h"
+
+#include <stdbool.h>
+
+#ifndef __PRINTER_PLANNER__
+#define __PRINTER_PLANNER__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Segment of the planning window. Speeds are squared and kept in mm/sec, as the acceleration is
+typedef struct
+{
+    uint8_t* speeds;        // position of the entry and exit speeds of the segment in the storage
+    float    distance;      // distance passed with the fetch speed, mm
+    float    nominal_sqr;   // fetch speed of the segment
+    float    minimal_sqr;   // speed the head can start or stop with
+    float    max_entry_sqr; // entry speed limited by the corner between the previous and this segment
+    float    entry_sqr;     // planned entry speed
+    uint16_t fetch_speed;   // mm/min
+} PlannerSegment;
+
+// Look ahead planner of the trapezoidal velocity profiles. It is used at the file translation time,
+// planned entry and exit speeds are written directly into the stored commands
+typedef struct
+{
+    GCodeAxisConfig axis_config;
+    PlannerSegment  segments[PLANNER_WINDOW];
+    uint8_t         first;
+    uint8_t         count;
+    float           direction[MOTOR_COUNT]; // unit vector of the last added segment
+} MotionPlanner;
+
+/// <summary>
+/// Prepares planner for the new file. The head is stopped
+/// </summary>
+/// <param name="planner">planner to be reset</param>
+/// <param name="axis_cfg">steps per mm of each axis, used to get the directions of segments</param>
+void PlannerReset(MotionPlanner* planner, const GCodeAxisConfig* axis_cfg);
+
+/// <summary>
+/// Adds segment to the end of the window and replans the window. Plan always ends with the stop of the head,
+/// so every stored segment has valid speeds even if no more segments will come.
+/// </summary>
+/// <param name="planner">motion planner</param>
+/// <param name="segment">difference between the end and the start points of the segment in steps, with fetch speed</param>
+/// <param name="segment_time">time to complete the segment with the fetch speed, should be nonzero</param>
+/// <param name="speeds">position of entry_speed and exit_speed of the segment, updated by every replanning</param>
+void PlannerAddSegment(MotionPlanner* planner, const GCodeCommandParams* segment, uint32_t segment_time, uint8_t* speeds);
+
+/// <summary>
+/// Changes position of the speeds of the last added segment, when the command is moved to another place of the storage
+/// </summary>
+/// <param name="planner">motion planner</param>
+/// <param name="speeds">new position of the speeds</param>
+void PlannerSetLocation(MotionPlanner* planner, uint8_t* speeds);
+
+/// <summary>
+/// Finalizes segments that are stored outside of the memory range, their speeds will not be changed anymore
+/// </summary>
+/// <param name="planner">motion planner</param>
+/// <param name="begin">start of the memory that can be still updated</param>
+/// <param name="end">end of the memory that can be still updated</param>
+/// <returns>number of segments remaining in the window</returns>
+uint8_t PlannerRelease(MotionPlanner* planner, const uint8_t* begin, const uint8_t* end);
+
+/// <summary>
+/// Finalizes all segments, the head stops at the end of the last segment
+/// </summary>
+/// <param name="planner">motion planner</param>
+void PlannerStop(MotionPlanner* planner);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__PRINTER_PLANNER__
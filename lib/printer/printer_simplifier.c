@@ -0,0 +1,161 @@
+#include "printer_simplifier.h"
+
+#include <math.h>
+#include <string.h>
+
+static bool isMove(const uint8_t* command)
+{
+    return (*(const parameterType*)command & GCODE_COMMAND) && GCODE_MOVE == command[0];
+}
+
+static const GCodeCommandParams* movePoint(const uint8_t* command)
+{
+    return (const GCodeCommandParams*)(command + sizeof(parameterType));
+}
+
+// point 0 is the start of the path, point i is the end of the i-th buffered move
+static const GCodeCommandParams* pathPoint(const PathSimplifier* simplifier, uint8_t index)
+{
+    return index ? movePoint(simplifier->window + (index - 1) * GCODE_CHUNK_SIZE) : &simplifier->start;
+}
+
+static int8_t extrusionSign(const GCodeCommandParams* from, const GCodeCommandParams* to)
+{
+    return (to->e > from->e) - (to->e < from->e);
+}
+
+// distance of the point from the segment in XYZ steps
+static float deviation(const GCodeCommandParams* a, const GCodeCommandParams* b, const GCodeCommandParams* point)
+{
+    float segment[3] = { (float)(b->x - a->x), (float)(b->y - a->y), (float)(b->z - a->z) };
+    float offset[3]  = { (float)(point->x - a->x), (float)(point->y - a->y), (float)(point->z - a->z) };
+
+    float length_sqr = segment[0] * segment[0] + segment[1] * segment[1] + segment[2] * segment[2];
+    float t = (length_sqr > 0) ? (offset[0] * segment[0] + offset[1] * segment[1] + offset[2] * segment[2]) / length_sqr : 0;
+    t = (t < 0) ? 0 : ((t > 1) ? 1 : t);
+
+    float distance_sqr = 0;
+    for (uint8_t i = 0; i < 3; ++i)
+    {
+        float d = offset[i] - t * segment[i];
+        distance_sqr += d * d;
+    }
+    return sqrtf(distance_sqr);
+}
+
+// the move continues the path if it has the same speed and extrudes, travels or retracts as the first move of the path
+static bool continuesPath(const PathSimplifier* simplifier, const GCodeCommandParams* point)
+{
+    const GCodeCommandParams* first = pathPoint(simplifier, 1);
+    return point->fetch_speed == first->fetch_speed &&
+        extrusionSign(&simplifier->position, point) == extrusionSign(&simplifier->start, first);
+}
+
+void SimplifierReset(PathSimplifier* simplifier, uint8_t* window, float tolerance)
+{
+    memset(simplifier, 0, sizeof(PathSimplifier));
+    simplifier->window    = window;
+    simplifier->tolerance = tolerance;
+}
+
+SIMPLIFIER_RESULT SimplifierAppend(PathSimplifier* simplifier, const uint8_t* command)
+{
+    if (simplifier->tolerance <= 0)
+    {
+        return SIMPLIFIER_BYPASS;
+    }
+    if (!isMove(command))
+    {
+        // home and set commands change the position
+        simplifier->has_position = false;
+        return SIMPLIFIER_BYPASS;
+    }
+
+    const GCodeCommandParams* point = movePoint(command);
+    if (!simplifier->has_position)
+    {
+        // the move without known start point can only start the path
+        simplifier->position     = *point;
+        simplifier->has_position = true;
+        return SIMPLIFIER_BYPASS;
+    }
+    if (simplifier->count && (SIMPLIFIER_WINDOW == simplifier->count || !continuesPath(simplifier, point)))
+    {
+        return SIMPLIFIER_BREAK;
+    }
+
+    if (!simplifier->count)
+    {
+        simplifier->start = simplifier->position;
+    }
+    memcpy(simplifier->window + simplifier->count * GCODE_CHUNK_SIZE, command, GCODE_CHUNK_SIZE);
+    ++simplifier->count;
+    simplifier->position = *point;
+    return SIMPLIFIER_BUFFERED;
+}
+
+uint8_t SimplifierFlush(PathSimplifier* simplifier)
+{
+    uint8_t count = simplifier->count;
+    if (!count)
+    {
+        return 0;
+    }
+
+    // Douglas-Peucker without recursion: ranges between the kept points are split by the farthest point
+    uint32_t keep = 1U << count;
+    uint8_t ranges[SIMPLIFIER_WINDOW][2];
+    uint8_t top = 0;
+    ranges[top][0] = 0;
+    ranges[top][1] = count;
+    ++top;
+    while (top)
+    {
+        --top;
+        uint8_t first = ranges[top][0];
+        uint8_t last  = ranges[top][1];
+
+        float max_deviation = 0;
+        uint8_t farthest = 0;
+        for (uint8_t i = first + 1; i < last; ++i)
+        {
+            float d = deviation(pathPoint(simplifier, first), pathPoint(simplifier, last), pathPoint(simplifier, i));
+            if (d > max_deviation)
+            {
+                max_deviation = d;
+                farthest      = i;
+            }
+        }
+
+        if (max_deviation > simplifier->tolerance)
+        {
+            keep |= 1U << farthest;
+            ranges[top][0] = first;
+            ranges[top][1] = farthest;
+            ++top;
+            ranges[top][0] = farthest;
+            ranges[top][1] = last;
+            ++top;
+        }
+        else if (max_deviation > simplifier->max_deviation)
+        {
+            simplifier->max_deviation = max_deviation;
+        }
+    }
+
+    // E of the kept move is absolute, so it covers extrusion of the dropped moves before it
+    uint8_t kept = 0;
+    for (uint8_t i = 1; i <= count; ++i)
+    {
+        if (keep & (1U << i))
+        {
+            if (kept != i - 1)
+            {
+                memcpy(simplifier->window + kept * GCODE_CHUNK_SIZE, simplifier->window + (i - 1) * GCODE_CHUNK_SIZE, GCODE_CHUNK_SIZE);
+            }
+            ++kept;
+        }
+    }
+    simplifier->count = 0;
+    return kept;
+}
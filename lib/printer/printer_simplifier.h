@@ -0,0 +1,65 @@
+#include "main.h"
+#include "printer_entities.h"
+
+#include <stdbool.h>
+
+#ifndef __PRINTER_SIMPLIFIER__
+#define __PRINTER_SIMPLIFIER__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// amount of moves simplified at once, the window takes one 512 bytes memory page
+#define SIMPLIFIER_WINDOW 16U
+
+// Streaming Douglas-Peucker simplification of dense paths. Moves of the same kind are buffered in the window,
+// the window is simplified when the path is broken or the window is full. Points deviating from the simplified
+// path by no more than the tolerance are dropped. E is absolute, so the kept move extrudes the filament of
+// all dropped moves before it and the total extrusion of the path is preserved
+typedef struct
+{
+    uint8_t*           window;          // buffered move commands, GCODE_CHUNK_SIZE each
+    float              tolerance;       // steps, 0 disables simplification
+    uint8_t            count;           // amount of buffered moves
+    bool               has_position;    // position of the head is known, i.e. the last command is a move
+    GCodeCommandParams start;           // position of the head before the first buffered move
+    GCodeCommandParams position;        // position of the head after the last seen move
+    float              max_deviation;   // steps, the largest deviation of the dropped point
+} PathSimplifier;
+
+typedef enum
+{
+    SIMPLIFIER_BUFFERED = 0,    // the move is buffered in the window
+    SIMPLIFIER_BREAK,           // the window has to be flushed before the command and the command is appended again
+    SIMPLIFIER_BYPASS,          // the window has to be flushed before the command and the command is stored as is
+} SIMPLIFIER_RESULT;
+
+/// <summary>
+/// Prepares simplifier for the new file
+/// </summary>
+/// <param name="simplifier">simplifier to be reset</param>
+/// <param name="window">memory page for the buffered moves, SIMPLIFIER_WINDOW commands</param>
+/// <param name="tolerance">max deviation of the dropped points from the simplified path in steps, 0 disables simplification</param>
+void SimplifierReset(PathSimplifier* simplifier, uint8_t* window, float tolerance);
+
+/// <summary>
+/// Appends the command to the buffered path
+/// </summary>
+/// <param name="simplifier">path simplifier</param>
+/// <param name="command">command in the GCODE_CHUNK_SIZE format</param>
+/// <returns>SIMPLIFIER_BUFFERED if the command shouldn't be stored, otherwise the window has to be flushed first</returns>
+SIMPLIFIER_RESULT SimplifierAppend(PathSimplifier* simplifier, const uint8_t* command);
+
+/// <summary>
+/// Simplifies the buffered path, kept moves are moved to the beginning of the window and have to be stored in order
+/// </summary>
+/// <param name="simplifier">path simplifier</param>
+/// <returns>amount of kept moves, the window is empty after the call</returns>
+uint8_t SimplifierFlush(PathSimplifier* simplifier);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__PRINTER_SIMPLIFIER__
@@ -27,7 +27,8 @@
 #include "sdcard.h"
 #include "touch.h"
 #include "termal_regulator.h"
-#include "motor.h"
+#include "adc_sampler.h"
+#include "stepper_group.h"
 
 #include "printer.h"
 #include "printer_memory_manager.h"
@@ -42,6 +43,12 @@
 
 /* Private define ------------------------------------------------------------*/
 /* USER CODE BEGIN PD */
+// ADC is triggered by TIM3 update, so the regular sequence is converted at MAIN_TIMER_FREQUENCY
+// regular sequences in each half of the circular DMA buffer
+#define ADC_SEQUENCES 64
+// sequences summed to one value of the channel, ~2.4 values per second reach the termal regulators.
+// The regulators don't average the values again, so each value is one update of the control
+#define ADC_DECIMATION 4096
 /* USER CODE END PD */
 
 /* Private macro -------------------------------------------------------------*/
@@ -62,6 +69,7 @@ TIM_HandleTypeDef htim3;
 /* USER CODE BEGIN PV */
 Application g_app = {0};
 PrinterConfiguration printer_cfg = {0};
+static uint16_t s_adc_buffer[2 * ADC_SEQUENCES * TERMO_REGULATOR_COUNT];
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
@@ -87,10 +95,21 @@ void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef* htim)
   OnTimer(g_app.hprinter);
 }
 
+// ranks of the regular sequence match the termo regulators. The regulators apply the targets set by
+// the main loop and the timer interrupt with the next value, so the values are passed at the fixed rate
+void OnADCSample(uint8_t channel, uint16_t value, void* parameter)
+{
+  ReadADCValue(g_app.hprinter, (TERMO_REGULATOR)channel, value);
+}
+
+void HAL_ADC_ConvHalfCpltCallback(ADC_HandleTypeDef* hadc)
+{
+  SAMPLER_HandleHalfTransfer(g_app.hsampler);
+}
+
 void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef* hadc)
 {
-    HAL_ADC_Stop_DMA(hadc); 
-    g_app.flag = 1;
+  SAMPLER_HandleTransfer(g_app.hsampler);
 }
 
 /* USER CODE END PFP */
@@ -144,6 +163,10 @@ int main(void)
   HSPIBUS ram_spi   = SPIBUS_Configure(&hspi3, HAL_MAX_DELAY);
 
   MemoryManagerConfigure(&printer_cfg.memory_manager);
+  // all pages except the printer state page are used to prefetch commands during printing
+  printer_cfg.prefetch_pages = MEMORY_PAGES_COUNT - 1;
+  // commands are decoded by the main loop, timer interrupt only starts prepared motion
+  printer_cfg.motion_blocks = MOTION_BLOCKS_COUNT;
   
   // Enable both SDCARDs, external and internal
   printer_cfg.storages[STORAGE_EXTERNAL] = SDCARD_Configure(main_spi, SDCARD_SELECT_GPIO_Port, SDCARD_SELECT_Pin);
@@ -187,50 +210,29 @@ int main(void)
   }
 
   // Enable motors
-  MotorConfig x_motor = 
-  {
-    PULSE_LOWER,
-    X_STEP_GPIO_Port, X_STEP_Pin,
-    X_DIR_GPIO_Port,  X_DIR_Pin,
-  };
-  printer_cfg.motors[MOTOR_X] = MOTOR_Configure(&x_motor);
-
-  MotorConfig y_motor = 
-  {
-    PULSE_LOWER,
-    Y_STEP_GPIO_Port, Y_STEP_Pin,
-    Y_DIR_GPIO_Port,  Y_DIR_Pin,
-  };
-  printer_cfg.motors[MOTOR_Y] = MOTOR_Configure(&y_motor);
-
-  MotorConfig z_motor = 
-  {
-    PULSE_LOWER,
-    Z_STEP_GPIO_Port, Z_STEP_Pin,
-    Z_DIR_GPIO_Port,  Z_DIR_Pin,
-  };
-  printer_cfg.motors[MOTOR_Z] = MOTOR_Configure(&z_motor);
-
-  MotorConfig extruder = 
+  MotorConfig motors[MOTOR_COUNT] = 
   {
-    PULSE_LOWER,
-    E_STEP_GPIO_Port, E_STEP_Pin,
-    E_DIR_GPIO_Port,  E_DIR_Pin,
+    { PULSE_LOWER, X_STEP_GPIO_Port, X_STEP_Pin, X_DIR_GPIO_Port, X_DIR_Pin },
+    { PULSE_LOWER, Y_STEP_GPIO_Port, Y_STEP_Pin, Y_DIR_GPIO_Port, Y_DIR_Pin },
+    { PULSE_LOWER, Z_STEP_GPIO_Port, Z_STEP_Pin, Z_DIR_GPIO_Port, Z_DIR_Pin },
+    { PULSE_LOWER, E_STEP_GPIO_Port, E_STEP_Pin, E_DIR_GPIO_Port, E_DIR_Pin },
   };
-  printer_cfg.motors[MOTOR_E] = MOTOR_Configure(&extruder);
+  printer_cfg.steppers = STEPPERGROUP_Configure(motors, MOTOR_COUNT);
 
   // Enable termal sensors
   TermalRegulatorConfig nozzle_cfg = 
   { 
     NOZZLE_HEAT_RELEY_GPIO_Port, NOZZLE_HEAT_RELEY_Pin, 
     GPIO_PIN_SET, GPIO_PIN_RESET,
-    0.467, -1065
+    0.467, -1065,
+    0, 0, 1
   };
   TermalRegulatorConfig table_cfg  = 
   { 
     TABLE_HEAT_RELEY_GPIO_Port, TABLE_HEAT_RELEY_Pin, 
-    GPIO_PIN_RESET, GPIO_PIN_SET,   
-    -0.033, 142
+    GPIO_PIN_SET, GPIO_PIN_RESET,   
+    -0.033, 142,
+    0, 0, 1
   };
 
   printer_cfg.termal_regulators[TERMO_NOZZLE] = TR_Configure(&nozzle_cfg);
@@ -242,8 +244,12 @@ int main(void)
 
   g_app.hprinter = Configure(&printer_cfg);
 
-  // Enable ADC DMA and Timer
-  HAL_ADC_Start_DMA(&hadc1, (uint32_t*)g_app.voltage, 2);
+  // Enable ADC DMA and Timer. Temperatures are sampled continuously by the circular DMA and
+  // passed to the printer from the DMA interrupt
+  AdcSamplerConfig sampler_cfg = { &hadc1, s_adc_buffer, ADC_SEQUENCES, TERMO_REGULATOR_COUNT,
+                                   ADC_DECIMATION, 0, OnADCSample, 0 };
+  g_app.hsampler = SAMPLER_Configure(&sampler_cfg);
+  SAMPLER_Start(g_app.hsampler);
   // Timer controls main motor controlling thread.
   HAL_TIM_Base_Start_IT(&htim3);
   /* USER CODE END 2 */
@@ -256,14 +262,6 @@ int main(void)
     /* USER CODE END WHILE */
 
     /* USER CODE BEGIN 3 */
-    if (g_app.flag)
-    {
-      ReadADCValue(g_app.hprinter, TERMO_NOZZLE, g_app.voltage[0]);
-      ReadADCValue(g_app.hprinter, TERMO_TABLE, g_app.voltage[1]);
-      g_app.flag = 0;
-      HAL_ADC_Start_DMA(&hadc1, (uint32_t*)g_app.voltage, 2);
-    }
-    HAL_Delay(10);
   }
   /* USER CODE END 3 */
 }
@@ -337,11 +335,11 @@ static void MX_ADC1_Init(void)
   hadc1.Init.ScanConvMode = ENABLE;
   hadc1.Init.ContinuousConvMode = DISABLE;
   hadc1.Init.DiscontinuousConvMode = DISABLE;
-  hadc1.Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_NONE;
-  hadc1.Init.ExternalTrigConv = ADC_SOFTWARE_START;
+  hadc1.Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_RISING;
+  hadc1.Init.ExternalTrigConv = ADC_EXTERNALTRIGCONV_T3_TRGO;
   hadc1.Init.DataAlign = ADC_DATAALIGN_RIGHT;
   hadc1.Init.NbrOfConversion = 2;
-  hadc1.Init.DMAContinuousRequests = DISABLE;
+  hadc1.Init.DMAContinuousRequests = ENABLE;
   hadc1.Init.EOCSelection = ADC_EOC_SINGLE_CONV;
   if (HAL_ADC_Init(&hadc1) != HAL_OK)
   {
@@ -517,7 +515,7 @@ static void MX_TIM3_Init(void)
   {
     Error_Handler();
   }
-  sMasterConfig.MasterOutputTrigger = TIM_TRGO_RESET;
+  sMasterConfig.MasterOutputTrigger = TIM_TRGO_UPDATE;
   sMasterConfig.MasterSlaveMode = TIM_MASTERSLAVEMODE_DISABLE;
   if (HAL_TIMEx_MasterConfigSynchronization(&htim3, &sMasterConfig) != HAL_OK)
   {